@@ -0,0 +1,201 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/actor/act_tracer.h"
+#include "oneflow/core/persistence/persistent_in_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+std::atomic<int64_t> act_tracer_uid(0);
+
+std::string EscapeJsonString(const std::string& str) {
+  std::string ret;
+  for (char c : str) {
+    if (c == '"' || c == '\\') { ret.push_back('\\'); }
+    ret.push_back(c);
+  }
+  return ret;
+}
+
+}  // namespace
+
+ActTracer::ActTracer(int64_t sample_interval, int64_t ring_buffer_size, int64_t flush_interval_ms,
+                     const std::function<void(const ActTraceEvent*, size_t)>& FlushEvents)
+    : uid_(act_tracer_uid++),
+      sample_interval_(sample_interval),
+      ring_buffer_size_(ring_buffer_size),
+      FlushEvents_(FlushEvents),
+      stopped_(false) {
+  CHECK_GT(sample_interval, 0);
+  CHECK_GT(ring_buffer_size, 0);
+  flush_thread_ = std::thread([this, flush_interval_ms]() {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (!stopped_) {
+      stop_cond_.wait_for(lock, std::chrono::milliseconds(flush_interval_ms));
+      Drain();
+    }
+  });
+}
+
+ActTracer::~ActTracer() {
+  {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    stopped_ = true;
+  }
+  stop_cond_.notify_one();
+  flush_thread_.join();
+  // the recording threads are gone by now, whatever they left behind is drained here
+  Drain();
+  const int64_t num_dropped = num_dropped_events();
+  if (num_dropped > 0) {
+    LOG(WARNING) << "ActTracer dropped " << num_dropped
+                 << " events, increase the ring buffer size or the sample interval";
+  }
+}
+
+ActTracer::RingBuffer* ActTracer::ThisThreadRingBuffer() {
+  // a thread may outlive a tracer and record into the next one, hence the uid
+  thread_local int64_t tracer_uid = -1;
+  thread_local RingBuffer* ring_buffer = nullptr;
+  if (tracer_uid != uid_) {
+    std::unique_lock<std::mutex> lock(ring_buffers_mutex_);
+    ring_buffers_.emplace_back(new RingBuffer(ring_buffer_size_));
+    ring_buffer = ring_buffers_.back().get();
+    tracer_uid = uid_;
+  }
+  return ring_buffer;
+}
+
+void ActTracer::Record(int64_t actor_id, int64_t act_id, ActTracePhase phase) {
+  RingBuffer* ring_buffer = ThisThreadRingBuffer();
+  const uint64_t head = ring_buffer->head.load(std::memory_order_relaxed);
+  if (head - ring_buffer->tail.load(std::memory_order_acquire) == ring_buffer_size_) {
+    ring_buffer->num_dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ActTraceEvent* event = &ring_buffer->events[head % ring_buffer_size_];
+  event->actor_id = actor_id;
+  event->act_id = act_id;
+  event->phase = phase;
+  event->time = GetCurTime();
+  ring_buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void ActTracer::Drain() {
+  // ring buffers live as long as the tracer, so FlushEvents runs without holding up the threads
+  // which record for the first time
+  std::vector<RingBuffer*> ring_buffers;
+  {
+    std::unique_lock<std::mutex> lock(ring_buffers_mutex_);
+    for (const auto& ring_buffer : ring_buffers_) { ring_buffers.push_back(ring_buffer.get()); }
+  }
+  for (RingBuffer* ring_buffer : ring_buffers) {
+    const uint64_t tail = ring_buffer->tail.load(std::memory_order_relaxed);
+    const uint64_t head = ring_buffer->head.load(std::memory_order_acquire);
+    if (head == tail) { continue; }
+    drained_.clear();
+    FOR_RANGE(uint64_t, i, tail, head) {
+      drained_.push_back(ring_buffer->events[i % ring_buffer_size_]);
+    }
+    ring_buffer->tail.store(head, std::memory_order_release);
+    FlushEvents_(drained_.data(), drained_.size());
+  }
+}
+
+int64_t ActTracer::num_dropped_events() const {
+  std::unique_lock<std::mutex> lock(ring_buffers_mutex_);
+  int64_t num_dropped = 0;
+  for (const auto& ring_buffer : ring_buffers_) {
+    num_dropped += ring_buffer->num_dropped.load(std::memory_order_relaxed);
+  }
+  return num_dropped;
+}
+
+void ParseActTraceEvents(const std::string& act_trace_filepath,
+                         std::vector<ActTraceEvent>* events) {
+  PersistentInStream in_stream(LocalFS(), act_trace_filepath);
+  ActTraceEvent event;
+  while (!in_stream.ReadFully(reinterpret_cast<char*>(&event), sizeof(event))) {
+    events->push_back(event);
+  }
+}
+
+void ActTraceEvents2Spans(const std::vector<ActTraceEvent>& events,
+                          std::vector<ActTraceSpan>* spans) {
+  const int32_t kAllPhases = (1 << kActReady) | (1 << kActStart) | (1 << kActStop);
+  // (actor_id, act_id) to the span and the mask of the phases seen
+  HashMap<std::pair<int64_t, int64_t>, std::pair<ActTraceSpan, int32_t>> act2span;
+  for (const ActTraceEvent& event : events) {
+    auto& span_and_mask = act2span[std::make_pair(event.actor_id, event.act_id)];
+    ActTraceSpan* span = &span_and_mask.first;
+    span->actor_id = event.actor_id;
+    span->act_id = event.act_id;
+    if (event.phase == kActReady) {
+      span->ready_time = event.time;
+    } else if (event.phase == kActStart) {
+      span->start_time = event.time;
+    } else if (event.phase == kActStop) {
+      span->stop_time = event.time;
+    } else {
+      UNIMPLEMENTED();
+    }
+    span_and_mask.second |= 1 << event.phase;
+  }
+  for (const auto& pair : act2span) {
+    if (pair.second.second == kAllPhases) { spans->push_back(pair.second.first); }
+  }
+  std::sort(spans->begin(), spans->end(), [](const ActTraceSpan& lhs, const ActTraceSpan& rhs) {
+    return lhs.ready_time < rhs.ready_time;
+  });
+}
+
+std::string ActTraceSpans2ChromeTraceJson(
+    const std::vector<ActTraceSpan>& spans,
+    const std::function<std::string(int64_t)>& ActorName4ActorId,
+    const std::function<std::pair<int64_t, int64_t>(int64_t)>& MachineAndStream4ActorId) {
+  // microseconds since the first act became ready
+  const double begin_time = spans.empty() ? 0 : spans.front().ready_time;
+  const auto Microseconds = [begin_time](double time) { return (time - begin_time) / 1000; };
+  std::ostringstream ss;
+  ss << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+  HashSet<std::pair<int64_t, int64_t>> machine_and_streams;
+  bool is_first = true;
+  for (const ActTraceSpan& span : spans) {
+    const std::pair<int64_t, int64_t> machine_and_stream = MachineAndStream4ActorId(span.actor_id);
+    machine_and_streams.insert(machine_and_stream);
+    ss << (is_first ? "\n" : ",\n");
+    is_first = false;
+    ss << "{\"name\": \"" << EscapeJsonString(ActorName4ActorId(span.actor_id))
+       << "\", \"cat\": \"act\", \"ph\": \"X\", \"pid\": " << machine_and_stream.first
+       << ", \"tid\": " << machine_and_stream.second
+       << ", \"ts\": " << Microseconds(span.start_time)
+       << ", \"dur\": " << (span.stop_time - span.start_time) / 1000
+       << ", \"args\": {\"actor_id\": " << span.actor_id << ", \"act_id\": " << span.act_id
+       << ", \"ready_to_start_us\": " << (span.start_time - span.ready_time) / 1000 << "}}";
+  }
+  for (const auto& machine_and_stream : machine_and_streams) {
+    ss << (is_first ? "\n" : ",\n");
+    is_first = false;
+    ss << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << machine_and_stream.first
+       << ", \"tid\": " << machine_and_stream.second
+       << ", \"args\": {\"name\": \"stream " << machine_and_stream.second << "\"}}";
+  }
+  ss << "\n]}\n";
+  return ss.str();
+}
+
+}  // namespace oneflow
@@ -0,0 +1,112 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_ACTOR_ACT_TRACER_H_
+#define ONEFLOW_CORE_ACTOR_ACT_TRACER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "oneflow/core/common/util.h"
+
+namespace oneflow {
+
+enum ActTracePhase : int64_t { kActReady = 0, kActStart = 1, kActStop = 2 };
+
+// An act is recorded as three events, one per phase, each by the thread the phase is observed
+// on: the actor thread when the act is ready and the device callback thread when the device
+// starts and stops working on it.
+struct ActTraceEvent {
+  int64_t actor_id;
+  int64_t act_id;
+  int64_t phase;
+  double time;
+};
+
+// The events of one act joined together
+struct ActTraceSpan {
+  int64_t actor_id;
+  int64_t act_id;
+  double ready_time;
+  double start_time;
+  double stop_time;
+};
+
+// ActTracer records act events into a lock free ring buffer owned by the recording thread,
+// so tracing an act costs a few stores and no allocation, lock or RPC. A background thread
+// drains all ring buffers into FlushEvents every flush_interval_ms and once more when the
+// tracer is destroyed. Events which do not fit into a full ring buffer are dropped and counted.
+//
+// Only one in sample_interval acts of every actor is traced.
+class ActTracer final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ActTracer);
+  ActTracer(int64_t sample_interval, int64_t ring_buffer_size, int64_t flush_interval_ms,
+            const std::function<void(const ActTraceEvent*, size_t)>& FlushEvents);
+  ~ActTracer();
+
+  bool IsSampled(int64_t act_id) const { return act_id % sample_interval_ == 0; }
+  void Record(int64_t actor_id, int64_t act_id, ActTracePhase phase);
+  int64_t num_dropped_events() const;
+
+  static std::string act_trace_bin_filename() { return "act_trace.bin"; }
+  static std::string act_trace_json_filename() { return "act_trace.json"; }
+
+ private:
+  // single producer, the thread owning it, and single consumer, the flush thread
+  struct RingBuffer {
+    explicit RingBuffer(int64_t size) : events(size), head(0), tail(0), num_dropped(0) {}
+    std::vector<ActTraceEvent> events;
+    std::atomic<uint64_t> head;
+    // keeps the indices of the producer and the consumer on different cache lines
+    char padding[64];
+    std::atomic<uint64_t> tail;
+    std::atomic<int64_t> num_dropped;
+  };
+
+  RingBuffer* ThisThreadRingBuffer();
+  void Drain();
+
+  const int64_t uid_;
+  const int64_t sample_interval_;
+  const uint64_t ring_buffer_size_;
+  const std::function<void(const ActTraceEvent*, size_t)> FlushEvents_;
+  std::vector<std::unique_ptr<RingBuffer>> ring_buffers_;
+  mutable std::mutex ring_buffers_mutex_;
+  std::vector<ActTraceEvent> drained_;
+
+  bool stopped_;
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cond_;
+  std::thread flush_thread_;
+};
+
+void ParseActTraceEvents(const std::string& act_trace_filepath, std::vector<ActTraceEvent>* events);
+
+// Joins the events of every act, acts with a missing event are skipped
+void ActTraceEvents2Spans(const std::vector<ActTraceEvent>& events,
+                          std::vector<ActTraceSpan>* spans);
+
+// Chrome trace event format, which chrome://tracing and Perfetto open. Every act is a complete
+// event on the row of its stream and named after its actor.
+std::string ActTraceSpans2ChromeTraceJson(
+    const std::vector<ActTraceSpan>& spans,
+    const std::function<std::string(int64_t)>& ActorName4ActorId,
+    const std::function<std::pair<int64_t, int64_t>(int64_t)>& MachineAndStream4ActorId);
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_ACTOR_ACT_TRACER_H_
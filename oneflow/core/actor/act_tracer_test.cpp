@@ -0,0 +1,112 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/actor/act_tracer.h"
+
+namespace oneflow {
+
+namespace test {
+
+TEST(ActTracer, record_and_flush) {
+  const int64_t num_threads = 4;
+  const int64_t num_acts = 10000;
+  std::vector<ActTraceEvent> flushed;
+  std::mutex flushed_mutex;
+  {
+    ActTracer tracer(2, 1 << 16, 1, [&](const ActTraceEvent* events, size_t num_events) {
+      std::unique_lock<std::mutex> lock(flushed_mutex);
+      flushed.insert(flushed.end(), events, events + num_events);
+    });
+    std::vector<std::thread> threads;
+    FOR_RANGE(int64_t, actor_id, 0, num_threads) {
+      threads.emplace_back([&tracer, actor_id]() {
+        FOR_RANGE(int64_t, act_id, 0, num_acts) {
+          if (!tracer.IsSampled(act_id)) { continue; }
+          tracer.Record(actor_id, act_id, kActReady);
+          tracer.Record(actor_id, act_id, kActStart);
+          tracer.Record(actor_id, act_id, kActStop);
+        }
+      });
+    }
+    for (std::thread& thread : threads) { thread.join(); }
+    ASSERT_EQ(tracer.num_dropped_events(), 0);
+  }
+  ASSERT_EQ(flushed.size(), num_threads * num_acts / 2 * 3);
+  std::vector<ActTraceSpan> spans;
+  ActTraceEvents2Spans(flushed, &spans);
+  ASSERT_EQ(spans.size(), num_threads * num_acts / 2);
+  for (const ActTraceSpan& span : spans) {
+    ASSERT_EQ(span.act_id % 2, 0);
+    ASSERT_LE(span.ready_time, span.start_time);
+    ASSERT_LE(span.start_time, span.stop_time);
+  }
+}
+
+TEST(ActTracer, record_from_new_thread_while_flushing) {
+  std::atomic<int64_t> num_flushed(0);
+  ActTracer tracer(1, 16, 1, [&](const ActTraceEvent* events, size_t num_events) {
+    // a thread recording its first event while the events are written out
+    if (num_flushed == 0) { std::thread([&tracer]() { tracer.Record(1, 0, kActReady); }).join(); }
+    num_flushed += num_events;
+  });
+  tracer.Record(0, 0, kActReady);
+  while (num_flushed < 2) { std::this_thread::sleep_for(std::chrono::milliseconds(1)); }
+  ASSERT_EQ(num_flushed, 2);
+}
+
+TEST(ActTracer, drop_when_full) {
+  std::vector<ActTraceEvent> flushed;
+  {
+    // the flush thread does not get to run before the ring buffer is full
+    ActTracer tracer(1, 8, 1000 * 1000, [&](const ActTraceEvent* events, size_t num_events) {
+      flushed.insert(flushed.end(), events, events + num_events);
+    });
+    FOR_RANGE(int64_t, act_id, 0, 10) { tracer.Record(0, act_id, kActReady); }
+    ASSERT_EQ(tracer.num_dropped_events(), 2);
+  }
+  ASSERT_EQ(flushed.size(), 8);
+  // acts missing a phase are not turned into spans
+  std::vector<ActTraceSpan> spans;
+  ActTraceEvents2Spans(flushed, &spans);
+  ASSERT_TRUE(spans.empty());
+}
+
+TEST(ActTracer, chrome_trace_json) {
+  std::vector<ActTraceSpan> spans;
+  spans.push_back({7, 0, 1000, 3000, 8000});
+  spans.push_back({9, 0, 2000, 8000, 9000});
+  const std::string json = ActTraceSpans2ChromeTraceJson(
+      spans, [](int64_t actor_id) { return "actor\"" + std::to_string(actor_id); },
+      [](int64_t actor_id) { return std::make_pair(int64_t(0), actor_id % 2 + 100); });
+  ASSERT_NE(json.find("{\"name\": \"actor\\\"7\", \"cat\": \"act\", \"ph\": \"X\", \"pid\": 0, "
+                      "\"tid\": 101, \"ts\": 2, \"dur\": 5"),
+            std::string::npos);
+  ASSERT_NE(json.find("\"ready_to_start_us\": 6"), std::string::npos);
+  ASSERT_NE(json.find("\"ph\": \"M\", \"pid\": 0, \"tid\": 101"), std::string::npos);
+}
+
+TEST(ActTracer, DISABLED_record_overhead) {
+  const int64_t num_acts = 1000000;
+  ActTracer tracer(1, 1 << 20, 10, [](const ActTraceEvent* events, size_t num_events) {});
+  const auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int64_t, act_id, 0, num_acts) { tracer.Record(0, act_id, kActReady); }
+  const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  LOG(INFO) << "ActTracer::Record: " << elapsed.count() / num_acts << " ns per event, "
+            << tracer.num_dropped_events() << " dropped";
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/job/runtime_job_descs.h"
 #include "oneflow/core/job/machine_context.h"
+#include "oneflow/core/actor/act_tracer.h"
 
 namespace oneflow {
 
@@ -284,16 +285,15 @@ int Actor::HandlerNormal(const ActorMsg& msg) {
   } else if (msg.msg_type() == ActorMsgType::kRegstMsg) {
     if (msg.SrcMachineId() == Global<MachineCtx>::Get()->this_machine_id()) {
       Regst* regst = msg.regst();
-      if (naive_consumed_rs_.HasRegstDescId(regst->regst_desc_id())) {
-        CHECK_EQ(0, naive_consumed_rs_.TryPushBackRegst(regst));
-        const auto& rdeq = naive_consumed_rs_.RegstDeq4RegstDescId(regst->regst_desc_id());
+      const int64_t regst_desc_id = regst->regst_desc_id();
+      if (naive_consumed_rs_.TryPushBackRegst(regst, regst_desc_id) == 0) {
+        const auto& rdeq = naive_consumed_rs_.RegstDeq4RegstDescId(regst_desc_id);
         CHECK(rdeq.empty() == false);
         if (rdeq.front()->regst_desc()->regst_desc_type().has_data_regst_desc()) {
           NormalProcessNaiveReadableDataRegstMsg(rdeq);
         }
-      } else if (inplace_consumed_rs_.HasRegstDescId(regst->regst_desc_id())) {
-        CHECK_EQ(0, inplace_consumed_rs_.TryPushBackRegst(regst));
-        int64_t out_regst_desc_id = inplace_regst_desc_id_in2out_.at(regst->regst_desc_id());
+      } else if (inplace_consumed_rs_.TryPushBackRegst(regst, regst_desc_id) == 0) {
+        int64_t out_regst_desc_id = inplace_regst_desc_id_in2out_.at(regst_desc_id);
         CHECK(regst->packed_blob()->dptr()
               == inplace_produced_rs_.Front(out_regst_desc_id)->packed_blob()->dptr());
       } else if (TryUpdtStateAsProducedRegst(regst) == 0) {
@@ -354,7 +354,21 @@ int Actor::HandlerZombie(const ActorMsg& msg) {
 }
 
 void Actor::TryLogActEvent(const std::function<void()>& DoAct) const {
-  if (Global<RuntimeCtx>::Get()->is_experiment_phase() || NeedCollectActEvent()) {
+  ActTracer* act_tracer = Global<ActTracer>::Get();
+  if (act_tracer != nullptr && NeedCollectActEvent() && act_tracer->IsSampled(act_id_)) {
+    const int64_t actor_id = this->actor_id();
+    const int64_t act_id = act_id_;
+    act_tracer->Record(actor_id, act_id, kActReady);
+    device_ctx_->AddCallBack([actor_id, act_id]() {
+      Global<ActTracer>::Get()->Record(actor_id, act_id, kActStart);
+    });
+
+    DoAct();
+
+    device_ctx_->AddCallBack([actor_id, act_id]() {
+      Global<ActTracer>::Get()->Record(actor_id, act_id, kActStop);
+    });
+  } else if (Global<RuntimeCtx>::Get()->is_experiment_phase()) {
     auto act_event = std::make_shared<ActEvent>();
     act_event->set_is_experiment_phase(Global<RuntimeCtx>::Get()->is_experiment_phase());
     act_event->set_actor_id(actor_id());
@@ -422,7 +436,7 @@ void Actor::AsyncRetInplaceConsumedRegstIfNoConsumer() {
         return inplace_in_ids_with_no_out_consumed_.find(regst_desc_id)
                != inplace_in_ids_with_no_out_consumed_.end();
       },
-      [&](const std::deque<Regst*>& deq) {
+      [&](const RegstDeque& deq) {
         if (!deq.empty()) {
           Regst* in_regst = deq.front();
           CHECK(in_regst);
@@ -452,7 +466,7 @@ void Actor::AsyncSendConsumedCtrlRegstMsgToProducer() {
   };
 
   tmp_regst_desc_id_vec_.clear();
-  naive_consumed_rs_.ForChosenRegstDeq(IsChosenRegstDescId, [&](const std::deque<Regst*>& reg_deq) {
+  naive_consumed_rs_.ForChosenRegstDeq(IsChosenRegstDescId, [&](const RegstDeque& reg_deq) {
     CHECK(reg_deq.empty() == false);
     Regst* regst = reg_deq.front();
     CHECK(regst->regst_desc()->regst_desc_type().has_ctrl_regst_desc());
@@ -159,7 +159,7 @@ class Actor {
   }
 
   // Process Msg
-  virtual void NormalProcessNaiveReadableDataRegstMsg(const std::deque<Regst*>&) {}
+  virtual void NormalProcessNaiveReadableDataRegstMsg(const RegstDeque&) {}
   virtual bool NormalTryProcessReadableMsgFromOtherMachine(const ActorMsg&) { return false; }
   int TryUpdtStateAsProducedRegst(Regst* regst);
 
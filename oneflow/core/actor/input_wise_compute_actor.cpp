@@ -110,7 +110,7 @@ int64_t InputWiseCompActor::GetCurProcessedRegstDescId() const {
   int64_t cur_processed_regst_desc_id = -1;
   consumed_rs_.ForChosenRegstDeq(
       [cur_processed_regst_desc_id](int64_t) { return cur_processed_regst_desc_id == -1; },
-      [this, &cur_processed_regst_desc_id](const std::deque<Regst*>& reg_deq) {
+      [this, &cur_processed_regst_desc_id](const RegstDeque& reg_deq) {
         if (reg_deq.empty()) { return; }
         int64_t regst_desc_id = reg_deq.front()->regst_desc_id();
         if (regst_desc_id2is_processed_.at(regst_desc_id) == false) {
@@ -97,7 +97,7 @@ int64_t ReentrantLockCompActor::GetCurProcessedRegstDescId() const {
   int64_t cur_processed_regst_desc_id = -1;
   consumed_rs_.ForChosenRegstDeq(
       [&cur_processed_regst_desc_id](int64_t) { return cur_processed_regst_desc_id == -1; },
-      [&cur_processed_regst_desc_id](const std::deque<Regst*>& reg_deq) {
+      [&cur_processed_regst_desc_id](const RegstDeque& reg_deq) {
         if (reg_deq.empty()) { return; }
         cur_processed_regst_desc_id = reg_deq.front()->regst_desc_id();
       });
@@ -17,33 +17,15 @@ limitations under the License.
 
 namespace oneflow {
 
-bool RegstSlot::HasRegstDescId(int64_t regst_desc_id) const {
-  CHECK(is_inited_);
-  return regst_desc_id2regsts_.find(regst_desc_id) != regst_desc_id2regsts_.end();
-}
-
-const std::deque<Regst*>& RegstSlot::RegstDeq4RegstDescId(int64_t regst_desc_id) const {
-  CHECK(is_inited_);
-  return regst_desc_id2regsts_.at(regst_desc_id);
+void RegstDeque::Grow() {
+  std::vector<Regst*> buffer(buffer_.size() * 2);
+  FOR_RANGE(size_t, i, 0, size_) { buffer[i] = at(i); }
+  buffer_.swap(buffer);
+  head_ = 0;
 }
 
 int RegstSlot::TryPushBackRegst(Regst* regst) {
-  CHECK(is_inited_);
-  auto it = regst_desc_id2regsts_.find(regst->regst_desc_id());
-  if (it == regst_desc_id2regsts_.end()) { return -1; }
-  if (it->second.empty()) { available_regst_desc_cnt_ += 1; }
-  it->second.push_back(regst);
-  return 0;
-}
-
-int RegstSlot::TryPopFrontRegst(int64_t regst_desc_id) {
-  CHECK(is_inited_);
-  auto it = regst_desc_id2regsts_.find(regst_desc_id);
-  if (it == regst_desc_id2regsts_.end()) { return -1; }
-  CHECK(it->second.empty() == false);
-  it->second.pop_front();
-  if (it->second.empty()) { available_regst_desc_cnt_ -= 1; }
-  return 0;
+  return TryPushBackRegst(regst, regst->regst_desc_id());
 }
 
 void RegstSlot::PopFrontRegsts(const std::vector<int64_t>& regst_desc_ids) {
@@ -53,52 +35,70 @@ void RegstSlot::PopFrontRegsts(const std::vector<int64_t>& regst_desc_ids) {
 
 void RegstSlot::InsertRegstDescId(int64_t regst_desc_id) {
   CHECK(is_inited_ == false);
-  CHECK(regst_desc_id2regsts_.emplace(regst_desc_id, std::deque<Regst*>()).second);
+  CHECK(std::find(regst_desc_ids_.begin(), regst_desc_ids_.end(), regst_desc_id)
+        == regst_desc_ids_.end());
+  regst_desc_ids_.push_back(regst_desc_id);
+  regst_deqs_.emplace_back();
 }
 
-Regst* RegstSlot::Front(int64_t regst_desc_id) const {
-  CHECK(is_inited_);
-  auto it = regst_desc_id2regsts_.find(regst_desc_id);
-  if (it == regst_desc_id2regsts_.end()) { return nullptr; }
-  if (it->second.empty()) { return nullptr; }
-  return it->second.front();
+void RegstSlot::BuildIndexTable() {
+  // regst desc ids are small numbers handed out one after another, so their low bits are
+  // distinct more often than not
+  const auto HasCollision = [this](size_t size) {
+    std::vector<bool> is_used(size, false);
+    for (int64_t regst_desc_id : regst_desc_ids_) {
+      const size_t pos = static_cast<size_t>(regst_desc_id) & (size - 1);
+      if (is_used[pos]) { return true; }
+      is_used[pos] = true;
+    }
+    return false;
+  };
+  size_t size = 2;
+  while (size < regst_desc_ids_.size() * 2) { size *= 2; }
+  const size_t max_size = std::max<size_t>(size * 8, 64);
+  while (size < max_size && HasCollision(size)) { size *= 2; }
+  index_table_.assign(size, -1);
+  FOR_RANGE(size_t, i, 0, regst_desc_ids_.size()) {
+    size_t pos = static_cast<size_t>(regst_desc_ids_[i]) & (size - 1);
+    while (index_table_[pos] != -1) { pos = (pos + 1) & (size - 1); }
+    index_table_[pos] = i;
+  }
 }
 
 Regst* RegstSlot::SoleFront() const {
   CHECK(is_inited_);
   CHECK_EQ(1, total_regst_desc_cnt());
-  auto it = regst_desc_id2regsts_.begin();
-  if (it->second.empty()) { return nullptr; }
-  return it->second.front();
+  if (regst_deqs_.front().empty()) { return nullptr; }
+  return regst_deqs_.front().front();
 }
 
 Regst* RegstSlot::FirstFront() const {
   CHECK(is_inited_);
   CHECK_GE(total_regst_desc_cnt(), 1);
-  auto it = regst_desc_id2regsts_.begin();
-  if (it->second.empty()) { return nullptr; }
-  return it->second.front();
+  if (regst_deqs_.front().empty()) { return nullptr; }
+  return regst_deqs_.front().front();
 }
 
 void RegstSlot::InitedDone() {
   CHECK(is_inited_ == false);
+  BuildIndexTable();
   is_inited_ = true;
 }
 
 void RegstSlot::ForChosenFrontRegst(std::function<bool(int64_t)> IsChosenRegstDescId,
                                     std::function<void(Regst*)> Handler) const {
-  for (const auto& kv : regst_desc_id2regsts_) {
-    if (IsChosenRegstDescId(kv.first)) {
-      CHECK(kv.second.empty() == false);
-      Handler(kv.second.front());
+  FOR_RANGE(size_t, i, 0, regst_desc_ids_.size()) {
+    if (IsChosenRegstDescId(regst_desc_ids_[i])) {
+      CHECK(regst_deqs_[i].empty() == false);
+      Handler(regst_deqs_[i].front());
     }
   }
 }
 
 void RegstSlot::ForChosenRegstDeq(std::function<bool(int64_t)> IsChosenRegstDescId,
-                                  std::function<void(const std::deque<Regst*>&)> Handler) const {
-  for (const auto& kv : regst_desc_id2regsts_) {
-    if (IsChosenRegstDescId(kv.first)) { Handler(kv.second); }
+                                  std::function<void(const RegstDeque&)> Handler) const {
+  FOR_RANGE(size_t, i, 0, regst_desc_ids_.size()) {
+    if (IsChosenRegstDescId(regst_desc_ids_[i])) { Handler(regst_deqs_[i]); }
   }
 }
 
@@ -106,7 +106,7 @@ void RegstSlot::ForEachFrontRegst(std::function<void(Regst*)> Handler) const {
   ForChosenFrontRegst([](int64_t) { return true; }, Handler);
 }
 
-void RegstSlot::ForEachRegstDeq(std::function<void(const std::deque<Regst*>&)> Handler) const {
+void RegstSlot::ForEachRegstDeq(std::function<void(const RegstDeque&)> Handler) const {
   ForChosenRegstDeq([](int64_t) { return true; }, Handler);
 }
 
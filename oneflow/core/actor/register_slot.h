@@ -20,32 +20,103 @@ limitations under the License.
 
 namespace oneflow {
 
+// FIFO of the regsts of one regst desc, a ring buffer doubling its capacity when it is full.
+// There are no more than register_num regsts of a regst desc, so it stops growing early on.
+class RegstDeque final {
+ public:
+  RegstDeque() : buffer_(kInitCapacity), head_(0), size_(0) {}
+  ~RegstDeque() = default;
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+  Regst* front() const {
+    CHECK_GT(size_, 0);
+    return buffer_[head_];
+  }
+  Regst* at(size_t i) const {
+    CHECK_LT(i, size_);
+    return buffer_[(head_ + i) & (buffer_.size() - 1)];
+  }
+
+  void push_back(Regst* regst) {
+    if (size_ == buffer_.size()) { Grow(); }
+    buffer_[(head_ + size_) & (buffer_.size() - 1)] = regst;
+    size_ += 1;
+  }
+  void pop_front() {
+    CHECK_GT(size_, 0);
+    head_ = (head_ + 1) & (buffer_.size() - 1);
+    size_ -= 1;
+  }
+
+ private:
+  static const size_t kInitCapacity = 4;
+
+  void Grow();
+
+  // capacity is a power of two
+  std::vector<Regst*> buffer_;
+  size_t head_;
+  size_t size_;
+};
+
 class RegstSlot final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(RegstSlot);
-  RegstSlot() : regst_desc_id2regsts_(), available_regst_desc_cnt_(0), is_inited_(false) {}
+  RegstSlot() : index_table_(1, -1), available_regst_desc_cnt_(0), is_inited_(false) {}
   ~RegstSlot() = default;
 
   bool is_inited() const { return is_inited_; }
-  size_t total_regst_desc_cnt() const { return regst_desc_id2regsts_.size(); }
+  size_t total_regst_desc_cnt() const { return regst_desc_ids_.size(); }
   size_t available_regst_desc_cnt() const { return available_regst_desc_cnt_; }
 
   bool IsCurSlotReady() const { return available_regst_desc_cnt() == total_regst_desc_cnt(); }
-  bool HasRegstDescId(int64_t regst_desc_id) const;
-  const std::deque<Regst*>& RegstDeq4RegstDescId(int64_t regst_desc_id) const;
+  bool HasRegstDescId(int64_t regst_desc_id) const {
+    CHECK(is_inited_);
+    return Index4RegstDescId(regst_desc_id) != -1;
+  }
+  const RegstDeque& RegstDeq4RegstDescId(int64_t regst_desc_id) const {
+    CHECK(is_inited_);
+    const int64_t index = Index4RegstDescId(regst_desc_id);
+    CHECK_NE(index, -1);
+    return regst_deqs_[index];
+  }
   void ForEachFrontRegst(std::function<void(Regst*)>) const;
-  void ForEachRegstDeq(std::function<void(const std::deque<Regst*>&)>) const;
+  void ForEachRegstDeq(std::function<void(const RegstDeque&)>) const;
   void ForChosenFrontRegst(std::function<bool(int64_t)>, std::function<void(Regst*)>) const;
   void ForChosenRegstDeq(std::function<bool(int64_t)>,
-                         std::function<void(const std::deque<Regst*>&)>) const;
+                         std::function<void(const RegstDeque&)>) const;
 
-  Regst* Front(int64_t regst_desc_id) const;
+  Regst* Front(int64_t regst_desc_id) const {
+    CHECK(is_inited_);
+    const int64_t index = Index4RegstDescId(regst_desc_id);
+    if (index == -1 || regst_deqs_[index].empty()) { return nullptr; }
+    return regst_deqs_[index].front();
+  }
   Regst* SoleFront() const;
   Regst* FirstFront() const;
 
   // 0: success, -1: cannot find regst_desc_id
   int TryPushBackRegst(Regst* regst);
-  int TryPopFrontRegst(int64_t regst_desc_id);
+  int TryPushBackRegst(Regst* regst, int64_t regst_desc_id) {
+    CHECK(is_inited_);
+    const int64_t index = Index4RegstDescId(regst_desc_id);
+    if (index == -1) { return -1; }
+    RegstDeque* regst_deq = &regst_deqs_[index];
+    if (regst_deq->empty()) { available_regst_desc_cnt_ += 1; }
+    regst_deq->push_back(regst);
+    return 0;
+  }
+  int TryPopFrontRegst(int64_t regst_desc_id) {
+    CHECK(is_inited_);
+    const int64_t index = Index4RegstDescId(regst_desc_id);
+    if (index == -1) { return -1; }
+    RegstDeque* regst_deq = &regst_deqs_[index];
+    CHECK(regst_deq->empty() == false);
+    regst_deq->pop_front();
+    if (regst_deq->empty()) { available_regst_desc_cnt_ -= 1; }
+    return 0;
+  }
 
   void PopFrontRegsts(const std::vector<int64_t>& regst_desc_ids);
 
@@ -53,7 +124,24 @@ class RegstSlot final {
   void InsertRegstDescId(int64_t regst_desc_id);
 
  private:
-  HashMap<int64_t, std::deque<Regst*>> regst_desc_id2regsts_;
+  // -1 if regst_desc_id is not in the slot. index_table_ is an open addressing hash table of
+  // the indices of the regst desc ids with linear probing. Its size is chosen to leave no
+  // collisions where possible, so the first probe almost always finds the index.
+  int64_t Index4RegstDescId(int64_t regst_desc_id) const {
+    const size_t mask = index_table_.size() - 1;
+    size_t pos = static_cast<size_t>(regst_desc_id) & mask;
+    while (true) {
+      const int32_t index = index_table_[pos];
+      if (index == -1) { return -1; }
+      if (regst_desc_ids_[index] == regst_desc_id) { return index; }
+      pos = (pos + 1) & mask;
+    }
+  }
+  void BuildIndexTable();
+
+  std::vector<int64_t> regst_desc_ids_;
+  std::vector<RegstDeque> regst_deqs_;
+  std::vector<int32_t> index_table_;
   size_t available_regst_desc_cnt_;
   bool is_inited_;
 };
@@ -0,0 +1,133 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/actor/register_slot.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// RegstSlot never dereferences the regsts when it is told their regst desc ids
+Regst* FakeRegst(int64_t i) { return reinterpret_cast<Regst*>(static_cast<uintptr_t>(i + 1) * 64); }
+
+}  // namespace
+
+TEST(RegstDeque, fifo) {
+  RegstDeque deq;
+  int64_t pushed = 0;
+  int64_t popped = 0;
+  // interleaved so the ring buffer wraps around and grows with elements in the middle
+  FOR_RANGE(int64_t, round, 0, 20) {
+    FOR_RANGE(int64_t, i, 0, round + 3) { deq.push_back(FakeRegst(pushed++)); }
+    FOR_RANGE(int64_t, i, 0, round + 1) {
+      ASSERT_EQ(deq.size(), pushed - popped);
+      FOR_RANGE(int64_t, j, 0, deq.size()) { ASSERT_EQ(deq.at(j), FakeRegst(popped + j)); }
+      ASSERT_EQ(deq.front(), FakeRegst(popped++));
+      deq.pop_front();
+    }
+  }
+  while (!deq.empty()) {
+    ASSERT_EQ(deq.front(), FakeRegst(popped++));
+    deq.pop_front();
+  }
+  ASSERT_EQ(popped, pushed);
+}
+
+TEST(RegstSlot, push_pop) {
+  for (int64_t regst_desc_cnt : {1, 3, 40}) {
+    RegstSlot slot;
+    FOR_RANGE(int64_t, i, 0, regst_desc_cnt) { slot.InsertRegstDescId(i * 7 + 100); }
+    slot.InitedDone();
+    ASSERT_FALSE(slot.HasRegstDescId(99));
+    ASSERT_EQ(slot.TryPushBackRegst(FakeRegst(0), 99), -1);
+    ASSERT_EQ(slot.TryPopFrontRegst(99), -1);
+    FOR_RANGE(int64_t, i, 0, regst_desc_cnt) {
+      const int64_t regst_desc_id = i * 7 + 100;
+      ASSERT_TRUE(slot.HasRegstDescId(regst_desc_id));
+      ASSERT_FALSE(slot.IsCurSlotReady());
+      ASSERT_EQ(slot.Front(regst_desc_id), nullptr);
+      ASSERT_EQ(slot.TryPushBackRegst(FakeRegst(2 * i), regst_desc_id), 0);
+      ASSERT_EQ(slot.TryPushBackRegst(FakeRegst(2 * i + 1), regst_desc_id), 0);
+      ASSERT_EQ(slot.available_regst_desc_cnt(), i + 1);
+    }
+    ASSERT_TRUE(slot.IsCurSlotReady());
+    int64_t i = 0;
+    slot.ForEachFrontRegst([&](Regst* regst) { ASSERT_EQ(regst, FakeRegst(2 * i++)); });
+    FOR_RANGE(int64_t, i, 0, regst_desc_cnt) {
+      const int64_t regst_desc_id = i * 7 + 100;
+      ASSERT_EQ(slot.RegstDeq4RegstDescId(regst_desc_id).size(), 2);
+      ASSERT_EQ(slot.TryPopFrontRegst(regst_desc_id), 0);
+      ASSERT_EQ(slot.Front(regst_desc_id), FakeRegst(2 * i + 1));
+    }
+    ASSERT_TRUE(slot.IsCurSlotReady());
+    std::vector<int64_t> regst_desc_ids;
+    FOR_RANGE(int64_t, i, 0, regst_desc_cnt) { regst_desc_ids.push_back(i * 7 + 100); }
+    slot.PopFrontRegsts(regst_desc_ids);
+    ASSERT_EQ(slot.available_regst_desc_cnt(), 0);
+  }
+}
+
+TEST(RegstSlot, DISABLED_dispatch_cost) {
+  // what the actor thread does for every regst message: find the consuming regst desc, queue
+  // the regst, look at the queue and, once the act is done, dequeue it again
+  const int64_t num_msgs = 4 * 1000 * 1000;
+  for (int64_t regst_desc_cnt : {1, 4, 16, 64}) {
+    std::vector<int64_t> regst_desc_ids;
+    FOR_RANGE(int64_t, i, 0, regst_desc_cnt) { regst_desc_ids.push_back(i * 1237 + 5); }
+    std::vector<int64_t> msg_regst_desc_ids(num_msgs);
+    std::mt19937 gen(regst_desc_cnt);
+    for (int64_t& id : msg_regst_desc_ids) { id = regst_desc_ids.at(gen() % regst_desc_cnt); }
+
+    RegstSlot slot;
+    for (int64_t regst_desc_id : regst_desc_ids) { slot.InsertRegstDescId(regst_desc_id); }
+    slot.InitedDone();
+    auto start = std::chrono::steady_clock::now();
+    int64_t checksum = 0;
+    FOR_RANGE(int64_t, i, 0, num_msgs) {
+      const int64_t regst_desc_id = msg_regst_desc_ids[i];
+      CHECK(slot.TryPushBackRegst(FakeRegst(i), regst_desc_id) == 0);
+      checksum += slot.RegstDeq4RegstDescId(regst_desc_id).size();
+      CHECK(slot.TryPopFrontRegst(regst_desc_id) == 0);
+    }
+    const std::chrono::duration<double, std::nano> slot_ns =
+        std::chrono::steady_clock::now() - start;
+
+    // the HashMap of std::deque RegstSlot used before
+    HashMap<int64_t, std::deque<Regst*>> regst_desc_id2regsts;
+    for (int64_t regst_desc_id : regst_desc_ids) { regst_desc_id2regsts[regst_desc_id]; }
+    start = std::chrono::steady_clock::now();
+    FOR_RANGE(int64_t, i, 0, num_msgs) {
+      const int64_t regst_desc_id = msg_regst_desc_ids[i];
+      auto it = regst_desc_id2regsts.find(regst_desc_id);
+      CHECK(it != regst_desc_id2regsts.end());
+      it->second.push_back(FakeRegst(i));
+      checksum -= regst_desc_id2regsts.at(regst_desc_id).size();
+      regst_desc_id2regsts.at(regst_desc_id).pop_front();
+    }
+    const std::chrono::duration<double, std::nano> map_ns =
+        std::chrono::steady_clock::now() - start;
+    ASSERT_EQ(checksum, 0);
+    LOG(INFO) << "regst desc cnt: " << regst_desc_cnt
+              << ", RegstSlot: " << slot_ns.count() / num_msgs
+              << " ns per message, HashMap of deques: " << map_ns.count() / num_msgs
+              << " ns per message";
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/job/resource_desc.h"
 #include "oneflow/core/job/env_desc.h"
 #include "oneflow/core/job/global_for.h"
+#include "oneflow/core/common/balanced_splitter.h"
 
 #ifdef PLATFORM_POSIX
 
@@ -28,6 +29,9 @@ namespace oneflow {
 
 namespace {
 
+// reads smaller than this stay on a single socket
+constexpr int64_t kMinStripeByteSize = 4 * 1024 * 1024;
+
 sockaddr_in GetSockAddr(const std::string& addr, uint16_t port) {
   sockaddr_in sa;
   sa.sin_family = AF_INET;
@@ -49,14 +53,36 @@ int SockListen(int listen_sockfd, uint16_t listen_port, int32_t total_machine_nu
   return bind_result;
 }
 
-int64_t GetMachineId(const sockaddr_in& sa) {
-  char addr[INET_ADDRSTRLEN];
-  memset(addr, '\0', sizeof(addr));
-  PCHECK(inet_ntop(AF_INET, &(sa.sin_addr), addr, INET_ADDRSTRLEN));
-  for (int64_t i = 0; i < Global<ResourceDesc, ForSession>::Get()->TotalMachineNum(); ++i) {
-    if (Global<ResourceDesc, ForSession>::Get()->machine(i).addr() == addr) { return i; }
+// The first bytes on every connection tell the acceptor which machine and which of the sockets
+// to that machine it is, so several processes behind one address can be told apart
+struct SocketHandshake {
+  int64_t machine_id;
+  int64_t socket_idx;
+};
+
+void BlockingWrite(int sockfd, const char* ptr, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(sockfd, ptr, size);
+    if (n == -1) {
+      PCHECK(errno == EINTR);
+      continue;
+    }
+    ptr += n;
+    size -= n;
+  }
+}
+
+void BlockingRead(int sockfd, char* ptr, size_t size) {
+  while (size > 0) {
+    ssize_t n = read(sockfd, ptr, size);
+    if (n == -1) {
+      PCHECK(errno == EINTR);
+      continue;
+    }
+    CHECK_GT(n, 0) << "sockfd " << sockfd << " closed by peer during handshake";
+    ptr += n;
+    size -= n;
   }
-  UNIMPLEMENTED();
 }
 
 std::string GenPortKey(int64_t machine_id) { return "EpollPort/" + std::to_string(machine_id); }
@@ -74,6 +100,15 @@ uint16_t PullPort(int64_t machine_id) {
 }  // namespace
 
 EpollCommNet::~EpollCommNet() {
+  for (int64_t peer_id : peer_machine_id()) {
+    const SocketWriteStat stat = GetWriteStat(peer_id);
+    LOG(INFO) << "CommNet to machine " << peer_id << ": " << stat.msg_cnt << " msgs, "
+              << stat.byte_cnt << " bytes in " << stat.syscall_cnt << " syscalls, "
+              << (stat.syscall_cnt > 0 ? stat.msg_cnt / static_cast<double>(stat.syscall_cnt) : 0)
+              << " msgs/syscall, "
+              << (stat.syscall_cnt > 0 ? stat.byte_cnt / static_cast<double>(stat.syscall_cnt) : 0)
+              << " bytes/syscall";
+  }
   for (size_t i = 0; i < pollers_.size(); ++i) {
     LOG(INFO) << "CommNet Thread " << i << " finish";
     pollers_[i]->Stop();
@@ -91,11 +126,36 @@ void EpollCommNet::SendActorMsg(int64_t dst_machine_id, const ActorMsg& actor_ms
   SocketMsg msg;
   msg.msg_type = SocketMsgType::kActor;
   msg.actor_msg = actor_msg;
-  GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+  // actor messages to one machine keep their order, so they all go through the first socket
+  GetSocketHelper(dst_machine_id, 0)->AsyncWrite(msg);
 }
 
-void EpollCommNet::SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg) {
-  GetSocketHelper(dst_machine_id)->AsyncWrite(msg);
+void EpollCommNet::SendSocketMsg(int64_t dst_machine_id, int64_t socket_idx,
+                                 const SocketMsg& msg) {
+  GetSocketHelper(dst_machine_id, socket_idx)->AsyncWrite(msg);
+}
+
+void EpollCommNet::StripeReadDone(void* read_id, void* stripe_cnt) {
+  if (stripe_cnt != nullptr) {
+    auto cnt = static_cast<std::atomic<int64_t>*>(stripe_cnt);
+    if (cnt->fetch_sub(1, std::memory_order_acq_rel) != 1) { return; }
+    delete cnt;
+  }
+  ReadDone(read_id);
+}
+
+SocketWriteStat EpollCommNet::GetWriteStat(int64_t dst_machine_id) {
+  SocketWriteStat sum;
+  sum.syscall_cnt = 0;
+  sum.msg_cnt = 0;
+  sum.byte_cnt = 0;
+  FOR_RANGE(int64_t, socket_idx, 0, socket_num_per_peer_) {
+    const SocketWriteStat stat = GetSocketHelper(dst_machine_id, socket_idx)->GetWriteStat();
+    sum.syscall_cnt += stat.syscall_cnt;
+    sum.msg_cnt += stat.msg_cnt;
+    sum.byte_cnt += stat.byte_cnt;
+  }
+  return sum;
 }
 
 SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
@@ -105,7 +165,9 @@ SocketMemDesc* EpollCommNet::NewMemDesc(void* ptr, size_t byte_size) {
   return mem_desc;
 }
 
-EpollCommNet::EpollCommNet(const Plan& plan) : CommNetIf(plan) {
+EpollCommNet::EpollCommNet(const Plan& plan) : CommNetIf(plan), read_cnt_(0) {
+  socket_num_per_peer_ = Global<ResourceDesc, ForSession>::Get()->CommNetSocketNumPerPeer();
+  CHECK_GT(socket_num_per_peer_, 0);
   pollers_.resize(Global<ResourceDesc, ForSession>::Get()->CommNetWorkerNum(), nullptr);
   for (size_t i = 0; i < pollers_.size(); ++i) { pollers_[i] = new IOEventPoller; }
   InitSockets();
@@ -116,7 +178,7 @@ void EpollCommNet::InitSockets() {
   int64_t this_machine_id = Global<MachineCtx>::Get()->this_machine_id();
   auto this_machine = Global<ResourceDesc, ForSession>::Get()->machine(this_machine_id);
   int64_t total_machine_num = Global<ResourceDesc, ForSession>::Get()->TotalMachineNum();
-  machine_id2sockfd_.assign(total_machine_num, -1);
+  machine_id2sockfds_.assign(total_machine_num, std::vector<int>(socket_num_per_peer_, -1));
   sockfd2helper_.clear();
   size_t poller_idx = 0;
   auto NewSocketHelper = [&](int sockfd) {
@@ -126,16 +188,17 @@ void EpollCommNet::InitSockets() {
   };
 
   // listen
+  const int32_t listen_backlog = total_machine_num * socket_num_per_peer_;
   int listen_sockfd = socket(AF_INET, SOCK_STREAM, 0);
   int32_t this_listen_port = Global<EnvDesc>::Get()->data_port();
   if (this_listen_port != -1) {
-    CHECK_EQ(SockListen(listen_sockfd, this_listen_port, total_machine_num), 0);
+    CHECK_EQ(SockListen(listen_sockfd, this_listen_port, listen_backlog), 0);
     PushPort(this_machine_id,
              ((this_machine.data_port_agent() != -1) ? (this_machine.data_port_agent())
                                                      : (this_listen_port)));
   } else {
     for (this_listen_port = 1024; this_listen_port < GetMaxVal<uint16_t>(); ++this_listen_port) {
-      if (SockListen(listen_sockfd, this_listen_port, total_machine_num) == 0) {
+      if (SockListen(listen_sockfd, this_listen_port, listen_backlog) == 0) {
         PushPort(this_machine_id, this_listen_port);
         break;
       }
@@ -153,47 +216,75 @@ void EpollCommNet::InitSockets() {
     uint16_t peer_port = PullPort(peer_id);
     auto peer_machine = Global<ResourceDesc, ForSession>::Get()->machine(peer_id);
     sockaddr_in peer_sockaddr = GetSockAddr(peer_machine.addr(), peer_port);
-    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    const int val = 1;
-    PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
-    PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
-           == 0);
-    CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    machine_id2sockfd_[peer_id] = sockfd;
+    FOR_RANGE(int64_t, socket_idx, 0, socket_num_per_peer_) {
+      int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+      const int val = 1;
+      PCHECK(setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&val, sizeof(int)) == 0);
+      PCHECK(connect(sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), sizeof(peer_sockaddr))
+             == 0);
+      SocketHandshake handshake;
+      handshake.machine_id = this_machine_id;
+      handshake.socket_idx = socket_idx;
+      BlockingWrite(sockfd, reinterpret_cast<const char*>(&handshake), sizeof(handshake));
+      CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
+      machine_id2sockfds_[peer_id][socket_idx] = sockfd;
+    }
   }
 
   // accept
-  FOR_RANGE(int32_t, idx, 0, src_machine_count) {
+  FOR_RANGE(int32_t, idx, 0, src_machine_count * socket_num_per_peer_) {
     sockaddr_in peer_sockaddr;
     socklen_t len = sizeof(peer_sockaddr);
     int sockfd = accept(listen_sockfd, reinterpret_cast<sockaddr*>(&peer_sockaddr), &len);
     PCHECK(sockfd != -1);
+    SocketHandshake handshake;
+    BlockingRead(sockfd, reinterpret_cast<char*>(&handshake), sizeof(handshake));
+    CHECK(peer_machine_id().find(handshake.machine_id) != peer_machine_id().end());
+    CHECK_LT(handshake.machine_id, this_machine_id);
+    int* sockfd_slot = &machine_id2sockfds_.at(handshake.machine_id).at(handshake.socket_idx);
+    CHECK_EQ(*sockfd_slot, -1);
     CHECK(sockfd2helper_.emplace(sockfd, NewSocketHelper(sockfd)).second);
-    int64_t peer_machine_id = GetMachineId(peer_sockaddr);
-    machine_id2sockfd_[peer_machine_id] = sockfd;
+    *sockfd_slot = sockfd;
   }
   PCHECK(close(listen_sockfd) == 0);
   ClearPort(this_machine_id);
 
   // useful log
   FOR_RANGE(int64_t, machine_id, 0, total_machine_num) {
-    LOG(INFO) << "machine " << machine_id << " sockfd " << machine_id2sockfd_[machine_id];
+    FOR_RANGE(int64_t, socket_idx, 0, socket_num_per_peer_) {
+      LOG(INFO) << "machine " << machine_id << " socket " << socket_idx << " sockfd "
+                << machine_id2sockfds_[machine_id][socket_idx];
+    }
   }
 }
 
-SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id) {
-  int sockfd = machine_id2sockfd_.at(machine_id);
+SocketHelper* EpollCommNet::GetSocketHelper(int64_t machine_id, int64_t socket_idx) {
+  int sockfd = machine_id2sockfds_.at(machine_id).at(socket_idx);
   return sockfd2helper_.at(sockfd);
 }
 
 void EpollCommNet::DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) {
-  SocketMsg msg;
-  msg.msg_type = SocketMsgType::kRequestWrite;
-  msg.request_write_msg.src_token = src_token;
-  msg.request_write_msg.dst_machine_id = Global<MachineCtx>::Get()->this_machine_id();
-  msg.request_write_msg.dst_token = dst_token;
-  msg.request_write_msg.read_id = read_id;
-  GetSocketHelper(src_machine_id)->AsyncWrite(msg);
+  const int64_t byte_size = static_cast<const SocketMemDesc*>(dst_token)->byte_size;
+  const int64_t stripe_num =
+      std::max<int64_t>(std::min<int64_t>(socket_num_per_peer_, byte_size / kMinStripeByteSize), 1);
+  const int64_t first_socket_idx =
+      read_cnt_.fetch_add(1, std::memory_order_relaxed) % socket_num_per_peer_;
+  void* stripe_cnt = nullptr;
+  if (stripe_num > 1) { stripe_cnt = new std::atomic<int64_t>(stripe_num); }
+  const BalancedSplitter bs(byte_size, stripe_num);
+  FOR_RANGE(int64_t, stripe_idx, 0, stripe_num) {
+    SocketMsg msg;
+    msg.msg_type = SocketMsgType::kRequestWrite;
+    msg.request_write_msg.src_token = src_token;
+    msg.request_write_msg.dst_machine_id = Global<MachineCtx>::Get()->this_machine_id();
+    msg.request_write_msg.dst_token = dst_token;
+    msg.request_write_msg.read_id = read_id;
+    msg.request_write_msg.offset = bs.At(stripe_idx).begin();
+    msg.request_write_msg.byte_size = bs.At(stripe_idx).size();
+    msg.request_write_msg.socket_idx = (first_socket_idx + stripe_idx) % socket_num_per_peer_;
+    msg.request_write_msg.stripe_cnt = stripe_cnt;
+    GetSocketHelper(src_machine_id, msg.request_write_msg.socket_idx)->AsyncWrite(msg);
+  }
 }
 
 }  // namespace oneflow
@@ -34,18 +34,22 @@ class EpollCommNet final : public CommNetIf<SocketMemDesc> {
   void RegisterMemoryDone() override;
 
   void SendActorMsg(int64_t dst_machine_id, const ActorMsg& msg) override;
-  void SendSocketMsg(int64_t dst_machine_id, const SocketMsg& msg);
+  void SendSocketMsg(int64_t dst_machine_id, int64_t socket_idx, const SocketMsg& msg);
+  void StripeReadDone(void* read_id, void* stripe_cnt);
+  SocketWriteStat GetWriteStat(int64_t dst_machine_id);
 
  private:
   SocketMemDesc* NewMemDesc(void* ptr, size_t byte_size) override;
 
   EpollCommNet(const Plan& plan);
   void InitSockets();
-  SocketHelper* GetSocketHelper(int64_t machine_id);
+  SocketHelper* GetSocketHelper(int64_t machine_id, int64_t socket_idx);
   void DoRead(void* read_id, int64_t src_machine_id, void* src_token, void* dst_token) override;
 
   std::vector<IOEventPoller*> pollers_;
-  std::vector<int> machine_id2sockfd_;
+  int64_t socket_num_per_peer_;
+  std::atomic<int64_t> read_cnt_;
+  std::vector<std::vector<int>> machine_id2sockfds_;
   HashMap<int, SocketHelper*> sockfd2helper_;
 };
 
@@ -0,0 +1,193 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/comm_network/epoll/epoll_comm_network.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/control/ctrl_client.h"
+#include "oneflow/core/control/ctrl_server.h"
+#include "oneflow/core/job/env.pb.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/resource_desc.h"
+
+#ifdef PLATFORM_POSIX
+
+#include <sys/wait.h>
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+constexpr int64_t kSocketNumPerPeer = 4;
+
+// unstriped, striped over some and over all of the sockets, with uneven stripes
+const std::vector<int64_t> kRegstByteSizes = {
+    1000, 9 * 1024 * 1024, 1, 4 * 1024 * 1024, 17 * 1024 * 1024 + 3, 64 * 1024 * 1024 + 5};
+
+char ExpectedByte(int64_t regst_idx, int64_t byte_idx) {
+  return static_cast<char>((byte_idx * 131 + regst_idx * 7) % 251);
+}
+
+int FindAvailablePort(uint16_t begin) {
+  for (uint16_t port = begin; port < GetMaxVal<uint16_t>(); ++port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in sa;
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    const int bind_result = bind(sock, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+    close(sock);
+    if (bind_result == 0) { return port; }
+  }
+  return -1;
+}
+
+// two machines on two loopback addresses, each process listens on its own ctrl port
+EnvProto GetEnvProto(int64_t this_machine_id, const std::vector<int>& ctrl_ports) {
+  EnvProto ret;
+  FOR_RANGE(int64_t, i, 0, ctrl_ports.size()) {
+    auto* machine = ret.add_machine();
+    machine->set_id(i);
+    machine->set_addr("127.0.0." + std::to_string(i + 1));
+    machine->set_ctrl_port_agent(ctrl_ports.at(i));
+  }
+  ret.set_ctrl_port(ctrl_ports.at(this_machine_id));
+  return ret;
+}
+
+Resource GetResource(int64_t machine_num) {
+  Resource ret;
+  ret.set_machine_num(machine_num);
+  ret.set_gpu_device_num(0);
+  ret.set_cpu_device_num(1);
+  ret.set_comm_net_worker_num(2);
+  ret.set_comm_net_socket_num_per_peer(kSocketNumPerPeer);
+  return ret;
+}
+
+Plan GetPlan(int64_t machine_num) {
+  Plan plan;
+  auto* peer_machine_ids = plan.mutable_net_topo()->mutable_peer_machine_ids();
+  FOR_RANGE(int64_t, i, 0, machine_num) {
+    FOR_RANGE(int64_t, j, 0, machine_num) {
+      if (j != i) { (*peer_machine_ids)[i].add_machine_id(j); }
+    }
+  }
+  return plan;
+}
+
+std::string GenSrcTokenKey(int64_t regst_idx) {
+  return "EpollCommNetTest/src_token/" + std::to_string(regst_idx);
+}
+
+// machine 0 serves the regsts, machine 1 reads all of them through one actor read stream
+void RunMachine(int64_t this_machine_id, const std::vector<int>& ctrl_ports) {
+  Global<EnvDesc>::New(GetEnvProto(this_machine_id, ctrl_ports));
+  Global<CtrlServer>::New();
+  Global<CtrlClient>::New();
+  CHECK_EQ(Global<EnvDesc>::Get()->GetMachineId(Global<CtrlServer>::Get()->this_machine_addr()),
+           this_machine_id);
+  Global<MachineCtx>::New(this_machine_id);
+  Global<ResourceDesc, ForEnv>::New(GetResource(ctrl_ports.size()));
+  Global<ResourceDesc, ForSession>::New(GetResource(ctrl_ports.size()));
+  EpollCommNet::Init(GetPlan(ctrl_ports.size()));
+
+  std::vector<std::vector<char>> regsts;
+  std::vector<void*> tokens;
+  for (const int64_t byte_size : kRegstByteSizes) {
+    regsts.emplace_back(byte_size);
+    tokens.push_back(Global<CommNet>::Get()->RegisterMemory(regsts.back().data(), byte_size));
+  }
+  Global<CommNet>::Get()->RegisterMemoryDone();
+  if (this_machine_id == 0) {
+    FOR_RANGE(int64_t, i, 0, regsts.size()) {
+      FOR_RANGE(int64_t, j, 0, regsts.at(i).size()) { regsts.at(i).at(j) = ExpectedByte(i, j); }
+      Global<CtrlClient>::Get()->PushKVT(GenSrcTokenKey(i),
+                                         reinterpret_cast<uint64_t>(tokens.at(i)));
+    }
+  } else {
+    std::mutex mtx;
+    std::vector<int64_t> done_regst_idxs;
+    std::vector<bool> intact(regsts.size(), false);
+    BlockingCounter counter(regsts.size());
+    void* actor_read_id = Global<CommNet>::Get()->NewActorReadId();
+    FOR_RANGE(int64_t, i, 0, regsts.size()) {
+      uint64_t src_token = 0;
+      Global<CtrlClient>::Get()->PullKVT(GenSrcTokenKey(i), &src_token);
+      Global<CommNet>::Get()->Read(actor_read_id, 0, reinterpret_cast<void*>(src_token),
+                                   tokens.at(i));
+      // runs once read i and all reads before it are done
+      Global<CommNet>::Get()->AddReadCallBack(actor_read_id, [&, i]() {
+        bool is_intact = true;
+        FOR_RANGE(int64_t, j, 0, regsts.at(i).size()) {
+          if (regsts.at(i).at(j) != ExpectedByte(i, j)) {
+            is_intact = false;
+            break;
+          }
+        }
+        {
+          std::unique_lock<std::mutex> lock(mtx);
+          done_regst_idxs.push_back(i);
+          intact.at(i) = is_intact;
+        }
+        counter.Decrease();
+      });
+    }
+    counter.WaitUntilCntEqualZero();
+    Global<CommNet>::Get()->DeleteActorReadId(actor_read_id);
+    std::vector<int64_t> expected_regst_idxs(regsts.size());
+    std::iota(expected_regst_idxs.begin(), expected_regst_idxs.end(), 0);
+    EXPECT_EQ(done_regst_idxs, expected_regst_idxs);
+    FOR_RANGE(int64_t, i, 0, regsts.size()) { EXPECT_TRUE(intact.at(i)) << i; }
+  }
+  // the pollers of machine 0 serve the reads until machine 1 is done
+  OF_BARRIER();
+  for (void* token : tokens) { Global<CommNet>::Get()->UnRegisterMemory(token); }
+  Global<CommNet>::Delete();
+  Global<ResourceDesc, ForSession>::Delete();
+  Global<ResourceDesc, ForEnv>::Delete();
+  Global<MachineCtx>::Delete();
+  Global<CtrlClient>::Delete();
+  Global<CtrlServer>::Delete();
+  Global<EnvDesc>::Delete();
+}
+
+}  // namespace
+
+TEST(EpollCommNet, striped_reads_between_two_processes) {
+  const int port0 = FindAvailablePort(10000);
+  if (port0 == -1) { return; }
+  const int port1 = FindAvailablePort(port0 + 1);
+  if (port1 == -1) { return; }
+  const std::vector<int> ctrl_ports = {port0, port1};
+  const pid_t pid = fork();
+  PCHECK(pid != -1);
+  if (pid == 0) {
+    RunMachine(1, ctrl_ports);
+    _exit(::testing::Test::HasFailure() ? 1 : 0);
+  }
+  RunMachine(0, ctrl_ports);
+  int status = 0;
+  PCHECK(waitpid(pid, &status, 0) == pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+}
+
+}  // namespace test
+
+}  // namespace oneflow
+
+#endif  // PLATFORM_POSIX
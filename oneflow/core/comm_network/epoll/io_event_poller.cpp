@@ -93,8 +93,16 @@ void IOEventPoller::EpollLoop() {
     const epoll_event* cur_event = ep_events_;
     for (int event_idx = 0; event_idx < event_num; ++event_idx, ++cur_event) {
       auto io_handler = static_cast<IOHandler*>(cur_event->data.ptr);
-      PCHECK(!(cur_event->events & EPOLLERR)) << "fd: " << io_handler->fd;
       if (io_handler->fd == break_epoll_loop_fd_) { return; }
+      if (cur_event->events & EPOLLERR) {
+        // MSG_ZEROCOPY completions on the socket error queue are reported as EPOLLERR as well,
+        // they are reaped by the write handler
+        int sock_err = 0;
+        socklen_t len = sizeof(sock_err);
+        PCHECK(getsockopt(io_handler->fd, SOL_SOCKET, SO_ERROR, &sock_err, &len) == 0)
+            << "fd: " << io_handler->fd;
+        CHECK_EQ(sock_err, 0) << "fd: " << io_handler->fd;
+      }
       if (cur_event->events & EPOLLIN) {
         if (cur_event->events & EPOLLRDHUP) {
           LOG(FATAL) << "fd " << io_handler->fd << " closed by peer";
@@ -102,7 +110,7 @@ void IOEventPoller::EpollLoop() {
           io_handler->read_handler();
         }
       }
-      if (cur_event->events & EPOLLOUT) { io_handler->write_handler(); }
+      if (cur_event->events & (EPOLLOUT | EPOLLERR)) { io_handler->write_handler(); }
     }
   }
 }
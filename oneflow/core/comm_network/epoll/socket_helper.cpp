@@ -33,6 +33,8 @@ SocketHelper::~SocketHelper() {
 
 void SocketHelper::AsyncWrite(const SocketMsg& msg) { write_helper_->AsyncWrite(msg); }
 
+SocketWriteStat SocketHelper::GetWriteStat() const { return write_helper_->GetWriteStat(); }
+
 }  // namespace oneflow
 
 #endif  // PLATFORM_POSIX
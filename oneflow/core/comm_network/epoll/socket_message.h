@@ -29,6 +29,7 @@ limitations under the License.
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include "oneflow/core/actor/actor_message.h"
 
@@ -45,17 +46,29 @@ enum class SocketMsgType {
 #undef MAKE_ENTRY
 };
 
+// A large read is split into stripes which travel over different sockets of the same peer.
+// [offset, offset + byte_size) is the part of the register carried by this message,
+// stripe_cnt points to the number of unfinished stripes on the reading machine, or is nullptr
+// if the read is not striped.
 struct RequestWriteMsg {
   void* src_token;
   int64_t dst_machine_id;
   void* dst_token;
   void* read_id;
+  int64_t offset;
+  int64_t byte_size;
+  int64_t socket_idx;
+  void* stripe_cnt;
 };
 
 struct RequestReadMsg {
   void* src_token;
   void* dst_token;
   void* read_id;
+  int64_t offset;
+  int64_t byte_size;
+  int64_t socket_idx;
+  void* stripe_cnt;
 };
 
 struct SocketMsg {
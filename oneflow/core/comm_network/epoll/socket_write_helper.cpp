@@ -15,13 +15,24 @@ limitations under the License.
 */
 #include "oneflow/core/comm_network/epoll/socket_write_helper.h"
 #include "oneflow/core/comm_network/epoll/socket_memory_desc.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
 
 #ifdef PLATFORM_POSIX
 
 #include <sys/eventfd.h>
+#include <linux/errqueue.h>
 
 namespace oneflow {
 
+namespace {
+
+constexpr size_t kMaxBatchMsgNum = 64;
+constexpr size_t kMaxIovNumPerSyscall = 128;
+constexpr size_t kZeroCopyMinByteSize = 64 * 1024;
+
+}  // namespace
+
 SocketWriteHelper::~SocketWriteHelper() {
   delete cur_msg_queue_;
   cur_msg_queue_ = nullptr;
@@ -40,9 +51,20 @@ SocketWriteHelper::SocketWriteHelper(int sockfd, IOEventPoller* poller) {
                                    std::bind(&SocketWriteHelper::ProcessQueueNotEmptyEvent, this));
   cur_msg_queue_ = new std::queue<SocketMsg>;
   pending_msg_queue_ = new std::queue<SocketMsg>;
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-  write_ptr_ = nullptr;
-  write_size_ = 0;
+  batch_msgs_.reserve(kMaxBatchMsgNum);
+  batch_iovs_.reserve(2 * kMaxBatchMsgNum);
+  batch_iov_idx_ = 0;
+  batch_remaining_byte_size_ = 0;
+  zero_copy_enabled_ = false;
+  batch_zero_copy_ = false;
+  zero_copy_send_cnt_ = 0;
+  zero_copy_completed_cnt_ = 0;
+  syscall_cnt_ = 0;
+  msg_cnt_ = 0;
+  byte_cnt_ = 0;
+  if (Global<ResourceDesc, ForSession>::Get()->comm_net_enable_zero_copy()) {
+    TryEnableZeroCopy();
+  }
 }
 
 void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
@@ -53,7 +75,18 @@ void SocketWriteHelper::AsyncWrite(const SocketMsg& msg) {
   if (need_send_event) { SendQueueNotEmptyEvent(); }
 }
 
-void SocketWriteHelper::NotifyMeSocketWriteable() { WriteUntilMsgQueueEmptyOrSocketNotWriteable(); }
+void SocketWriteHelper::NotifyMeSocketWriteable() {
+  if (zero_copy_enabled_) { DrainZeroCopyCompletions(); }
+  WriteUntilMsgQueueEmptyOrSocketNotWriteable();
+}
+
+SocketWriteStat SocketWriteHelper::GetWriteStat() const {
+  SocketWriteStat stat;
+  stat.syscall_cnt = syscall_cnt_.load(std::memory_order_relaxed);
+  stat.msg_cnt = msg_cnt_.load(std::memory_order_relaxed);
+  stat.byte_cnt = byte_cnt_.load(std::memory_order_relaxed);
+  return stat;
+}
 
 void SocketWriteHelper::SendQueueNotEmptyEvent() {
   uint64_t event_num = 1;
@@ -67,10 +100,13 @@ void SocketWriteHelper::ProcessQueueNotEmptyEvent() {
 }
 
 void SocketWriteHelper::WriteUntilMsgQueueEmptyOrSocketNotWriteable() {
-  while ((this->*cur_write_handle_)()) {}
+  while (true) {
+    if (batch_iov_idx_ == batch_iovs_.size() && !InitBatch()) { return; }
+    if (!WriteBatch()) { return; }
+  }
 }
 
-bool SocketWriteHelper::InitMsgWriteHandle() {
+bool SocketWriteHelper::InitBatch() {
   if (cur_msg_queue_->empty()) {
     {
       std::unique_lock<std::mutex> lck(pending_msg_queue_mtx_);
@@ -78,66 +114,122 @@ bool SocketWriteHelper::InitMsgWriteHandle() {
     }
     if (cur_msg_queue_->empty()) { return false; }
   }
-  cur_msg_ = cur_msg_queue_->front();
-  cur_msg_queue_->pop();
-  write_ptr_ = reinterpret_cast<const char*>(&cur_msg_);
-  write_size_ = sizeof(cur_msg_);
-  cur_write_handle_ = &SocketWriteHelper::MsgHeadWriteHandle;
+  if (batch_zero_copy_) {
+    zero_copy_batches_.emplace_back(zero_copy_send_cnt_, std::move(batch_msgs_));
+    batch_msgs_ = std::vector<SocketMsg>();
+    batch_msgs_.reserve(kMaxBatchMsgNum);
+    batch_zero_copy_ = false;
+  }
+  batch_msgs_.clear();
+  batch_iovs_.clear();
+  batch_iov_idx_ = 0;
+  batch_remaining_byte_size_ = 0;
+  while (!cur_msg_queue_->empty() && batch_msgs_.size() < kMaxBatchMsgNum) {
+    batch_msgs_.push_back(cur_msg_queue_->front());
+    cur_msg_queue_->pop();
+  }
+  // batch_msgs_ is not resized any more, so the iovecs can point into it
+  for (SocketMsg& msg : batch_msgs_) {
+    iovec head;
+    head.iov_base = &msg;
+    head.iov_len = sizeof(SocketMsg);
+    batch_iovs_.push_back(head);
+    if (msg.msg_type == SocketMsgType::kRequestRead) {
+      auto src_mem_desc = static_cast<const SocketMemDesc*>(msg.request_read_msg.src_token);
+      const RequestReadMsg& request_read_msg = msg.request_read_msg;
+      CHECK_LE(request_read_msg.offset + request_read_msg.byte_size, src_mem_desc->byte_size);
+      if (request_read_msg.byte_size > 0) {
+        iovec body;
+        body.iov_base = static_cast<char*>(src_mem_desc->mem_ptr) + request_read_msg.offset;
+        body.iov_len = request_read_msg.byte_size;
+        batch_iovs_.push_back(body);
+      }
+    }
+  }
+  for (const iovec& iov : batch_iovs_) { batch_remaining_byte_size_ += iov.iov_len; }
+  msg_cnt_.fetch_add(batch_msgs_.size(), std::memory_order_relaxed);
   return true;
 }
 
-bool SocketWriteHelper::MsgHeadWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgHeadDone);
-}
-
-bool SocketWriteHelper::MsgBodyWriteHandle() {
-  return DoCurWrite(&SocketWriteHelper::SetStatusWhenMsgBodyDone);
-}
-
-bool SocketWriteHelper::DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)()) {
-  ssize_t n = write(sockfd_, write_ptr_, write_size_);
-  if (n == write_size_) {
-    (this->*set_cur_write_done)();
-    return true;
-  } else if (n >= 0) {
-    write_ptr_ += n;
-    write_size_ -= n;
-    return true;
-  } else {
+bool SocketWriteHelper::WriteBatch() {
+  msghdr msg;
+  std::memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = batch_iovs_.data() + batch_iov_idx_;
+  msg.msg_iovlen = std::min(batch_iovs_.size() - batch_iov_idx_, kMaxIovNumPerSyscall);
+  int flags = 0;
+#ifdef MSG_ZEROCOPY
+  if (zero_copy_enabled_ && batch_remaining_byte_size_ >= kZeroCopyMinByteSize) {
+    flags |= MSG_ZEROCOPY;
+  }
+#endif
+  ssize_t n = sendmsg(sockfd_, &msg, flags);
+  if (n < 0) {
     CHECK_EQ(n, -1);
-    PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+    // ENOBUFS means too many zero copy completions are not reaped yet, they arrive with EPOLLERR
+    PCHECK(errno == EAGAIN || errno == EWOULDBLOCK || (zero_copy_enabled_ && errno == ENOBUFS));
     return false;
   }
-}
-
-void SocketWriteHelper::SetStatusWhenMsgHeadDone() {
-  switch (cur_msg_.msg_type) {
-#define MAKE_ENTRY(x, y) \
-  case SocketMsgType::k##x: return SetStatusWhen##x##MsgHeadDone();
-    OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
-    default: UNIMPLEMENTED();
+  syscall_cnt_.fetch_add(1, std::memory_order_relaxed);
+  byte_cnt_.fetch_add(n, std::memory_order_relaxed);
+  if (flags != 0) {
+    zero_copy_send_cnt_ += 1;
+    batch_zero_copy_ = true;
   }
+  batch_remaining_byte_size_ -= n;
+  size_t written = n;
+  while (written > 0) {
+    iovec* iov = &batch_iovs_.at(batch_iov_idx_);
+    if (written >= iov->iov_len) {
+      written -= iov->iov_len;
+      batch_iov_idx_ += 1;
+    } else {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+      iov->iov_len -= written;
+      written = 0;
+    }
+  }
+  while (batch_iov_idx_ < batch_iovs_.size() && batch_iovs_.at(batch_iov_idx_).iov_len == 0) {
+    batch_iov_idx_ += 1;
+  }
+  return true;
 }
 
-void SocketWriteHelper::SetStatusWhenMsgBodyDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestWriteMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
-}
-
-void SocketWriteHelper::SetStatusWhenRequestReadMsgHeadDone() {
-  const void* src_token = cur_msg_.request_read_msg.src_token;
-  auto src_mem_desc = static_cast<const SocketMemDesc*>(src_token);
-  write_ptr_ = reinterpret_cast<const char*>(src_mem_desc->mem_ptr);
-  write_size_ = src_mem_desc->byte_size;
-  cur_write_handle_ = &SocketWriteHelper::MsgBodyWriteHandle;
+void SocketWriteHelper::TryEnableZeroCopy() {
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+  const int val = 1;
+  if (setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &val, sizeof(val)) == 0) {
+    zero_copy_enabled_ = true;
+  } else {
+    LOG(WARNING) << "SO_ZEROCOPY is not supported on sockfd " << sockfd_ << ", errno " << errno;
+  }
+#else
+  LOG(WARNING) << "MSG_ZEROCOPY is not supported by this build";
+#endif
 }
 
-void SocketWriteHelper::SetStatusWhenActorMsgHeadDone() {
-  cur_write_handle_ = &SocketWriteHelper::InitMsgWriteHandle;
+void SocketWriteHelper::DrainZeroCopyCompletions() {
+  while (zero_copy_completed_cnt_ < zero_copy_send_cnt_) {
+    char control[128];
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(sockfd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+      PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+      return;
+    }
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm)) {
+      auto serr = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cm));
+      if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) { continue; }
+      // [ee_info, ee_data] is the range of completed zero copy sendmsg calls, tcp completes
+      // them in order
+      zero_copy_completed_cnt_ = std::max<uint64_t>(zero_copy_completed_cnt_, serr->ee_data + 1);
+    }
+  }
+  while (!zero_copy_batches_.empty()
+         && zero_copy_batches_.front().first <= zero_copy_completed_cnt_) {
+    zero_copy_batches_.pop_front();
+  }
 }
 
 }  // namespace oneflow
@@ -23,6 +23,15 @@ limitations under the License.
 
 namespace oneflow {
 
+struct SocketWriteStat {
+  int64_t syscall_cnt;
+  int64_t msg_cnt;
+  int64_t byte_cnt;
+};
+
+// All the messages queued while the poller thread is busy are coalesced into one sendmsg() with
+// an iovec per message head and per payload, so the flush latency is bounded by one poller
+// wakeup and no message is held back waiting for more.
 class SocketWriteHelper final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(SocketWriteHelper);
@@ -35,22 +44,17 @@ class SocketWriteHelper final {
 
   void NotifyMeSocketWriteable();
 
+  SocketWriteStat GetWriteStat() const;
+
  private:
   void SendQueueNotEmptyEvent();
   void ProcessQueueNotEmptyEvent();
 
   void WriteUntilMsgQueueEmptyOrSocketNotWriteable();
-  bool InitMsgWriteHandle();
-  bool MsgHeadWriteHandle();
-  bool MsgBodyWriteHandle();
-
-  bool DoCurWrite(void (SocketWriteHelper::*set_cur_write_done)());
-  void SetStatusWhenMsgHeadDone();
-  void SetStatusWhenMsgBodyDone();
-
-#define MAKE_ENTRY(x, y) void SetStatusWhen##x##MsgHeadDone();
-  OF_PP_FOR_EACH_TUPLE(MAKE_ENTRY, SOCKET_MSG_TYPE_SEQ);
-#undef MAKE_ENTRY
+  bool InitBatch();
+  bool WriteBatch();
+  void TryEnableZeroCopy();
+  void DrainZeroCopyCompletions();
 
   int sockfd_;
   int queue_not_empty_fd_;
@@ -60,10 +64,23 @@ class SocketWriteHelper final {
   std::mutex pending_msg_queue_mtx_;
   std::queue<SocketMsg>* pending_msg_queue_;
 
-  SocketMsg cur_msg_;
-  bool (SocketWriteHelper::*cur_write_handle_)();
-  const char* write_ptr_;
-  size_t write_size_;
+  std::vector<SocketMsg> batch_msgs_;
+  std::vector<iovec> batch_iovs_;
+  size_t batch_iov_idx_;
+  size_t batch_remaining_byte_size_;
+
+  bool zero_copy_enabled_;
+  bool batch_zero_copy_;
+  // sequence numbers the kernel gives zero copy sendmsg calls, counted from 0
+  uint64_t zero_copy_send_cnt_;
+  uint64_t zero_copy_completed_cnt_;
+  // message heads of fully sent batches are referenced by zero copy sends until the kernel
+  // reports them complete, each batch is kept with the count of zero copy sends it used
+  std::deque<std::pair<uint64_t, std::vector<SocketMsg>>> zero_copy_batches_;
+
+  std::atomic<int64_t> syscall_cnt_;
+  std::atomic<int64_t> msg_cnt_;
+  std::atomic<int64_t> byte_cnt_;
 };
 
 }  // namespace oneflow
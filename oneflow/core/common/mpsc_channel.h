@@ -0,0 +1,275 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+#define ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/common/channel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace oneflow {
+
+constexpr size_t kMpscChannelCacheLineSize = 64;
+
+inline void MpscChannelCpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Multi-producer/single-consumer channel with the same interface as Channel<T>.
+// Producers enqueue with a single atomic exchange onto a linked list (Vyukov's MPSC queue),
+// the consumer spins for an adaptive number of rounds before parking on a condition variable.
+// The mutex is only touched when the consumer is actually parked.
+// Nodes released by the consumer go to a free list which producers take them from, so a
+// channel in steady state does not allocate. The free list is kept until the channel is
+// destroyed and holds at most as many nodes as the channel once had queued items.
+// A Send that returns kChannelStatusSuccess is always received, even when it races Close.
+// Receive/ReceiveMany must only be called from one thread at a time.
+template<typename T>
+class MpscChannel final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(MpscChannel);
+  MpscChannel();
+  ~MpscChannel();
+
+  ChannelStatus Send(const T& item);
+  ChannelStatus Receive(T* item);
+  ChannelStatus ReceiveMany(std::queue<T>* items);
+  void Close();
+
+ private:
+  struct Node {
+    explicit Node(const T& val) : next(nullptr), value(val) {}
+    Node() : next(nullptr) {}
+    std::atomic<Node*> next;
+    T value;
+  };
+  static const int32_t kMinSpinRound = 16;
+  static const int32_t kMaxSpinRound = 4096;
+
+  Node* AcquireNode(const T& item);
+  void ReleaseNode(Node* node);
+  void Push(Node* node);
+  Node* TryPop();
+  bool Empty() const;
+  bool IsClosedAndDrained() const;
+  template<typename ConsumeT>
+  ChannelStatus WaitAndConsume(const ConsumeT& Consume);
+  void WakeUpConsumer();
+
+  // written by producers
+  alignas(kMpscChannelCacheLineSize) std::atomic<Node*> head_;
+  std::atomic<bool> is_closed_;
+  // Sends which passed the closed check and have not finished pushing
+  std::atomic<int64_t> active_sender_cnt_;
+  // pushed to by the consumer, popped by the one producer holding free_nodes_pop_lock_, a
+  // stack with a single popper has no ABA problem
+  alignas(kMpscChannelCacheLineSize) std::atomic<Node*> free_nodes_;
+  std::atomic_flag free_nodes_pop_lock_;
+  // written by the consumer
+  alignas(kMpscChannelCacheLineSize) Node* tail_;
+  int32_t spin_round_;
+  // spinning on a single core only steals the producers' time slice
+  bool yield_when_spin_;
+  // 1 if the consumer is parked or about to park
+  alignas(kMpscChannelCacheLineSize) std::atomic<int32_t> consumer_parked_;
+  std::mutex park_mutex_;
+  std::condition_variable park_cond_;
+  Node stub_;
+};
+
+template<typename T>
+const int32_t MpscChannel<T>::kMinSpinRound;
+
+template<typename T>
+const int32_t MpscChannel<T>::kMaxSpinRound;
+
+template<typename T>
+MpscChannel<T>::MpscChannel()
+    : head_(&stub_),
+      is_closed_(false),
+      active_sender_cnt_(0),
+      free_nodes_(nullptr),
+      tail_(&stub_),
+      spin_round_(kMinSpinRound),
+      yield_when_spin_(std::thread::hardware_concurrency() <= 1),
+      consumer_parked_(0) {
+  free_nodes_pop_lock_.clear();
+}
+
+template<typename T>
+MpscChannel<T>::~MpscChannel() {
+  while (TryPop() != nullptr) {}
+  if (tail_ != &stub_) { delete tail_; }
+  Node* node = free_nodes_.load(std::memory_order_acquire);
+  while (node != nullptr) {
+    Node* next = node->next.load(std::memory_order_relaxed);
+    delete node;
+    node = next;
+  }
+}
+
+template<typename T>
+typename MpscChannel<T>::Node* MpscChannel<T>::AcquireNode(const T& item) {
+  Node* node = nullptr;
+  // a producer losing the lock allocates rather than waits, Send never blocks
+  if (!free_nodes_pop_lock_.test_and_set(std::memory_order_acquire)) {
+    node = free_nodes_.load(std::memory_order_acquire);
+    while (node != nullptr
+           && !free_nodes_.compare_exchange_weak(node, node->next.load(std::memory_order_relaxed),
+                                                 std::memory_order_acquire)) {}
+    free_nodes_pop_lock_.clear(std::memory_order_release);
+  }
+  if (node == nullptr) { return new Node(item); }
+  node->next.store(nullptr, std::memory_order_relaxed);
+  node->value = item;
+  return node;
+}
+
+template<typename T>
+void MpscChannel<T>::ReleaseNode(Node* node) {
+  Node* top = free_nodes_.load(std::memory_order_relaxed);
+  do {
+    node->next.store(top, std::memory_order_relaxed);
+  } while (!free_nodes_.compare_exchange_weak(top, node, std::memory_order_release,
+                                              std::memory_order_relaxed));
+}
+
+template<typename T>
+void MpscChannel<T>::Push(Node* node) {
+  Node* prev = head_.exchange(node, std::memory_order_seq_cst);
+  prev->next.store(node, std::memory_order_release);
+}
+
+template<typename T>
+typename MpscChannel<T>::Node* MpscChannel<T>::TryPop() {
+  Node* tail = tail_;
+  Node* next = tail->next.load(std::memory_order_acquire);
+  if (next == nullptr) {
+    if (tail == head_.load(std::memory_order_seq_cst)) { return nullptr; }
+    // a producer has swung head_ but not yet linked its node
+    do {
+      MpscChannelCpuRelax();
+      next = tail->next.load(std::memory_order_acquire);
+    } while (next == nullptr);
+  }
+  tail_ = next;
+  if (tail != &stub_) { ReleaseNode(tail); }
+  // the returned node stays alive as the new tail until the next pop
+  return next;
+}
+
+template<typename T>
+bool MpscChannel<T>::Empty() const {
+  return tail_->next.load(std::memory_order_acquire) == nullptr
+         && tail_ == head_.load(std::memory_order_seq_cst);
+}
+
+template<typename T>
+void MpscChannel<T>::WakeUpConsumer() {
+  if (consumer_parked_.load(std::memory_order_seq_cst) == 0) { return; }
+  if (consumer_parked_.exchange(0, std::memory_order_seq_cst) == 1) {
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    park_cond_.notify_one();
+  }
+}
+
+template<typename T>
+bool MpscChannel<T>::IsClosedAndDrained() const {
+  // a Send counted before the load of is_closed_ has its node pushed before it leaves the count
+  return is_closed_.load(std::memory_order_seq_cst)
+         && active_sender_cnt_.load(std::memory_order_seq_cst) == 0 && Empty();
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::Send(const T& item) {
+  // counted before the closed check, so the consumer cannot see Close and an empty queue while
+  // this item is still on its way
+  active_sender_cnt_.fetch_add(1, std::memory_order_seq_cst);
+  if (is_closed_.load(std::memory_order_seq_cst)) {
+    active_sender_cnt_.fetch_sub(1, std::memory_order_seq_cst);
+    return kChannelStatusErrorClosed;
+  }
+  Push(AcquireNode(item));
+  active_sender_cnt_.fetch_sub(1, std::memory_order_seq_cst);
+  // also wakes a consumer which parked on a closed channel waiting for this Send to finish
+  WakeUpConsumer();
+  return kChannelStatusSuccess;
+}
+
+template<typename T>
+template<typename ConsumeT>
+ChannelStatus MpscChannel<T>::WaitAndConsume(const ConsumeT& Consume) {
+  int32_t spin_cnt = 0;
+  while (true) {
+    Node* node = TryPop();
+    if (node != nullptr) {
+      Consume(node);
+      if (spin_cnt > 0) { spin_round_ = std::min(spin_round_ * 2, kMaxSpinRound); }
+      return kChannelStatusSuccess;
+    }
+    if (IsClosedAndDrained()) { return kChannelStatusErrorClosed; }
+    if (spin_cnt < spin_round_) {
+      ++spin_cnt;
+      if (yield_when_spin_) {
+        std::this_thread::yield();
+      } else {
+        MpscChannelCpuRelax();
+      }
+      continue;
+    }
+    spin_round_ = std::max(spin_round_ / 2, kMinSpinRound);
+    consumer_parked_.store(1, std::memory_order_seq_cst);
+    if (!Empty() || IsClosedAndDrained()) {
+      consumer_parked_.store(0, std::memory_order_relaxed);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(park_mutex_);
+    park_cond_.wait(lock, [this]() {
+      return consumer_parked_.load(std::memory_order_seq_cst) == 0;
+    });
+    spin_cnt = 0;
+  }
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::Receive(T* item) {
+  return WaitAndConsume([item](Node* node) { *item = std::move(node->value); });
+}
+
+template<typename T>
+ChannelStatus MpscChannel<T>::ReceiveMany(std::queue<T>* items) {
+  return WaitAndConsume([this, items](Node* node) {
+    items->push(std::move(node->value));
+    while ((node = TryPop()) != nullptr) { items->push(std::move(node->value)); }
+  });
+}
+
+template<typename T>
+void MpscChannel<T>::Close() {
+  is_closed_.store(true, std::memory_order_seq_cst);
+  WakeUpConsumer();
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_COMMON_MPSC_CHANNEL_H_
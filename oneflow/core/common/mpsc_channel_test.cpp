@@ -0,0 +1,124 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/common/mpsc_channel.h"
+#include "oneflow/core/common/range.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename ChannelT>
+void SendRange(ChannelT* channel, Range range) {
+  for (int64_t i = range.begin(); i < range.end(); ++i) {
+    if (channel->Send(i) != kChannelStatusSuccess) { break; }
+  }
+}
+
+template<typename ChannelT>
+void ReceiveAll(ChannelT* channel, std::vector<int64_t>* visit) {
+  std::queue<int64_t> items;
+  while (channel->ReceiveMany(&items) == kChannelStatusSuccess) {
+    while (!items.empty()) {
+      ++visit->at(items.front());
+      items.pop();
+    }
+  }
+}
+
+template<typename ChannelT>
+double MsgsPerSecond(int32_t sender_num, int64_t msg_num_per_sender) {
+  ChannelT channel;
+  std::vector<int64_t> visit(msg_num_per_sender, 0);
+  auto start = std::chrono::steady_clock::now();
+  std::thread receiver(ReceiveAll<ChannelT>, &channel, &visit);
+  std::vector<std::thread> senders;
+  for (int32_t i = 0; i < sender_num; ++i) {
+    senders.push_back(std::thread(SendRange<ChannelT>, &channel, Range(0, msg_num_per_sender)));
+  }
+  for (std::thread& sender : senders) { sender.join(); }
+  channel.Close();
+  receiver.join();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  for (int64_t cnt : visit) { CHECK_EQ(cnt, sender_num); }
+  return sender_num * msg_num_per_sender / elapsed.count();
+}
+
+}  // namespace
+
+TEST(MpscChannel, 30sender1receiver) {
+  MpscChannel<int64_t> channel;
+  int32_t sender_num = 30;
+  int64_t range_num = 2000;
+  std::vector<int64_t> visit(range_num, 0);
+  std::thread receiver(ReceiveAll<MpscChannel<int64_t>>, &channel, &visit);
+  std::vector<std::thread> senders;
+  for (int32_t i = 0; i < sender_num; ++i) {
+    senders.push_back(std::thread(SendRange<MpscChannel<int64_t>>, &channel, Range(0, range_num)));
+  }
+  for (std::thread& sender : senders) { sender.join(); }
+  channel.Close();
+  receiver.join();
+  for (int64_t i = 0; i < range_num; ++i) { ASSERT_EQ(visit.at(i), sender_num); }
+}
+
+TEST(MpscChannel, receive_in_order_and_close) {
+  MpscChannel<int64_t> channel;
+  FOR_RANGE(int64_t, i, 0, 100) { ASSERT_EQ(channel.Send(i), kChannelStatusSuccess); }
+  channel.Close();
+  ASSERT_EQ(channel.Send(100), kChannelStatusErrorClosed);
+  int64_t item = -1;
+  FOR_RANGE(int64_t, i, 0, 100) {
+    ASSERT_EQ(channel.Receive(&item), kChannelStatusSuccess);
+    ASSERT_EQ(item, i);
+  }
+  ASSERT_EQ(channel.Receive(&item), kChannelStatusErrorClosed);
+}
+
+TEST(MpscChannel, successful_sends_racing_close_are_received) {
+  FOR_RANGE(int32_t, round, 0, 50) {
+    MpscChannel<int64_t> channel;
+    const int32_t sender_num = 4;
+    std::atomic<int64_t> sent_cnt(0);
+    std::vector<std::thread> senders;
+    FOR_RANGE(int32_t, i, 0, sender_num) {
+      senders.push_back(std::thread([&channel, &sent_cnt]() {
+        while (channel.Send(1) == kChannelStatusSuccess) { sent_cnt += 1; }
+      }));
+    }
+    int64_t received_cnt = 0;
+    std::thread receiver([&channel, &received_cnt]() {
+      int64_t item = 0;
+      while (channel.Receive(&item) == kChannelStatusSuccess) { received_cnt += item; }
+    });
+    std::this_thread::sleep_for(std::chrono::microseconds(100 * (round % 5)));
+    channel.Close();
+    for (std::thread& sender : senders) { sender.join(); }
+    receiver.join();
+    ASSERT_EQ(received_cnt, sent_cnt.load());
+  }
+}
+
+TEST(MpscChannel, DISABLED_throughput_vs_channel) {
+  const int64_t msg_num_per_sender = 200000;
+  for (int32_t sender_num : {1, 4, 8}) {
+    double channel_rate = MsgsPerSecond<Channel<int64_t>>(sender_num, msg_num_per_sender);
+    double mpsc_rate = MsgsPerSecond<MpscChannel<int64_t>>(sender_num, msg_num_per_sender);
+    LOG(INFO) << "senders: " << sender_num << ", Channel: " << channel_rate
+              << " msgs/sec, MpscChannel: " << mpsc_rate << " msgs/sec";
+  }
+}
+
+}  // namespace oneflow
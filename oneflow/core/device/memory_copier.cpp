@@ -15,7 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/device/memory_copier.h"
 #include "oneflow/core/common/auto_registration_factory.h"
-#include "oneflow/core/common/nd_index_offset_helper.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
@@ -30,7 +30,7 @@ void CheckPosExtent(const int64_t num_axes, const Shape& shape, const NdIndex& p
   CHECK_EQ(extent.NumAxes(), num_axes);
   FOR_RANGE(int64_t, i, 0, num_axes) {
     CHECK_GE(pos.At(i), 0);
-    CHECK_GT(extent.At(i), 0);
+    CHECK_GE(extent.At(i), 0);
     CHECK_GT(shape.At(i), 0);
     CHECK_LE(pos.At(i) + extent.At(i), shape.At(i));
   }
@@ -75,30 +75,93 @@ MemoryCopyNdDesc GetDescInBytes(const MemoryCopyNdDesc& desc) {
   return desc_in_bytes;
 }
 
-}  // namespace
+// bytes one host copy task moves, and the copy size worth splitting into such tasks
+constexpr int64_t kHostCopyGrainBytes = 256 * 1024;
+constexpr int64_t kHostCopyParallelBytes = 4 * kHostCopyGrainBytes;
 
-template<int32_t NDIMS>
-void CopyNDCpuImpl(DeviceCtx* ctx, void* dst, const void* src, const MemoryCopyNdDesc& desc) {
-  NdIndexOffsetHelper<int64_t, NDIMS> src_helper(desc.src_shape.dim_vec().data());
-  NdIndexOffsetHelper<int64_t, NDIMS> dst_helper(desc.dst_shape.dim_vec().data());
-  NdIndexOffsetHelper<int64_t, NDIMS> copy_helper(desc.extent.dim_vec().data());
-  FOR_RANGE(int64_t, i, 0, desc.extent.elem_cnt()) {
-    int64_t copy_idx[NDIMS];
-    int64_t src_idx[NDIMS];
-    int64_t dst_idx[NDIMS];
-    copy_helper.OffsetToNdIndex(i, copy_idx);
-    FOR_RANGE(int64_t, j, 0, NDIMS) {
-      src_idx[j] = desc.src_pos.At(j) + copy_idx[j];
-      dst_idx[j] = desc.dst_pos.At(j) + copy_idx[j];
+// Copies the desc (in bytes) as memcpy runs of its innermost rows. Axes which are contiguous
+// with the axis inside them in both src and dst are merged first, so a slice of whole rows or a
+// copy of a full tensor turns into a few long runs. The outer index of a row is only computed at
+// the start of a task and advanced as an odometer afterwards.
+void HostCopyNd(void* dst, const void* src, const MemoryCopyNdDesc& desc) {
+  // a zero extent on any axis copies nothing, and the odometer below would divide by it
+  if (desc.extent.elem_cnt() == 0) { return; }
+  const int64_t num_axes = MemoryCopyNdDescGetNumAxes(desc);
+  int64_t extent[SHAPE_MAX_AXIS_SIZE] = {};
+  int64_t dst_stride[SHAPE_MAX_AXIS_SIZE];
+  int64_t src_stride[SHAPE_MAX_AXIS_SIZE];
+  int64_t num_dims = 0;
+  int64_t dst_offset = 0;
+  int64_t src_offset = 0;
+  int64_t dst_axis_stride = 1;
+  int64_t src_axis_stride = 1;
+  // collapsed dims are collected innermost first
+  for (int64_t i = num_axes - 1; i >= 0; --i) {
+    dst_offset += desc.dst_pos.At(i) * dst_axis_stride;
+    src_offset += desc.src_pos.At(i) * src_axis_stride;
+    const int64_t dim_extent = desc.extent.At(i);
+    if (num_dims > 0 && dst_axis_stride == dst_stride[num_dims - 1] * extent[num_dims - 1]
+        && src_axis_stride == src_stride[num_dims - 1] * extent[num_dims - 1]) {
+      extent[num_dims - 1] *= dim_extent;
+    } else if (dim_extent != 1 || num_dims == 0) {
+      extent[num_dims] = dim_extent;
+      dst_stride[num_dims] = dst_axis_stride;
+      src_stride[num_dims] = src_axis_stride;
+      num_dims += 1;
+    }
+    dst_axis_stride *= desc.dst_shape.At(i);
+    src_axis_stride *= desc.src_shape.At(i);
+  }
+  unsigned char* dst_ptr = reinterpret_cast<unsigned char*>(dst) + dst_offset;
+  const unsigned char* src_ptr = reinterpret_cast<const unsigned char*>(src) + src_offset;
+  const int64_t row_size = extent[0];
+  int64_t num_rows = 1;
+  FOR_RANGE(int64_t, i, 1, num_dims) { num_rows *= extent[i]; }
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  const bool parallel = thread_pool != nullptr && row_size * num_rows >= kHostCopyParallelBytes;
+  if (num_rows == 1) {
+    if (parallel) {
+      thread_pool->ParallelFor(0, row_size, kHostCopyGrainBytes, [&](int64_t begin, int64_t end) {
+        std::memcpy(dst_ptr + begin, src_ptr + begin, end - begin);
+      });
+    } else {
+      std::memcpy(dst_ptr, src_ptr, row_size);
     }
-    const int64_t src_offset = src_helper.NdIndexToOffset(src_idx);
-    const int64_t dst_offset = dst_helper.NdIndexToOffset(dst_idx);
-    unsigned char* dst_ptr = reinterpret_cast<unsigned char*>(dst) + dst_offset;
-    const unsigned char* src_ptr = reinterpret_cast<const unsigned char*>(src) + src_offset;
-    *dst_ptr = *src_ptr;
+    return;
+  }
+  auto CopyRows = [&](int64_t begin, int64_t end) {
+    int64_t index[SHAPE_MAX_AXIS_SIZE];
+    int64_t dst_row_offset = 0;
+    int64_t src_row_offset = 0;
+    int64_t remaining = begin;
+    FOR_RANGE(int64_t, i, 1, num_dims) {
+      index[i] = remaining % extent[i];
+      remaining /= extent[i];
+      dst_row_offset += index[i] * dst_stride[i];
+      src_row_offset += index[i] * src_stride[i];
+    }
+    FOR_RANGE(int64_t, row, begin, end) {
+      std::memcpy(dst_ptr + dst_row_offset, src_ptr + src_row_offset, row_size);
+      for (int64_t i = 1; i < num_dims; ++i) {
+        dst_row_offset += dst_stride[i];
+        src_row_offset += src_stride[i];
+        if (++index[i] < extent[i]) { break; }
+        dst_row_offset -= extent[i] * dst_stride[i];
+        src_row_offset -= extent[i] * src_stride[i];
+        index[i] = 0;
+      }
+    }
+  };
+  if (parallel) {
+    thread_pool->ParallelFor(0, num_rows, std::max<int64_t>(kHostCopyGrainBytes / row_size, 1),
+                             CopyRows);
+  } else {
+    CopyRows(0, num_rows);
   }
 }
 
+}  // namespace
+
 MemoryCopyNdDesc MemoryCopyNdDesc::CreateDimReducedDesc() const {
   MemoryCopyNdDesc reduced;
   DimVector dst_shape_vec;
@@ -194,22 +257,19 @@ void MemoryCopier::CopyND(DeviceCtx* ctx, void* dst, const void* src,
   UNIMPLEMENTED();
 }
 
+void HostMemoryCopier::Copy(DeviceCtx* ctx, void* dst, const void* src,
+                            const MemoryCopyNdDesc& desc) const {
+  CheckMemoryCopyNdDesc(desc);
+  HostCopyNd(dst, src, desc);
+}
+
 void HostMemoryCopier::Copy1D(DeviceCtx* ctx, void* dst, const void* src, size_t count) const {
   memcpy(dst, src, count);
 }
 
 void HostMemoryCopier::CopyND(DeviceCtx* ctx, void* dst, const void* src,
                               const MemoryCopyNdDesc& desc) const {
-  const int32_t num_axes = desc.src_shape.NumAxes();
-  if (num_axes == 4) {
-    CopyNDCpuImpl<4>(ctx, dst, src, desc);
-  } else if (num_axes == 5) {
-    CopyNDCpuImpl<5>(ctx, dst, src, desc);
-  } else if (num_axes == 6) {
-    CopyNDCpuImpl<6>(ctx, dst, src, desc);
-  } else {
-    UNIMPLEMENTED();
-  }
+  HostCopyNd(dst, src, desc);
 }
 
 #ifdef WITH_CUDA
@@ -290,11 +350,4 @@ SPECIALIZE_COPY_ELEM(int32_t)
 SPECIALIZE_COPY_ELEM(int64_t)
 SPECIALIZE_COPY_ELEM(int8_t)
 
-#define SPECIALIZE_COPY_ND_CPU_IMPL(NDIMS)                                        \
-  template void CopyNDCpuImpl<NDIMS>(DeviceCtx * ctx, void* dst, const void* src, \
-                                     const MemoryCopyNdDesc& desc);
-SPECIALIZE_COPY_ND_CPU_IMPL(4)
-SPECIALIZE_COPY_ND_CPU_IMPL(5)
-SPECIALIZE_COPY_ND_CPU_IMPL(6)
-
 }  // namespace oneflow
@@ -33,8 +33,6 @@ struct MemoryCopyNdDesc {
   MemoryCopyNdDesc CreateDimReducedDesc() const;
 };
 
-template<int32_t NDIMS>
-void CopyNDCpuImpl(DeviceCtx* ctx, void* dst, const void* src, const MemoryCopyNdDesc& desc);
 #ifdef WITH_CUDA
 template<int32_t NDIMS>
 void CopyNDGpuImpl(DeviceCtx* ctx, void* dst, const void* src, const MemoryCopyNdDesc& desc);
@@ -67,6 +65,10 @@ class HostMemoryCopier final : public MemoryCopier {
   HostMemoryCopier() = default;
   ~HostMemoryCopier() override = default;
 
+  // synchronous, any number of axes, large copies are split across the compute thread pool
+  void Copy(DeviceCtx* ctx, void* dst, const void* src,
+            const MemoryCopyNdDesc& desc) const override;
+
  private:
   void Copy1D(DeviceCtx* ctx, void* dst, const void* src, size_t count) const override;
   void CopyND(DeviceCtx* ctx, void* dst, const void* src,
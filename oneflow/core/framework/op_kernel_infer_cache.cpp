@@ -16,11 +16,114 @@ limitations under the License.
 #include "oneflow/core/framework/op_kernel_infer_cache.h"
 #include "oneflow/core/framework/op_kernel.h"
 #include "oneflow/core/operator/operator.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/job/global_for.h"
 
 namespace oneflow {
 
 namespace user_op {
 
+OpKernelInferCacheStore::OpKernelInferCacheStore(size_t max_size)
+    : max_size_per_shard_(std::max<size_t>(max_size / kNumShards, 1)),
+      shards_(kNumShards),
+      hit_cnt_(0),
+      miss_cnt_(0),
+      eviction_cnt_(0) {}
+
+OpKernelInferCacheStore::~OpKernelInferCacheStore() {
+  const OpKernelInferCacheStats stats = GetStats();
+  if (stats.hit_cnt + stats.miss_cnt > 0) {
+    LOG(INFO) << "OpKernelInferCache hits: " << stats.hit_cnt << ", misses: " << stats.miss_cnt
+              << ", evictions: " << stats.eviction_cnt;
+  }
+}
+
+OpKernelInferCacheStore::Shard* OpKernelInferCacheStore::Shard4HashValue(size_t hash_value) {
+  // symbols hash to their addresses, so the shard index comes from the high bits of a multiply
+  const uint64_t mixed = static_cast<uint64_t>(hash_value) * 0x9e3779b97f4a7c15ULL;
+  return &shards_.at(mixed >> 60);
+}
+
+OpKernelInferCacheStore::ValueType OpKernelInferCacheStore::Get(const KeyType& key,
+                                                                size_t hash_value) {
+  Shard* shard = Shard4HashValue(hash_value);
+  std::unique_lock<std::mutex> lock(shard->mutex);
+  const auto iter = shard->key2entry.find(HashEqTraitPtr<const KeyType>(&key, hash_value));
+  if (iter == shard->key2entry.end()) {
+    lock.unlock();
+    miss_cnt_.fetch_add(1, std::memory_order_relaxed);
+    return ValueType();
+  }
+  shard->entries.splice(shard->entries.begin(), shard->entries, iter->second);
+  ValueType value = iter->second->value;
+  lock.unlock();
+  hit_cnt_.fetch_add(1, std::memory_order_relaxed);
+  return value;
+}
+
+void OpKernelInferCacheStore::Put(const KeyType& key, size_t hash_value, const ValueType& value) {
+  Shard* shard = Shard4HashValue(hash_value);
+  // evicted values are released after unlocking
+  std::list<Entry> evicted;
+  {
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    const auto iter = shard->key2entry.find(HashEqTraitPtr<const KeyType>(&key, hash_value));
+    if (iter != shard->key2entry.end()) {
+      // another kernel of the same op got here first
+      shard->entries.splice(shard->entries.begin(), shard->entries, iter->second);
+      return;
+    }
+    if (shard->entries.size() >= max_size_per_shard_) {
+      const Entry& lru = shard->entries.back();
+      CHECK_EQ(shard->key2entry.erase(HashEqTraitPtr<const KeyType>(&lru.key, lru.hash_value)),
+               1);
+      evicted.splice(evicted.begin(), shard->entries, std::prev(shard->entries.end()));
+    }
+    shard->entries.push_front(Entry{key, hash_value, value});
+    const KeyType* new_key = &shard->entries.front().key;
+    CHECK(shard->key2entry
+              .emplace(HashEqTraitPtr<const KeyType>(new_key, hash_value), shard->entries.begin())
+              .second);
+  }
+  if (!evicted.empty()) { eviction_cnt_.fetch_add(1, std::memory_order_relaxed); }
+}
+
+void OpKernelInferCacheStore::Clear() {
+  for (Shard& shard : shards_) {
+    std::list<Entry> entries;
+    {
+      std::unique_lock<std::mutex> lock(shard.mutex);
+      shard.key2entry.clear();
+      entries.swap(shard.entries);
+    }
+  }
+}
+
+OpKernelInferCacheStats OpKernelInferCacheStore::GetStats() const {
+  OpKernelInferCacheStats stats;
+  stats.hit_cnt = hit_cnt_.load(std::memory_order_relaxed);
+  stats.miss_cnt = miss_cnt_.load(std::memory_order_relaxed);
+  stats.eviction_cnt = eviction_cnt_.load(std::memory_order_relaxed);
+  stats.size = 0;
+  for (const Shard& shard : shards_) {
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    stats.size += shard.entries.size();
+  }
+  return stats;
+}
+
+std::shared_ptr<OpKernelInferCacheStore> OpKernelInferCacheStore::GetShared(size_t max_size) {
+  static std::mutex mutex;
+  static std::weak_ptr<OpKernelInferCacheStore> shared_store;
+  std::unique_lock<std::mutex> lock(mutex);
+  std::shared_ptr<OpKernelInferCacheStore> store = shared_store.lock();
+  if (!store) {
+    store.reset(new OpKernelInferCacheStore(max_size));
+    shared_store = store;
+  }
+  return store;
+}
+
 OpKernelInferCache::OpKernelInferCache(const KernelConf& kernel_conf, const JobDesc& job_desc) {
   const OperatorConf& op_conf = kernel_conf.op_attribute().op_conf();
   std::shared_ptr<Operator> op = ConstructOp(op_conf, &job_desc);
@@ -28,19 +131,13 @@ OpKernelInferCache::OpKernelInferCache(const KernelConf& kernel_conf, const JobD
   cache_key_.op_conf_sym = op->GetOpConfWithoutOpNameAndLbn();
   cache_key_.ibn_idx2shape_sym.resize(op->input_bns().size());
   cache_key_.dtype_signature_sym = SymbolOf(kernel_conf.dtype_signature());
-}
-
-bool OpKernelInferCache::IsCacheHit() const {
-  size_t hash_value = std::hash<KeyType>()(cache_key_);
-  HashEqTraitPtr<const KeyType> ptr_wrapper(&cache_key_, hash_value);
-  return cached_key2value_.find(ptr_wrapper) != cached_key2value_.end();
+  cache_key_hash_value_ = std::hash<KeyType>()(cache_key_);
+  store_ = OpKernelInferCacheStore::GetShared(
+      Global<ResourceDesc, ForSession>::Get()->op_kernel_infer_cache_max_size());
 }
 
 OpKernelInferCache::ValueType OpKernelInferCache::GetCacheValue() const {
-  size_t hash_value = std::hash<KeyType>()(cache_key_);
-  HashEqTraitPtr<const KeyType> ptr_wrapper(&cache_key_, hash_value);
-  CHECK(cached_key2value_.find(ptr_wrapper) != cached_key2value_.end());
-  return cached_key2value_.at(ptr_wrapper);
+  return store_->Get(cache_key_, cache_key_hash_value_);
 }
 
 void OpKernelInferCache::UpdateCacheKey(KernelInferContext* ctx) {
@@ -54,10 +151,10 @@ void OpKernelInferCache::UpdateCacheKey(KernelInferContext* ctx) {
     const auto& arg_pair = inputs.at(i);
     cache_key_.ibn_idx2shape_sym.at(i) = GetSymbolOfShape(arg_pair.first, arg_pair.second);
   }
+  cache_key_hash_value_ = std::hash<KeyType>()(cache_key_);
 }
 
 void OpKernelInferCache::UpdateCacheValue(KernelInferContext* ctx) {
-  if (cached_key2value_.size() >= max_size_) { Reset(); }
   auto* cache_value = new OpInferCacheValue();
   cache_value->obn_idx2shape_sym.resize(ctx->outputs().size());
   FOR_RANGE(int, i, 0, ctx->outputs().size()) {
@@ -68,30 +165,7 @@ void OpKernelInferCache::UpdateCacheValue(KernelInferContext* ctx) {
     out_shape_view.ToShape(&out_shape);
     cache_value->obn_idx2shape_sym.at(i).reset(out_shape);
   }
-  KeyType* new_key = new KeyType(cache_key_);
-  key_storage_.emplace_back(new_key);
-  size_t hash_value = std::hash<KeyType>()(cache_key_);
-  HashEqTraitPtr<const KeyType> ptr_wrapper(new_key, hash_value);
-  CHECK(cached_key2value_.emplace(ptr_wrapper, ValueType(cache_value)).second);
-}
-
-void OpKernelInferCache::Reset() {
-  CHECK_EQ(cached_key2value_.size(), key_storage_.size());
-  HashMap to_release_key2values;
-  KeyStorage to_release_key_storage;
-  std::swap(cached_key2value_, to_release_key2values);
-  std::swap(key_storage_, to_release_key_storage);
-  if (to_release_key2values.size() <= kReleaseInIndependentThreadThreshold) {
-    to_release_key2values.clear();
-    to_release_key_storage.clear();
-  } else {
-    std::thread(
-        [](HashMap&& cache, KeyStorage&& key_storage) {
-          cache.clear();
-          key_storage.clear();
-        },
-        std::move(to_release_key2values), std::move(to_release_key_storage));
-  }
+  store_->Put(cache_key_, cache_key_hash_value_, ValueType(cache_value));
 }
 
 }  // namespace user_op
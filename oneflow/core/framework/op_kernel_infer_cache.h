@@ -26,28 +26,76 @@ namespace user_op {
 
 class KernelInferContext;
 
+struct OpKernelInferCacheStats {
+  int64_t hit_cnt;
+  int64_t miss_cnt;
+  int64_t eviction_cnt;
+  int64_t size;
+};
+
+// Inferred output shapes keyed by op conf (without op name), dtype signature and input shapes.
+// Entries are split into shards by key hash and each shard evicts its least recently used entry
+// when full, so dynamic shapes never flush the whole cache at once.
+class OpKernelInferCacheStore final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OpKernelInferCacheStore);
+  using KeyType = OpInferCacheKey;
+  using ValueType = std::shared_ptr<const OpInferCacheValue>;
+  static constexpr int kNumShards = 16;
+
+  explicit OpKernelInferCacheStore(size_t max_size);
+  ~OpKernelInferCacheStore();
+
+  // nullptr if key is not cached
+  ValueType Get(const KeyType& key, size_t hash_value);
+  void Put(const KeyType& key, size_t hash_value, const ValueType& value);
+  void Clear();
+  OpKernelInferCacheStats GetStats() const;
+
+  // The store of all the kernels in this process, so that kernels of identical ops share their
+  // entries. It is released together with the last OpKernelInferCache using it.
+  static std::shared_ptr<OpKernelInferCacheStore> GetShared(size_t max_size);
+
+ private:
+  struct Entry {
+    KeyType key;
+    size_t hash_value;
+    ValueType value;
+  };
+  struct Shard {
+    mutable std::mutex mutex;
+    // most recently used first, list nodes keep the keys the map points to in place
+    std::list<Entry> entries;
+    std::unordered_map<HashEqTraitPtr<const KeyType>, std::list<Entry>::iterator> key2entry;
+  };
+
+  Shard* Shard4HashValue(size_t hash_value);
+
+  size_t max_size_per_shard_;
+  std::vector<Shard> shards_;
+  std::atomic<int64_t> hit_cnt_;
+  std::atomic<int64_t> miss_cnt_;
+  std::atomic<int64_t> eviction_cnt_;
+};
+
 class OpKernelInferCache final {
  public:
   using KeyType = OpInferCacheKey;
   using ValueType = std::shared_ptr<const OpInferCacheValue>;
-  using HashMap = std::unordered_map<HashEqTraitPtr<const KeyType>, ValueType>;
-  using KeyStorage = std::list<std::unique_ptr<KeyType>>;
-  static constexpr size_t kReleaseInIndependentThreadThreshold = 4096;
 
   OpKernelInferCache(const KernelConf& kernel_conf, const JobDesc& job_desc);
   ~OpKernelInferCache() = default;
 
-  bool IsCacheHit() const;
+  // nullptr on cache miss. Checking and getting is a single lookup since other kernels may
+  // evict the entry in between.
   ValueType GetCacheValue() const;
   void UpdateCacheKey(KernelInferContext* ctx);
   void UpdateCacheValue(KernelInferContext* ctx);
-  void Reset();
 
  private:
   KeyType cache_key_;
-  HashMap cached_key2value_;
-  KeyStorage key_storage_;
-  size_t max_size_;
+  size_t cache_key_hash_value_;
+  std::shared_ptr<OpKernelInferCacheStore> store_;
 };
 
 }  // namespace user_op
@@ -0,0 +1,120 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/op_kernel_infer_cache.h"
+#include "oneflow/core/operator/operator.h"
+
+namespace oneflow {
+
+namespace user_op {
+
+namespace test {
+
+namespace {
+
+OpInferCacheKey MakeKey(const std::string& op_type_name, int64_t seq_len) {
+  OperatorConf op_conf;
+  op_conf.set_name("undefined-op-name");
+  op_conf.mutable_user_conf()->set_op_type_name(op_type_name);
+  OpInferCacheKey key;
+  key.job_desc = nullptr;
+  key.op_conf_sym = SymbolOf(op_conf);
+  key.dtype_signature_sym = SymbolOf(DTypeSignature());
+  key.ibn_idx2shape_sym = {SymbolOf(Shape({seq_len, 512})), SymbolOf(Shape({seq_len, 512}))};
+  return key;
+}
+
+OpKernelInferCacheStore::ValueType MakeValue(int64_t seq_len) {
+  auto* value = new OpInferCacheValue();
+  value->obn_idx2shape_sym = {SymbolOf(Shape({seq_len, 512}))};
+  return OpKernelInferCacheStore::ValueType(value);
+}
+
+size_t Hash(const OpInferCacheKey& key) { return std::hash<OpInferCacheKey>()(key); }
+
+}  // namespace
+
+TEST(OpKernelInferCacheStore, get_put) {
+  OpKernelInferCacheStore store(1024);
+  const OpInferCacheKey key = MakeKey("add_n", 7);
+  ASSERT_TRUE(store.Get(key, Hash(key)) == nullptr);
+  store.Put(key, Hash(key), MakeValue(7));
+  // an equal key built elsewhere, e.g. by another kernel of the same op, hits the same entry
+  const OpInferCacheKey same_key = MakeKey("add_n", 7);
+  ASSERT_EQ(Hash(same_key), Hash(key));
+  const auto value = store.Get(same_key, Hash(same_key));
+  ASSERT_TRUE(value != nullptr);
+  ASSERT_EQ(*value->obn_idx2shape_sym.at(0), Shape({7, 512}));
+  const OpInferCacheKey other_op_key = MakeKey("multiply", 7);
+  ASSERT_TRUE(store.Get(other_op_key, Hash(other_op_key)) == nullptr);
+  const OpKernelInferCacheStats stats = store.GetStats();
+  ASSERT_EQ(stats.hit_cnt, 1);
+  ASSERT_EQ(stats.miss_cnt, 2);
+  ASSERT_EQ(stats.size, 1);
+  store.Clear();
+  ASSERT_EQ(store.GetStats().size, 0);
+}
+
+TEST(OpKernelInferCacheStore, lru_eviction) {
+  const int64_t max_size = OpKernelInferCacheStore::kNumShards * 4;
+  OpKernelInferCacheStore store(max_size);
+  const OpInferCacheKey hot_key = MakeKey("add_n", 0);
+  store.Put(hot_key, Hash(hot_key), MakeValue(0));
+  const int64_t num_seq_lens = 10000;
+  FOR_RANGE(int64_t, seq_len, 1, num_seq_lens) {
+    const OpInferCacheKey key = MakeKey("add_n", seq_len);
+    ASSERT_TRUE(store.Get(key, Hash(key)) == nullptr);
+    store.Put(key, Hash(key), MakeValue(seq_len));
+    // the entry used on every step is never the least recently used one
+    ASSERT_TRUE(store.Get(hot_key, Hash(hot_key)) != nullptr);
+  }
+  const OpKernelInferCacheStats stats = store.GetStats();
+  ASSERT_LE(stats.size, max_size);
+  ASSERT_EQ(stats.eviction_cnt, num_seq_lens - stats.size);
+  ASSERT_EQ(stats.hit_cnt, num_seq_lens - 1);
+  // recently inserted entries survive, old ones are gone
+  const OpInferCacheKey last_key = MakeKey("add_n", num_seq_lens - 1);
+  ASSERT_TRUE(store.Get(last_key, Hash(last_key)) != nullptr);
+  const OpInferCacheKey first_key = MakeKey("add_n", 1);
+  ASSERT_TRUE(store.Get(first_key, Hash(first_key)) == nullptr);
+}
+
+TEST(OpKernelInferCacheStore, shared_by_kernels) {
+  std::shared_ptr<OpKernelInferCacheStore> store = OpKernelInferCacheStore::GetShared(1024);
+  ASSERT_EQ(OpKernelInferCacheStore::GetShared(1024), store);
+  std::vector<std::thread> threads;
+  FOR_RANGE(int, i, 0, 4) {
+    threads.emplace_back([]() {
+      std::shared_ptr<OpKernelInferCacheStore> store = OpKernelInferCacheStore::GetShared(1024);
+      FOR_RANGE(int64_t, seq_len, 0, 2000) {
+        const OpInferCacheKey key = MakeKey("add_n", seq_len % 100);
+        if (store->Get(key, Hash(key)) == nullptr) {
+          store->Put(key, Hash(key), MakeValue(seq_len % 100));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  const OpKernelInferCacheStats stats = store->GetStats();
+  ASSERT_EQ(stats.size, 100);
+  ASSERT_EQ(stats.hit_cnt + stats.miss_cnt, 4 * 2000);
+  ASSERT_EQ(stats.eviction_cnt, 0);
+}
+
+}  // namespace test
+
+}  // namespace user_op
+
+}  // namespace oneflow
@@ -26,6 +26,7 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/persistence_thread_pool.h"
 #include "oneflow/core/common/str_util.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/vm/virtual_machine_scope.h"
@@ -87,6 +88,8 @@ Maybe<void> EnvGlobalObjectsScope::Init(const EnvProto& env_proto) {
   Global<ResourceDesc, ForEnv>::New(GetDefaultResource(env_proto));
   Global<ResourceDesc, ForSession>::New(GetDefaultResource(env_proto));
   Global<ThreadPool>::New(Global<ResourceDesc, ForSession>::Get()->ComputeThreadPoolSize());
+  Global<PersistenceThreadPoolScope>::New(
+      Global<ResourceDesc, ForSession>::Get()->PersistenceThreadPoolSize());
   Global<vm::VirtualMachineScope>::New(Global<ResourceDesc, ForSession>::Get()->resource());
   Global<EagerJobBuildAndInferCtxMgr>::New();
 #ifdef WITH_CUDA
@@ -101,6 +104,7 @@ EnvGlobalObjectsScope::~EnvGlobalObjectsScope() {
 #endif
   Global<EagerJobBuildAndInferCtxMgr>::Delete();
   Global<vm::VirtualMachineScope>::Delete();
+  Global<PersistenceThreadPoolScope>::Delete();
   Global<ThreadPool>::Delete();
   if (Global<ResourceDesc, ForSession>::Get() != nullptr) {
     Global<ResourceDesc, ForSession>::Delete();
@@ -92,6 +92,10 @@ int64_t IDMgr::GlobalWorkStreamId4ActorId(int64_t actor_id) const {
   return GlobalWorkStreamId4TaskId(actor_id);
 }
 
+int64_t IDMgr::ThrdLocalTaskId4ActorId(int64_t actor_id) const {
+  return actor_id & ((static_cast<int64_t>(1) << task_id_bit_num_) - 1);
+}
+
 int64_t IDMgr::GlobalThrdId4TaskId(int64_t task_id) const {
   int shift = local_work_stream_id_bit_num_ + task_id_bit_num_;
   return (task_id >> shift) << shift;
@@ -82,6 +82,10 @@ class IDMgr final {
   //  1   |     10     |   11    |          21          | 21
   int64_t GlobalWorkStreamId4ActorId(int64_t actor_id) const;
   int64_t GlobalWorkStreamId4TaskId(int64_t task_id) const;
+  // thrd_local_task_id, numbers the tasks of a thread from 0 on
+  // sign | machine_id | thrd_id | local_work_stream_id | thrd_local_task_id
+  //  1   |     10     |   11    |          21          |         21
+  int64_t ThrdLocalTaskId4ActorId(int64_t actor_id) const;
   int64_t AllocateChainId(int64_t global_work_stream_id);
   int64_t PickCpuThrdIdEvenly(int64_t machine_id);
 
@@ -107,6 +107,8 @@ TEST(IDMgr, runtime_thrd_id) {
       + (static_cast<int64_t>(101) << local_work_stream_shl)  // work_stream_id_101
       + 6;                                                    // actor_id_6
   ASSERT_EQ(Global<IDMgr>::Get()->ThrdId4ActorId(actor_id6_machine2thrd4), 4);
+  ASSERT_EQ(Global<IDMgr>::Get()->ThrdLocalTaskId4ActorId(actor_id5_machine1thrd3), 5);
+  ASSERT_EQ(Global<IDMgr>::Get()->ThrdLocalTaskId4ActorId(actor_id6_machine2thrd4), 6);
   Delete();
 }
 
@@ -29,6 +29,7 @@ limitations under the License.
 #include "oneflow/core/job/available_memory_desc.pb.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/actor/act_event_logger.h"
+#include "oneflow/core/actor/act_tracer.h"
 #include "oneflow/core/job/oneflow.h"
 #include "oneflow/core/job/model_io_v2_job.h"
 #include "oneflow/core/job/model_io_job.h"
@@ -993,7 +994,7 @@ Oneflow::~Oneflow() {
   runtime_.reset();
   if (Global<Profiler>::Get() != nullptr) {
     Global<Profiler>::Get()->Profile(
-        plan_, JoinPath(FLAGS_log_dir, ActEventLogger::act_event_bin_filename()));
+        plan_, JoinPath(FLAGS_log_dir, ActTracer::act_trace_bin_filename()));
   }
 }
 
@@ -17,7 +17,7 @@ limitations under the License.
 #include "oneflow/core/job/job_desc.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
 #include "oneflow/core/common/str_util.h"
-#include "oneflow/core/actor/act_event_logger.h"
+#include "oneflow/core/actor/act_tracer.h"
 
 namespace oneflow {
 
@@ -49,21 +49,21 @@ class ActorProfileInfo {
 };
 }  // namespace
 
-void Profiler::Profile(const Plan& plan, const std::string& act_event_filepath) {
-  HashMap<int64_t, TaskType> task_id2task_type;
+void Profiler::Profile(const Plan& plan, const std::string& act_trace_filepath) {
+  HashMap<int64_t, const TaskProto*> task_id2task;
   for (const TaskProto& task : plan.task()) {
-    CHECK(task_id2task_type.emplace(task.task_id(), task.task_type()).second);
+    CHECK(task_id2task.emplace(task.task_id(), &task).second);
   }
 
-  std::list<std::unique_ptr<ActEvent>> act_events;
-  ParseActEvents(act_event_filepath, &act_events);
+  std::vector<ActTraceEvent> act_trace_events;
+  ParseActTraceEvents(act_trace_filepath, &act_trace_events);
+  std::vector<ActTraceSpan> act_trace_spans;
+  ActTraceEvents2Spans(act_trace_events, &act_trace_spans);
 
   HashMap<int64_t, std::vector<ActTimeInfo>> actor_id2act_time_info;
-  for (const auto& act_event : act_events) {
-    int64_t actor_id = act_event->actor_id();
-    ActTimeInfo act_time_info(
-        {act_event->ready_time(), act_event->start_time(), act_event->stop_time()});
-    actor_id2act_time_info[actor_id].emplace_back(act_time_info);
+  for (const ActTraceSpan& span : act_trace_spans) {
+    ActTimeInfo act_time_info({span.ready_time, span.start_time, span.stop_time});
+    actor_id2act_time_info[span.actor_id].emplace_back(act_time_info);
   }
 
   using ProfileInfoPair = std::pair<int64_t, ActorProfileInfo>;
@@ -106,8 +106,25 @@ void Profiler::Profile(const Plan& plan, const std::string& act_event_filepath)
                << " avg_act_time:" << std::to_string(pair.second.avg_act_time())
                << " avg_act_interval:" << std::to_string(pair.second.avg_act_interval())
                << " bottleneck_score:" << std::to_string(pair.second.CalcBottleNeckScore())
-               << " type:" << TaskType_Name(task_id2task_type.at(pair.first)) << "\n";
+               << " type:" << TaskType_Name(task_id2task.at(pair.first)->task_type()) << "\n";
   }
+
+  const auto ActorName4ActorId = [&](int64_t actor_id) {
+    const TaskProto* task = task_id2task.at(actor_id);
+    std::string name = TaskType_Name(task->task_type());
+    const ExecSequence& exec_sequence = task->exec_sequence();
+    if (exec_sequence.exec_node_size() == 1) {
+      name += ":" + exec_sequence.exec_node(0).kernel_conf().op_attribute().op_conf().name();
+    }
+    return name;
+  };
+  const auto MachineAndStream4ActorId = [&](int64_t actor_id) {
+    const TaskProto* task = task_id2task.at(actor_id);
+    return std::make_pair(task->machine_id(), task->thrd_id());
+  };
+  TeePersistentLogStream::Create(ActTracer::act_trace_json_filename())
+      ->Write(ActTraceSpans2ChromeTraceJson(act_trace_spans, ActorName4ActorId,
+                                            MachineAndStream4ActorId));
 }
 
 }  // namespace oneflow
@@ -27,7 +27,9 @@ class Profiler final {
   Profiler() = default;
   ~Profiler() = default;
 
-  void Profile(const Plan& plan, const std::string& act_event_filepath);
+  // Reports the act time and interval of the actors traced by ActTracer and exports the trace
+  // in the chrome trace format
+  void Profile(const Plan& plan, const std::string& act_trace_filepath);
 
  private:
 };
@@ -38,6 +38,15 @@ int32_t ResourceDesc::ComputeThreadPoolSize() const {
   }
 }
 
+int32_t ResourceDesc::PersistenceThreadPoolSize() const {
+  if (resource_.has_persistence_thread_pool_size()) {
+    CHECK_GT(resource_.persistence_thread_pool_size(), 0);
+    return resource_.persistence_thread_pool_size();
+  } else {
+    return CpuDeviceNum();
+  }
+}
+
 bool ResourceDesc::enable_debug_mode() const {
   return std::getenv("ONEFLOW_DEBUG_MODE") != nullptr || resource_.enable_debug_mode();
 }
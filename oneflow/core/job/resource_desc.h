@@ -33,6 +33,8 @@ class ResourceDesc final {
   size_t TotalMachineNum() const;
   const Machine& machine(int32_t idx) const;
   size_t CommNetWorkerNum() const { return resource_.comm_net_worker_num(); }
+  bool comm_net_enable_zero_copy() const { return resource_.comm_net_enable_zero_copy(); }
+  int32_t CommNetSocketNumPerPeer() const { return resource_.comm_net_socket_num_per_peer(); }
   size_t rdma_mem_block_byte() const { return resource_.rdma_mem_block_mbyte() * kMB; }
   size_t rdma_recv_msg_buf_byte() const { return resource_.rdma_recv_msg_buf_mbyte() * kMB; }
   int32_t CpuDeviceNum() const { return resource_.cpu_device_num(); }
@@ -50,7 +52,11 @@ class ResourceDesc final {
   }
   bool enable_thread_local_cache() const { return resource_.enable_thread_local_cache(); }
   size_t thread_local_cache_max_size() const { return resource_.thread_local_cache_max_size(); }
+  size_t op_kernel_infer_cache_max_size() const {
+    return resource_.op_kernel_infer_cache_max_size();
+  }
   int32_t ComputeThreadPoolSize() const;
+  int32_t PersistenceThreadPoolSize() const;
   bool enable_debug_mode() const;
   CollectiveBoxingConf collective_boxing_conf() const;
 
@@ -24,6 +24,8 @@ limitations under the License.
 #include "oneflow/core/job/runtime_job_descs.h"
 #include "oneflow/core/thread/thread_manager.h"
 #include "oneflow/core/actor/act_event_logger.h"
+#include "oneflow/core/actor/act_tracer.h"
+#include "oneflow/core/persistence/persistent_out_stream.h"
 #include "oneflow/core/graph/task_node.h"
 #include "oneflow/core/device/cuda_util.h"
 #include "oneflow/core/memory/memory_allocator.h"
@@ -96,10 +98,22 @@ Runtime::~Runtime() {
 
 void Runtime::NewAllGlobal(const Plan& plan, size_t total_piece_num, bool is_experiment_phase) {
   Global<RuntimeCtx>::New(total_piece_num, is_experiment_phase);
-  if (Global<MachineCtx>::Get()->IsThisMachineMaster()
-      && Global<RuntimeCtx>::Get()->NeedCollectActEvent()) {
+  if (Global<MachineCtx>::Get()->IsThisMachineMaster() && is_experiment_phase) {
     Global<ActEventLogger>::New(is_experiment_phase);
   }
+  if (!is_experiment_phase && Global<RuntimeCtx>::Get()->NeedCollectActEvent()) {
+    // every machine traces its own actors into its own log dir
+    const ProfilerConf& profiler_conf = *Global<const ProfilerConf>::Get();
+    std::shared_ptr<PersistentOutStream> out_stream(new PersistentOutStream(
+        LocalFS(), JoinPath(FLAGS_log_dir, ActTracer::act_trace_bin_filename())));
+    Global<ActTracer>::New(profiler_conf.act_trace_sample_interval(),
+                           profiler_conf.act_trace_ring_buffer_size(),
+                           profiler_conf.act_trace_flush_interval_ms(),
+                           [out_stream](const ActTraceEvent* events, size_t num_events) {
+                             out_stream->Write(reinterpret_cast<const char*>(events),
+                                               num_events * sizeof(ActTraceEvent));
+                           });
+  }
   if (Global<ResourceDesc, ForSession>::Get()->TotalMachineNum() > 1) {
 #ifdef PLATFORM_POSIX
     if (Global<ResourceDesc, ForSession>::Get()->use_rdma()) {
@@ -132,6 +146,7 @@ void Runtime::DeleteAllGlobal() {
   Global<MemoryAllocator>::Delete();
   Global<boxing::collective::CollectiveBoxingExecutor>::Delete();
   Global<CommNet>::Delete();
+  Global<ActTracer>::Delete();
   Global<ActEventLogger>::Delete();
   Global<RuntimeCtx>::Delete();
   Global<summary::EventsWriter>::Delete();
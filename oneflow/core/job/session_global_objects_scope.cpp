@@ -77,10 +77,7 @@ Maybe<void> SessionGlobalObjectsScope::Init(const ConfigProto& config_proto) {
   Global<const IOConf>::New(config_proto.io_conf());
   Global<const ProfilerConf>::New(config_proto.profiler_conf());
   Global<IDMgr>::New();
-  if (Global<MachineCtx>::Get()->IsThisMachineMaster()
-      && Global<const ProfilerConf>::Get()->collect_act_event()) {
-    Global<Profiler>::New();
-  }
+  if (Global<const ProfilerConf>::Get()->collect_act_event()) { Global<Profiler>::New(); }
   PushAvailableMemDescOfThisMachine();
   if (Global<MachineCtx>::Get()->IsThisMachineMaster()) {
     Global<AvailableMemDesc>::New();
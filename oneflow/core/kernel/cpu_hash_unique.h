@@ -0,0 +1,274 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_KERNEL_CPU_HASH_UNIQUE_H_
+#define ONEFLOW_CORE_KERNEL_CPU_HASH_UNIQUE_H_
+
+#include "oneflow/core/common/data_type.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+// Unique on the host with open-addressing hash tables carved out of the kernel workspace.
+// Large inputs are scattered into partitions by key hash, each partition is deduplicated in its
+// own table and partitions run in parallel on the compute thread pool when there is one. Unique
+// keys come out grouped by partition and in order of first occurrence within a partition. The
+// number of partitions only depends on n, so the result does not depend on the number of threads.
+template<typename KEY, typename IDX>
+class CpuHashUnique final {
+ public:
+  static int64_t GetWorkspaceSizeInBytes(int64_t n) {
+    const int64_t num = std::max<int64_t>(n, 1);
+    return RoundUp(2 * num * sizeof(Slot)) + 2 * RoundUp(num * sizeof(IDX)) + RoundUp(num);
+  }
+
+  // count may be null
+  static void Unique(int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out, IDX* idx_out,
+                     IDX* count, void* workspace, int64_t workspace_size_in_bytes) {
+    Run(n, in, num_unique, unique_out, idx_out, count, workspace, workspace_size_in_bytes,
+        [](const IDX*, const IDX*, int64_t, IDX) {});
+  }
+
+  // Unique of in, then row u of out (rows have m elements) is the sum of the rows i of values
+  // with idx_out[i] == u. Rows from num_unique on are zeroed.
+  template<typename T>
+  static void UniqueAndSegmentSum(int64_t n, int64_t m, const KEY* in, const T* values,
+                                  IDX* num_unique, KEY* unique_out, IDX* idx_out, T* out,
+                                  void* workspace, int64_t workspace_size_in_bytes) {
+    // each partition owns the rows of its unique keys, rows are summed in order of elements
+    auto SumPartition = [=](const IDX* elems, const IDX* local_idx, int64_t size, IDX offset) {
+      IDX next_local_idx = 0;
+      FOR_RANGE(int64_t, j, 0, size) {
+        const int64_t i = elems == nullptr ? j : elems[j];
+        const T* row = values + i * m;
+        T* out_row = out + (offset + local_idx[j]) * m;
+        if (local_idx[j] == next_local_idx) {
+          std::copy(row, row + m, out_row);
+          next_local_idx += 1;
+        } else {
+          FOR_RANGE(int64_t, k, 0, m) { out_row[k] += row[k]; }
+        }
+      }
+    };
+    Run(n, in, num_unique, unique_out, idx_out, nullptr, workspace, workspace_size_in_bytes,
+        SumPartition);
+    std::fill(out + static_cast<int64_t>(*num_unique) * m, out + n * m, GetZeroVal<T>());
+  }
+
+ private:
+  struct Slot {
+    KEY key;
+    IDX idx;
+  };
+  static constexpr int64_t kAlignSize = 64;
+  // elements per partition and per scatter chunk worth a task of their own
+  static constexpr int64_t kPartitionSize = 16384;
+  static constexpr int64_t kMaxNumPartitions = 64;
+  static constexpr int64_t kMaxNumChunks = 64;
+  static constexpr uint64_t kInitCapacity = 1024;
+
+  static int64_t RoundUp(int64_t n) { return (n + kAlignSize - 1) / kAlignSize * kAlignSize; }
+
+  static uint64_t Hash(KEY key) {
+    // murmur3 finalizer, std::hash of integers is the identity
+    uint64_t h = std::hash<KEY>()(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  // the low half of the hash picks the slot, the high bits pick the partition
+  static uint64_t SlotIndex(KEY key, uint64_t capacity) {
+    return ((Hash(key) & 0xffffffffULL) * capacity) >> 32;
+  }
+
+  static int64_t GetNumPartitions(int64_t n) {
+    int64_t num_partitions = 1;
+    while (num_partitions < kMaxNumPartitions && num_partitions * 2 * kPartitionSize <= n) {
+      num_partitions *= 2;
+    }
+    return num_partitions;
+  }
+
+  static void ParallelFor(int64_t num_tasks, const std::function<void(int64_t, int64_t)>& fn) {
+    ThreadPool* thread_pool = Global<ThreadPool>::Get();
+    if (thread_pool == nullptr || num_tasks <= 1) {
+      fn(0, num_tasks);
+    } else {
+      thread_pool->ParallelFor(0, num_tasks, 1, fn);
+    }
+  }
+
+  static void InsertNewKey(Slot* slots, uint64_t capacity, KEY key, IDX idx) {
+    uint64_t s = SlotIndex(key, capacity);
+    while (slots[s].idx != -1) { s = s + 1 == capacity ? 0 : s + 1; }
+    slots[s].key = key;
+    slots[s].idx = idx;
+  }
+
+  // Dedups keys[0, size) in slots[0, 2 * size), writing unique keys and counts from unique_out
+  // and count on and the index of each key among them to local_idx. unique_out may be keys, it
+  // is never written past the key being read. Returns the number of unique keys. The table
+  // starts small and is rebuilt from unique_out with twice the capacity whenever it gets half
+  // full, so few unique keys only touch a small, cache resident table.
+  static IDX UniquePartition(const KEY* keys, int64_t size, Slot* slots, KEY* unique_out,
+                             IDX* local_idx, IDX* count) {
+    const uint64_t max_capacity = 2 * size;
+    uint64_t capacity = std::min<uint64_t>(kInitCapacity, max_capacity);
+    FOR_RANGE(uint64_t, s, 0, capacity) { slots[s].idx = -1; }
+    IDX num_unique = 0;
+    FOR_RANGE(int64_t, j, 0, size) {
+      const KEY key = keys[j];
+      uint64_t s = SlotIndex(key, capacity);
+      while (slots[s].idx != -1 && !(slots[s].key == key)) { s = s + 1 == capacity ? 0 : s + 1; }
+      if (slots[s].idx != -1) {
+        if (count != nullptr) { count[slots[s].idx] += 1; }
+        local_idx[j] = slots[s].idx;
+        continue;
+      }
+      slots[s].key = key;
+      slots[s].idx = num_unique;
+      unique_out[num_unique] = key;
+      if (count != nullptr) { count[num_unique] = 1; }
+      local_idx[j] = num_unique;
+      num_unique += 1;
+      if (2 * static_cast<uint64_t>(num_unique) > capacity && capacity < max_capacity) {
+        capacity = std::min(2 * capacity, max_capacity);
+        FOR_RANGE(uint64_t, s, 0, capacity) { slots[s].idx = -1; }
+        FOR_RANGE(IDX, idx, 0, num_unique) { InsertNewKey(slots, capacity, unique_out[idx], idx); }
+      }
+    }
+    return num_unique;
+  }
+
+  // OnPartition(elems, local_idx, size, offset) is called for every partition once its unique
+  // keys are in place from offset on. Its j-th element is element elems[j] of the input and maps
+  // to unique key offset + local_idx[j]. elems is null when the whole input is one partition.
+  template<typename OnPartitionFn>
+  static void Run(int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out, IDX* idx_out,
+                  IDX* count, void* workspace, int64_t workspace_size_in_bytes,
+                  const OnPartitionFn& OnPartition) {
+    CHECK_GE(workspace_size_in_bytes, GetWorkspaceSizeInBytes(n));
+    const int64_t num = std::max<int64_t>(n, 1);
+    char* ptr = reinterpret_cast<char*>(workspace);
+    Slot* slots = reinterpret_cast<Slot*>(ptr);
+    ptr += RoundUp(2 * num * sizeof(Slot));
+    IDX* elems = reinterpret_cast<IDX*>(ptr);
+    ptr += RoundUp(num * sizeof(IDX));
+    IDX* local_idx = reinterpret_cast<IDX*>(ptr);
+    ptr += RoundUp(num * sizeof(IDX));
+    uint8_t* partition4elem = reinterpret_cast<uint8_t*>(ptr);
+    const int64_t num_partitions = GetNumPartitions(n);
+    if (num_partitions == 1) {
+      *num_unique = UniquePartition(in, n, slots, unique_out, idx_out, count);
+      OnPartition(nullptr, idx_out, n, 0);
+      return;
+    }
+    int shift = 64;
+    for (int64_t i = 1; i < num_partitions; i *= 2) { shift -= 1; }
+    const int64_t num_chunks = std::min<int64_t>(kMaxNumChunks, n / kPartitionSize);
+    const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+    // chunk2partition_pos[c * num_partitions + p] is where chunk c puts partition p
+    std::vector<int64_t> chunk2partition_pos(num_chunks * num_partitions, 0);
+    ParallelFor(num_chunks, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, c, begin, end) {
+        int64_t* cnt = chunk2partition_pos.data() + c * num_partitions;
+        FOR_RANGE(int64_t, i, c * chunk_size, std::min((c + 1) * chunk_size, n)) {
+          const uint8_t partition = Hash(in[i]) >> shift;
+          partition4elem[i] = partition;
+          cnt[partition] += 1;
+        }
+      }
+    });
+    std::vector<int64_t> partition_start(num_partitions + 1, 0);
+    FOR_RANGE(int64_t, p, 0, num_partitions) {
+      int64_t pos = partition_start.at(p);
+      FOR_RANGE(int64_t, c, 0, num_chunks) {
+        const int64_t cnt = chunk2partition_pos.at(c * num_partitions + p);
+        chunk2partition_pos.at(c * num_partitions + p) = pos;
+        pos += cnt;
+      }
+      partition_start.at(p + 1) = pos;
+    }
+    // Keys are scattered to unique_out, which every partition dedups in place. Chunks scatter in
+    // order, so every partition lists its elements in increasing order.
+    ParallelFor(num_chunks, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, c, begin, end) {
+        std::vector<int64_t> pos(chunk2partition_pos.begin() + c * num_partitions,
+                                 chunk2partition_pos.begin() + (c + 1) * num_partitions);
+        FOR_RANGE(int64_t, i, c * chunk_size, std::min((c + 1) * chunk_size, n)) {
+          const int64_t j = pos[partition4elem[i]]++;
+          unique_out[j] = in[i];
+          elems[j] = i;
+        }
+      }
+    });
+    std::vector<IDX> partition_num_unique(num_partitions);
+    ParallelFor(num_partitions, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, p, begin, end) {
+        const int64_t start = partition_start.at(p);
+        partition_num_unique.at(p) = UniquePartition(
+            unique_out + start, partition_start.at(p + 1) - start, slots + 2 * start,
+            unique_out + start, local_idx + start, count == nullptr ? nullptr : count + start);
+      }
+    });
+    std::vector<IDX> partition_offset(num_partitions + 1, 0);
+    FOR_RANGE(int64_t, p, 0, num_partitions) {
+      const IDX offset = partition_offset.at(p);
+      const int64_t start = partition_start.at(p);
+      const IDX size = partition_num_unique.at(p);
+      std::copy(unique_out + start, unique_out + start + size, unique_out + offset);
+      if (count != nullptr) { std::copy(count + start, count + start + size, count + offset); }
+      partition_offset.at(p + 1) = offset + size;
+    }
+    *num_unique = partition_offset.at(num_partitions);
+    // idx_out is written in input order, reading every partition front to back
+    ParallelFor(num_chunks, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, c, begin, end) {
+        std::vector<int64_t> pos(chunk2partition_pos.begin() + c * num_partitions,
+                                 chunk2partition_pos.begin() + (c + 1) * num_partitions);
+        FOR_RANGE(int64_t, i, c * chunk_size, std::min((c + 1) * chunk_size, n)) {
+          const uint8_t partition = partition4elem[i];
+          idx_out[i] = partition_offset[partition] + local_idx[pos[partition]++];
+        }
+      }
+    });
+    ParallelFor(num_partitions, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, p, begin, end) {
+        const int64_t start = partition_start.at(p);
+        OnPartition(elems + start, local_idx + start, partition_start.at(p + 1) - start,
+                    partition_offset.at(p));
+      }
+    });
+  }
+};
+
+template<typename KEY, typename IDX>
+constexpr int64_t CpuHashUnique<KEY, IDX>::kAlignSize;
+template<typename KEY, typename IDX>
+constexpr int64_t CpuHashUnique<KEY, IDX>::kPartitionSize;
+template<typename KEY, typename IDX>
+constexpr int64_t CpuHashUnique<KEY, IDX>::kMaxNumPartitions;
+template<typename KEY, typename IDX>
+constexpr int64_t CpuHashUnique<KEY, IDX>::kMaxNumChunks;
+template<typename KEY, typename IDX>
+constexpr uint64_t CpuHashUnique<KEY, IDX>::kInitCapacity;
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_KERNEL_CPU_HASH_UNIQUE_H_
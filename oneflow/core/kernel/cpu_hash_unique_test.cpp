@@ -0,0 +1,185 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/cpu_hash_unique.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// ids drawn from [0, range) with probability proportional to 1 / (rank + 1) ^ skew
+std::vector<int64_t> RandomIds(int64_t n, int64_t range, double skew) {
+  std::mt19937 gen(n + range);
+  std::vector<int64_t> ids(n);
+  if (skew == 0) {
+    std::uniform_int_distribution<int64_t> dis(0, range - 1);
+    for (int64_t& id : ids) { id = dis(gen); }
+  } else {
+    std::vector<double> weights(range);
+    FOR_RANGE(int64_t, i, 0, range) { weights.at(i) = 1.0 / std::pow(i + 1, skew); }
+    std::discrete_distribution<int64_t> dis(weights.begin(), weights.end());
+    // spread the hot ids over the id space
+    for (int64_t& id : ids) { id = dis(gen) * 2654435761LL % (range * 16); }
+  }
+  return ids;
+}
+
+struct UniqueResult {
+  int64_t num_unique;
+  std::vector<int64_t> unique_out;
+  std::vector<int32_t> idx_out;
+  std::vector<int32_t> count;
+};
+
+UniqueResult RunUnique(const std::vector<int64_t>& ids) {
+  const int64_t n = ids.size();
+  std::vector<char> workspace(CpuHashUnique<int64_t, int32_t>::GetWorkspaceSizeInBytes(n));
+  UniqueResult ret;
+  ret.unique_out.resize(n);
+  ret.idx_out.resize(n);
+  ret.count.resize(n);
+  int32_t num_unique = 0;
+  CpuHashUnique<int64_t, int32_t>::Unique(n, ids.data(), &num_unique, ret.unique_out.data(),
+                                          ret.idx_out.data(), ret.count.data(), workspace.data(),
+                                          workspace.size());
+  ret.num_unique = num_unique;
+  ret.unique_out.resize(num_unique);
+  ret.count.resize(num_unique);
+  return ret;
+}
+
+void CheckUnique(const std::vector<int64_t>& ids) {
+  const UniqueResult ret = RunUnique(ids);
+  HashMap<int64_t, int32_t> id2count;
+  for (int64_t id : ids) { id2count[id] += 1; }
+  ASSERT_EQ(ret.num_unique, id2count.size());
+  FOR_RANGE(int64_t, i, 0, ret.num_unique) {
+    ASSERT_EQ(ret.count.at(i), id2count.at(ret.unique_out.at(i)));
+  }
+  FOR_RANGE(int64_t, i, 0, ids.size()) {
+    ASSERT_EQ(ret.unique_out.at(ret.idx_out.at(i)), ids.at(i));
+  }
+}
+
+double UniqueMIdsPerSec(const std::vector<int64_t>& ids,
+                        const std::function<void(const std::vector<int64_t>&)>& Unique) {
+  Unique(ids);
+  const int iters = 3;
+  const auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int, i, 0, iters) { Unique(ids); }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return ids.size() * iters / elapsed.count() / 1e6;
+}
+
+}  // namespace
+
+TEST(CpuHashUnique, unique) {
+  CheckUnique({3});
+  CheckUnique({5, 5, 5, 1, 5});
+  CheckUnique(RandomIds(1000, 100, 0));
+  CheckUnique(RandomIds(100000, 1000000, 0));
+  CheckUnique(RandomIds(100000, 10000, 1.2));
+  const std::vector<int64_t> ids = RandomIds(300000, 50000, 1.05);
+  const UniqueResult serial = RunUnique(ids);
+  Global<ThreadPool>::New(4);
+  CheckUnique(ids);
+  // partitions only depend on the input, so does the order of unique ids
+  const UniqueResult parallel = RunUnique(ids);
+  Global<ThreadPool>::Delete();
+  ASSERT_EQ(serial.unique_out, parallel.unique_out);
+  ASSERT_EQ(serial.idx_out, parallel.idx_out);
+  ASSERT_EQ(serial.count, parallel.count);
+}
+
+TEST(CpuHashUnique, unique_and_segment_sum) {
+  Global<ThreadPool>::New(4);
+  for (int64_t n : {7, 100000}) {
+    const int64_t m = 3;
+    const std::vector<int64_t> ids = RandomIds(n, n / 4 + 1, 1.1);
+    std::vector<float> values(n * m);
+    FOR_RANGE(int64_t, i, 0, n * m) { values.at(i) = i % 7 - 3; }
+    std::vector<char> workspace(CpuHashUnique<int64_t, int64_t>::GetWorkspaceSizeInBytes(n));
+    int64_t num_unique = 0;
+    std::vector<int64_t> unique_out(n);
+    std::vector<int64_t> idx_out(n);
+    std::vector<float> out(n * m, 1.f);
+    CpuHashUnique<int64_t, int64_t>::UniqueAndSegmentSum(
+        n, m, ids.data(), values.data(), &num_unique, unique_out.data(), idx_out.data(),
+        out.data(), workspace.data(), workspace.size());
+    HashMap<int64_t, std::vector<double>> id2sum;
+    FOR_RANGE(int64_t, i, 0, n) {
+      auto& sum = id2sum[ids.at(i)];
+      sum.resize(m);
+      FOR_RANGE(int64_t, k, 0, m) { sum.at(k) += values.at(i * m + k); }
+    }
+    ASSERT_EQ(num_unique, id2sum.size());
+    FOR_RANGE(int64_t, u, 0, num_unique) {
+      FOR_RANGE(int64_t, k, 0, m) {
+        ASSERT_EQ(out.at(u * m + k), id2sum.at(unique_out.at(u)).at(k));
+      }
+    }
+    FOR_RANGE(int64_t, i, num_unique * m, n * m) { ASSERT_EQ(out.at(i), 0.f); }
+  }
+  Global<ThreadPool>::Delete();
+}
+
+TEST(CpuHashUnique, DISABLED_throughput) {
+  // a batch of sparse ids, from distinct ids to a few hot ones
+  const int64_t n = 1 << 20;
+  const std::vector<std::pair<std::string, std::vector<int64_t>>> id_sets = {
+      {"uniform over 64M", RandomIds(n, 1 << 26, 0)},
+      {"uniform over 64K", RandomIds(n, 1 << 16, 0)},
+      {"zipf 1.05 over 1M", RandomIds(n, 1 << 20, 1.05)},
+      {"zipf 1.5 over 1M", RandomIds(n, 1 << 20, 1.5)}};
+  std::vector<int64_t> unique_out(n);
+  std::vector<int32_t> idx_out(n);
+  std::vector<char> workspace(CpuHashUnique<int64_t, int32_t>::GetWorkspaceSizeInBytes(n));
+  auto HashMapUnique = [&](const std::vector<int64_t>& ids) {
+    HashMap<int64_t, int32_t> map;
+    FOR_RANGE(int64_t, i, 0, n) {
+      auto it = map.find(ids[i]);
+      if (it == map.end()) {
+        const int32_t idx = map.size();
+        unique_out[idx] = ids[i];
+        map[ids[i]] = idx;
+        idx_out[i] = idx;
+      } else {
+        idx_out[i] = it->second;
+      }
+    }
+  };
+  auto HashUnique = [&](const std::vector<int64_t>& ids) {
+    int32_t num_unique = 0;
+    CpuHashUnique<int64_t, int32_t>::Unique(n, ids.data(), &num_unique, unique_out.data(),
+                                            idx_out.data(), nullptr, workspace.data(),
+                                            workspace.size());
+  };
+  for (const auto& pair : id_sets) {
+    const double hash_map_rate = UniqueMIdsPerSec(pair.second, HashMapUnique);
+    const double serial_rate = UniqueMIdsPerSec(pair.second, HashUnique);
+    Global<ThreadPool>::New(std::thread::hardware_concurrency());
+    const double pool_rate = UniqueMIdsPerSec(pair.second, HashUnique);
+    Global<ThreadPool>::Delete();
+    LOG(INFO) << pair.first << ", HashMap: " << hash_map_rate
+              << " M ids/s, open addressing: " << serial_rate
+              << " M ids/s, open addressing on thread pool: " << pool_rate << " M ids/s";
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
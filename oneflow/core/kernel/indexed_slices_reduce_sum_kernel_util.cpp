@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/kernel/indexed_slices_reduce_sum_kernel_util.h"
 #include "oneflow/core/kernel/unique_kernel_util.h"
+#include "oneflow/core/kernel/cpu_hash_unique.h"
 #include "oneflow/core/kernel/unsorted_segment_sum_kernel_util.h"
 
 namespace oneflow {
@@ -24,6 +25,29 @@ int64_t GetUniqueIdxSize(int64_t n) {
   return GetCudaAlignedSize(n * sizeof(IDX));
 }
 
+// the host version sums the rows of each unique index while deduplicating, instead of zeroing
+// all the n rows and scattering into them afterwards
+template<typename K, typename T, typename IDX>
+struct IndexedSlicesReduceSumKernelUtil<DeviceType::kCPU, K, T, IDX> {
+  static void ReduceSum(DeviceCtx* ctx, int64_t n, int64_t m, const K* indices, const T* values,
+                        IDX* num_unique_indices, K* indices_out, T* values_out, void* workspace,
+                        int64_t workspace_size_in_bytes) {
+    const int64_t unique_idx_size = GetUniqueIdxSize<IDX>(n);
+    CHECK_LE(unique_idx_size, workspace_size_in_bytes);
+    IDX* unique_idx_ptr = reinterpret_cast<IDX*>(workspace);
+    void* unique_workspace_ptr = reinterpret_cast<unsigned char*>(workspace) + unique_idx_size;
+    CpuHashUnique<K, IDX>::UniqueAndSegmentSum(n, m, indices, values, num_unique_indices,
+                                               indices_out, unique_idx_ptr, values_out,
+                                               unique_workspace_ptr,
+                                               workspace_size_in_bytes - unique_idx_size);
+  }
+  static void GetReduceSumWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n, int64_t m,
+                                               int64_t* workspace_size_in_bytes) {
+    *workspace_size_in_bytes =
+        GetUniqueIdxSize<IDX>(n) + CpuHashUnique<K, IDX>::GetWorkspaceSizeInBytes(n);
+  }
+};
+
 template<DeviceType device_type, typename K, typename T, typename IDX>
 void IndexedSlicesReduceSumKernelUtil<device_type, K, T, IDX>::ReduceSum(
     DeviceCtx* ctx, int64_t n, int64_t m, const K* indices, const T* values,
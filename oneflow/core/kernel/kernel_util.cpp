@@ -413,13 +413,9 @@ KU_FLOATING_METHOD BatchedGemm(DeviceCtx* ctx, const enum CBLAS_ORDER order,
                                const enum CBLAS_TRANSPOSE trans_b, int batch_size, int m, int n,
                                int k, const T alpha, const T* a, const T* b, const T beta, T* c,
                                T** buf) {
-  const int a_stride = m * k;
-  const int b_stride = k * n;
-  const int c_stride = m * n;
-  FOR_RANGE(int32_t, i, 0, batch_size) {
-    KernelUtil<DeviceType::kCPU, T>::OFGemm(ctx, trans_a, trans_b, m, n, k, alpha, a + i * a_stride,
-                                            b + i * b_stride, beta, c + i * c_stride);
-  }
+  CHECK_EQ(order, CblasRowMajor);
+  BlasIf<DeviceType::kCPU>::OFBatchedGemm(ctx, trans_a, trans_b, batch_size, m, n, k, alpha, a, b,
+                                          beta, c, buf);
 }
 
 KU_FLOATING_METHOD Exp(DeviceCtx* ctx, const int64_t n, const T* x, T* y) {
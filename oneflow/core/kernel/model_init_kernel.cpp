@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/kernel/kernel.h"
+#include "oneflow/core/persistence/persistence_thread_pool.h"
 
 namespace oneflow {
 
@@ -59,10 +60,12 @@ class ModelInitKernel final : public KernelIf<DeviceType::kCPU> {
         return snapshot;
       }
     };
+    // snapshots of different variables are read in parallel
+    TaskGroup read_tasks(PersistenceThreadPool());
     const auto InitializeWithSnapshot = [&](const std::string& snapshot_path,
                                             const std::string& key, Blob* blob) {
       SnapshotReader* reader = GetSnapshotReader(snapshot_path);
-      reader->Read(key, blob);
+      read_tasks.Run([reader, key, blob]() { reader->Read(key, blob); });
     };
     FOR_RANGE(int64_t, i, 0, num_var) {
       Blob* out_i = BnInOp2Blob(GenRepeatedBn("out", i));
@@ -84,6 +87,7 @@ class ModelInitKernel final : public KernelIf<DeviceType::kCPU> {
         UNIMPLEMENTED();
       }
     }
+    read_tasks.Wait();
   }
 };
 
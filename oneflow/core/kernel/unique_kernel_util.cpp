@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/kernel/unique_kernel_util.h"
+#include "oneflow/core/kernel/cpu_hash_unique.h"
 
 namespace oneflow {
 
@@ -27,31 +28,16 @@ struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void UniqueWithCounts(DeviceCtx* ctx, int64_t n, const KEY* in, IDX* num_unique,
                                KEY* unique_out, IDX* idx_out, IDX* count, void* workspace,
                                int64_t workspace_size_in_bytes) {
-    HashMap<KEY, IDX> map;
-    FOR_RANGE(int64_t, i, 0, n) {
-      KEY in_i = in[i];
-      auto it = map.find(in_i);
-      if (it == map.end()) {
-        IDX idx = map.size();
-        if (count != nullptr) { count[idx] = 1; }
-        idx_out[i] = idx;
-        unique_out[idx] = in_i;
-        map[in_i] = idx;
-      } else {
-        IDX idx = it->second;
-        if (count != nullptr) { count[idx] += 1; }
-        idx_out[i] = idx;
-      }
-    }
-    *num_unique = map.size();
+    CpuHashUnique<KEY, IDX>::Unique(n, in, num_unique, unique_out, idx_out, count, workspace,
+                                    workspace_size_in_bytes);
   }
   static void GetUniqueWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n,
                                             int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    *workspace_size_in_bytes = CpuHashUnique<KEY, IDX>::GetWorkspaceSizeInBytes(n);
   }
   static void GetUniqueWithCountsWorkspaceSizeInBytes(DeviceCtx* ctx, int64_t n,
                                                       int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    *workspace_size_in_bytes = CpuHashUnique<KEY, IDX>::GetWorkspaceSizeInBytes(n);
   }
 };
 
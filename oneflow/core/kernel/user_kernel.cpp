@@ -439,7 +439,8 @@ class UserKernel final : public Kernel {
                     std::function<Blob*(const std::string&)> BnInOp2Blob) const override {
     infer_ctx_->UpdateArg2Tensor(BnInOp2Blob);
     infer_cache_->UpdateCacheKey(infer_ctx_.get());
-    if (!infer_cache_->IsCacheHit()) {
+    std::shared_ptr<const OpInferCacheValue> cache_value_ptr = infer_cache_->GetCacheValue();
+    if (!cache_value_ptr) {
       UserKernelOpInferContext* op_infer_ctx =
           dynamic_cast<UserKernelOpInferContext*>(infer_ctx_->MutOpInferContext());
       CHECK_NOTNULL(op_infer_ctx);
@@ -460,7 +461,6 @@ class UserKernel final : public Kernel {
       }
       infer_cache_->UpdateCacheValue(infer_ctx_.get());
     } else {
-      std::shared_ptr<const OpInferCacheValue> cache_value_ptr = infer_cache_->GetCacheValue();
       FOR_RANGE(int, i, 0, infer_ctx_->outputs().size()) {
         const auto& out_arg_pair = infer_ctx_->outputs().at(i);
         MutShapeView* mut_shape_view =
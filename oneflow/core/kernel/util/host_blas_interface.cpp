@@ -15,6 +15,8 @@ limitations under the License.
 */
 #include "oneflow/core/kernel/util/host_blas_interface.h"
 #include "oneflow/core/register/blob.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
@@ -52,17 +54,34 @@ static void AxpyImpl(DeviceCtx* ctx, const int n, const T alpha, const T* x, con
   }
 }
 
+// Products with fewer multiply-adds than this are too small for the BLAS library to thread,
+// so a batch of them is split across the compute thread pool instead. Larger products are
+// issued one at a time and threaded inside the BLAS library.
+constexpr int64_t kBatchedGemmMaxParallelMacs = 1 << 21;
+// multiply-adds worth handing to another thread
+constexpr int64_t kBatchedGemmGrainMacs = 1 << 16;
+
 template<typename T>
 void BatchedGemmImpl(DeviceCtx* ctx, const enum CBLAS_ORDER order,
                      const enum CBLAS_TRANSPOSE trans_a, const enum CBLAS_TRANSPOSE trans_b,
                      int batch_size, int m, int n, int k, const T alpha, const T* a, const T* b,
                      const T beta, T* c, T** buf) {
-  const int a_stride = m * k;
-  const int b_stride = k * n;
-  const int c_stride = m * n;
-  FOR_RANGE(int32_t, i, 0, batch_size) {
-    BlasIf<DeviceType::kCPU>::OFGemm(ctx, trans_a, trans_b, m, n, k, alpha, a + i * a_stride,
-                                     b + i * b_stride, beta, c + i * c_stride);
+  const int64_t a_stride = static_cast<int64_t>(m) * k;
+  const int64_t b_stride = static_cast<int64_t>(k) * n;
+  const int64_t c_stride = static_cast<int64_t>(m) * n;
+  const auto GemmRange = [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      BlasIf<DeviceType::kCPU>::OFGemm(ctx, trans_a, trans_b, m, n, k, alpha, a + i * a_stride,
+                                       b + i * b_stride, beta, c + i * c_stride);
+    }
+  };
+  const int64_t macs = std::max<int64_t>(c_stride * k, 1);
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (thread_pool == nullptr || batch_size <= 1 || macs >= kBatchedGemmMaxParallelMacs) {
+    GemmRange(0, batch_size);
+  } else {
+    const int64_t grain = std::max<int64_t>(kBatchedGemmGrainMacs / macs, 1);
+    thread_pool->ParallelFor(0, batch_size, grain, GemmRange);
   }
 }
 
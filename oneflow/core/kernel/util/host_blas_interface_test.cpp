@@ -0,0 +1,106 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/kernel/util/host_blas_interface.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+std::vector<float> RandomVector(int64_t n) {
+  std::mt19937 gen(n);
+  std::uniform_real_distribution<float> dis(-1, 1);
+  std::vector<float> vec(n);
+  for (float& val : vec) { val = dis(gen); }
+  return vec;
+}
+
+void CheckBatchedGemm(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b, int batch_size,
+                      int m, int n, int k) {
+  const std::vector<float> a = RandomVector(batch_size * m * k);
+  const std::vector<float> b = RandomVector(batch_size * k * n);
+  std::vector<float> c = RandomVector(batch_size * m * n);
+  const std::vector<float> c_in = c;
+  const float alpha = 0.5;
+  const float beta = 2;
+  BlasIf<DeviceType::kCPU>::OFBatchedGemm(nullptr, trans_a, trans_b, batch_size, m, n, k, alpha,
+                                          a.data(), b.data(), beta, c.data(), nullptr);
+  FOR_RANGE(int, batch, 0, batch_size) {
+    const float* a_mat = a.data() + batch * m * k;
+    const float* b_mat = b.data() + batch * k * n;
+    FOR_RANGE(int, i, 0, m) {
+      FOR_RANGE(int, j, 0, n) {
+        double sum = 0;
+        FOR_RANGE(int, l, 0, k) {
+          const float a_val = trans_a == CblasNoTrans ? a_mat[i * k + l] : a_mat[l * m + i];
+          const float b_val = trans_b == CblasNoTrans ? b_mat[l * n + j] : b_mat[j * k + l];
+          sum += a_val * b_val;
+        }
+        const int64_t idx = (batch * m + i) * n + j;
+        ASSERT_NEAR(c.at(idx), alpha * sum + beta * c_in.at(idx), 1e-4);
+      }
+    }
+  }
+}
+
+double BatchedGemmSeconds(int batch_size, int m, int n, int k) {
+  const std::vector<float> a = RandomVector(batch_size * m * k);
+  const std::vector<float> b = RandomVector(batch_size * k * n);
+  std::vector<float> c(batch_size * m * n);
+  const int iters = 5;
+  const auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int, i, 0, iters) {
+    BlasIf<DeviceType::kCPU>::OFBatchedGemm(nullptr, CblasNoTrans, CblasTrans, batch_size, m, n,
+                                            k, 1.f, a.data(), b.data(), 0.f, c.data(), nullptr);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iters;
+}
+
+}  // namespace
+
+TEST(HostBlasInterface, batched_gemm) {
+  CheckBatchedGemm(CblasNoTrans, CblasNoTrans, 3, 4, 5, 6);
+  Global<ThreadPool>::New(4);
+  CheckBatchedGemm(CblasNoTrans, CblasTrans, 37, 16, 9, 33);
+  CheckBatchedGemm(CblasTrans, CblasNoTrans, 64, 8, 64, 16);
+  CheckBatchedGemm(CblasTrans, CblasTrans, 2, 130, 140, 150);
+  Global<ThreadPool>::Delete();
+}
+
+TEST(HostBlasInterface, DISABLED_batched_gemm_throughput) {
+  // (batch, m, n, k) of attention-like products, from many tiny matrices to a few large ones
+  const std::vector<std::vector<int>> sweep = {{1024, 16, 16, 64},  {512, 64, 64, 64},
+                                               {256, 128, 128, 64}, {96, 128, 128, 128},
+                                               {32, 256, 256, 64},  {4, 512, 512, 512}};
+  for (const auto& dims : sweep) {
+    const double serial_sec = BatchedGemmSeconds(dims.at(0), dims.at(1), dims.at(2), dims.at(3));
+    Global<ThreadPool>::New(std::thread::hardware_concurrency());
+    const double pool_sec = BatchedGemmSeconds(dims.at(0), dims.at(1), dims.at(2), dims.at(3));
+    Global<ThreadPool>::Delete();
+    const double gflop = 2.0 * dims.at(0) * dims.at(1) * dims.at(2) * dims.at(3) / 1e9;
+    LOG(INFO) << "batch: " << dims.at(0) << ", m: " << dims.at(1) << ", n: " << dims.at(2)
+              << ", k: " << dims.at(3) << ", serial: " << gflop / serial_sec
+              << " GFLOPS, thread pool: " << gflop / pool_sec << " GFLOPS";
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
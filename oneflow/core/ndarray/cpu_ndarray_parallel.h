@@ -0,0 +1,118 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_NDARRAY_CPU_NDARRAY_PARALLEL_H_
+#define ONEFLOW_CORE_NDARRAY_CPU_NDARRAY_PARALLEL_H_
+
+#include "oneflow/core/ndarray/xpu_shape.h"
+#include "oneflow/core/common/global.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+// elements handled by one task, smaller ranges are not worth a hop to the thread pool
+constexpr int64_t kCpuNdarrayParallelGrain = 32768;
+
+// Calls fn(begin, end) on disjoint ranges covering [0, n), in parallel on the compute thread
+// pool when there is one and n is large enough.
+inline void CpuNdarrayParallelFor(int64_t n, int64_t grain,
+                                  const std::function<void(int64_t, int64_t)>& fn) {
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (thread_pool == nullptr || n <= grain) {
+    fn(0, n);
+  } else {
+    thread_pool->ParallelFor(0, n, grain, fn);
+  }
+}
+
+// Offset of the first element of the x row broadcast to row `row` of y.
+// Rows run along the innermost axis, x has the same number of axes as y.
+template<int NDIMS>
+inline int64_t CpuBroadcastRowOffset(const XpuShape& y_shape, const XpuShape& x_shape,
+                                     int64_t row) {
+  int64_t offset = 0;
+  for (int i = NDIMS - 2; i >= 0; --i) {
+    const int64_t coord = row % y_shape.At(i);
+    row /= y_shape.At(i);
+    offset += (coord % x_shape.At(i)) * x_shape.DimElemNum(i);
+  }
+  return offset;
+}
+
+// The innermost axis of a simplified broadcast is either full or broadcast, so every row is
+// a contiguous loop over one operand against either a contiguous row or a scalar of the other.
+// The three cases are spelled out for the compiler to vectorize.
+template<typename T, typename Y, template<typename> class binary_func>
+inline void CpuBroadcastBinaryRow(int64_t n, Y* y, const T* a, bool a_is_scalar, const T* b,
+                                  bool b_is_scalar) {
+  if (!a_is_scalar && !b_is_scalar) {
+    for (int64_t i = 0; i < n; ++i) { y[i] = binary_func<T>::Invoke(a[i], b[i]); }
+  } else if (!a_is_scalar) {
+    const T b_val = *b;
+    for (int64_t i = 0; i < n; ++i) { y[i] = binary_func<T>::Invoke(a[i], b_val); }
+  } else if (!b_is_scalar) {
+    const T a_val = *a;
+    for (int64_t i = 0; i < n; ++i) { y[i] = binary_func<T>::Invoke(a_val, b[i]); }
+  } else {
+    const Y y_val = binary_func<T>::Invoke(*a, *b);
+    for (int64_t i = 0; i < n; ++i) { y[i] = y_val; }
+  }
+}
+
+// y = binary_func(broadcast(a), broadcast(b)), split by rows of y across the thread pool.
+// y may alias a when both have the shape of y.
+template<typename T, typename Y, int NDIMS, template<typename> class binary_func>
+void CpuBroadcastBinaryApply(const XpuShape& y_shape, Y* y, const XpuShape& a_shape, const T* a,
+                             const XpuShape& b_shape, const T* b) {
+  const int64_t row_size = y_shape.At(NDIMS - 1);
+  if (row_size == 0) { return; }
+  const int64_t row_num = y_shape.ElemNum() / row_size;
+  const bool a_is_scalar = (a_shape.At(NDIMS - 1) == 1);
+  const bool b_is_scalar = (b_shape.At(NDIMS - 1) == 1);
+  const int64_t grain = std::max<int64_t>(kCpuNdarrayParallelGrain / row_size, 1);
+  CpuNdarrayParallelFor(row_num, grain, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, row, begin, end) {
+      CpuBroadcastBinaryRow<T, Y, binary_func>(
+          row_size, y + row * row_size, a + CpuBroadcastRowOffset<NDIMS>(y_shape, a_shape, row),
+          a_is_scalar, b + CpuBroadcastRowOffset<NDIMS>(y_shape, b_shape, row), b_is_scalar);
+    }
+  });
+}
+
+// y = unary_func(broadcast(x)), split by rows of y across the thread pool.
+template<typename T, int NDIMS, template<typename> class unary_func>
+void CpuBroadcastUnaryApply(const XpuShape& y_shape, T* y, const XpuShape& x_shape, const T* x) {
+  const int64_t row_size = y_shape.At(NDIMS - 1);
+  if (row_size == 0) { return; }
+  const int64_t row_num = y_shape.ElemNum() / row_size;
+  const bool x_is_scalar = (x_shape.At(NDIMS - 1) == 1);
+  const int64_t grain = std::max<int64_t>(kCpuNdarrayParallelGrain / row_size, 1);
+  CpuNdarrayParallelFor(row_num, grain, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, row, begin, end) {
+      T* y_row = y + row * row_size;
+      const T* x_row = x + CpuBroadcastRowOffset<NDIMS>(y_shape, x_shape, row);
+      if (x_is_scalar) {
+        const T y_val = unary_func<T>::Invoke(*x_row);
+        for (int64_t i = 0; i < row_size; ++i) { y_row[i] = y_val; }
+      } else {
+        for (int64_t i = 0; i < row_size; ++i) { y_row[i] = unary_func<T>::Invoke(x_row[i]); }
+      }
+    }
+  });
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_NDARRAY_CPU_NDARRAY_PARALLEL_H_
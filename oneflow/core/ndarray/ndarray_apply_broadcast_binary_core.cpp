@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/ndarray/ndarray_apply_broadcast_binary_core.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 
@@ -22,7 +23,9 @@ struct NdarrayApplyBroadcastBinaryCoreWrapper<DeviceType::kCPU, T, NDIMS, binary
   static void Apply(DeviceCtx* ctx,
                     const XpuVarNdarray<typename BinaryFuncTrait<binary_func, T>::return_type>& y,
                     const XpuVarNdarray<const T>& a, const XpuVarNdarray<const T>& b) {
-    NdarrayApplyBroadcastBinaryCore<T, NDIMS, binary_func>::Apply(y, a, b);
+    CpuBroadcastBinaryApply<T, typename BinaryFuncTrait<binary_func, T>::return_type, NDIMS,
+                            binary_func>(y.shape(), y.ptr(), a.shape(), a.ptr(), b.shape(),
+                                         b.ptr());
   }
 };
 
@@ -31,7 +34,8 @@ struct NdarrayApplyBroadcastInplaceBinaryCoreWrapper<DeviceType::kCPU, T, NDIMS,
     final {
   static void InplaceApply(DeviceCtx* ctx, const XpuVarNdarray<T>& y,
                            const XpuVarNdarray<const T>& x) {
-    NdarrayApplyBroadcastBinaryCore<T, NDIMS, binary_func>::InplaceApply(y, x);
+    CpuBroadcastBinaryApply<T, T, NDIMS, binary_func>(y.shape(), y.ptr(), y.shape(), y.ptr(),
+                                                      x.shape(), x.ptr());
   }
 };
 
@@ -0,0 +1,138 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ndarray/ndarray_apply_broadcast_binary.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+struct BroadcastCase {
+  DimVector y_dim;
+  DimVector a_dim;
+  DimVector b_dim;
+};
+
+// the broadcast patterns of bias_add, scale by channel, row/column softmax and outer products
+std::vector<BroadcastCase> GetBroadcastCases() {
+  return {{{4096, 1024}, {4096, 1024}, {4096, 1024}},
+          {{4096, 1024}, {4096, 1024}, {1, 1024}},
+          {{4096, 1024}, {4096, 1024}, {4096, 1}},
+          {{4096, 1024}, {4096, 1}, {1, 1024}},
+          {{64, 256, 28, 28}, {64, 256, 28, 28}, {1, 256, 1, 1}},
+          {{64, 56, 56, 256}, {64, 56, 56, 256}, {1, 1, 1, 256}},
+          {{32, 16, 64, 128}, {32, 16, 64, 128}, {32, 1, 1, 128}}};
+}
+
+// odd sizes so that the work splits unevenly across the pool
+std::vector<BroadcastCase> GetSmallBroadcastCases() {
+  return {{{77}, {77}, {1}},
+          {{1}, {1}, {1}},
+          {{3, 1031}, {1, 1031}, {3, 1}},
+          {{5, 7, 9}, {5, 7, 9}, {5, 1, 9}},
+          {{4, 33, 1, 65}, {4, 33, 1, 65}, {1, 33, 1, 1}},
+          {{2, 3, 5, 7, 11}, {2, 1, 5, 1, 11}, {1, 3, 1, 7, 1}},
+          {{513, 129}, {513, 129}, {513, 129}}};
+}
+
+int64_t NaiveOffset(const DimVector& y_dim, const DimVector& x_dim, int64_t y_offset) {
+  int64_t x_offset = 0;
+  int64_t x_stride = 1;
+  for (int i = y_dim.size() - 1; i >= 0; --i) {
+    const int64_t coord = y_offset % y_dim.at(i);
+    y_offset /= y_dim.at(i);
+    x_offset += (coord % x_dim.at(i)) * x_stride;
+    x_stride *= x_dim.at(i);
+  }
+  return x_offset;
+}
+
+void FillRandom(std::vector<float>* vec) {
+  std::mt19937 gen(vec->size());
+  std::uniform_real_distribution<float> dis(-1, 1);
+  for (float& val : *vec) { val = dis(gen); }
+}
+
+// use_core: time the generic per-element core every device shares
+double BroadcastAddSeconds(const BroadcastCase& c, int32_t repeat, bool check, bool use_core) {
+  const Shape y_shape(c.y_dim);
+  const Shape a_shape(c.a_dim);
+  const Shape b_shape(c.b_dim);
+  std::vector<float> y(y_shape.elem_cnt());
+  std::vector<float> a(a_shape.elem_cnt());
+  std::vector<float> b(b_shape.elem_cnt());
+  FillRandom(&a);
+  FillRandom(&b);
+  const XpuVarNdarray<float> y_arr(y_shape, y.data());
+  const XpuVarNdarray<const float> a_arr(a_shape, a.data());
+  const XpuVarNdarray<const float> b_arr(b_shape, b.data());
+  const auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int32_t, i, 0, repeat) {
+    if (use_core) {
+      NdarrayApplyBroadcastBinaryCore<float, 4, BinaryFuncAdd>::Apply(y_arr, a_arr, b_arr);
+    } else {
+      NdarrayApplyBroadcastBinary<DeviceType::kCPU, float, BinaryFuncAdd>::Apply(nullptr, y_arr,
+                                                                                a_arr, b_arr);
+    }
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  if (check) {
+    FOR_RANGE(int64_t, i, 0, y_shape.elem_cnt()) {
+      CHECK_EQ(y.at(i), a.at(NaiveOffset(c.y_dim, c.a_dim, i))
+                            + b.at(NaiveOffset(c.y_dim, c.b_dim, i)));
+    }
+  }
+  return elapsed.count() / repeat;
+}
+
+}  // namespace
+
+TEST(NdarrayApplyBroadcastBinary, cpu_add) {
+  for (const BroadcastCase& c : GetSmallBroadcastCases()) {
+    BroadcastAddSeconds(c, 1, true, false);
+  }
+  Global<ThreadPool>::New(4);
+  for (const BroadcastCase& c : GetSmallBroadcastCases()) {
+    BroadcastAddSeconds(c, 1, true, false);
+  }
+  Global<ThreadPool>::Delete();
+}
+
+TEST(NdarrayApplyBroadcastBinary, DISABLED_cpu_add_time_vs_thread_num) {
+  const int32_t max_thread_num = std::thread::hardware_concurrency();
+  for (const BroadcastCase& c : GetBroadcastCases()) {
+    const double serial_sec = BroadcastAddSeconds(c, 5, false, false);
+    for (int32_t thread_num = 2; thread_num <= max_thread_num; thread_num *= 2) {
+      Global<ThreadPool>::New(thread_num);
+      const double sec = BroadcastAddSeconds(c, 5, false, false);
+      Global<ThreadPool>::Delete();
+      LOG(INFO) << Shape(c.y_dim).ToString() << " = " << Shape(c.a_dim).ToString() << " + "
+                << Shape(c.b_dim).ToString() << ", threads: " << thread_num
+                << ", speedup: " << serial_sec / sec;
+    }
+    LOG(INFO) << Shape(c.y_dim).ToString() << " = " << Shape(c.a_dim).ToString() << " + "
+              << Shape(c.b_dim).ToString() << ", serial: " << serial_sec * 1e3 << " ms";
+    if (c.y_dim.size() == 4) {
+      LOG(INFO) << "generic core: " << BroadcastAddSeconds(c, 1, false, true) * 1e3 << " ms";
+    }
+  }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -14,13 +14,14 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/ndarray/ndarray_apply_broadcast_unary_core.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 
 template<typename T, int NDIMS, template<typename> class unary_func>
 struct NdarrayApplyBroadcastUnaryCoreWrapper<DeviceType::kCPU, T, NDIMS, unary_func> final {
   static void Apply(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
-    NdarrayApplyBroadcastUnaryCore<T, NDIMS, unary_func>::Apply(y, x);
+    CpuBroadcastUnaryApply<T, NDIMS, unary_func>(y.shape(), y.ptr(), x.shape(), x.ptr());
   }
 };
 
@@ -15,13 +15,18 @@ limitations under the License.
 */
 #include "oneflow/core/ndarray/ndarray_apply_unary_core.h"
 #include "oneflow/core/ndarray/unary_func.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 
 template<typename T, template<typename> class unary_func>
 struct NdarrayApplyUnaryCoreWrapper<DeviceType::kCPU, T, unary_func> final {
   static void InplaceApply(DeviceCtx* ctx, const XpuVarNdarray<T>& y) {
-    NdarrayApplyUnaryCore<T, unary_func>::InplaceApply(y.ptr(), y.shape().ElemNum());
+    CpuNdarrayParallelFor(y.shape().ElemNum(), kCpuNdarrayParallelGrain,
+                          [&](int64_t begin, int64_t end) {
+                            NdarrayApplyUnaryCore<T, unary_func>::InplaceApply(y.ptr() + begin,
+                                                                               end - begin);
+                          });
   }
 };
 
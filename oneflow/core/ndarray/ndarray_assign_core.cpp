@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/ndarray/ndarray_assign_core.h"
 #include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 
@@ -22,7 +23,13 @@ template<typename T, int NDIMS>
 struct NdarrayAssignCoreWrapper<DeviceType::kCPU, T, NDIMS> final {
   static void Assign(DeviceCtx* ctx, const XpuVarNdarray<T>& y,
                      const XpuReducedNdarray<T, NDIMS>& reduced) {
-    NdarrayAssignCore<T, NDIMS>::Assign(y, reduced);
+    T* y_ptr = y.ptr();
+    CpuNdarrayParallelFor(y.shape().ElemNum(), kCpuNdarrayParallelGrain,
+                          [&](int64_t begin, int64_t end) {
+                            FOR_RANGE(int64_t, i, begin, end) {
+                              y_ptr[i] = reduced.template Get<NDIMS>(i);
+                            }
+                          });
   }
 };
 
@@ -17,26 +17,215 @@ limitations under the License.
 #include "oneflow/core/common/preprocessor.h"
 #include "oneflow/core/ndarray/ndarray_reduce_impl.h"
 #include "oneflow/core/ndarray/binary_func.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 
-#define SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(struct_name)                                            \
-  template<typename T, template<typename> class binary_func>                                       \
-  struct struct_name<DeviceType::kCPU, T, binary_func> final {                                     \
-    static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {              \
-      return false;                                                                                \
-    }                                                                                              \
-    static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x, \
-                       const XpuVarNdarray<T>& tmp_storage) {                                      \
-      UNIMPLEMENTED();                                                                             \
-    }                                                                                              \
+namespace {
+
+// Contiguous spans are reduced with kCpuReduceLaneNum independent accumulators, which the
+// compiler maps onto vector lanes, and spans longer than kCpuReduceLeafSize are split in halves
+// and combined pairwise. The rounding error of float sums grows with log(n) instead of n.
+constexpr int64_t kCpuReduceLaneNum = 8;
+constexpr int64_t kCpuReduceLeafSize = 256;
+// rows of a column reduction accumulated in one pass before the partials are combined pairwise
+constexpr int64_t kCpuColReduceRowBlock = 64;
+// columns accumulated by one task, small enough for the accumulators to stay in L1
+constexpr int64_t kCpuColReduceColBlock = 1024;
+
+template<typename T, template<typename> class binary_func>
+T CpuReduceSpan(const T* x, int64_t n) {
+  if (n > kCpuReduceLeafSize) {
+    const int64_t half = (n / 2 + kCpuReduceLaneNum - 1) / kCpuReduceLaneNum * kCpuReduceLaneNum;
+    return binary_func<T>::Invoke(CpuReduceSpan<T, binary_func>(x, half),
+                                  CpuReduceSpan<T, binary_func>(x + half, n - half));
+  }
+  T lanes[kCpuReduceLaneNum];
+  std::fill(lanes, lanes + kCpuReduceLaneNum, UnitOfBinaryFunc<T, binary_func>::Val());
+  int64_t i = 0;
+  for (; i + kCpuReduceLaneNum <= n; i += kCpuReduceLaneNum) {
+    for (int64_t j = 0; j < kCpuReduceLaneNum; ++j) {
+      lanes[j] = binary_func<T>::Invoke(lanes[j], x[i + j]);
+    }
+  }
+  T ret = UnitOfBinaryFunc<T, binary_func>::Val();
+  for (; i < n; ++i) { ret = binary_func<T>::Invoke(ret, x[i]); }
+  for (int64_t j = 0; j < kCpuReduceLaneNum; ++j) { ret = binary_func<T>::Invoke(ret, lanes[j]); }
+  return ret;
+}
+
+// y[i] = reduce(x[i * num_cols, (i + 1) * num_cols))
+template<typename T, template<typename> class binary_func>
+void CpuRowReduce(int64_t num_rows, int64_t num_cols, const T* x, T* y) {
+  const int64_t grain =
+      std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(num_cols, 1), 1);
+  CpuNdarrayParallelFor(num_rows, grain, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      y[i] = CpuReduceSpan<T, binary_func>(x + i * num_cols, num_cols);
+    }
+  });
+}
+
+// y[b][j] = reduce over i of x[b][i][j], for num_batches matrices of num_rows x num_cols.
+// Blocks of kCpuColReduceRowBlock rows are accumulated row by row, which vectorizes along the
+// columns, and the per-block partials are then combined pairwise.
+template<typename T, template<typename> class binary_func>
+void CpuColReduce(int64_t num_batches, int64_t num_rows, int64_t num_cols, const T* x, T* y) {
+  if (num_rows == 0) {
+    std::fill(y, y + num_batches * num_cols, UnitOfBinaryFunc<T, binary_func>::Val());
+    return;
+  }
+  const int64_t row_block_num = (num_rows + kCpuColReduceRowBlock - 1) / kCpuColReduceRowBlock;
+  const int64_t col_block_num = (num_cols + kCpuColReduceColBlock - 1) / kCpuColReduceColBlock;
+  std::vector<T> partials;
+  if (row_block_num > 1) { partials.resize(num_batches * row_block_num * num_cols); }
+  // partial of row block r of batch b, or y itself when there is a single row block
+  auto Partial = [&](int64_t b, int64_t r) -> T* {
+    return row_block_num > 1 ? partials.data() + (b * row_block_num + r) * num_cols
+                             : y + b * num_cols;
+  };
+  const int64_t task_num = num_batches * row_block_num * col_block_num;
+  const int64_t task_elem_num =
+      std::min(kCpuColReduceRowBlock, num_rows) * std::min(kCpuColReduceColBlock, num_cols);
+  const int64_t task_grain =
+      std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(task_elem_num, 1), 1);
+  CpuNdarrayParallelFor(task_num, task_grain, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, task, begin, end) {
+      const int64_t c = task % col_block_num;
+      const int64_t r = task / col_block_num % row_block_num;
+      const int64_t b = task / col_block_num / row_block_num;
+      const int64_t col_begin = c * kCpuColReduceColBlock;
+      const int64_t col_size = std::min(kCpuColReduceColBlock, num_cols - col_begin);
+      const int64_t row_begin = r * kCpuColReduceRowBlock;
+      const int64_t row_end = std::min(row_begin + kCpuColReduceRowBlock, num_rows);
+      T* acc = Partial(b, r) + col_begin;
+      std::fill(acc, acc + col_size, UnitOfBinaryFunc<T, binary_func>::Val());
+      FOR_RANGE(int64_t, i, row_begin, row_end) {
+        const T* x_row = x + (b * num_rows + i) * num_cols + col_begin;
+        for (int64_t j = 0; j < col_size; ++j) {
+          acc[j] = binary_func<T>::Invoke(acc[j], x_row[j]);
+        }
+      }
+    }
+  });
+  if (row_block_num == 1) { return; }
+  const int64_t combine_grain =
+      std::max<int64_t>(kCpuNdarrayParallelGrain / (row_block_num * kCpuColReduceColBlock), 1);
+  auto CombinePartials = [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, task, begin, end) {
+      const int64_t c = task % col_block_num;
+      const int64_t b = task / col_block_num;
+      const int64_t col_begin = c * kCpuColReduceColBlock;
+      const int64_t col_size = std::min(kCpuColReduceColBlock, num_cols - col_begin);
+      for (int64_t stride = 1; stride < row_block_num; stride *= 2) {
+        for (int64_t r = 0; r + stride < row_block_num; r += 2 * stride) {
+          T* dst = Partial(b, r) + col_begin;
+          const T* src = Partial(b, r + stride) + col_begin;
+          for (int64_t j = 0; j < col_size; ++j) {
+            dst[j] = binary_func<T>::Invoke(dst[j], src[j]);
+          }
+        }
+      }
+      std::copy(Partial(b, 0) + col_begin, Partial(b, 0) + col_begin + col_size,
+                y + b * num_cols + col_begin);
+    }
+  };
+  CpuNdarrayParallelFor(num_batches * col_block_num, combine_grain, CombinePartials);
+}
+
+}  // namespace
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayScalarReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    return y.shape().ElemNum() == 1;
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t n = x.shape().ElemNum();
+    // fixed block boundaries keep the result independent of the number of threads
+    const int64_t block_num = (n + kCpuNdarrayParallelGrain - 1) / kCpuNdarrayParallelGrain;
+    std::vector<T> partials(block_num);
+    CpuNdarrayParallelFor(block_num, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        const int64_t offset = i * kCpuNdarrayParallelGrain;
+        partials[i] = CpuReduceSpan<T, binary_func>(
+            x.ptr() + offset, std::min(kCpuNdarrayParallelGrain, n - offset));
+      }
+    });
+    *y.ptr() = CpuReduceSpan<T, binary_func>(partials.data(), block_num);
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixRowReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1;
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    CpuRowReduce<T, binary_func>(x.shape().At(0), x.shape().At(1), x.ptr(), y.ptr());
   }
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayScalarReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixRowReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayMatrixColReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeYReduce);
-SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL(NdarrayXYZCubeXZReduce);
-#undef SPECIALIZE_CPU_NDARRAY_REDUCE_IMPL
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayMatrixColReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 2) { return false; }
+    if (y.shape().NumAxes() != 2) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1);
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    CpuColReduce<T, binary_func>(1, x.shape().At(0), x.shape().At(1), x.ptr(), y.ptr());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeYReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 3) { return false; }
+    if (y.shape().NumAxes() != 3) { return false; }
+    return x.shape().At(0) == y.shape().At(0) && y.shape().At(1) == 1
+           && x.shape().At(2) == y.shape().At(2);
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    CpuColReduce<T, binary_func>(x.shape().At(0), x.shape().At(1), x.shape().At(2), x.ptr(),
+                                 y.ptr());
+  }
+};
+
+template<typename T, template<typename> class binary_func>
+struct NdarrayXYZCubeXZReduce<DeviceType::kCPU, T, binary_func> final {
+  static bool Matched(const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x) {
+    if (x.shape().NumAxes() != 3) { return false; }
+    if (y.shape().NumAxes() != 3) { return false; }
+    return y.shape().At(0) == 1 && x.shape().At(1) == y.shape().At(1) && y.shape().At(2) == 1;
+  }
+
+  static void Reduce(DeviceCtx* ctx, const XpuVarNdarray<T>& y, const XpuVarNdarray<const T>& x,
+                     const XpuVarNdarray<T>& tmp_storage) {
+    CHECK(Matched(y, x));
+    const int64_t dim_x = x.shape().At(0);
+    const int64_t dim_y = x.shape().At(1);
+    const int64_t dim_z = x.shape().At(2);
+    // tmp_storage may alias x, the z-reduced matrix gets its own buffer
+    std::vector<T> xy(dim_x * dim_y);
+    CpuRowReduce<T, binary_func>(dim_x * dim_y, dim_z, x.ptr(), xy.data());
+    CpuColReduce<T, binary_func>(1, dim_x, dim_y, xy.data(), y.ptr());
+  }
+};
 
 #define INSTANTIATE_NDARRAY_REDUCE_IMPL(dtype, binary_func)                                       \
   template struct NdarrayScalarReduce<DeviceType::kCPU, OF_PP_PAIR_FIRST(dtype), binary_func>;    \
@@ -0,0 +1,156 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ndarray/ndarray_reduce.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+struct ReduceCase {
+  DimVector x_dim;
+  DimVector y_dim;
+};
+
+// scalar, row, column, XYZ-cube Y and XYZ-cube XZ reductions, then one for the generic path
+std::vector<ReduceCase> GetSmallReduceCases() {
+  return {{{1001}, {1}},          {{3, 5, 7}, {1, 1, 1}},   {{129, 67}, {129, 1}},
+          {{257, 1031}, {1, 1031}}, {{3000, 3}, {1, 3}},    {{5, 130, 33}, {5, 1, 33}},
+          {{70, 9, 13}, {1, 9, 1}}, {{0, 7}, {1, 7}},       {{4, 3, 5, 6}, {1, 3, 1, 6}}};
+}
+
+std::vector<ReduceCase> GetLargeReduceCases() {
+  return {{{1 << 24}, {1}},
+          {{4096, 4096}, {4096, 1}},
+          {{4096, 4096}, {1, 4096}},
+          {{64, 256, 1024}, {64, 1, 1024}},
+          {{64, 256, 1024}, {1, 256, 1}}};
+}
+
+int64_t ReducedOffset(const DimVector& x_dim, const DimVector& y_dim, int64_t x_offset) {
+  int64_t y_offset = 0;
+  int64_t y_stride = 1;
+  for (int i = x_dim.size() - 1; i >= 0; --i) {
+    const int64_t coord = x_offset % x_dim.at(i);
+    x_offset /= x_dim.at(i);
+    y_offset += (coord % y_dim.at(i)) * y_stride;
+    y_stride *= y_dim.at(i);
+  }
+  return y_offset;
+}
+
+template<typename T>
+void FillRandom(std::vector<T>* vec) {
+  std::mt19937 gen(vec->size());
+  std::uniform_int_distribution<int32_t> dis(-100, 100);
+  for (T& val : *vec) { val = static_cast<T>(dis(gen)) / 8; }
+}
+
+template<typename T, template<typename> class binary_func>
+void CheckReduce(const ReduceCase& c) {
+  const Shape x_shape(c.x_dim);
+  const Shape y_shape(c.y_dim);
+  std::vector<T> x(x_shape.elem_cnt());
+  std::vector<T> tmp(x_shape.elem_cnt());
+  std::vector<T> y(y_shape.elem_cnt());
+  FillRandom(&x);
+  NdarrayReduce<DeviceType::kCPU, T, binary_func>::Reduce(
+      nullptr, XpuVarNdarray<T>(y_shape, y.data()), XpuVarNdarray<const T>(x_shape, x.data()),
+      XpuVarNdarray<T>(x_shape, tmp.data()));
+  std::vector<T> expected(y.size(), UnitOfBinaryFunc<T, binary_func>::Val());
+  FOR_RANGE(int64_t, i, 0, x.size()) {
+    T* ret = &expected.at(ReducedOffset(c.x_dim, c.y_dim, i));
+    *ret = binary_func<T>::Invoke(*ret, x.at(i));
+  }
+  // the values are multiples of 1/8, so float sums are exact in any order
+  FOR_RANGE(int64_t, i, 0, y.size()) { ASSERT_EQ(y.at(i), expected.at(i)); }
+}
+
+template<template<typename> class binary_func>
+void CheckAllReduceCases() {
+  for (const ReduceCase& c : GetSmallReduceCases()) {
+    CheckReduce<float, binary_func>(c);
+    CheckReduce<double, binary_func>(c);
+    CheckReduce<int32_t, binary_func>(c);
+  }
+}
+
+double ReduceSumSeconds(const ReduceCase& c, bool use_default) {
+  const Shape x_shape(c.x_dim);
+  const Shape y_shape(c.y_dim);
+  std::vector<float> x(x_shape.elem_cnt());
+  std::vector<float> tmp(x_shape.elem_cnt());
+  std::vector<float> y(y_shape.elem_cnt());
+  FillRandom(&x);
+  const XpuVarNdarray<float> y_arr(y_shape, y.data());
+  const XpuVarNdarray<const float> x_arr(x_shape, x.data());
+  const XpuVarNdarray<float> tmp_arr(x_shape, tmp.data());
+  const auto start = std::chrono::steady_clock::now();
+  if (use_default) {
+    NdarrayDefaultReduce<DeviceType::kCPU, float, BinaryFuncSum>::Reduce(nullptr, y_arr, x_arr,
+                                                                       tmp_arr);
+  } else {
+    NdarrayReduce<DeviceType::kCPU, float, BinaryFuncSum>::Reduce(nullptr, y_arr, x_arr, tmp_arr);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}  // namespace
+
+TEST(NdarrayReduce, cpu_reduce) {
+  CheckAllReduceCases<BinaryFuncSum>();
+  CheckAllReduceCases<BinaryFuncMax>();
+  CheckAllReduceCases<BinaryFuncMin>();
+  Global<ThreadPool>::New(4);
+  CheckAllReduceCases<BinaryFuncSum>();
+  CheckAllReduceCases<BinaryFuncMax>();
+  Global<ThreadPool>::Delete();
+}
+
+TEST(NdarrayReduce, cpu_float_sum_accuracy) {
+  const int64_t n = 1 << 24;
+  std::vector<float> x(n, 0.1f);
+  std::vector<float> tmp(n);
+  float y = 0;
+  NdarrayReduce<DeviceType::kCPU, float, BinaryFuncSum>::Reduce(
+      nullptr, XpuVarNdarray<float>(Shape({1}), &y), XpuVarNdarray<const float>(Shape({n}), x.data()),
+      XpuVarNdarray<float>(Shape({n}), tmp.data()));
+  float sequential = 0;
+  for (float val : x) { sequential += val; }
+  const double expected = n * static_cast<double>(0.1f);
+  LOG(INFO) << "relative error, pairwise: " << std::abs(y - expected) / expected
+            << ", sequential: " << std::abs(sequential - expected) / expected;
+  ASSERT_LT(std::abs(y - expected) / expected, 1e-6);
+}
+
+TEST(NdarrayReduce, DISABLED_cpu_reduce_sum_time_vs_default) {
+  Global<ThreadPool>::New(std::thread::hardware_concurrency());
+  for (const ReduceCase& c : GetLargeReduceCases()) {
+    const double default_sec = ReduceSumSeconds(c, true);
+    const double fast_sec = ReduceSumSeconds(c, false);
+    LOG(INFO) << Shape(c.x_dim).ToString() << " -> " << Shape(c.y_dim).ToString()
+              << ", default: " << default_sec * 1e3 << " ms, fast path: " << fast_sec * 1e3
+              << " ms";
+  }
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -21,6 +21,7 @@ limitations under the License.
 #include "oneflow/core/common/shape.h"
 #include "oneflow/core/common/dtype_signature.h"
 #include "oneflow/core/common/symbol.h"
+#include "oneflow/core/common/util.h"
 
 namespace oneflow {
 
@@ -53,14 +54,15 @@ template<>
 struct hash<oneflow::OpInferCacheKey> final {
   size_t operator()(const oneflow::OpInferCacheKey& op_infer_cache_key) const {
     using namespace oneflow;
-    size_t ibn_idx2shape_sym_hash_value = 0;
+    size_t hash_value = std::hash<const JobDesc*>()(op_infer_cache_key.job_desc);
+    HashCombine(&hash_value, std::hash<Symbol<OperatorConf>>()(op_infer_cache_key.op_conf_sym));
+    HashCombine(&hash_value,
+                std::hash<Symbol<DTypeSignature>>()(op_infer_cache_key.dtype_signature_sym));
+    // combined in order, inputs of equal shapes must not cancel each other out
     for (const auto& shape_sym : op_infer_cache_key.ibn_idx2shape_sym) {
-      ibn_idx2shape_sym_hash_value ^= std::hash<Symbol<Shape>>()(shape_sym);
+      HashCombine(&hash_value, std::hash<Symbol<Shape>>()(shape_sym));
     }
-    return std::hash<const JobDesc*>()(op_infer_cache_key.job_desc)
-           ^ std::hash<Symbol<OperatorConf>>()(op_infer_cache_key.op_conf_sym)
-           ^ ibn_idx2shape_sym_hash_value
-           ^ std::hash<Symbol<DTypeSignature>>()(op_infer_cache_key.dtype_signature_sym);
+    return hash_value;
   }
 };
 
@@ -34,6 +34,9 @@ class BinaryInStream {
   virtual void set_cur_file_pos(uint64_t val) = 0;
   virtual bool IsEof() const = 0;
 
+  // the whole file contents if they are addressable in memory, nullptr otherwise
+  virtual const char* mapped_data() const { return nullptr; }
+
  protected:
   BinaryInStream() = default;
 };
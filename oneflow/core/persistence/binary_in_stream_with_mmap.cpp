@@ -0,0 +1,32 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/binary_in_stream_with_mmap.h"
+#include <cstring>
+
+namespace oneflow {
+
+BinaryInStreamWithMmap::BinaryInStreamWithMmap(std::unique_ptr<fs::ReadOnlyMemoryRegion>&& region)
+    : region_(std::move(region)), cur_file_pos_(0) {}
+
+int32_t BinaryInStreamWithMmap::Read(char* s, size_t n) {
+  if (IsEof()) return -1;
+  CHECK_LE(cur_file_pos_ + n, region_->length());
+  std::memcpy(s, region_->data() + cur_file_pos_, n);
+  cur_file_pos_ += n;
+  return 0;
+}
+
+}  // namespace oneflow
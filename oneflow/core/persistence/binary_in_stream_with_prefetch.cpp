@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/binary_in_stream_with_prefetch.h"
+#include "oneflow/core/persistence/persistence_thread_pool.h"
+#include <cstring>
+
+namespace oneflow {
+
+BinaryInStreamWithPrefetch::BinaryInStreamWithPrefetch(fs::FileSystem* fs,
+                                                       const std::string& file_path,
+                                                       int64_t prefetch_depth, size_t chunk_size)
+    : cur_file_pos_(0),
+      prefetch_depth_(prefetch_depth),
+      chunk_size_(chunk_size),
+      next_chunk_offset_(0) {
+  CHECK_GT(prefetch_depth_, 0);
+  CHECK_GT(chunk_size_, 0);
+  fs->NewRandomAccessFile(file_path, &file_);
+  file_size_ = fs->GetFileSize(file_path);
+}
+
+BinaryInStreamWithPrefetch::~BinaryInStreamWithPrefetch() { WaitAllChunks(); }
+
+void BinaryInStreamWithPrefetch::set_cur_file_pos(uint64_t val) {
+  WaitAllChunks();
+  chunks_.clear();
+  cur_file_pos_ = val;
+  next_chunk_offset_ = val;
+}
+
+void BinaryInStreamWithPrefetch::IssueChunk(std::unique_ptr<Chunk>&& chunk) {
+  chunk->offset = next_chunk_offset_;
+  chunk->size = std::min<uint64_t>(chunk_size_, file_size_ - next_chunk_offset_);
+  chunk->data.resize(chunk->size);
+  next_chunk_offset_ += chunk->size;
+  Chunk* raw_chunk = chunk.get();
+  chunks_.push_back(std::move(chunk));
+  raw_chunk->read_task.Run([this, raw_chunk]() {
+    file_->Read(raw_chunk->offset, raw_chunk->size, raw_chunk->data.data());
+  });
+}
+
+void BinaryInStreamWithPrefetch::WaitAllChunks() {
+  for (const auto& chunk : chunks_) { chunk->read_task.Wait(); }
+}
+
+int32_t BinaryInStreamWithPrefetch::Read(char* s, size_t n) {
+  if (IsEof()) return -1;
+  CHECK_LE(cur_file_pos_ + n, file_size_);
+  while (n > 0) {
+    while (static_cast<int64_t>(chunks_.size()) < prefetch_depth_
+           && next_chunk_offset_ < file_size_) {
+      IssueChunk(std::unique_ptr<Chunk>(new Chunk(PersistenceThreadPool())));
+    }
+    Chunk* front = chunks_.front().get();
+    CHECK_GE(cur_file_pos_, front->offset);
+    front->read_task.Wait();
+    const size_t pos_in_chunk = cur_file_pos_ - front->offset;
+    const size_t copy_size = std::min(n, front->size - pos_in_chunk);
+    std::memcpy(s, front->data.data() + pos_in_chunk, copy_size);
+    s += copy_size;
+    n -= copy_size;
+    cur_file_pos_ += copy_size;
+    if (pos_in_chunk + copy_size == front->size) {
+      // recycle the buffer of the consumed chunk for the next prefetch
+      std::unique_ptr<Chunk> consumed = std::move(chunks_.front());
+      chunks_.pop_front();
+      if (next_chunk_offset_ < file_size_) { IssueChunk(std::move(consumed)); }
+    }
+  }
+  return 0;
+}
+
+}  // namespace oneflow
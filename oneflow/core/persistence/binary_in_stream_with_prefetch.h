@@ -0,0 +1,66 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_BINARY_IN_STREAM_WITH_PREFETCH_H_
+#define ONEFLOW_CORE_PERSISTENCE_BINARY_IN_STREAM_WITH_PREFETCH_H_
+
+#include "oneflow/core/persistence/file_system.h"
+#include "oneflow/core/persistence/binary_in_stream.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+// Keeps up to prefetch_depth chunks ahead of the reader in flight on the persistence thread
+// pool, so the reading thread only blocks when storage is slower than its consumer. A chunk the
+// pool has not started yet is read on the reading thread.
+class BinaryInStreamWithPrefetch final : public BinaryInStream {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(BinaryInStreamWithPrefetch);
+  BinaryInStreamWithPrefetch() = delete;
+  virtual ~BinaryInStreamWithPrefetch();
+
+  BinaryInStreamWithPrefetch(fs::FileSystem* fs, const std::string& file_path,
+                             int64_t prefetch_depth, size_t chunk_size);
+  int32_t Read(char* s, size_t n) override;
+
+  uint64_t file_size() const override { return file_size_; }
+  uint64_t cur_file_pos() const override { return cur_file_pos_; }
+  void set_cur_file_pos(uint64_t val) override;
+  bool IsEof() const override { return cur_file_pos_ == file_size_; }
+
+ private:
+  struct Chunk {
+    explicit Chunk(ThreadPool* thread_pool) : read_task(thread_pool) {}
+    uint64_t offset;
+    size_t size;
+    std::vector<char> data;
+    TaskGroup read_task;
+  };
+
+  void IssueChunk(std::unique_ptr<Chunk>&& chunk);
+  void WaitAllChunks();
+
+  std::unique_ptr<fs::RandomAccessFile> file_;
+  uint64_t file_size_;
+  uint64_t cur_file_pos_;
+  int64_t prefetch_depth_;
+  size_t chunk_size_;
+  uint64_t next_chunk_offset_;
+  std::deque<std::unique_ptr<Chunk>> chunks_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_BINARY_IN_STREAM_WITH_PREFETCH_H_
@@ -40,6 +40,22 @@ class RandomAccessFile {
  private:
 };
 
+// A readonly memory mapped file abstraction.
+//
+// The contents stay valid as long as the region is alive.
+class ReadOnlyMemoryRegion {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReadOnlyMemoryRegion);
+  ReadOnlyMemoryRegion() = default;
+  virtual ~ReadOnlyMemoryRegion() = default;
+
+  // Returns a pointer to the memory region.
+  virtual const char* data() const = 0;
+
+  // Returns the length of the memory region in bytes.
+  virtual uint64_t length() const = 0;
+};
+
 //  A file abstraction for sequential writing.
 //
 // The implementation must provide buffering since callers may append
@@ -90,6 +106,16 @@ class FileSystem {
   virtual void NewRandomAccessFile(const std::string& fname,
                                    std::unique_ptr<RandomAccessFile>* result) = 0;
 
+  // Creates a readonly region of memory with the file contents, which is
+  // expected to be read sequentially from the beginning to the end.
+  //
+  // Returns false and leaves *result untouched if the file system does not
+  // support memory mapping.
+  virtual bool NewReadOnlyMemoryRegionFromFile(const std::string& fname,
+                                               std::unique_ptr<ReadOnlyMemoryRegion>* result) {
+    return false;
+  }
+
   // Creates an object that writes to a new file with the specified
   // name.
   //
@@ -0,0 +1,46 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_PERSISTENCE_PERSISTENCE_THREAD_POOL_H_
+#define ONEFLOW_CORE_PERSISTENCE_PERSISTENCE_THREAD_POOL_H_
+
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+// Owns the threads for blocking file system calls: dataset indexing, prefetch reads and the
+// fan-out of snapshot loads and saves. They are kept apart from the compute thread pool so that
+// waiting on storage never occupies compute threads. Every wait on works of this pool goes
+// through a TaskGroup or ParallelFor, which run not-yet-started works on the waiting thread, so
+// one pool of any size serves all of them without deadlock.
+// Created and destroyed with the env, like Global<ThreadPool>.
+class PersistenceThreadPoolScope final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PersistenceThreadPoolScope);
+  explicit PersistenceThreadPoolScope(int32_t thread_num) : thread_pool_(thread_num) {}
+  ~PersistenceThreadPoolScope() = default;
+
+  ThreadPool* thread_pool() { return &thread_pool_; }
+
+ private:
+  ThreadPool thread_pool_;
+};
+
+// the pool of Global<PersistenceThreadPoolScope>, which must exist
+ThreadPool* PersistenceThreadPool();
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_PERSISTENCE_PERSISTENCE_THREAD_POOL_H_
@@ -16,6 +16,8 @@ limitations under the License.
 #include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/persistence/binary_in_stream_with_local_copy.h"
 #include "oneflow/core/persistence/binary_in_stream_without_local_copy.h"
+#include "oneflow/core/persistence/binary_in_stream_with_mmap.h"
+#include "oneflow/core/persistence/binary_in_stream_with_prefetch.h"
 #include "oneflow/core/job/job_set.pb.h"
 #include <cstring>
 
@@ -41,10 +43,19 @@ PersistentInStream::PersistentInStream(fs::FileSystem* fs,
                                        const std::vector<std::string>& file_paths, uint64_t offset,
                                        bool cyclic, bool with_local_copy) {
   if (with_local_copy) { CHECK_EQ(offset, 0); }
+  const bool try_mmap = !with_local_copy && Global<const IOConf>::Get()->persistence_enable_mmap();
+  const int64_t prefetch_depth = Global<const IOConf>::Get()->persistence_prefetch_depth();
+  CHECK_GE(prefetch_depth, 0);
   std::vector<std::shared_ptr<BinaryInStream>> streams;
   for (auto& file_path : file_paths) {
+    std::unique_ptr<fs::ReadOnlyMemoryRegion> region;
     if (with_local_copy) {
       streams.emplace_back(new BinaryInStreamWithLocalCopy(fs, file_path));
+    } else if (try_mmap && fs->NewReadOnlyMemoryRegionFromFile(file_path, &region)) {
+      streams.emplace_back(new BinaryInStreamWithMmap(std::move(region)));
+    } else if (prefetch_depth > 0) {
+      streams.emplace_back(
+          new BinaryInStreamWithPrefetch(fs, file_path, prefetch_depth, GetBufferSize()));
     } else {
       streams.emplace_back(new BinaryInStreamWithoutLocalCopy(fs, file_path));
     }
@@ -58,7 +69,6 @@ PersistentInStream::PersistentInStream(fs::FileSystem* fs,
   buffer_.resize(GetBufferSize() + 1);
   cur_buf_begin_ = buffer_.data();
   cur_buf_end_ = buffer_.data();
-  *cur_buf_end_ = '\0';
 }
 
 PersistentInStream::PersistentInStream(fs::FileSystem* fs,
@@ -81,19 +91,22 @@ PersistentInStream::PersistentInStream(fs::FileSystem* fs, const std::string& fi
 int32_t PersistentInStream::ReadLine(std::string* l) {
   if (IsEof()) { return -1; }
   l->clear();
-  while (*cur_buf_begin_ != '\n') {
+  while (true) {
     if (cur_buf_begin_ == cur_buf_end_) {
       UpdateBuffer();
-      if (cur_buf_begin_ == cur_buf_end_) {
-        return 0;
-      } else {
-        continue;
-      }
+      if (cur_buf_begin_ == cur_buf_end_) { return 0; }
+    }
+    const char* line_end = static_cast<const char*>(
+        std::memchr(cur_buf_begin_, '\n', cur_buf_end_ - cur_buf_begin_));
+    if (line_end == nullptr) {
+      l->append(cur_buf_begin_, cur_buf_end_);
+      cur_buf_begin_ = cur_buf_end_;
+    } else {
+      l->append(cur_buf_begin_, line_end);
+      cur_buf_begin_ = line_end + 1;
+      return 0;
     }
-    l->push_back(*cur_buf_begin_++);
   }
-  ++cur_buf_begin_;
-  return 0;
 }
 
 int32_t PersistentInStream::ReadFully(char* s, size_t n) {
@@ -110,12 +123,27 @@ int32_t PersistentInStream::ReadFully(char* s, size_t n) {
   return 0;
 }
 
+int32_t PersistentInStream::ReadSpan(size_t n, const char** span) {
+  if (IsEof()) { return -1; }
+  if (cur_buf_begin_ == cur_buf_end_) { UpdateBuffer(); }
+  if (cur_buf_end_ - cur_buf_begin_ >= static_cast<int64_t>(n)) {
+    *span = cur_buf_begin_;
+    cur_buf_begin_ += n;
+    return 0;
+  }
+  // the bytes cross a buffer or file boundary
+  span_buffer_.resize(n);
+  CHECK_EQ(ReadFully(span_buffer_.data(), n), 0);
+  *span = span_buffer_.data();
+  return 0;
+}
+
 void PersistentInStream::UpdateBuffer() {
   CHECK_EQ(cur_buf_begin_, cur_buf_end_);
-  uint64_t n = stream_scanner_->UpdateBuffer(&buffer_);
-  cur_buf_begin_ = buffer_.data();
-  cur_buf_end_ = buffer_.data() + n;
-  *cur_buf_end_ = '\0';
+  const char* data = buffer_.data();
+  uint64_t n = stream_scanner_->UpdateBuffer(&buffer_, &data);
+  cur_buf_begin_ = data;
+  cur_buf_end_ = data + n;
 }
 
 bool PersistentInStream::IsEof() const {
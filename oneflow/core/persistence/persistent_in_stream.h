@@ -38,6 +38,10 @@ class PersistentInStream {
   // -1: eof
   int32_t ReadLine(std::string* l);
   int32_t ReadFully(char* s, size_t n);
+  // Makes *span point to the next n bytes without copying them when they are contiguous in
+  // memory, which is always the case for memory mapped files.
+  // *span is valid until the next read on this stream.
+  int32_t ReadSpan(size_t n, const char** span);
 
  private:
   bool IsEof() const;
@@ -46,8 +50,9 @@ class PersistentInStream {
   std::unique_ptr<StreamScanner> stream_scanner_;
 
   std::vector<char> buffer_;
-  char* cur_buf_begin_;
-  char* cur_buf_end_;
+  std::vector<char> span_buffer_;
+  const char* cur_buf_begin_;
+  const char* cur_buf_end_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,167 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/persistent_in_stream.h"
+#include "oneflow/core/persistence/persistence_thread_pool.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/job/job_set.pb.h"
+
+namespace oneflow {
+
+#ifdef PLATFORM_POSIX
+
+namespace {
+
+std::string WriteTestFile(const std::string& name, const std::string& content) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  std::string file_name = JoinPath(current_dir, name);
+  std::unique_ptr<fs::WritableFile> file;
+  LocalFS()->NewWritableFile(file_name, &file);
+  file->Append(content.data(), content.size());
+  file->Close();
+  return file_name;
+}
+
+void ResetIOConf(bool enable_mmap, int64_t prefetch_depth, int64_t buf_byte) {
+  Global<const IOConf>::Delete();
+  IOConf io_conf;
+  io_conf.set_persistence_buf_byte(buf_byte);
+  io_conf.set_persistence_enable_mmap(enable_mmap);
+  io_conf.set_persistence_prefetch_depth(prefetch_depth);
+  Global<const IOConf>::New(io_conf);
+}
+
+// size + payload chunks, as in OFRecord part files
+std::string GenChunks(int64_t chunk_num, int64_t chunk_size) {
+  std::string content;
+  std::string payload(chunk_size, 'x');
+  FOR_RANGE(int64_t, i, 0, chunk_num) {
+    content.append(reinterpret_cast<const char*>(&chunk_size), sizeof(int64_t));
+    payload[0] = static_cast<char>(i);
+    content.append(payload);
+  }
+  return content;
+}
+
+double ReadChunksMBPerSec(const std::string& file_name, bool enable_mmap, int64_t prefetch_depth,
+                          bool with_span) {
+  ResetIOConf(enable_mmap, prefetch_depth, 32 * 1024);
+  PersistentInStream in_stream(LocalFS(), file_name);
+  std::vector<char> copy_buffer;
+  int64_t byte_cnt = 0;
+  int64_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  int64_t size = 0;
+  while (in_stream.ReadFully(reinterpret_cast<char*>(&size), sizeof(int64_t)) == 0) {
+    const char* payload = nullptr;
+    if (with_span) {
+      CHECK_EQ(in_stream.ReadSpan(size, &payload), 0);
+    } else {
+      copy_buffer.resize(size);
+      CHECK_EQ(in_stream.ReadFully(copy_buffer.data(), size), 0);
+      payload = copy_buffer.data();
+    }
+    checksum += payload[0];
+    byte_cnt += size + sizeof(int64_t);
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  CHECK_NE(checksum, -1);
+  return byte_cnt / elapsed.count() / (1024 * 1024);
+}
+
+}  // namespace
+
+TEST(PersistentInStream, read_line_and_span) {
+  std::string content;
+  FOR_RANGE(int32_t, i, 0, 100) { content += std::string(i % 97, 'a' + i % 26) + "\n"; }
+  content += "last line without newline";
+  std::string file_name = WriteTestFile("/tmp_persistent_in_stream_test", content);
+  Global<PersistenceThreadPoolScope>::New(2);
+  for (int32_t mode = 0; mode < 3; ++mode) {
+    // 0: buffered, 1: mmap, 2: buffered with prefetching
+    ResetIOConf(mode == 1, mode == 2 ? 3 : 0, 64);
+    {
+      PersistentInStream in_stream(LocalFS(), file_name);
+      std::string line;
+      FOR_RANGE(int32_t, i, 0, 100) {
+        ASSERT_EQ(in_stream.ReadLine(&line), 0);
+        ASSERT_EQ(line, std::string(i % 97, 'a' + i % 26));
+      }
+      ASSERT_EQ(in_stream.ReadLine(&line), 0);
+      ASSERT_EQ(line, "last line without newline");
+      ASSERT_EQ(in_stream.ReadLine(&line), -1);
+    }
+    {
+      PersistentInStream in_stream(LocalFS(), file_name);
+      size_t pos = 0;
+      const char* span = nullptr;
+      for (size_t n : {1, 63, 64, 65, 200}) {
+        ASSERT_EQ(in_stream.ReadSpan(n, &span), 0);
+        ASSERT_EQ(std::string(span, n), content.substr(pos, n));
+        pos += n;
+      }
+    }
+  }
+  Global<PersistenceThreadPoolScope>::Delete();
+  LocalFS()->DelFile(file_name);
+  Global<const IOConf>::Delete();
+}
+
+TEST(PersistentInStream, prefetch_readers_on_persistence_thread_pool) {
+  const std::string content = GenChunks(64, 1000);
+  std::string file_name = WriteTestFile("/tmp_persistent_in_stream_pool_test", content);
+  ResetIOConf(false, 4, 256);
+  for (int32_t thread_num : {1, 4}) {
+    Global<PersistenceThreadPoolScope>::New(thread_num);
+    // more blocked readers than persistence threads, and their chunks are read on the same pool
+    const int64_t reader_num = 4 * thread_num;
+    std::atomic<int64_t> ok_cnt(0);
+    PersistenceThreadPool()->ParallelFor(0, reader_num, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        PersistentInStream in_stream(LocalFS(), file_name);
+        std::string read(content.size(), 0);
+        if (in_stream.ReadFully(&read[0], read.size()) == 0 && read == content) { ok_cnt += 1; }
+      }
+    });
+    ASSERT_EQ(ok_cnt.load(), reader_num);
+    Global<PersistenceThreadPoolScope>::Delete();
+  }
+  LocalFS()->DelFile(file_name);
+  Global<const IOConf>::Delete();
+}
+
+TEST(PersistentInStream, DISABLED_chunk_read_throughput) {
+  std::string file_name =
+      WriteTestFile("/tmp_persistent_in_stream_bench", GenChunks(256, 128 * 1024));
+  Global<PersistenceThreadPoolScope>::New(4);
+  LOG(INFO) << "buffered ReadFully: " << ReadChunksMBPerSec(file_name, false, 0, false)
+            << " MB/s";
+  LOG(INFO) << "buffered ReadSpan: " << ReadChunksMBPerSec(file_name, false, 0, true) << " MB/s";
+  LOG(INFO) << "prefetched ReadFully: " << ReadChunksMBPerSec(file_name, false, 8, false)
+            << " MB/s";
+  LOG(INFO) << "prefetched ReadSpan: " << ReadChunksMBPerSec(file_name, false, 8, true)
+            << " MB/s";
+  LOG(INFO) << "mmap ReadFully: " << ReadChunksMBPerSec(file_name, true, 0, false) << " MB/s";
+  LOG(INFO) << "mmap ReadSpan: " << ReadChunksMBPerSec(file_name, true, 0, true) << " MB/s";
+  Global<PersistenceThreadPoolScope>::Delete();
+  LocalFS()->DelFile(file_name);
+  Global<const IOConf>::Delete();
+}
+
+#endif  // PLATFORM_POSIX
+
+}  // namespace oneflow
@@ -62,6 +62,22 @@ class PosixRandomAccessFile : public RandomAccessFile {
   }
 };
 
+class PosixReadOnlyMemoryRegion : public ReadOnlyMemoryRegion {
+ private:
+  const char* address_;
+  uint64_t length_;
+
+ public:
+  PosixReadOnlyMemoryRegion(const char* address, uint64_t length)
+      : address_(address), length_(length) {}
+  ~PosixReadOnlyMemoryRegion() override {
+    if (length_ > 0) { munmap(const_cast<char*>(address_), length_); }
+  }
+
+  const char* data() const override { return address_; }
+  uint64_t length() const override { return length_; }
+};
+
 class PosixWritableFile : public WritableFile {
  private:
   std::string fname_;
@@ -96,6 +112,32 @@ void PosixFileSystem::NewRandomAccessFile(const std::string& fname,
   CHECK_NOTNULL(result->get());
 }
 
+bool PosixFileSystem::NewReadOnlyMemoryRegionFromFile(
+    const std::string& fname, std::unique_ptr<ReadOnlyMemoryRegion>* result) {
+  std::string translated_fname = TranslateName(fname);
+  int fd = open(translated_fname.c_str(), O_RDONLY);
+  PCHECK(fd >= 0) << "Fail to open file " << fname;
+  struct stat sbuf;
+  PCHECK(fstat(fd, &sbuf) == 0) << "Fail to load statistics of " << fname;
+  const uint64_t length = sbuf.st_size;
+  const char* address = nullptr;
+  if (length > 0) {
+    void* ptr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr == MAP_FAILED) {
+      PLOG(WARNING) << "Fail to mmap file " << fname;
+      close(fd);
+      return false;
+    }
+    // the kernel reads ahead aggressively and drops pages behind the reader
+    PCHECK(madvise(ptr, length, MADV_SEQUENTIAL) == 0);
+    PCHECK(madvise(ptr, length, MADV_WILLNEED) == 0);
+    address = static_cast<const char*>(ptr);
+  }
+  close(fd);
+  result->reset(new PosixReadOnlyMemoryRegion(address, length));
+  return true;
+}
+
 void PosixFileSystem::NewWritableFile(const std::string& fname,
                                       std::unique_ptr<WritableFile>* result) {
   std::string translated_fname = TranslateName(fname);
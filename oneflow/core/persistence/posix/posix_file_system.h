@@ -33,6 +33,9 @@ class PosixFileSystem final : public FileSystem {
   void NewRandomAccessFile(const std::string& fname,
                            std::unique_ptr<RandomAccessFile>* result) override;
 
+  bool NewReadOnlyMemoryRegionFromFile(const std::string& fname,
+                                       std::unique_ptr<ReadOnlyMemoryRegion>* result) override;
+
   void NewWritableFile(const std::string& fname, std::unique_ptr<WritableFile>* result) override;
 
   void NewAppendableFile(const std::string& fname, std::unique_ptr<WritableFile>* result) override;
@@ -15,23 +15,98 @@ limitations under the License.
 */
 #include "oneflow/core/persistence/snapshot.h"
 #include "oneflow/core/common/str_util.h"
-#include "oneflow/core/persistence/persistent_in_stream.h"
 #include "oneflow/core/persistence/persistent_out_stream.h"
-#include "oneflow/core/register/tensor_slice_copier.h"
-#include "oneflow/core/device/cpu_device_context.h"
+#include "oneflow/core/persistence/persistence_thread_pool.h"
+#include "oneflow/core/register/blob.h"
+#include <cstring>
 
 namespace oneflow {
 
 namespace {
 
+// byte ranges separated by a smaller gap are fetched by one read, dropping the gap
+constexpr size_t kMaxReadGapByteSize = 256 * 1024;
+// upper bound of a single read, which is also the unit of parallelism
+constexpr size_t kMaxReadByteSize = 16 * 1024 * 1024;
+
 std::string GenDataFilePath(const std::string& root, const std::string& key) {
   return JoinPath(root, key);
 }
 
+// a contiguous byte range of the snapshot file and its place in the slice
+struct ReadPiece {
+  uint64_t file_offset;
+  uint64_t dst_offset;
+  size_t byte_size;
+};
+
+// consecutive pieces fetched by one read
+struct ReadSegment {
+  uint64_t file_offset;
+  size_t byte_size;
+  int64_t piece_begin;
+  int64_t piece_end;
+};
+
+void GenReadPieces(const Shape& logical_blob_shape, const TensorSliceView& slice,
+                   size_t size_of_data_type, std::vector<ReadPiece>* pieces) {
+  if (slice.shape().elem_cnt() == 0) { return; }
+  const int64_t num_axes = slice.NumAxes();
+  // the slice is contiguous in the file from contiguous_axis inwards
+  int64_t contiguous_axis = num_axes - 1;
+  while (contiguous_axis > 0
+         && slice.At(contiguous_axis).size() == logical_blob_shape.At(contiguous_axis)) {
+    contiguous_axis -= 1;
+  }
+  const size_t run_byte_size = slice.shape().Count(contiguous_axis) * size_of_data_type;
+  const int64_t run_num = slice.shape().Count(0, contiguous_axis);
+  std::vector<int64_t> index(contiguous_axis, 0);
+  FOR_RANGE(int64_t, run, 0, run_num) {
+    int64_t file_elem_offset =
+        slice.At(contiguous_axis).begin() * logical_blob_shape.Count(contiguous_axis + 1);
+    FOR_RANGE(int64_t, axis, 0, contiguous_axis) {
+      file_elem_offset +=
+          (slice.At(axis).begin() + index.at(axis)) * logical_blob_shape.Count(axis + 1);
+    }
+    const uint64_t file_offset = file_elem_offset * size_of_data_type;
+    const uint64_t dst_offset = run * run_byte_size;
+    for (size_t offset = 0; offset < run_byte_size; offset += kMaxReadByteSize) {
+      pieces->push_back(ReadPiece{file_offset + offset, dst_offset + offset,
+                                  std::min(kMaxReadByteSize, run_byte_size - offset)});
+    }
+    for (int64_t axis = contiguous_axis - 1; axis >= 0; --axis) {
+      index.at(axis) += 1;
+      if (index.at(axis) < slice.At(axis).size()) { break; }
+      index.at(axis) = 0;
+    }
+  }
+}
+
+void GenReadSegments(const std::vector<ReadPiece>& pieces, std::vector<ReadSegment>* segments) {
+  FOR_RANGE(int64_t, i, 0, pieces.size()) {
+    const ReadPiece& piece = pieces.at(i);
+    if (!segments->empty()) {
+      ReadSegment* last = &segments->back();
+      const uint64_t last_end = last->file_offset + last->byte_size;
+      const uint64_t merged_byte_size = piece.file_offset + piece.byte_size - last->file_offset;
+      if (piece.file_offset - last_end <= kMaxReadGapByteSize
+          && merged_byte_size <= kMaxReadByteSize) {
+        last->byte_size = merged_byte_size;
+        last->piece_end = i + 1;
+        continue;
+      }
+    }
+    segments->push_back(ReadSegment{piece.file_offset, piece.byte_size, i, i + 1});
+  }
+}
+
 }  // namespace
 
 SnapshotReader::SnapshotReader(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {}
+    : SnapshotReader(snapshot_root_path, PersistenceThreadPool()) {}
+
+SnapshotReader::SnapshotReader(const std::string& snapshot_root_path, ThreadPool* io_thread_pool)
+    : root_path_(snapshot_root_path), io_thread_pool_(io_thread_pool) {}
 
 bool SnapshotReader::HasKey(const std::string& key) const {
   const std::string path = GenDataFilePath(root_path_, key);
@@ -52,20 +127,31 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
   const int64_t logical_blob_size = logical_blob_shape.elem_cnt() * GetSizeOfDataType(data_type);
   CHECK_EQ(SnapshotFS()->GetFileSize(path), logical_blob_size)
       << "unexpected model snapshot size, path: " << path;
-  if (slice.shape().Count(1) == logical_blob_shape.Count(1)) {
-    PersistentInStream in_stream(
-        SnapshotFS(), path,
-        slice.At(0).begin() * slice.shape().Count(1) * GetSizeOfDataType(data_type));
-    in_stream.ReadFully(dst, slice.shape().elem_cnt() * GetSizeOfDataType(data_type));
-  } else {
-    std::vector<char> buffer(logical_blob_size);
-    PersistentInStream in_stream(SnapshotFS(), path);
-    in_stream.ReadFully(buffer.data(), logical_blob_size);
-    TensorSliceCopier copier(slice, logical_blob_slice, data_type);
-    CpuDeviceCtx device_ctx;
-    std::unique_ptr<MemoryCopier> host_memory_copier(NewDefaultMemoryCopier(DeviceType::kCPU));
-    copier.Copy(&device_ctx, *host_memory_copier, dst, buffer.data());
-  }
+  // only the byte ranges covered by the slice are fetched, in parallel
+  std::vector<ReadPiece> pieces;
+  GenReadPieces(logical_blob_shape, slice, GetSizeOfDataType(data_type), &pieces);
+  std::vector<ReadSegment> segments;
+  GenReadSegments(pieces, &segments);
+  std::unique_ptr<fs::RandomAccessFile> file;
+  SnapshotFS()->NewRandomAccessFile(path, &file);
+  io_thread_pool_->ParallelFor(0, segments.size(), 1, [&](int64_t begin, int64_t end) {
+    std::vector<char> buffer;
+    FOR_RANGE(int64_t, i, begin, end) {
+      const ReadSegment& segment = segments.at(i);
+      if (segment.piece_end - segment.piece_begin == 1) {
+        const ReadPiece& piece = pieces.at(segment.piece_begin);
+        file->Read(piece.file_offset, piece.byte_size, dst + piece.dst_offset);
+        continue;
+      }
+      buffer.resize(segment.byte_size);
+      file->Read(segment.file_offset, segment.byte_size, buffer.data());
+      FOR_RANGE(int64_t, j, segment.piece_begin, segment.piece_end) {
+        const ReadPiece& piece = pieces.at(j);
+        std::memcpy(dst + piece.dst_offset, buffer.data() + piece.file_offset - segment.file_offset,
+                    piece.byte_size);
+      }
+    }
+  });
 }
 
 void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shape,
@@ -77,7 +163,7 @@ void SnapshotReader::Read(const std::string& key, const Shape& logical_blob_shap
 void SnapshotReader::Close() {}
 
 SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path)
-    : root_path_(snapshot_root_path) {
+    : root_path_(snapshot_root_path), write_tasks_(PersistenceThreadPool()) {
   OfCallOnce("SnapshotWriteCheckRootPath-" + snapshot_root_path, [&]() {
     if (SnapshotFS()->FileExists(snapshot_root_path)) {
       CHECK(SnapshotFS()->IsDirectory(snapshot_root_path))
@@ -90,12 +176,16 @@ SnapshotWriter::SnapshotWriter(const std::string& snapshot_root_path)
   });
 }
 
-void SnapshotWriter::Write(const std::string& key, const char* data, size_t size) {
+std::string SnapshotWriter::PrepareFilePath(const std::string& key) {
   const std::string path = GenDataFilePath(root_path_, key);
   const std::string dir_path = Dirname(path);
   SnapshotFS()->CreateDirIfNotExist(dir_path);
   CHECK(!SnapshotFS()->FileExists(path));
-  PersistentOutStream out_stream(SnapshotFS(), path);
+  return path;
+}
+
+void SnapshotWriter::Write(const std::string& key, const char* data, size_t size) {
+  PersistentOutStream out_stream(SnapshotFS(), PrepareFilePath(key));
   out_stream.Write(data, size);
 }
 
@@ -103,7 +193,21 @@ void SnapshotWriter::Write(const std::string& key, const Blob* blob) {
   Write(key, blob->dptr<char>(), blob->ByteSizeOfBlobBody());
 }
 
+void SnapshotWriter::AsyncWrite(const std::string& key, const char* data, size_t size) {
+  // directories are created on the calling thread, files of sibling keys may share them
+  const std::string path = PrepareFilePath(key);
+  write_tasks_.Run([path, data, size]() {
+    PersistentOutStream out_stream(SnapshotFS(), path);
+    out_stream.Write(data, size);
+  });
+}
+
+void SnapshotWriter::AsyncWrite(const std::string& key, const Blob* blob) {
+  AsyncWrite(key, blob->dptr<char>(), blob->ByteSizeOfBlobBody());
+}
+
 void SnapshotWriter::Close() {
+  write_tasks_.Wait();
   PersistentOutStream out_stream(SnapshotFS(), JoinPath(root_path_, "snapshot_done"));
 }
 
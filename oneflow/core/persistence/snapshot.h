@@ -19,6 +19,7 @@ limitations under the License.
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/control/ctrl_client.h"
 #include "oneflow/core/register/tensor_slice_view.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 
@@ -29,6 +30,7 @@ class SnapshotReader final {
   OF_DISALLOW_COPY_AND_MOVE(SnapshotReader);
   SnapshotReader() = delete;
   explicit SnapshotReader(const std::string& snapshot_root_path);
+  SnapshotReader(const std::string& snapshot_root_path, ThreadPool* io_thread_pool);
   ~SnapshotReader() = default;
 
   void Read(const std::string& key, const Shape& logical_blob_shape, DataType data_type,
@@ -41,6 +43,7 @@ class SnapshotReader final {
 
  private:
   const std::string root_path_;
+  ThreadPool* io_thread_pool_;
 };
 
 class SnapshotWriter final {
@@ -52,10 +55,16 @@ class SnapshotWriter final {
 
   void Write(const std::string& key, const char* data, size_t size);
   void Write(const std::string& key, const Blob* blob);
+  // Writes on the persistence threads, the data must stay alive until Close()
+  void AsyncWrite(const std::string& key, const char* data, size_t size);
+  void AsyncWrite(const std::string& key, const Blob* blob);
   void Close();
 
  private:
+  std::string PrepareFilePath(const std::string& key);
+
   const std::string root_path_;
+  TaskGroup write_tasks_;
 };
 
 }  // namespace oneflow
@@ -0,0 +1,124 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/persistence/snapshot.h"
+#include "oneflow/core/persistence/persistence_thread_pool.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/job/job_set.pb.h"
+
+namespace oneflow {
+
+#ifdef PLATFORM_POSIX
+
+namespace {
+
+void ResetIOConf() {
+  Global<const IOConf>::Delete();
+  IOConf io_conf;
+  io_conf.mutable_data_fs_conf()->mutable_localfs_conf();
+  io_conf.mutable_snapshot_fs_conf()->mutable_localfs_conf();
+  Global<const IOConf>::New(io_conf);
+}
+
+// writes a float tensor whose elements are their own linear offsets
+std::string WriteTestSnapshot(const std::string& name, const Shape& shape) {
+  std::string root = GetCwd();
+  StringReplace(&root, '\\', '/');
+  root = JoinPath(root, name);
+  LocalFS()->CreateDirIfNotExist(root);
+  std::vector<float> data(shape.elem_cnt());
+  FOR_RANGE(int64_t, i, 0, data.size()) { data.at(i) = static_cast<float>(i); }
+  std::unique_ptr<fs::WritableFile> file;
+  LocalFS()->NewWritableFile(JoinPath(root, "var"), &file);
+  file->Append(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
+  file->Close();
+  return root;
+}
+
+void CheckSlice(const Shape& shape, const TensorSliceView& slice, const std::vector<float>& dst) {
+  ASSERT_EQ(dst.size(), slice.shape().elem_cnt());
+  std::vector<int64_t> index(slice.NumAxes(), 0);
+  FOR_RANGE(int64_t, i, 0, dst.size()) {
+    int64_t offset = 0;
+    FOR_RANGE(int64_t, axis, 0, slice.NumAxes()) {
+      offset += (slice.At(axis).begin() + index.at(axis)) * shape.Count(axis + 1);
+    }
+    ASSERT_EQ(dst.at(i), static_cast<float>(offset));
+    for (int64_t axis = slice.NumAxes() - 1; axis >= 0; --axis) {
+      index.at(axis) += 1;
+      if (index.at(axis) < slice.At(axis).size()) { break; }
+      index.at(axis) = 0;
+    }
+  }
+}
+
+double ReadSliceSeconds(const SnapshotReader& reader, const Shape& shape,
+                        const TensorSliceView& slice) {
+  std::vector<float> dst(slice.shape().elem_cnt());
+  auto start = std::chrono::steady_clock::now();
+  reader.Read("var", shape, DataType::kFloat, slice, reinterpret_cast<char*>(dst.data()));
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}  // namespace
+
+TEST(SnapshotReader, read_slice) {
+  ResetIOConf();
+  const Shape shape({6, 70000, 3});
+  const std::string root = WriteTestSnapshot("/tmp_snapshot_reader_test", shape);
+  Global<PersistenceThreadPoolScope>::New(4);
+  SnapshotReader reader(root);
+  const std::vector<TensorSliceView> slices = {
+      TensorSliceView(shape),
+      TensorSliceView({Range(2, 5), Range(0, 70000), Range(0, 3)}),
+      TensorSliceView({Range(0, 6), Range(100, 60000), Range(0, 3)}),
+      TensorSliceView({Range(1, 4), Range(0, 70000), Range(1, 2)}),
+      TensorSliceView({Range(0, 6), Range(5, 7), Range(0, 2)}),
+      TensorSliceView({Range(3, 4), Range(9, 10), Range(2, 3)}),
+  };
+  for (const TensorSliceView& slice : slices) {
+    std::vector<float> dst(slice.shape().elem_cnt());
+    reader.Read("var", shape, DataType::kFloat, slice, reinterpret_cast<char*>(dst.data()));
+    CheckSlice(shape, slice, dst);
+  }
+  Global<PersistenceThreadPoolScope>::Delete();
+  LocalFS()->RecursivelyDeleteDir(root);
+  Global<const IOConf>::Delete();
+}
+
+TEST(SnapshotReader, DISABLED_load_time_vs_parallelism) {
+  ResetIOConf();
+  const Shape shape({16384, 2048});
+  const std::string root = WriteTestSnapshot("/tmp_snapshot_reader_bench", shape);
+  const TensorSliceView full_slice(shape);
+  const TensorSliceView row_slice({Range(0, 4096), Range(0, 2048)});
+  const TensorSliceView col_slice({Range(0, 16384), Range(0, 512)});
+  for (int32_t thread_num : {1, 2, 4, 8}) {
+    ThreadPool io_thread_pool(thread_num);
+    SnapshotReader reader(root, &io_thread_pool);
+    LOG(INFO) << "threads: " << thread_num
+              << ", full: " << ReadSliceSeconds(reader, shape, full_slice)
+              << " s, 1/4 rows: " << ReadSliceSeconds(reader, shape, row_slice)
+              << " s, 1/4 cols: " << ReadSliceSeconds(reader, shape, col_slice) << " s";
+  }
+  LocalFS()->RecursivelyDeleteDir(root);
+  Global<const IOConf>::Delete();
+}
+
+#endif  // PLATFORM_POSIX
+
+}  // namespace oneflow
@@ -53,12 +53,21 @@ void StreamScanner::AddStream(fs::FileSystem* fs, const std::shared_ptr<BinaryIn
 
 bool StreamScanner::IsEof() const { return whole_file_pos_ == whole_file_size_; }
 
-uint64_t StreamScanner::UpdateBuffer(std::vector<char>* buffer) {
+uint64_t StreamScanner::UpdateBuffer(std::vector<char>* buffer, const char** data) {
   if (cur_stream_id_ == stream_num_) return 0;
-  uint64_t n = std::min(buffer->size() - 1, streams_[cur_stream_id_]->file_size()
-                                                - streams_[cur_stream_id_]->cur_file_pos());
-  if (n == 0) { return 0; }
-  streams_[cur_stream_id_]->Read(buffer->data(), n);
+  BinaryInStream* stream = streams_[cur_stream_id_].get();
+  const uint64_t remaining = stream->file_size() - stream->cur_file_pos();
+  if (remaining == 0) { return 0; }
+  uint64_t n = 0;
+  if (stream->mapped_data() != nullptr) {
+    n = remaining;
+    *data = stream->mapped_data() + stream->cur_file_pos();
+    stream->set_cur_file_pos(stream->file_size());
+  } else {
+    n = std::min(buffer->size() - 1, remaining);
+    stream->Read(buffer->data(), n);
+    *data = buffer->data();
+  }
   AddNForCurFilePos(n);
   return n;
 }
@@ -30,7 +30,9 @@ class StreamScanner {
   StreamScanner(fs::FileSystem* fs, const std::vector<std::shared_ptr<BinaryInStream>>& streams,
                 uint64_t offset);
   bool IsEof() const;
-  uint64_t UpdateBuffer(std::vector<char>* buffer);
+  // Makes *data point to the next bytes and returns how many there are.
+  // Mapped streams hand out their memory directly, others are copied into buffer.
+  uint64_t UpdateBuffer(std::vector<char>* buffer, const char** data);
 
  protected:
   virtual void AddNForCurFilePos(uint64_t n) = 0;
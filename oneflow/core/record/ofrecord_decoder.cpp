@@ -19,7 +19,6 @@ limitations under the License.
 #include "oneflow/core/record/ofrecord_bytes_list_decoder.h"
 #include "oneflow/core/common/balanced_splitter.h"
 #include "oneflow/core/thread/thread_manager.h"
-#include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/record/encode_case_util.h"
 
 namespace oneflow {
@@ -130,16 +129,15 @@ void OFRecordDecoder<encode_case, T>::ReadDataContent(
   int32_t thread_num = thread_pool->thread_num();
   int32_t part_num = std::min(record_blob.record_num(), thread_num);
   if (part_num >= 2) {
-    BlockingCounter bc(part_num);
+    TaskGroup task_group(thread_pool);
     FOR_RANGE(int32_t, part_id, 0, part_num) {
-      thread_pool->AddWork([&ctx, &in_blob, &blob_conf, &col_id, &out_blob, &bc, part_id, &part_num,
-                            &one_col_elem_num, &random_seed, this]() {
+      task_group.Run([&ctx, &in_blob, &blob_conf, &col_id, &out_blob, part_id, &part_num,
+                      &one_col_elem_num, &random_seed, this]() {
         ReadPartDataContent(ctx, in_blob, blob_conf, col_id, out_blob, part_id, part_num,
                             one_col_elem_num, random_seed);
-        bc.Decrease();
       });
     }
-    bc.WaitUntilCntEqualZero();
+    task_group.Wait();
   } else {
     ReadPartDataContent(ctx, in_blob, blob_conf, col_id, out_blob, 0, 1, one_col_elem_num,
                         random_seed);
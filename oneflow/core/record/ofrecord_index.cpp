@@ -0,0 +1,79 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/record/ofrecord_index.h"
+#include <cstring>
+
+namespace oneflow {
+
+namespace {
+
+constexpr uint64_t kScanBufferByteSize = 4 * 1024 * 1024;
+
+}  // namespace
+
+OFRecordIndex::OFRecordIndex(fs::FileSystem* fs, const std::string& part_path) {
+  const uint64_t part_size = fs->GetFileSize(part_path);
+  const std::string index_path = IndexFilePath(part_path);
+  if (fs->FileExists(index_path)) {
+    Load(fs, index_path, part_size);
+  } else {
+    Scan(fs, part_path, part_size);
+  }
+}
+
+std::string OFRecordIndex::IndexFilePath(const std::string& part_path) {
+  return part_path + ".index";
+}
+
+void OFRecordIndex::Load(fs::FileSystem* fs, const std::string& index_path, uint64_t part_size) {
+  const uint64_t index_size = fs->GetFileSize(index_path);
+  CHECK_EQ(index_size % sizeof(int64_t), 0) << "broken OFRecord index file: " << index_path;
+  offsets_.resize(index_size / sizeof(int64_t) + 1);
+  std::unique_ptr<fs::RandomAccessFile> file;
+  fs->NewRandomAccessFile(index_path, &file);
+  file->Read(0, index_size, reinterpret_cast<char*>(offsets_.data()));
+  offsets_.back() = part_size;
+  FOR_RANGE(int64_t, i, 0, record_num()) {
+    CHECK_LT(offsets_.at(i), offsets_.at(i + 1)) << "broken OFRecord index file: " << index_path;
+  }
+}
+
+void OFRecordIndex::Scan(fs::FileSystem* fs, const std::string& part_path, uint64_t part_size) {
+  // the part file is read in large blocks, so small records cost no read of their own and only
+  // payloads longer than a block are skipped by seeking
+  std::unique_ptr<fs::RandomAccessFile> file;
+  fs->NewRandomAccessFile(part_path, &file);
+  std::vector<char> buffer;
+  uint64_t buffer_offset = 0;
+  uint64_t offset = 0;
+  while (offset < part_size) {
+    CHECK_LE(offset + sizeof(int64_t), part_size) << "broken OFRecord part file: " << part_path;
+    if (offset < buffer_offset || offset + sizeof(int64_t) > buffer_offset + buffer.size()) {
+      buffer_offset = offset;
+      buffer.resize(std::min<uint64_t>(kScanBufferByteSize, part_size - offset));
+      file->Read(buffer_offset, buffer.size(), buffer.data());
+    }
+    int64_t size = -1;
+    std::memcpy(&size, buffer.data() + (offset - buffer_offset), sizeof(int64_t));
+    CHECK_GE(size, 0) << "broken OFRecord part file: " << part_path;
+    offsets_.push_back(offset);
+    offset += sizeof(int64_t) + size;
+  }
+  CHECK_EQ(offset, part_size) << "broken OFRecord part file: " << part_path;
+  offsets_.push_back(part_size);
+}
+
+}  // namespace oneflow
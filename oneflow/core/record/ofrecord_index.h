@@ -0,0 +1,51 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_RECORD_OFRECORD_INDEX_H_
+#define ONEFLOW_CORE_RECORD_OFRECORD_INDEX_H_
+
+#include "oneflow/core/persistence/file_system.h"
+
+namespace oneflow {
+
+// Offsets of the records of an OFRecord part file, which is a sequence of int64 size + payload
+// chunks. The index of "part-0" is stored beside it in "part-0.index" as raw int64 offsets, one
+// per record, as tools/gen_ofrecord_index.py writes it. When the sidecar file is missing the
+// part file is scanned instead.
+class OFRecordIndex final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordIndex);
+  OFRecordIndex() = delete;
+  OFRecordIndex(fs::FileSystem* fs, const std::string& part_path);
+  ~OFRecordIndex() = default;
+
+  int64_t record_num() const { return offsets_.size() - 1; }
+  // offset of the payload of the i-th record
+  int64_t payload_offset(int64_t i) const { return offsets_.at(i) + sizeof(int64_t); }
+  int64_t payload_size(int64_t i) const { return offsets_.at(i + 1) - payload_offset(i); }
+
+  static std::string IndexFilePath(const std::string& part_path);
+
+ private:
+  void Load(fs::FileSystem* fs, const std::string& index_path, uint64_t part_size);
+  void Scan(fs::FileSystem* fs, const std::string& part_path, uint64_t part_size);
+
+  // offsets of the size fields, followed by the size of the part file
+  std::vector<int64_t> offsets_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_RECORD_OFRECORD_INDEX_H_
@@ -0,0 +1,69 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/record/ofrecord_index.h"
+#include "oneflow/core/common/process_state.h"
+#include "oneflow/core/common/str_util.h"
+
+namespace oneflow {
+
+#ifdef PLATFORM_POSIX
+
+TEST(OFRecordIndex, scan_and_load) {
+  std::string current_dir = GetCwd();
+  StringReplace(&current_dir, '\\', '/');
+  const std::string part_path = JoinPath(current_dir, "/tmp_ofrecord_index_test_part-0");
+  std::vector<int64_t> sizes = {1, 100, 0, 7, 6 * 1024 * 1024, 0, 4096, 33};
+  std::string content;
+  for (int64_t size : sizes) {
+    content.append(reinterpret_cast<const char*>(&size), sizeof(int64_t));
+    content.append(std::string(size, 'a' + content.size() % 26));
+  }
+  std::unique_ptr<fs::WritableFile> file;
+  LocalFS()->NewWritableFile(part_path, &file);
+  file->Append(content.data(), content.size());
+  file->Close();
+  const auto CheckIndex = [&](const OFRecordIndex& index) {
+    ASSERT_EQ(index.record_num(), sizes.size());
+    int64_t offset = 0;
+    FOR_RANGE(int64_t, i, 0, sizes.size()) {
+      ASSERT_EQ(index.payload_offset(i), offset + sizeof(int64_t));
+      ASSERT_EQ(index.payload_size(i), sizes.at(i));
+      offset += sizeof(int64_t) + sizes.at(i);
+    }
+  };
+  const std::string index_path = OFRecordIndex::IndexFilePath(part_path);
+  ASSERT_FALSE(LocalFS()->FileExists(index_path));
+  OFRecordIndex scanned(LocalFS(), part_path);
+  CheckIndex(scanned);
+  // the sidecar as tools/gen_ofrecord_index.py writes it
+  std::vector<int64_t> offsets;
+  int64_t offset = 0;
+  for (int64_t size : sizes) {
+    offsets.push_back(offset);
+    offset += sizeof(int64_t) + size;
+  }
+  LocalFS()->NewWritableFile(index_path, &file);
+  file->Append(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(int64_t));
+  file->Close();
+  OFRecordIndex loaded(LocalFS(), part_path);
+  CheckIndex(loaded);
+  LocalFS()->DelFile(index_path);
+  LocalFS()->DelFile(part_path);
+}
+
+#endif  // PLATFORM_POSIX
+
+}  // namespace oneflow
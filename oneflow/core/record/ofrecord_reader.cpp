@@ -14,9 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/record/ofrecord_reader.h"
-#include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/thread/thread_manager.h"
-#include "oneflow/core/common/balanced_splitter.h"
 
 namespace oneflow {
 
@@ -28,8 +26,8 @@ bool ReadChunk(PersistentInStream* is, OFRecordChunk* chunk) {
   if (is->ReadFully(reinterpret_cast<char*>(&chunk->size), sizeof(int64_t)) == 0) {
     CHECK_GE(chunk->size, 0);
     CHECK_LE(chunk->size, MAX_CHUNK_SIZE);
-    chunk->data.reset(new char[chunk->size]);
-    CHECK_EQ(is->ReadFully(chunk->data.get(), chunk->size), 0);
+    chunk->data.resize(chunk->size);
+    CHECK_EQ(is->ReadFully(chunk->data.data(), chunk->size), 0);
     return true;
   }
   return false;
@@ -41,31 +39,22 @@ NaiveOFRecordReader::NaiveOFRecordReader(PersistentInStream* in, size_t num_max_
     : in_stream_(in), num_read_(0), num_max_read_(num_max_read) {}
 
 size_t NaiveOFRecordReader::Read(size_t n, OFRecord* allocated_records) {
-  std::vector<OFRecordChunk> chunks(n);
+  if (chunks_.size() < n) { chunks_.resize(n); }
   const size_t can_read = std::min(n, num_max_read_ - num_read_);
   size_t cur_read = 0;
   FOR_RANGE(size_t, i, 0, can_read) {
-    if (ReadChunk(in_stream_, &chunks[i])) {
+    if (ReadChunk(in_stream_, &chunks_[i])) {
       cur_read += 1;
     } else {
       break;
     }
   }
   if (cur_read == 0) { return 0; }
-  ThreadPool* thread_pool = Global<ThreadPool>::Get();
-  const int64_t thread_num = std::min<int64_t>(thread_pool->thread_num(), cur_read);
-  BlockingCounter bc(thread_num);
-  const BalancedSplitter bs(cur_read, thread_num);
-  FOR_RANGE(int64_t, tid, 0, thread_num) {
-    const Range thrd_range = bs.At(tid);
-    thread_pool->AddWork([thrd_range, &bc, &chunks, &allocated_records]() {
-      FOR_RANGE(int64_t, i, thrd_range.begin(), thrd_range.end()) {
-        CHECK(allocated_records[i].ParseFromArray(chunks.at(i).data.get(), chunks.at(i).size));
-      }
-      bc.Decrease();
-    });
-  }
-  bc.WaitUntilCntEqualZero();
+  Global<ThreadPool>::Get()->ParallelFor(0, cur_read, 1, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      CHECK(allocated_records[i].ParseFromArray(chunks_.at(i).data.data(), chunks_.at(i).size));
+    }
+  });
   num_read_ += cur_read;
   return cur_read;
 }
@@ -84,6 +73,10 @@ RandomShuffleOFRecordReader::RandomShuffleOFRecordReader(PersistentInStream* in,
 void RandomShuffleOFRecordReader::FillBuffer() {
   for (; num_read_ < num_max_read_ && buffered_chunks_.size() < buffer_size_; ++num_read_) {
     OFRecordChunk chunk;
+    if (!free_chunks_.empty()) {
+      chunk = std::move(free_chunks_.back());
+      free_chunks_.pop_back();
+    }
     if (ReadChunk(in_stream_, &chunk)) {
       buffered_chunks_.emplace_back(std::move(chunk));
     } else {
@@ -104,8 +97,9 @@ size_t RandomShuffleOFRecordReader::Read(size_t n, OFRecord* allocated_records)
     if (pos != buffered_chunks_.size() - 1) {
       std::swap(buffered_chunks_[pos], buffered_chunks_.back());
     }
-    CHECK(allocated_records[cur_read].ParseFromArray(buffered_chunks_.back().data.get(),
+    CHECK(allocated_records[cur_read].ParseFromArray(buffered_chunks_.back().data.data(),
                                                      buffered_chunks_.back().size));
+    free_chunks_.push_back(std::move(buffered_chunks_.back()));
     buffered_chunks_.pop_back();
     ++cur_read;
   }
@@ -24,7 +24,8 @@ namespace oneflow {
 
 struct OFRecordChunk {
   int64_t size = 0;
-  std::unique_ptr<char[]> data;
+  // capacity is kept when a chunk is reused for the next record
+  std::vector<char> data;
 };
 
 class OFRecordReader {
@@ -50,6 +51,7 @@ class NaiveOFRecordReader final : public OFRecordReader {
   PersistentInStream* in_stream_;
   size_t num_read_;
   const size_t num_max_read_;
+  std::vector<OFRecordChunk> chunks_;
 };
 
 class RandomShuffleOFRecordReader final : public OFRecordReader {
@@ -73,6 +75,7 @@ class RandomShuffleOFRecordReader final : public OFRecordReader {
   std::mt19937 random_gen_;
   size_t num_read_;
   std::vector<OFRecordChunk> buffered_chunks_;
+  std::vector<OFRecordChunk> free_chunks_;
   bool is_eof_;
 };
 
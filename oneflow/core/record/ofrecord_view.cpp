@@ -0,0 +1,257 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/record/ofrecord_view.h"
+#include <cstring>
+
+namespace oneflow {
+
+namespace {
+
+enum WireType : uint32_t {
+  kWireTypeVarint = 0,
+  kWireTypeFixed64 = 1,
+  kWireTypeLengthDelimited = 2,
+  kWireTypeFixed32 = 5,
+};
+
+// Minimal reader of the protobuf wire format
+class WireReader final {
+ public:
+  WireReader(const char* data, size_t size) : cur_(data), end_(data + size) {}
+  ~WireReader() = default;
+
+  bool AtEnd() const { return cur_ == end_; }
+
+  bool ReadVarint(uint64_t* value) {
+    *value = 0;
+    for (int32_t shift = 0; shift < 64; shift += 7) {
+      if (cur_ == end_) { return false; }
+      const uint8_t byte = static_cast<uint8_t>(*cur_++);
+      *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if ((byte & 0x80) == 0) { return true; }
+    }
+    return false;
+  }
+
+  bool ReadTag(uint32_t* field, uint32_t* wire_type) {
+    uint64_t tag = 0;
+    if (!ReadVarint(&tag)) { return false; }
+    *field = static_cast<uint32_t>(tag >> 3);
+    *wire_type = static_cast<uint32_t>(tag & 0x7);
+    return *field != 0;
+  }
+
+  bool ReadFixed(size_t size, const char** data) {
+    if (static_cast<size_t>(end_ - cur_) < size) { return false; }
+    *data = cur_;
+    cur_ += size;
+    return true;
+  }
+
+  bool ReadLengthDelimited(const char** data, size_t* size) {
+    uint64_t length = 0;
+    if (!ReadVarint(&length)) { return false; }
+    *size = length;
+    return ReadFixed(length, data);
+  }
+
+  bool Skip(uint32_t wire_type) {
+    uint64_t varint = 0;
+    const char* data = nullptr;
+    size_t size = 0;
+    switch (wire_type) {
+      case kWireTypeVarint: return ReadVarint(&varint);
+      case kWireTypeFixed64: return ReadFixed(8, &data);
+      case kWireTypeLengthDelimited: return ReadLengthDelimited(&data, &size);
+      case kWireTypeFixed32: return ReadFixed(4, &data);
+      default: return false;
+    }
+  }
+
+ private:
+  const char* cur_;
+  const char* end_;
+};
+
+template<typename T>
+struct ValueWire;
+
+template<>
+struct ValueWire<float> {
+  static const Feature::KindCase kind_case = Feature::kFloatList;
+  static const uint32_t wire_type = kWireTypeFixed32;
+};
+
+template<>
+struct ValueWire<double> {
+  static const Feature::KindCase kind_case = Feature::kDoubleList;
+  static const uint32_t wire_type = kWireTypeFixed64;
+};
+
+template<>
+struct ValueWire<int32_t> {
+  static const Feature::KindCase kind_case = Feature::kInt32List;
+  static const uint32_t wire_type = kWireTypeVarint;
+};
+
+template<>
+struct ValueWire<int64_t> {
+  static const Feature::KindCase kind_case = Feature::kInt64List;
+  static const uint32_t wire_type = kWireTypeVarint;
+};
+
+template<typename T>
+bool ReadValue(WireReader* reader, T* value) {
+  if (ValueWire<T>::wire_type == kWireTypeVarint) {
+    uint64_t varint = 0;
+    if (!reader->ReadVarint(&varint)) { return false; }
+    *value = static_cast<T>(varint);
+    return true;
+  }
+  const char* data = nullptr;
+  if (!reader->ReadFixed(sizeof(T), &data)) { return false; }
+  std::memcpy(value, data, sizeof(T));
+  return true;
+}
+
+bool ParseFeature(const char* data, size_t size, FeatureView* feature) {
+  WireReader reader(data, size);
+  uint32_t field = 0;
+  uint32_t wire_type = 0;
+  while (!reader.AtEnd()) {
+    if (!reader.ReadTag(&field, &wire_type)) { return false; }
+    if (field >= Feature::kBytesList && field <= Feature::kInt64List
+        && wire_type == kWireTypeLengthDelimited) {
+      const char* list_data = nullptr;
+      size_t list_size = 0;
+      if (!reader.ReadLengthDelimited(&list_data, &list_size)) { return false; }
+      *feature = FeatureView(static_cast<Feature::KindCase>(field), list_data, list_size);
+    } else if (!reader.Skip(wire_type)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void FeatureView::GetBytesList(std::vector<OFRecordBytes>* values) const {
+  CHECK(has_bytes_list());
+  values->clear();
+  WireReader reader(data_, size_);
+  uint32_t field = 0;
+  uint32_t wire_type = 0;
+  while (!reader.AtEnd()) {
+    CHECK(reader.ReadTag(&field, &wire_type));
+    if (field == 1 && wire_type == kWireTypeLengthDelimited) {
+      OFRecordBytes value;
+      CHECK(reader.ReadLengthDelimited(&value.data, &value.size));
+      values->push_back(value);
+    } else {
+      CHECK(reader.Skip(wire_type));
+    }
+  }
+}
+
+template<typename T>
+void FeatureView::GetValues(std::vector<T>* values) const {
+  CHECK(kind_case_ == ValueWire<T>::kind_case);
+  values->clear();
+  WireReader reader(data_, size_);
+  uint32_t field = 0;
+  uint32_t wire_type = 0;
+  T value;
+  while (!reader.AtEnd()) {
+    CHECK(reader.ReadTag(&field, &wire_type));
+    if (field != 1) {
+      CHECK(reader.Skip(wire_type));
+    } else if (wire_type == kWireTypeLengthDelimited) {
+      // packed
+      const char* packed_data = nullptr;
+      size_t packed_size = 0;
+      CHECK(reader.ReadLengthDelimited(&packed_data, &packed_size));
+      if (ValueWire<T>::wire_type != kWireTypeVarint) {
+        CHECK_EQ(packed_size % sizeof(T), 0);
+        values->reserve(values->size() + packed_size / sizeof(T));
+      }
+      WireReader packed_reader(packed_data, packed_size);
+      while (!packed_reader.AtEnd()) {
+        CHECK(ReadValue(&packed_reader, &value));
+        values->push_back(value);
+      }
+    } else {
+      CHECK(wire_type == ValueWire<T>::wire_type);
+      CHECK(ReadValue(&reader, &value));
+      values->push_back(value);
+    }
+  }
+}
+
+template void FeatureView::GetValues<float>(std::vector<float>* values) const;
+template void FeatureView::GetValues<double>(std::vector<double>* values) const;
+template void FeatureView::GetValues<int32_t>(std::vector<int32_t>* values) const;
+template void FeatureView::GetValues<int64_t>(std::vector<int64_t>* values) const;
+
+bool OFRecordView::Parse(const char* data, size_t size) {
+  features_.clear();
+  WireReader reader(data, size);
+  uint32_t field = 0;
+  uint32_t wire_type = 0;
+  while (!reader.AtEnd()) {
+    if (!reader.ReadTag(&field, &wire_type)) { return false; }
+    if (field != 1 || wire_type != kWireTypeLengthDelimited) {
+      if (!reader.Skip(wire_type)) { return false; }
+      continue;
+    }
+    // map entry: 1 is the name, 2 is the feature
+    const char* entry_data = nullptr;
+    size_t entry_size = 0;
+    if (!reader.ReadLengthDelimited(&entry_data, &entry_size)) { return false; }
+    Entry entry;
+    entry.name = OFRecordBytes{"", 0};
+    WireReader entry_reader(entry_data, entry_size);
+    while (!entry_reader.AtEnd()) {
+      if (!entry_reader.ReadTag(&field, &wire_type)) { return false; }
+      if (field == 1 && wire_type == kWireTypeLengthDelimited) {
+        if (!entry_reader.ReadLengthDelimited(&entry.name.data, &entry.name.size)) {
+          return false;
+        }
+      } else if (field == 2 && wire_type == kWireTypeLengthDelimited) {
+        const char* feature_data = nullptr;
+        size_t feature_size = 0;
+        if (!entry_reader.ReadLengthDelimited(&feature_data, &feature_size)) { return false; }
+        if (!ParseFeature(feature_data, feature_size, &entry.feature)) { return false; }
+      } else if (!entry_reader.Skip(wire_type)) {
+        return false;
+      }
+    }
+    features_.push_back(entry);
+  }
+  return true;
+}
+
+bool OFRecordView::Find(const std::string& name, FeatureView* feature) const {
+  // the last entry of a key wins, as in a parsed map
+  for (auto it = features_.rbegin(); it != features_.rend(); ++it) {
+    if (it->name.size == name.size() && std::memcmp(it->name.data, name.data(), name.size()) == 0) {
+      *feature = it->feature;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace oneflow
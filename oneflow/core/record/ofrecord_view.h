@@ -0,0 +1,82 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
+#define ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
+
+#include "oneflow/core/common/util.h"
+#include "oneflow/core/record/record.pb.h"
+
+namespace oneflow {
+
+struct OFRecordBytes {
+  const char* data;
+  size_t size;
+};
+
+// One feature of an OFRecordView, referencing the serialized list message.
+class FeatureView final {
+ public:
+  FeatureView() : kind_case_(Feature::KIND_NOT_SET), data_(nullptr), size_(0) {}
+  FeatureView(Feature::KindCase kind_case, const char* data, size_t size)
+      : kind_case_(kind_case), data_(data), size_(size) {}
+  ~FeatureView() = default;
+
+  Feature::KindCase kind_case() const { return kind_case_; }
+  bool has_bytes_list() const { return kind_case_ == Feature::kBytesList; }
+  bool has_float_list() const { return kind_case_ == Feature::kFloatList; }
+  bool has_double_list() const { return kind_case_ == Feature::kDoubleList; }
+  bool has_int32_list() const { return kind_case_ == Feature::kInt32List; }
+  bool has_int64_list() const { return kind_case_ == Feature::kInt64List; }
+
+  // the values point into the serialized record, nothing is copied
+  void GetBytesList(std::vector<OFRecordBytes>* values) const;
+  // T must match the kind: float, double, int32_t or int64_t
+  template<typename T>
+  void GetValues(std::vector<T>* values) const;
+
+ private:
+  Feature::KindCase kind_case_;
+  const char* data_;
+  size_t size_;
+};
+
+// Read-only view of a serialized OFRecord which, unlike OFRecord::ParseFromArray, neither
+// allocates messages nor copies the feature bytes. The serialized bytes must outlive the view.
+// It only fits readers that own the serialized bytes, such as the image classification dataset;
+// kOFRecord tensors carry parsed OFRecord objects, so the decoders behind them read Feature.
+class OFRecordView final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordView);
+  OFRecordView() = default;
+  ~OFRecordView() = default;
+
+  // returns false if the bytes are not a well-formed OFRecord
+  bool Parse(const char* data, size_t size);
+  // returns false if the record has no feature named `name`
+  bool Find(const std::string& name, FeatureView* feature) const;
+  size_t feature_size() const { return features_.size(); }
+
+ private:
+  struct Entry {
+    OFRecordBytes name;
+    FeatureView feature;
+  };
+  std::vector<Entry> features_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_RECORD_OFRECORD_VIEW_H_
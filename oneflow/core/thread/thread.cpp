@@ -50,7 +50,7 @@ void Thread::PollMsgChannel(const ThreadCtx& thread_ctx) {
     local_msg_queue_.pop();
     if (msg.msg_type() == ActorMsgType::kCmdMsg) {
       if (msg.actor_cmd() == ActorCmd::kStopThread) {
-        CHECK(id2actor_ptr_.empty());
+        CHECK_EQ(running_actor_cnt_, 0);
         break;
       } else if (msg.actor_cmd() == ActorCmd::kConstructActor) {
         ConstructActor(msg.dst_actor_id(), thread_ctx);
@@ -60,12 +60,15 @@ void Thread::PollMsgChannel(const ThreadCtx& thread_ctx) {
       }
     }
     int64_t actor_id = msg.dst_actor_id();
-    auto actor_it = id2actor_ptr_.find(actor_id);
-    CHECK(actor_it != id2actor_ptr_.end());
-    int process_msg_ret = actor_it->second->ProcessMsg(msg);
+    size_t actor_idx = Global<IDMgr>::Get()->ThrdLocalTaskId4ActorId(actor_id);
+    CHECK_LT(actor_idx, actors_.size());
+    std::unique_ptr<Actor>& actor = actors_[actor_idx];
+    CHECK(actor);
+    int process_msg_ret = actor->ProcessMsg(msg);
     if (process_msg_ret == 1) {
       LOG(INFO) << "thread " << thrd_id_ << " deconstruct actor " << actor_id;
-      id2actor_ptr_.erase(actor_it);
+      actor.reset();
+      running_actor_cnt_ -= 1;
       Global<RuntimeCtx>::Get()->DecreaseCounter("running_actor_cnt");
     } else {
       CHECK_EQ(process_msg_ret, 0);
@@ -77,7 +80,11 @@ void Thread::ConstructActor(int64_t actor_id, const ThreadCtx& thread_ctx) {
   LOG(INFO) << "thread " << thrd_id_ << " construct actor " << actor_id;
   std::unique_lock<std::mutex> lck(id2task_mtx_);
   auto task_it = id2task_.find(actor_id);
-  CHECK(id2actor_ptr_.emplace(actor_id, NewActor(task_it->second, thread_ctx)).second);
+  const size_t actor_idx = Global<IDMgr>::Get()->ThrdLocalTaskId4ActorId(actor_id);
+  if (actor_idx >= actors_.size()) { actors_.resize(actor_idx + 1); }
+  CHECK(!actors_[actor_idx]);
+  actors_[actor_idx] = NewActor(task_it->second, thread_ctx);
+  running_actor_cnt_ += 1;
   id2task_.erase(task_it);
   Global<RuntimeCtx>::Get()->DecreaseCounter("constructing_actor_cnt");
 }
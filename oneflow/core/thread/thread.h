@@ -17,7 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_THREAD_THREAD_H_
 
 #include "oneflow/core/actor/actor_message_bus.h"
-#include "oneflow/core/common/channel.h"
+#include "oneflow/core/common/mpsc_channel.h"
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/job/task.pb.h"
 #include "oneflow/core/thread/thread_context.h"
@@ -32,7 +32,7 @@ class Thread {
 
   void AddTask(const TaskProto&);
 
-  Channel<ActorMsg>* GetMsgChannelPtr() { return &msg_channel_; }
+  MpscChannel<ActorMsg>* GetMsgChannelPtr() { return &msg_channel_; }
   void EnqueueActorMsg(const ActorMsg& msg);
 
   void JoinAllActor() { actor_thread_.join(); }
@@ -50,8 +50,10 @@ class Thread {
   std::mutex id2task_mtx_;
 
   std::thread actor_thread_;
-  Channel<ActorMsg> msg_channel_;
-  HashMap<int64_t, std::unique_ptr<Actor>> id2actor_ptr_;
+  MpscChannel<ActorMsg> msg_channel_;
+  // indexed by the thrd_local_task_id of the actors, which numbers the tasks of a thread densely
+  std::vector<std::unique_ptr<Actor>> actors_;
+  int64_t running_actor_cnt_ = 0;
   std::queue<ActorMsg> local_msg_queue_;
 
   int64_t thrd_id_;
@@ -18,8 +18,6 @@ limitations under the License.
 #include "oneflow/core/job/global_for.h"
 #include "oneflow/core/thread/cpu_thread.h"
 #include "oneflow/core/thread/gpu_thread.h"
-#include "oneflow/core/common/balanced_splitter.h"
-#include "oneflow/core/common/blocking_counter.h"
 #include "oneflow/core/job/machine_context.h"
 #include "oneflow/core/job/global_for.h"
 
@@ -71,17 +69,9 @@ void SingleThreadLoop(size_t num, std::function<void(size_t i)> Callback) {
 }
 
 void MultiThreadLoop(size_t num, std::function<void(size_t i)> Callback) {
-  size_t thread_num = Global<ThreadPool>::Get()->thread_num();
-  thread_num = std::min(num, thread_num);
-  BalancedSplitter bs(num, thread_num);
-  BlockingCounter bc(thread_num);
-  FOR_RANGE(size_t, range_id, 0, thread_num) {
-    Global<ThreadPool>::Get()->AddWork([&bc, &bs, range_id, Callback] {
-      FOR_RANGE(size_t, i, bs.At(range_id).begin(), bs.At(range_id).end()) { Callback(i); }
-      bc.Decrease();
-    });
-  }
-  bc.WaitUntilCntEqualZero();
+  Global<ThreadPool>::Get()->ParallelFor(0, num, 1, [&Callback](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) { Callback(i); }
+  });
 }
 
 }  // namespace oneflow
@@ -17,28 +17,153 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+constexpr int64_t kParallelForChunkNumPerThread = 4;
+
+thread_local const ThreadPool* tls_thread_pool = nullptr;
+thread_local int32_t tls_worker_id = -1;
+
+}  // namespace
+
 ThreadPool::ThreadPool(int32_t thread_num)
-    : work_chans_(thread_num), threads_(thread_num), work_cnt_(0) {
+    : work_deques_(thread_num),
+      threads_(thread_num),
+      pending_work_cnt_(0),
+      idle_thread_cnt_(0),
+      is_closed_(false) {
+  FOR_RANGE(int32_t, i, 0, thread_num) { work_deques_.at(i).reset(new WorkDeque()); }
   FOR_RANGE(int32_t, i, 0, thread_num) {
-    Channel<std::function<void()>>* chan = &(work_chans_.at(i));
-    threads_[i] = std::thread([chan]() {
-      std::function<void()> work;
-      while (chan->Receive(&work) == kChannelStatusSuccess) { work(); }
-    });
+    threads_[i] = std::thread([this, i]() { WorkerLoop(i); });
   }
 }
 
 ThreadPool::~ThreadPool() {
-  FOR_RANGE(int32_t, i, 0, work_chans_.size()) {
-    work_chans_.at(i).Close();
-    threads_.at(i).join();
+  {
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    is_closed_ = true;
   }
+  idle_cond_.notify_all();
+  for (std::thread& thread : threads_) { thread.join(); }
 }
 
 void ThreadPool::AddWork(const std::function<void()>& work) {
-  const size_t cur_chan_idx =
-      work_cnt_.fetch_add(1, std::memory_order_relaxed) % work_chans_.size();
-  work_chans_.at(cur_chan_idx).Send(work);
+  WorkDeque* deque =
+      tls_thread_pool == this ? work_deques_.at(tls_worker_id).get() : &injected_works_;
+  {
+    std::unique_lock<std::mutex> lock(deque->mutex);
+    deque->works.push_back(work);
+  }
+  pending_work_cnt_.fetch_add(1, std::memory_order_seq_cst);
+  if (idle_thread_cnt_.load(std::memory_order_seq_cst) > 0) {
+    { std::unique_lock<std::mutex> lock(idle_mutex_); }
+    idle_cond_.notify_one();
+  }
+}
+
+bool ThreadPool::TryPopOrSteal(int32_t worker_id, std::function<void()>* work) {
+  // own works newest first, then outside works and stolen works oldest first
+  const auto TryPop = [&](WorkDeque* deque, bool from_back) {
+    std::unique_lock<std::mutex> lock(deque->mutex);
+    if (deque->works.empty()) { return false; }
+    if (from_back) {
+      *work = std::move(deque->works.back());
+      deque->works.pop_back();
+    } else {
+      *work = std::move(deque->works.front());
+      deque->works.pop_front();
+    }
+    pending_work_cnt_.fetch_sub(1, std::memory_order_seq_cst);
+    return true;
+  };
+  if (TryPop(work_deques_.at(worker_id).get(), true)) { return true; }
+  if (TryPop(&injected_works_, false)) { return true; }
+  const int32_t deque_num = work_deques_.size();
+  FOR_RANGE(int32_t, i, 1, deque_num) {
+    if (TryPop(work_deques_.at((worker_id + i) % deque_num).get(), false)) { return true; }
+  }
+  return false;
+}
+
+void ThreadPool::WorkerLoop(int32_t worker_id) {
+  tls_thread_pool = this;
+  tls_worker_id = worker_id;
+  std::function<void()> work;
+  while (true) {
+    if (TryPopOrSteal(worker_id, &work)) {
+      work();
+      work = std::function<void()>();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_thread_cnt_.fetch_add(1, std::memory_order_seq_cst);
+    idle_cond_.wait(lock, [this]() {
+      return pending_work_cnt_.load(std::memory_order_seq_cst) > 0 || is_closed_;
+    });
+    idle_thread_cnt_.fetch_sub(1, std::memory_order_seq_cst);
+    if (is_closed_ && pending_work_cnt_.load(std::memory_order_seq_cst) == 0) { break; }
+  }
+}
+
+void ThreadPool::ParallelFor(int64_t begin, int64_t end, int64_t grain,
+                             const std::function<void(int64_t, int64_t)>& fn) {
+  if (end <= begin) { return; }
+  const int64_t total = end - begin;
+  grain = std::max<int64_t>(grain, 1);
+  const int64_t max_chunk_num = thread_num() * kParallelForChunkNumPerThread;
+  // rounding down keeps every chunk at least grain long
+  const int64_t chunk_num = std::min(total / grain, max_chunk_num);
+  if (chunk_num <= 1) {
+    fn(begin, end);
+    return;
+  }
+  const int64_t chunk_size = total / chunk_num;
+  const int64_t remainder = total % chunk_num;
+  TaskGroup task_group(this);
+  int64_t chunk_begin = begin;
+  FOR_RANGE(int64_t, i, 0, chunk_num) {
+    const int64_t chunk_end = chunk_begin + chunk_size + (i < remainder ? 1 : 0);
+    task_group.Run([&fn, chunk_begin, chunk_end]() { fn(chunk_begin, chunk_end); });
+    chunk_begin = chunk_end;
+  }
+  CHECK_EQ(chunk_begin, end);
+  task_group.Wait();
+}
+
+TaskGroup::TaskGroup(ThreadPool* thread_pool)
+    : thread_pool_(thread_pool), state_(std::make_shared<State>()) {}
+
+TaskGroup::~TaskGroup() { Wait(); }
+
+void TaskGroup::Run(const std::function<void()>& task) {
+  {
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->tasks.push_back(task);
+    state_->unfinished_cnt += 1;
+  }
+  std::shared_ptr<State> state = state_;
+  thread_pool_->AddWork([state]() { TryRunOne(state.get()); });
+}
+
+bool TaskGroup::TryRunOne(State* state) {
+  std::function<void()> task;
+  {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    if (state->tasks.empty()) { return false; }
+    task = std::move(state->tasks.front());
+    state->tasks.pop_front();
+  }
+  task();
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->unfinished_cnt -= 1;
+  if (state->unfinished_cnt == 0) { state->cond.notify_all(); }
+  return true;
+}
+
+void TaskGroup::Wait() {
+  while (TryRunOne(state_.get())) {}
+  std::unique_lock<std::mutex> lock(state_->mutex);
+  state_->cond.wait(lock, [this]() { return state_->unfinished_cnt == 0; });
 }
 
 }  // namespace oneflow
@@ -17,10 +17,14 @@ limitations under the License.
 #define ONEFLOW_CORE_THREAD_THREAD_POOL_H_
 
 #include "oneflow/core/common/util.h"
-#include "oneflow/core/common/channel.h"
 
 namespace oneflow {
 
+// Work-stealing thread pool.
+// Every worker owns a deque for the works it adds itself: it pushes and pops at the back, idle
+// workers steal from the front of the others, so one slow work item never stalls the items
+// queued behind it. Works added from outside the pool go to a shared queue and start in the
+// order they were added.
 class ThreadPool final {
  public:
   OF_DISALLOW_COPY_AND_MOVE(ThreadPool);
@@ -31,11 +35,57 @@ class ThreadPool final {
   int32_t thread_num() const { return threads_.size(); }
   void AddWork(const std::function<void()>& work);
 
+  // Splits [begin, end) into chunks of at least `grain` indices and calls fn(chunk_begin,
+  // chunk_end) for every chunk. The calling thread executes chunks as well and returns when all
+  // of them are done.
+  void ParallelFor(int64_t begin, int64_t end, int64_t grain,
+                   const std::function<void(int64_t, int64_t)>& fn);
+
  private:
-  std::vector<Channel<std::function<void()>>> work_chans_;
+  struct WorkDeque {
+    std::mutex mutex;
+    std::deque<std::function<void()>> works;
+  };
+
+  void WorkerLoop(int32_t worker_id);
+  bool TryPopOrSteal(int32_t worker_id, std::function<void()>* work);
+
+  WorkDeque injected_works_;
+  std::vector<std::unique_ptr<WorkDeque>> work_deques_;
   std::vector<std::thread> threads_;
 
-  std::atomic<size_t> work_cnt_;
+  std::atomic<int64_t> pending_work_cnt_;
+  std::atomic<int32_t> idle_thread_cnt_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cond_;
+  bool is_closed_;
+};
+
+// A set of works which can be waited on as a whole.
+// Works are queued in the group, the pool only gets trampolines which pick the next one. Wait()
+// runs the not-yet-started works on the calling thread, so nested waits from inside a pool work
+// never deadlock and never pick up unrelated long-running works.
+class TaskGroup final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(TaskGroup);
+  explicit TaskGroup(ThreadPool* thread_pool);
+  ~TaskGroup();
+
+  void Run(const std::function<void()>& task);
+  void Wait();
+
+ private:
+  // shared with the trampolines, which may outlive the group
+  struct State {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::function<void()>> tasks;
+    int64_t unfinished_cnt = 0;
+  };
+  static bool TryRunOne(State* state);
+
+  ThreadPool* thread_pool_;
+  std::shared_ptr<State> state_;
 };
 
 }  // namespace oneflow
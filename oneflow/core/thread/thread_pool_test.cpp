@@ -0,0 +1,101 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/common/blocking_counter.h"
+
+namespace oneflow {
+
+TEST(ThreadPool, parallel_for_visits_each_index_once) {
+  ThreadPool thread_pool(4);
+  for (int64_t grain : {1, 7, 1000, 5000}) {
+    std::vector<std::atomic<int32_t>> visit(3000);
+    for (auto& cnt : visit) { cnt = 0; }
+    thread_pool.ParallelFor(0, visit.size(), grain, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) { visit.at(i) += 1; }
+    });
+    for (auto& cnt : visit) { ASSERT_EQ(cnt.load(), 1); }
+  }
+}
+
+TEST(ThreadPool, parallel_for_chunks_are_at_least_grain) {
+  ThreadPool thread_pool(4);
+  for (int64_t total : {3, 10, 11, 1001}) {
+    for (int64_t grain : {1, 4, 7, 100}) {
+      std::mutex mutex;
+      std::vector<int64_t> chunk_sizes;
+      thread_pool.ParallelFor(0, total, grain, [&](int64_t begin, int64_t end) {
+        std::unique_lock<std::mutex> lock(mutex);
+        chunk_sizes.push_back(end - begin);
+      });
+      for (int64_t size : chunk_sizes) {
+        // a range shorter than grain is one chunk
+        ASSERT_GE(size, std::min(grain, total)) << total << " " << grain;
+      }
+    }
+  }
+}
+
+TEST(ThreadPool, nested_parallel_for) {
+  ThreadPool thread_pool(2);
+  std::atomic<int64_t> sum(0);
+  thread_pool.ParallelFor(0, 16, 1, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      thread_pool.ParallelFor(0, 100, 1, [&](int64_t inner_begin, int64_t inner_end) {
+        sum += inner_end - inner_begin;
+      });
+    }
+  });
+  ASSERT_EQ(sum.load(), 1600);
+}
+
+TEST(ThreadPool, slow_work_does_not_block_queued_works) {
+  ThreadPool thread_pool(2);
+  BlockingCounter release_slow_work(1);
+  BlockingCounter fast_works(8);
+  thread_pool.AddWork([&]() { release_slow_work.WaitUntilCntEqualZero(); });
+  FOR_RANGE(int32_t, i, 0, 8) {
+    thread_pool.AddWork([&]() { fast_works.Decrease(); });
+  }
+  fast_works.WaitUntilCntEqualZero();
+  release_slow_work.Decrease();
+}
+
+TEST(ThreadPool, outside_works_start_in_order) {
+  ThreadPool thread_pool(1);
+  std::vector<int32_t> order;
+  BlockingCounter done(100);
+  FOR_RANGE(int32_t, i, 0, 100) {
+    thread_pool.AddWork([&, i]() {
+      order.push_back(i);
+      done.Decrease();
+    });
+  }
+  done.WaitUntilCntEqualZero();
+  FOR_RANGE(int32_t, i, 0, 100) { ASSERT_EQ(order.at(i), i); }
+}
+
+TEST(TaskGroup, wait) {
+  ThreadPool thread_pool(3);
+  std::atomic<int32_t> cnt(0);
+  TaskGroup task_group(&thread_pool);
+  FOR_RANGE(int32_t, i, 0, 100) {
+    task_group.Run([&]() { cnt += 1; });
+  }
+  task_group.Wait();
+  ASSERT_EQ(cnt.load(), 100);
+}
+
+}  // namespace oneflow
@@ -14,17 +14,180 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <cstdlib>
+#include <cstring>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
 #include "oneflow/core/vm/cpu_allocator.h"
-#include "oneflow/core/common/util.h"
 
 namespace oneflow {
 namespace vm {
 
+namespace {
+
+constexpr int64_t kDefaultMaxCachedBytes = 4LL << 30;
+
+int32_t ThisThreadShardId() {
+  static std::atomic<int32_t> num_threads(0);
+  thread_local const int32_t shard_id = num_threads++ % CpuAllocator::kNumShards;
+  return shard_id;
+}
+
+void UpdatePeak(std::atomic<int64_t>* peak, int64_t value) {
+  int64_t cur = peak->load(std::memory_order_relaxed);
+  while (value > cur && !peak->compare_exchange_weak(cur, value, std::memory_order_relaxed)) {}
+}
+
+}  // namespace
+
+constexpr std::size_t CpuAllocator::kMemAllocAlignSize;
+constexpr int32_t CpuAllocator::kNumClasses;
+constexpr std::size_t CpuAllocator::kMaxClassSize;
+constexpr std::size_t CpuAllocator::kHugePageSize;
+constexpr int32_t CpuAllocator::kNumShards;
+
+CpuAllocator::CpuAllocator()
+    : CpuAllocator(std::getenv("ONEFLOW_CPU_ALLOCATOR_MAX_CACHED_MB") != nullptr
+                       ? std::atoll(std::getenv("ONEFLOW_CPU_ALLOCATOR_MAX_CACHED_MB")) << 20
+                       : kDefaultMaxCachedBytes,
+                   std::getenv("ONEFLOW_CPU_ALLOCATOR_USE_HUGE_PAGE") != nullptr) {}
+
+CpuAllocator::CpuAllocator(std::size_t max_cached_bytes, bool use_huge_page)
+    : max_cached_bytes_(max_cached_bytes),
+      use_huge_page_(use_huge_page),
+      shards_(kNumShards),
+      class2num_cached_(kNumClasses),
+      in_use_bytes_(0),
+      requested_bytes_(0),
+      cached_bytes_(0),
+      peak_in_use_bytes_(0),
+      peak_reserved_bytes_(0),
+      num_allocations_(0),
+      num_system_allocations_(0) {
+  for (Shard& shard : shards_) { shard.free_lists.resize(kNumClasses); }
+}
+
+CpuAllocator::~CpuAllocator() { EmptyCache(); }
+
+int32_t CpuAllocator::Class4Size(std::size_t size) {
+  if (size <= 256) { return static_cast<int32_t>((std::max<std::size_t>(size, 1) + 63) / 64 - 1); }
+  // 2^p < size <= 2^(p + 1), split into four classes of 2^(p - 2) bytes each
+  const int32_t p = 63 ^ __builtin_clzll(size - 1);
+  const std::size_t step = static_cast<std::size_t>(1) << (p - 2);
+  return 4 + (p - 8) * 4 + static_cast<int32_t>((size - 1 - (step << 2)) / step);
+}
+
+std::size_t CpuAllocator::Size4Class(int32_t cls) {
+  if (cls < 4) { return (cls + 1) * 64; }
+  const int32_t group = (cls - 4) / 4;
+  return (static_cast<std::size_t>(256) << group)
+         + ((cls - 4) % 4 + 1) * (static_cast<std::size_t>(64) << group);
+}
+
+char* CpuAllocator::SystemAllocate(std::size_t size) {
+  const bool huge = use_huge_page_ && size >= kHugePageSize;
+  void* ptr = nullptr;
+  if (posix_memalign(&ptr, huge ? kHugePageSize : kMemAllocAlignSize, size) != 0) {
+    return nullptr;
+  }
+#ifdef MADV_HUGEPAGE
+  // a hint only, transparent huge pages may well be disabled on this machine
+  if (huge) { madvise(ptr, size, MADV_HUGEPAGE); }
+#endif
+  num_system_allocations_.fetch_add(1, std::memory_order_relaxed);
+  return reinterpret_cast<char*>(ptr);
+}
+
+void CpuAllocator::SystemDeallocate(char* mem_ptr, std::size_t size) { std::free(mem_ptr); }
+
+char* CpuAllocator::TryPopFromShard(int32_t shard_id, int32_t cls) {
+  Shard* shard = &shards_.at(shard_id);
+  std::unique_lock<std::mutex> lock(shard->mutex);
+  std::vector<char*>* free_list = &shard->free_lists.at(cls);
+  if (free_list->empty()) { return nullptr; }
+  char* mem_ptr = free_list->back();
+  free_list->pop_back();
+  class2num_cached_.at(cls).fetch_sub(1, std::memory_order_relaxed);
+  return mem_ptr;
+}
+
 void CpuAllocator::Allocate(char** mem_ptr, std::size_t size) {
-  *mem_ptr = reinterpret_cast<char*>(std::malloc(size));
+  *mem_ptr = nullptr;
+  if (size == 0) { return; }
+  num_allocations_.fetch_add(1, std::memory_order_relaxed);
+  const bool cacheable = size <= kMaxClassSize;
+  const int32_t cls = cacheable ? Class4Size(size) : -1;
+  const std::size_t aligned_size = cacheable ? Size4Class(cls) : RoundUp(size, kMemAllocAlignSize);
+  if (cacheable && class2num_cached_.at(cls).load(std::memory_order_relaxed) > 0) {
+    const int32_t shard_id = ThisThreadShardId();
+    FOR_RANGE(int32_t, i, 0, kNumShards) {
+      *mem_ptr = TryPopFromShard((shard_id + i) % kNumShards, cls);
+      if (*mem_ptr != nullptr) { break; }
+    }
+    if (*mem_ptr != nullptr) {
+      cached_bytes_.fetch_sub(aligned_size, std::memory_order_relaxed);
+    }
+  }
+  if (*mem_ptr == nullptr) {
+    *mem_ptr = SystemAllocate(aligned_size);
+    if (*mem_ptr == nullptr) {
+      EmptyCache();
+      *mem_ptr = SystemAllocate(aligned_size);
+    }
+    CHECK(*mem_ptr != nullptr);
+  }
+  requested_bytes_.fetch_add(size, std::memory_order_relaxed);
+  const int64_t in_use = in_use_bytes_.fetch_add(aligned_size, std::memory_order_relaxed)
+                         + static_cast<int64_t>(aligned_size);
+  UpdatePeak(&peak_in_use_bytes_, in_use);
+  UpdatePeak(&peak_reserved_bytes_, in_use + cached_bytes_.load(std::memory_order_relaxed));
+}
+
+void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) {
+  if (mem_ptr == nullptr) { return; }
+  const bool cacheable = size <= kMaxClassSize;
+  const int32_t cls = cacheable ? Class4Size(size) : -1;
+  const std::size_t aligned_size = cacheable ? Size4Class(cls) : RoundUp(size, kMemAllocAlignSize);
+  requested_bytes_.fetch_sub(size, std::memory_order_relaxed);
+  in_use_bytes_.fetch_sub(aligned_size, std::memory_order_relaxed);
+  if (cacheable
+      && cached_bytes_.fetch_add(aligned_size, std::memory_order_relaxed) + aligned_size
+             <= max_cached_bytes_) {
+    Shard* shard = &shards_.at(ThisThreadShardId());
+    std::unique_lock<std::mutex> lock(shard->mutex);
+    shard->free_lists.at(cls).push_back(mem_ptr);
+    class2num_cached_.at(cls).fetch_add(1, std::memory_order_relaxed);
+  } else {
+    if (cacheable) { cached_bytes_.fetch_sub(aligned_size, std::memory_order_relaxed); }
+    SystemDeallocate(mem_ptr, aligned_size);
+  }
 }
 
-void CpuAllocator::Deallocate(char* mem_ptr, std::size_t size) { std::free(mem_ptr); }
+void CpuAllocator::EmptyCache() {
+  for (Shard& shard : shards_) {
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    FOR_RANGE(int32_t, cls, 0, kNumClasses) {
+      std::vector<char*>* free_list = &shard.free_lists.at(cls);
+      const std::size_t aligned_size = Size4Class(cls);
+      for (char* mem_ptr : *free_list) { SystemDeallocate(mem_ptr, aligned_size); }
+      cached_bytes_.fetch_sub(aligned_size * free_list->size(), std::memory_order_relaxed);
+      class2num_cached_.at(cls).fetch_sub(free_list->size(), std::memory_order_relaxed);
+      free_list->clear();
+    }
+  }
+}
+
+CpuAllocatorStats CpuAllocator::GetStats() const {
+  CpuAllocatorStats stats;
+  stats.in_use_bytes = in_use_bytes_.load(std::memory_order_relaxed);
+  stats.requested_bytes = requested_bytes_.load(std::memory_order_relaxed);
+  stats.cached_bytes = cached_bytes_.load(std::memory_order_relaxed);
+  stats.peak_in_use_bytes = peak_in_use_bytes_.load(std::memory_order_relaxed);
+  stats.peak_reserved_bytes = peak_reserved_bytes_.load(std::memory_order_relaxed);
+  stats.num_allocations = num_allocations_.load(std::memory_order_relaxed);
+  stats.num_system_allocations = num_system_allocations_.load(std::memory_order_relaxed);
+  return stats;
+}
 
 COMMAND(Global<CpuAllocator>::SetAllocated(new CpuAllocator()));
 
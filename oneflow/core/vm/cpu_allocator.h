@@ -17,18 +17,91 @@ limitations under the License.
 #define ONEFLOW_CORE_VM_CPU_ALLOCATOR_H_
 
 #include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <vector>
 #include "oneflow/core/vm/allocator.h"
+#include "oneflow/core/common/util.h"
 
 namespace oneflow {
 namespace vm {
 
+struct CpuAllocatorStats {
+  // bytes of the size classes handed out and not yet returned
+  int64_t in_use_bytes = 0;
+  // bytes the callers asked for, in_use_bytes minus this is lost to size class rounding
+  int64_t requested_bytes = 0;
+  // bytes returned by the callers and kept for reuse
+  int64_t cached_bytes = 0;
+  int64_t peak_in_use_bytes = 0;
+  // peak of in_use_bytes + cached_bytes, i.e. of the memory taken from the system
+  int64_t peak_reserved_bytes = 0;
+  int64_t num_allocations = 0;
+  // allocations which could not be served from the cache
+  int64_t num_system_allocations = 0;
+};
+
+// CpuAllocator rounds every request up to a size class and caches freed memory per class, so
+// the steady state of an eager job, which frees and allocates blobs of the same sizes for every
+// instruction, does not touch the system allocator at all.
+//
+// Size classes are 64, 128, 192, 256 bytes and then four classes per power of two, like
+//    Class:  0,  1,   2,   3,   4,   5,   6,   7,   8,   9, ...
+//    Size:  64, 128, 192, 256, 320, 384, 448, 512, 640, 768, ...
+// so above 256 bytes no more than a fifth of a block is lost to rounding. Requests larger than
+// kMaxClassSize bypass the cache.
+//
+// Free lists are sharded and each thread sticks to one shard, so threads allocating at the same
+// time rarely wait for each other. A thread whose shard has nothing of the class asked for takes
+// memory from the other shards before it goes to the system. Deallocate() must be given the
+// size passed to Allocate().
 class CpuAllocator final : public Allocator {
  public:
-  explicit CpuAllocator() = default;
-  ~CpuAllocator() override = default;
+  OF_DISALLOW_COPY_AND_MOVE(CpuAllocator);
+  // Reads ONEFLOW_CPU_ALLOCATOR_MAX_CACHED_MB and ONEFLOW_CPU_ALLOCATOR_USE_HUGE_PAGE.
+  CpuAllocator();
+  CpuAllocator(std::size_t max_cached_bytes, bool use_huge_page);
+  ~CpuAllocator() override;
 
   void Allocate(char** mem_ptr, std::size_t size) override;
   void Deallocate(char* mem_ptr, std::size_t size) override;
+
+  // Gives all cached memory back to the system
+  void EmptyCache();
+  CpuAllocatorStats GetStats() const;
+
+  static int32_t Class4Size(std::size_t size);
+  static std::size_t Size4Class(int32_t cls);
+
+  static constexpr std::size_t kMemAllocAlignSize = 64;
+  static constexpr int32_t kNumClasses = 4 + 4 * 20;
+  static constexpr std::size_t kMaxClassSize = 256 << 20;
+  static constexpr std::size_t kHugePageSize = 2 << 20;
+  static constexpr int32_t kNumShards = 16;
+
+ private:
+  struct Shard {
+    std::mutex mutex;
+    std::vector<std::vector<char*>> free_lists;
+  };
+
+  char* SystemAllocate(std::size_t size);
+  void SystemDeallocate(char* mem_ptr, std::size_t size);
+  // Pops a cached block of class cls from shard shard_id, nullptr if there is none
+  char* TryPopFromShard(int32_t shard_id, int32_t cls);
+
+  const std::size_t max_cached_bytes_;
+  const bool use_huge_page_;
+  std::vector<Shard> shards_;
+  std::vector<std::atomic<int64_t>> class2num_cached_;
+
+  std::atomic<int64_t> in_use_bytes_;
+  std::atomic<int64_t> requested_bytes_;
+  std::atomic<int64_t> cached_bytes_;
+  std::atomic<int64_t> peak_in_use_bytes_;
+  std::atomic<int64_t> peak_reserved_bytes_;
+  std::atomic<int64_t> num_allocations_;
+  std::atomic<int64_t> num_system_allocations_;
 };
 
 }  // namespace vm
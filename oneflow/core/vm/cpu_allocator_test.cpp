@@ -0,0 +1,197 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/vm/cpu_allocator.h"
+
+namespace oneflow {
+namespace vm {
+
+namespace test {
+
+namespace {
+
+class MallocAllocator final : public Allocator {
+ public:
+  MallocAllocator() = default;
+  ~MallocAllocator() override = default;
+
+  void Allocate(char** mem_ptr, std::size_t size) override {
+    *mem_ptr = reinterpret_cast<char*>(std::malloc(size));
+  }
+  void Deallocate(char* mem_ptr, std::size_t size) override { std::free(mem_ptr); }
+};
+
+// Blob sizes of the instructions of an eager training step of a small conv net: every
+// instruction allocates its output and the inputs are freed once their last reader ran.
+struct TraceOp {
+  std::size_t out_bytes;
+  std::vector<int32_t> free_after;
+};
+
+std::vector<TraceOp> MakeEagerTrace() {
+  std::vector<TraceOp> trace;
+  const std::vector<std::size_t> feature_bytes = {64 * 56 * 56 * 4, 128 * 28 * 28 * 4,
+                                                  256 * 14 * 14 * 4, 512 * 7 * 7 * 4};
+  std::vector<int32_t> live;
+  for (int32_t stage = 0; stage < 4; ++stage) {
+    for (int32_t layer = 0; layer < 4; ++layer) {
+      // conv, normalization, relu, and a small parameter sized blob for the bn moments
+      for (std::size_t bytes : {feature_bytes.at(stage), feature_bytes.at(stage),
+                                feature_bytes.at(stage), static_cast<std::size_t>(512 * 4)}) {
+        TraceOp op;
+        op.out_bytes = bytes;
+        if (live.size() > 3) {
+          op.free_after.push_back(live.front());
+          live.erase(live.begin());
+        }
+        live.push_back(trace.size());
+        trace.push_back(op);
+      }
+    }
+  }
+  trace.back().free_after.insert(trace.back().free_after.end(), live.begin(), live.end());
+  return trace;
+}
+
+void ReplayTrace(Allocator* allocator, const std::vector<TraceOp>& trace, int32_t iters) {
+  std::vector<char*> ptrs(trace.size());
+  FOR_RANGE(int32_t, iter, 0, iters) {
+    FOR_RANGE(int64_t, i, 0, trace.size()) {
+      allocator->Allocate(&ptrs.at(i), trace.at(i).out_bytes);
+      // touch the first cache line like a kernel writing its output would
+      std::memset(ptrs.at(i), 0, 64);
+      for (int32_t j : trace.at(i).free_after) {
+        allocator->Deallocate(ptrs.at(j), trace.at(j).out_bytes);
+      }
+    }
+  }
+}
+
+double ReplaySeconds(Allocator* allocator, int32_t num_threads, int32_t iters) {
+  const std::vector<TraceOp> trace = MakeEagerTrace();
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  FOR_RANGE(int32_t, i, 0, num_threads) {
+    threads.emplace_back([&]() { ReplayTrace(allocator, trace, iters); });
+  }
+  for (std::thread& thread : threads) { thread.join(); }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}  // namespace
+
+TEST(CpuAllocator, size_class) {
+  ASSERT_EQ(CpuAllocator::Class4Size(1), 0);
+  ASSERT_EQ(CpuAllocator::Class4Size(64), 0);
+  ASSERT_EQ(CpuAllocator::Class4Size(65), 1);
+  ASSERT_EQ(CpuAllocator::Class4Size(256), 3);
+  ASSERT_EQ(CpuAllocator::Class4Size(257), 4);
+  ASSERT_EQ(CpuAllocator::Size4Class(4), 320);
+  ASSERT_EQ(CpuAllocator::Size4Class(CpuAllocator::kNumClasses - 1), CpuAllocator::kMaxClassSize);
+  FOR_RANGE(int32_t, cls, 0, CpuAllocator::kNumClasses) {
+    const std::size_t size = CpuAllocator::Size4Class(cls);
+    ASSERT_EQ(size % CpuAllocator::kMemAllocAlignSize, 0);
+    ASSERT_EQ(CpuAllocator::Class4Size(size), cls);
+    ASSERT_EQ(CpuAllocator::Class4Size(size + 1), cls + 1);
+    // above 256 bytes no more than a fifth of a block is lost to rounding
+    if (cls > 4) { ASSERT_LE((size - CpuAllocator::Size4Class(cls - 1) - 1) * 5, size); }
+  }
+}
+
+TEST(CpuAllocator, reuse_and_stats) {
+  CpuAllocator allocator(16 << 20, false);
+  const std::vector<std::size_t> sizes = {1, 100, 1000, 10000, 100000, 1000000};
+  std::vector<char*> ptrs;
+  for (std::size_t size : sizes) {
+    char* ptr = nullptr;
+    allocator.Allocate(&ptr, size);
+    ASSERT_TRUE(ptr != nullptr);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % CpuAllocator::kMemAllocAlignSize, 0);
+    std::memset(ptr, 1, size);
+    ptrs.push_back(ptr);
+  }
+  CpuAllocatorStats stats = allocator.GetStats();
+  ASSERT_EQ(stats.requested_bytes, 1111101);
+  ASSERT_GE(stats.in_use_bytes, stats.requested_bytes);
+  ASSERT_EQ(stats.cached_bytes, 0);
+  ASSERT_EQ(stats.num_system_allocations, 6);
+  const int64_t peak = stats.in_use_bytes;
+
+  allocator.Deallocate(ptrs.at(3), 10000);
+  char* ptr = nullptr;
+  allocator.Allocate(&ptr, 9000);
+  ASSERT_EQ(ptr, ptrs.at(3));
+  allocator.Deallocate(ptr, 9000);
+  stats = allocator.GetStats();
+  ASSERT_EQ(stats.num_system_allocations, 6);
+  ASSERT_EQ(stats.peak_in_use_bytes, peak);
+  ASSERT_GT(stats.cached_bytes, 0);
+
+  allocator.EmptyCache();
+  ASSERT_EQ(allocator.GetStats().cached_bytes, 0);
+  for (int32_t i : {0, 1, 2, 4, 5}) { allocator.Deallocate(ptrs.at(i), sizes.at(i)); }
+  stats = allocator.GetStats();
+  ASSERT_EQ(stats.in_use_bytes, 0);
+  ASSERT_EQ(stats.requested_bytes, 0);
+  ASSERT_EQ(stats.peak_reserved_bytes, peak);
+}
+
+TEST(CpuAllocator, max_cached_bytes) {
+  CpuAllocator allocator(1 << 20, true);
+  std::vector<char*> ptrs(8);
+  for (char*& ptr : ptrs) { allocator.Allocate(&ptr, 300 << 10); }
+  for (char* ptr : ptrs) { allocator.Deallocate(ptr, 300 << 10); }
+  ASSERT_LE(allocator.GetStats().cached_bytes, 1 << 20);
+  char* huge = nullptr;
+  allocator.Allocate(&huge, CpuAllocator::kMaxClassSize + 1);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(huge) % CpuAllocator::kHugePageSize, 0);
+  allocator.Deallocate(huge, CpuAllocator::kMaxClassSize + 1);
+  ASSERT_EQ(allocator.GetStats().in_use_bytes, 0);
+}
+
+TEST(CpuAllocator, eager_trace) {
+  for (int32_t num_threads : {1, 4}) {
+    CpuAllocator allocator(1 << 30, false);
+    ReplaySeconds(&allocator, num_threads, 1);
+    const int64_t num_system_allocations = allocator.GetStats().num_system_allocations;
+    ReplaySeconds(&allocator, num_threads, 4);
+    const CpuAllocatorStats stats = allocator.GetStats();
+    ASSERT_EQ(stats.in_use_bytes, 0);
+    // a single thread gets every block of later steps from the cache
+    if (num_threads == 1) { ASSERT_EQ(stats.num_system_allocations, num_system_allocations); }
+  }
+}
+
+TEST(CpuAllocator, DISABLED_eager_trace_throughput) {
+  const int32_t iters = 1000;
+  for (int32_t num_threads : {1, 4}) {
+    CpuAllocator allocator(1 << 30, false);
+    MallocAllocator malloc_allocator;
+    const double malloc_sec = ReplaySeconds(&malloc_allocator, num_threads, iters);
+    const double cached_sec = ReplaySeconds(&allocator, num_threads, iters);
+    const CpuAllocatorStats stats = allocator.GetStats();
+    LOG(INFO) << "threads: " << num_threads << ", malloc: " << malloc_sec
+              << " s, CpuAllocator: " << cached_sec << " s, allocations: "
+              << stats.num_allocations << ", system allocations: "
+              << stats.num_system_allocations << ", peak in use: " << stats.peak_in_use_bytes
+              << ", peak reserved: " << stats.peak_reserved_bytes;
+  }
+}
+
+}  // namespace test
+
+}  // namespace vm
+}  // namespace oneflow
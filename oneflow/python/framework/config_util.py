@@ -118,6 +118,43 @@ def comm_net_worker_num(val):
     sess.config_proto.resource.comm_net_worker_num = val
 
 
+@oneflow_export("config.comm_net_enable_zero_copy")
+def api_comm_net_enable_zero_copy(val: bool) -> None:
+    r"""Whether or not send large payloads of epoll mode network with MSG_ZEROCOPY.
+            It only takes effect when the kernel supports SO_ZEROCOPY.
+
+    Args:
+        val (bool):  True or False
+    """
+    return enable_if.unique([comm_net_enable_zero_copy, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def comm_net_enable_zero_copy(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.resource.comm_net_enable_zero_copy = val
+
+
+@oneflow_export("config.comm_net_socket_num_per_peer")
+def api_comm_net_socket_num_per_peer(val: int) -> None:
+    r"""Set up the number of sockets between every two machines in epoll mode network,
+            large register transfers are striped across them.
+
+    Args:
+        val (int): number of sockets
+    """
+    return enable_if.unique([comm_net_socket_num_per_peer, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def comm_net_socket_num_per_peer(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    assert val > 0
+    sess.config_proto.resource.comm_net_socket_num_per_peer = val
+
+
 @oneflow_export("config.max_mdsave_worker_num")
 def api_max_mdsave_worker_num(val: int) -> None:
     r"""Set up max number of workers for mdsave process.
@@ -169,6 +206,23 @@ def compute_thread_pool_size(val):
     sess.config_proto.resource.compute_thread_pool_size = val
 
 
+@oneflow_export("config.persistence_thread_pool_size")
+def api_persistence_thread_pool_size(val: int) -> None:
+    r"""Set up the size of the thread pool for file system reads and writes
+
+    Args:
+        val (int): size of thread pool
+    """
+    return enable_if.unique([persistence_thread_pool_size, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def persistence_thread_pool_size(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.resource.persistence_thread_pool_size = val
+
+
 @oneflow_export("config.rdma_mem_block_mbyte")
 def api_rdma_mem_block_mbyte(val: int) -> None:
     r"""Set up the memory block size in rdma mode.
@@ -323,6 +377,42 @@ def persistence_buf_byte(val):
     sess.config_proto.io_conf.persistence_buf_byte = val
 
 
+@oneflow_export("config.persistence_enable_mmap")
+def api_persistence_enable_mmap(val: bool) -> None:
+    r"""Whether or not read local files of persistence by memory mapping instead of
+            copying them through a buffer.
+
+    Args:
+        val (bool):  True or False
+    """
+    return enable_if.unique([persistence_enable_mmap, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def persistence_enable_mmap(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is bool
+    sess.config_proto.io_conf.persistence_enable_mmap = val
+
+
+@oneflow_export("config.persistence_prefetch_depth")
+def api_persistence_prefetch_depth(val: int) -> None:
+    r"""Number of buffers of persistence to read ahead asynchronously for each file.
+            Each buffer is persistence_buf_byte large, 0 disables prefetching.
+
+    Args:
+        val (int): depth of prefetching
+    """
+    return enable_if.unique([persistence_prefetch_depth, do_nothing])(val)
+
+
+@enable_if.condition(hob.in_normal_mode & ~hob.session_initialized)
+def persistence_prefetch_depth(val):
+    sess = session_ctx.GetDefaultSession()
+    assert type(val) is int
+    sess.config_proto.io_conf.persistence_prefetch_depth = val
+
+
 @oneflow_export("config.enable_model_io_v2")
 def api_enable_model_io_v2(val):
     r"""Whether or not use version2  of model input/output function.
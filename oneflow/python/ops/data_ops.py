@@ -288,6 +288,11 @@ def ofrecord_reader(
     random_shuffle: bool = False,
     shuffle_buffer_size: int = 1024,
     shuffle_after_epoch: bool = False,
+    use_index: bool = False,
+    num_read_workers: int = 1,
+    read_queue_depth: int = 64,
+    read_keep_order: bool = True,
+    resume_record_num: int = 0,
     name: Optional[str] = None,
 ) -> remote_blob_util.BlobDef:
     r"""Get ofrecord object from ofrecord dataset.
@@ -301,6 +306,11 @@ def ofrecord_reader(
         random_shuffle (bool, optional): Determines records shuffled or not. Defaults to False.
         shuffle_buffer_size (int, optional): Shuffle buffer size. Defaults to 1024.
         shuffle_after_epoch (bool, optional): Shuffled or not after each epoch. Defaults to False.
+        use_index (bool, optional): Read records through the index of every part file ("part-0.index" for "part-0", scanned from the part file when missing), so records are sharded across any number of ranks and shuffled globally. Defaults to False.
+        num_read_workers (int, optional): Number of threads reading records when use_index is True. Defaults to 1.
+        read_queue_depth (int, optional): Maximum number of records read ahead by the reading threads. Defaults to 64.
+        read_keep_order (bool, optional): Whether records read by several threads keep their order. Defaults to True.
+        resume_record_num (int, optional): Number of records each rank had read before the checkpoint being resumed, e.g. the trained iterations times the local batch size. They are skipped without being read. Requires use_index. Defaults to 0.
         name (Optional[str], optional): Optional name. Defaults to None.
         
     Returns:
@@ -364,6 +374,11 @@ def ofrecord_reader(
         .Attr("shuffle_buffer_size", shuffle_buffer_size)
         .Attr("shuffle_after_epoch", shuffle_after_epoch)
         .Attr("part_name_suffix_length", part_name_suffix_length)
+        .Attr("use_index", use_index)
+        .Attr("num_read_workers", num_read_workers)
+        .Attr("read_queue_depth", read_queue_depth)
+        .Attr("read_keep_order", read_keep_order)
+        .Attr("resume_record_num", resume_record_num)
         .Build()
         .InferAndTryRun()
         .RemoteBlobList()[0]
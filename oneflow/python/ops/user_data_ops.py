@@ -2108,6 +2108,9 @@ def api_coco_reader(
     random_seed: Optional[int] = None,
     group_by_aspect_ratio: bool = True,
     stride_partition: bool = True,
+    num_read_workers: int = 1,
+    read_queue_depth: int = 64,
+    read_keep_order: bool = True,
     name: str = None,
 ) -> BlobDef:
     assert name is not None
@@ -2121,6 +2124,9 @@ def api_coco_reader(
             random_seed=random_seed,
             group_by_aspect_ratio=group_by_aspect_ratio,
             stride_partition=stride_partition,
+            num_read_workers=num_read_workers,
+            read_queue_depth=read_queue_depth,
+            read_keep_order=read_keep_order,
             name=name,
         ),
     )
@@ -2137,6 +2143,9 @@ class COCOReader(module_util.Module):
         random_seed: Optional[int] = None,
         group_by_aspect_ratio: bool = True,
         stride_partition: bool = True,
+        num_read_workers: int = 1,
+        read_queue_depth: int = 64,
+        read_keep_order: bool = True,
         name: str = None,
     ):
         assert name is not None
@@ -2159,6 +2168,9 @@ class COCOReader(module_util.Module):
             .Attr("random_seed", random_seed)
             .Attr("group_by_ratio", group_by_aspect_ratio)
             .Attr("stride_partition", stride_partition)
+            .Attr("num_read_workers", num_read_workers)
+            .Attr("read_queue_depth", read_queue_depth)
+            .Attr("read_keep_order", read_keep_order)
             .CheckAndComplete()
         )
         self.op_module_builder.user_op_module.InitOpKernel()
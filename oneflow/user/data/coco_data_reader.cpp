@@ -33,7 +33,9 @@ COCODataReader::COCODataReader(user_op::KernelInitContext* ctx) : DataReader<COC
   loader_.reset(new DistributedTrainingDataset<COCOImage>(
       ctx->parallel_ctx().parallel_num(), ctx->parallel_ctx().parallel_id(),
       ctx->Attr<bool>("stride_partition"), ctx->Attr<bool>("shuffle_after_epoch"),
-      ctx->Attr<int64_t>("random_seed"), std::move(coco_dataset_ptr)));
+      ctx->Attr<int64_t>("random_seed"), std::move(coco_dataset_ptr),
+      ctx->Attr<int32_t>("num_read_workers"), ctx->Attr<int32_t>("read_queue_depth"),
+      ctx->Attr<bool>("read_keep_order"), 0));
 
   size_t batch_size = ctx->TensorDesc4ArgNameAndIndex("image", 0)->shape().elem_cnt();
   if (ctx->Attr<bool>("group_by_ratio")) {
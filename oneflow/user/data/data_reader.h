@@ -16,10 +16,10 @@ limitations under the License.
 #ifndef ONEFLOW_USER_DATA_DATA_READER_H_
 #define ONEFLOW_USER_DATA_DATA_READER_H_
 
-#include "oneflow/core/common/buffer.h"
 #include "oneflow/core/framework/op_kernel.h"
 #include "oneflow/user/data/dataset.h"
 #include "oneflow/user/data/parser.h"
+#include "oneflow/user/data/pipeline_stage.h"
 
 namespace oneflow {
 namespace data {
@@ -31,58 +31,54 @@ class DataReader {
  public:
   using LoadTargetPtr = std::shared_ptr<LoadTarget>;
   using LoadTargetPtrList = std::vector<LoadTargetPtr>;
-  DataReader(user_op::KernelInitContext* ctx)
-      : is_closed_(false), batch_buffer_(kDataReaderBatchBufferSize) {}
+  using BatchPtr = std::shared_ptr<LoadTargetPtrList>;
+  DataReader(user_op::KernelInitContext* ctx) : DataReader(ctx, kDataReaderBatchBufferSize) {}
+  DataReader(user_op::KernelInitContext* ctx, int32_t batch_queue_depth)
+      : name_(ctx->user_op_conf().op_name()), batch_queue_depth_(batch_queue_depth) {}
   virtual ~DataReader() {
-    Close();
-    if (load_thrd_.joinable()) { load_thrd_.join(); }
+    // the batching worker uses loader_, stop it first
+    batch_stage_.reset();
   }
 
   void Read(user_op::KernelComputeContext* ctx) {
-    CHECK(load_thrd_.joinable()) << "You should call StartLoadThread before read data";
+    CHECK(batch_stage_) << "You should call StartLoadThread before read data";
     auto batch_data = FetchBatchData();
     parser_->Parse(batch_data, ctx);
   }
 
   void Close() {
-    is_closed_.store(true);
-    bool buffer_drained = false;
-    while (!buffer_drained) {
-      std::shared_ptr<LoadTargetPtrList> abandoned_batch_data(nullptr);
-      auto status = batch_buffer_.TryReceive(&abandoned_batch_data);
-      CHECK_NE(status, BufferStatus::kBufferStatusErrorClosed);
-      buffer_drained = (status == BufferStatus::kBufferStatusEmpty);
-    }
-    batch_buffer_.Close();
+    if (batch_stage_) { batch_stage_->Close(); }
   }
 
  protected:
+  // batches are assembled by loader_ on a worker of the last pipeline stage, parsing stays on
+  // the calling thread because it writes the outputs of the kernel
   void StartLoadThread() {
-    if (load_thrd_.joinable()) { return; }
-    load_thrd_ = std::thread([this] {
-      while (!is_closed_.load() && LoadBatch()) {}
-    });
+    if (batch_stage_) { return; }
+    batch_stage_.reset(new PipelineStage<LoadTargetPtrList, BatchPtr>(
+        name_ + "-batch", 1, batch_queue_depth_, true,
+        [this](LoadTargetPtrList* batch) {
+          *batch = loader_->Next();
+          return true;
+        },
+        [](LoadTargetPtrList&& batch) {
+          return std::make_shared<LoadTargetPtrList>(std::move(batch));
+        }));
   }
 
   std::unique_ptr<Dataset<LoadTarget>> loader_;
   std::unique_ptr<Parser<LoadTarget>> parser_;
 
  private:
-  std::shared_ptr<LoadTargetPtrList> FetchBatchData() {
-    std::shared_ptr<LoadTargetPtrList> batch_data(nullptr);
-    CHECK_EQ(batch_buffer_.Receive(&batch_data), BufferStatus::kBufferStatusSuccess);
+  BatchPtr FetchBatchData() {
+    BatchPtr batch_data(nullptr);
+    CHECK(batch_stage_->Receive(&batch_data));
     return batch_data;
   }
 
-  bool LoadBatch() {
-    std::shared_ptr<LoadTargetPtrList> batch_data =
-        std::make_shared<LoadTargetPtrList>(std::move(loader_->Next()));
-    return batch_buffer_.Send(batch_data) == BufferStatus::kBufferStatusSuccess;
-  }
-
-  std::atomic<bool> is_closed_;
-  Buffer<std::shared_ptr<LoadTargetPtrList>> batch_buffer_;
-  std::thread load_thrd_;
+  const std::string name_;
+  const int32_t batch_queue_depth_;
+  std::unique_ptr<PipelineStage<LoadTargetPtrList, BatchPtr>> batch_stage_;
 };
 
 }  // namespace data
@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_USER_DATA_DISTRIBUTED_TRAINING_DATASET_H_
 
 #include "oneflow/user/data/dataset.h"
+#include "oneflow/user/data/pipeline_stage.h"
 
 namespace oneflow {
 namespace data {
@@ -31,6 +32,15 @@ class DistributedTrainingDataset final : public Dataset<LoadTarget> {
 
   DistributedTrainingDataset(int64_t parallel_num, int64_t parallel_id, bool stride_partition,
                              bool shuffle, int64_t random_seed, BaseDatasetUnqPtr&& dataset)
+      : DistributedTrainingDataset(parallel_num, parallel_id, stride_partition, shuffle,
+                                   random_seed, std::move(dataset), 1, 1, true, 0) {}
+  // samples are read by num_read_workers threads at most read_queue_depth ahead. The first
+  // skip_num samples of this shard are skipped without reading them, to resume where a previous
+  // run stopped.
+  DistributedTrainingDataset(int64_t parallel_num, int64_t parallel_id, bool stride_partition,
+                             bool shuffle, int64_t random_seed, BaseDatasetUnqPtr&& dataset,
+                             int32_t num_read_workers, int32_t read_queue_depth,
+                             bool read_keep_order, int64_t skip_num)
       : base_dataset_(std::move(dataset)),
         shuffle_(shuffle),
         stride_partition_(stride_partition),
@@ -48,10 +58,30 @@ class DistributedTrainingDataset final : public Dataset<LoadTarget> {
     index_seq_.resize(base_dataset_->Size());
     std::iota(index_seq_.begin(), index_seq_.end(), 0);
     GenNewIndexSequence();
+    SkipIndices(skip_num);
+    if (num_read_workers > 1) {
+      read_stage_.reset(new PipelineStage<int64_t, LoadTargetShdPtrVec>(
+          "read", num_read_workers, read_queue_depth, read_keep_order,
+          [this](int64_t* index) {
+            *index = NextIndex();
+            return true;
+          },
+          [this](int64_t&& index) { return base_dataset_->At(index); }));
+    }
   }
-  virtual ~DistributedTrainingDataset() = default;
+  virtual ~DistributedTrainingDataset() { read_stage_.reset(); }
 
   virtual LoadTargetShdPtrVec Next() override {
+    if (read_stage_) {
+      LoadTargetShdPtrVec ret;
+      CHECK(read_stage_->Receive(&ret));
+      return ret;
+    }
+    return base_dataset_->At(NextIndex());
+  }
+
+ private:
+  int64_t NextIndex() {
     // There are 2 partition strategies
     // assume epoch size is 10, index seq don't shuffle and there are 4 parts
     // stride partition strategy (when stride_partition is true):
@@ -62,7 +92,7 @@ class DistributedTrainingDataset final : public Dataset<LoadTarget> {
     //       |  part1   |  part2   |  part3   |  part4   |
     // iter0 | 0, 1, 2, | 3, 4, 5, | 6, 7, 8, | 9, 0, 1, |
     // iter1 | 2, 3, 4, | 5, 6, 7, | 8, 9, 0, | 1, 2, 3, |
-    LoadTargetShdPtrVec ret = base_dataset_->At(index_seq_.at(pos_));
+    const int64_t index = index_seq_.at(pos_);
     if (stride_partition_) {
       pos_ += num_shards_;
     } else {
@@ -74,10 +104,38 @@ class DistributedTrainingDataset final : public Dataset<LoadTarget> {
       }
     }
     CheckRanOutOfSize();
-    return ret;
+    return index;
+  }
+
+  // moves to where num NextIndex() calls would, one step per run of calls between wraps in the
+  // stride strategy and per rest of a shard in the contiguous one
+  void SkipIndices(int64_t num) {
+    CHECK_GE(num, 0);
+    const int64_t size = index_seq_.size();
+    while (num > 0) {
+      if (stride_partition_) {
+        const int64_t calls_to_wrap = (size - pos_ + num_shards_ - 1) / num_shards_;
+        const int64_t calls = std::min(num, calls_to_wrap);
+        pos_ += calls * num_shards_;
+        num -= calls;
+      } else {
+        const int64_t calls = std::min(num, shard_size_ - pos_in_shard_);
+        // all but the call finishing the shard advance by one, which wraps at most once
+        pos_ += calls - 1;
+        pos_in_shard_ += calls - 1;
+        CheckRanOutOfSize();
+        pos_ += 1;
+        pos_in_shard_ += 1;
+        if (pos_in_shard_ == shard_size_) {
+          pos_ += (num_shards_ - 1) * shard_size_;
+          pos_in_shard_ = 0;
+        }
+        num -= calls;
+      }
+      CheckRanOutOfSize();
+    }
   }
 
- private:
   void CheckRanOutOfSize() {
     if (pos_ >= index_seq_.size()) {
       GenNewIndexSequence();
@@ -103,6 +161,7 @@ class DistributedTrainingDataset final : public Dataset<LoadTarget> {
   int64_t pos_in_shard_;
   int64_t epoch_cnt_;
   std::vector<int64_t> index_seq_;
+  std::unique_ptr<PipelineStage<int64_t, LoadTargetShdPtrVec>> read_stage_;
 };
 
 }  // namespace data
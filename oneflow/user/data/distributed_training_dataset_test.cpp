@@ -0,0 +1,68 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/distributed_training_dataset.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+// samples are their own indices
+class IndexDataset final : public RandomAccessDataset<int64_t> {
+ public:
+  explicit IndexDataset(size_t size) : size_(size) {}
+  LoadTargetShdPtrVec At(int64_t index) const override {
+    return LoadTargetShdPtrVec{std::make_shared<int64_t>(index)};
+  }
+  size_t Size() const override { return size_; }
+
+ private:
+  size_t size_;
+};
+
+void CheckSkip(int64_t size, int64_t parallel_num, bool stride_partition, bool shuffle,
+               int64_t skip_num) {
+  FOR_RANGE(int64_t, parallel_id, 0, parallel_num) {
+    DistributedTrainingDataset<int64_t> read(
+        parallel_num, parallel_id, stride_partition, shuffle, 7,
+        std::unique_ptr<RandomAccessDataset<int64_t>>(new IndexDataset(size)));
+    DistributedTrainingDataset<int64_t> skipped(
+        parallel_num, parallel_id, stride_partition, shuffle, 7,
+        std::unique_ptr<RandomAccessDataset<int64_t>>(new IndexDataset(size)), 1, 1, true,
+        skip_num);
+    FOR_RANGE(int64_t, i, 0, skip_num) { read.Next(); }
+    FOR_RANGE(int64_t, i, 0, 3 * size) { ASSERT_EQ(*read.Next().at(0), *skipped.Next().at(0)); }
+  }
+}
+
+}  // namespace
+
+TEST(DistributedTrainingDataset, skip) {
+  for (const bool stride_partition : {true, false}) {
+    for (const bool shuffle : {true, false}) {
+      for (const int64_t skip_num : {0, 1, 2, 9, 10, 11, 57, 1000}) {
+        CheckSkip(10, 1, stride_partition, shuffle, skip_num);
+        CheckSkip(10, 4, stride_partition, shuffle, skip_num);
+        CheckSkip(7, 4, stride_partition, shuffle, skip_num);
+        CheckSkip(9, 5, stride_partition, shuffle, skip_num);
+        CheckSkip(97, 8, stride_partition, shuffle, skip_num);
+      }
+    }
+  }
+}
+
+}  // namespace data
+}  // namespace oneflow
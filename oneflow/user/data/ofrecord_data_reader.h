@@ -18,6 +18,8 @@ limitations under the License.
 
 #include "oneflow/user/data/data_reader.h"
 #include "oneflow/user/data/ofrecord_dataset.h"
+#include "oneflow/user/data/ofrecord_indexed_dataset.h"
+#include "oneflow/user/data/distributed_training_dataset.h"
 #include "oneflow/user/data/ofrecord_parser.h"
 #include "oneflow/user/data/random_shuffle_dataset.h"
 #include "oneflow/user/data/batch_dataset.h"
@@ -29,11 +31,28 @@ namespace data {
 class OFRecordDataReader final : public DataReader<TensorBuffer> {
  public:
   OFRecordDataReader(user_op::KernelInitContext* ctx) : DataReader<TensorBuffer>(ctx) {
-    loader_.reset(new OFRecordDataset(ctx));
-    parser_.reset(new OFRecordParser());
-    if (ctx->Attr<bool>("random_shuffle")) {
-      loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
+    if (ctx->Attr<bool>("use_index")) {
+      // records are sharded across ranks and shuffled globally by seeking through the index
+      std::unique_ptr<RandomAccessDataset<TensorBuffer>> indexed_dataset(
+          new OFRecordIndexedDataset(ctx));
+      const bool shuffle =
+          ctx->Attr<bool>("random_shuffle") || ctx->Attr<bool>("shuffle_after_epoch");
+      // all ranks must draw the same permutation
+      int64_t seed = ctx->Attr<int64_t>("seed");
+      if (seed == -1) { seed = kOneflowDatasetSeed; }
+      loader_.reset(new DistributedTrainingDataset<TensorBuffer>(
+          ctx->parallel_ctx().parallel_num(), ctx->parallel_ctx().parallel_id(), false, shuffle,
+          seed, std::move(indexed_dataset), ctx->Attr<int32_t>("num_read_workers"),
+          ctx->Attr<int32_t>("read_queue_depth"), ctx->Attr<bool>("read_keep_order"),
+          ctx->Attr<int64_t>("resume_record_num")));
+    } else {
+      CHECK_EQ(ctx->Attr<int64_t>("resume_record_num"), 0) << "resuming requires use_index";
+      loader_.reset(new OFRecordDataset(ctx));
+      if (ctx->Attr<bool>("random_shuffle")) {
+        loader_.reset(new RandomShuffleDataset<TensorBuffer>(ctx, std::move(loader_)));
+      }
     }
+    parser_.reset(new OFRecordParser());
     int32_t batch_size = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape().elem_cnt();
     loader_.reset(new BatchDataset<TensorBuffer>(batch_size, std::move(loader_)));
     StartLoadThread();
@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_OFRECORD_INDEXED_DATASET_H_
+#define ONEFLOW_USER_DATA_OFRECORD_INDEXED_DATASET_H_
+
+#include "oneflow/user/data/dataset.h"
+#include "oneflow/core/common/str_util.h"
+#include "oneflow/core/framework/op_kernel.h"
+#include "oneflow/core/persistence/persistence_thread_pool.h"
+#include "oneflow/core/record/ofrecord_index.h"
+#include "oneflow/core/job/job_set.pb.h"
+
+namespace oneflow {
+namespace data {
+
+// Random access to the records of all the part files through their OFRecordIndex, so records
+// rather than whole part files can be sharded and shuffled.
+class OFRecordIndexedDataset final : public RandomAccessDataset<TensorBuffer> {
+ public:
+  using LoadTargetShdPtr = std::shared_ptr<TensorBuffer>;
+  using LoadTargetShdPtrVec = std::vector<LoadTargetShdPtr>;
+  OF_DISALLOW_COPY_AND_MOVE(OFRecordIndexedDataset);
+  OFRecordIndexedDataset(user_op::KernelInitContext* ctx) {
+    const int32_t data_part_num = ctx->Attr<int32_t>("data_part_num");
+    const std::string data_dir = ctx->Attr<std::string>("data_dir");
+    const std::string part_name_prefix = ctx->Attr<std::string>("part_name_prefix");
+    const int32_t part_name_suffix_length = ctx->Attr<int32_t>("part_name_suffix_length");
+    std::vector<std::string> data_file_paths;
+    for (int i = 0; i < data_part_num; ++i) {
+      std::string num = std::to_string(i);
+      int32_t zero_count =
+          std::max(part_name_suffix_length - static_cast<int32_t>(num.length()), 0);
+      data_file_paths.push_back(
+          JoinPath(data_dir, part_name_prefix + std::string(zero_count, '0') + num));
+    }
+    files_.resize(data_part_num);
+    indexes_.resize(data_part_num);
+    PersistenceThreadPool()->ParallelFor(0, data_part_num, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        DataFS()->NewRandomAccessFile(data_file_paths.at(i), &files_.at(i));
+        indexes_.at(i).reset(new OFRecordIndex(DataFS(), data_file_paths.at(i)));
+      }
+    });
+    part_record_offsets_.push_back(0);
+    for (const auto& index : indexes_) {
+      part_record_offsets_.push_back(part_record_offsets_.back() + index->record_num());
+    }
+    CHECK_GT(Size(), 0);
+  }
+  ~OFRecordIndexedDataset() = default;
+
+  LoadTargetShdPtrVec At(int64_t index) const override {
+    CHECK_LT(index, Size());
+    const int64_t part_id = std::upper_bound(part_record_offsets_.cbegin(),
+                                             part_record_offsets_.cend(), index)
+                            - part_record_offsets_.cbegin() - 1;
+    const OFRecordIndex* part_index = indexes_.at(part_id).get();
+    const int64_t record_id = index - part_record_offsets_.at(part_id);
+    const int64_t size = part_index->payload_size(record_id);
+    CHECK_GE(size, 0);
+    LoadTargetShdPtr sample(new TensorBuffer());
+    sample->Resize(Shape({size}), DataType::kChar);
+    if (size > 0) {
+      files_.at(part_id)->Read(part_index->payload_offset(record_id), size,
+                               sample->mut_data<char>());
+    }
+    LoadTargetShdPtrVec ret;
+    ret.push_back(std::move(sample));
+    return ret;
+  }
+
+  size_t Size() const override { return part_record_offsets_.back(); }
+
+ private:
+  std::vector<std::unique_ptr<fs::RandomAccessFile>> files_;
+  std::vector<std::unique_ptr<OFRecordIndex>> indexes_;
+  // global index of the first record of every part, followed by the total record number
+  std::vector<int64_t> part_record_offsets_;
+};
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_OFRECORD_INDEXED_DATASET_H_
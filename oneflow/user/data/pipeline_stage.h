@@ -0,0 +1,207 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_DATA_PIPELINE_STAGE_H_
+#define ONEFLOW_USER_DATA_PIPELINE_STAGE_H_
+
+#include "oneflow/core/common/util.h"
+#include <map>
+
+namespace oneflow {
+namespace data {
+
+struct PipelineStageStat {
+  int64_t item_cnt;
+  double items_per_sec;
+  // fraction of the workers' time spent in Map
+  double worker_busy_ratio;
+  // finished items waiting for the consumer, averaged over Receive calls
+  double avg_queue_occupancy;
+};
+
+// One stage of a data reading pipeline. Items are pulled from Source one at a time under a lock,
+// so Source needs not be thread safe, and transformed by Map on num_workers threads. At most
+// queue_depth finished items wait for the consumer. With keep_order the items are received in
+// the order Source produced them, otherwise the finished item produced earliest goes first.
+template<typename In, typename Out>
+class PipelineStage final {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(PipelineStage);
+  PipelineStage(const std::string& name, int32_t num_workers, int32_t queue_depth,
+                bool keep_order, const std::function<bool(In*)>& Source,
+                const std::function<Out(In&&)>& Map);
+  ~PipelineStage();
+
+  // returns false once the stage is closed, or when Source is exhausted and all is received
+  bool Receive(Out* out);
+  void Close();
+  PipelineStageStat GetStat() const;
+
+ private:
+  void WorkerLoop();
+  bool HasRoom(int64_t seq) const;
+  bool HasReady() const;
+
+  const std::string name_;
+  const int32_t queue_depth_;
+  const bool keep_order_;
+  std::function<bool(In*)> Source_;
+  std::function<Out(In&&)> Map_;
+
+  std::mutex source_mutex_;
+  int64_t next_source_seq_;
+  bool is_source_exhausted_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  // finished items keyed by the order Source produced them
+  std::map<int64_t, Out> ready_items_;
+  int64_t next_receive_seq_;
+  int32_t alive_worker_num_;
+  std::atomic<bool> is_closed_;
+  std::vector<std::thread> workers_;
+
+  const std::chrono::steady_clock::time_point start_time_;
+  std::atomic<int64_t> map_ns_;
+  int64_t received_cnt_;
+  int64_t occupancy_sum_;
+};
+
+template<typename In, typename Out>
+PipelineStage<In, Out>::PipelineStage(const std::string& name, int32_t num_workers,
+                                      int32_t queue_depth, bool keep_order,
+                                      const std::function<bool(In*)>& Source,
+                                      const std::function<Out(In&&)>& Map)
+    : name_(name),
+      queue_depth_(queue_depth),
+      keep_order_(keep_order),
+      Source_(Source),
+      Map_(Map),
+      next_source_seq_(0),
+      is_source_exhausted_(false),
+      next_receive_seq_(0),
+      alive_worker_num_(num_workers),
+      is_closed_(false),
+      start_time_(std::chrono::steady_clock::now()),
+      map_ns_(0),
+      received_cnt_(0),
+      occupancy_sum_(0) {
+  CHECK_GT(num_workers, 0);
+  CHECK_GT(queue_depth, 0);
+  FOR_RANGE(int32_t, i, 0, num_workers) { workers_.emplace_back([this]() { WorkerLoop(); }); }
+}
+
+template<typename In, typename Out>
+PipelineStage<In, Out>::~PipelineStage() {
+  Close();
+  for (std::thread& worker : workers_) { worker.join(); }
+  const PipelineStageStat stat = GetStat();
+  LOG(INFO) << "data pipeline stage " << name_ << ": " << stat.item_cnt << " items, "
+            << stat.items_per_sec << " items/sec, workers busy " << stat.worker_busy_ratio * 100
+            << "%, queue occupancy " << stat.avg_queue_occupancy << "/" << queue_depth_;
+}
+
+template<typename In, typename Out>
+bool PipelineStage<In, Out>::HasRoom(int64_t seq) const {
+  // in order mode the item the consumer waits for always fits, so workers never deadlock
+  if (keep_order_) { return seq < next_receive_seq_ + queue_depth_; }
+  return ready_items_.size() < queue_depth_;
+}
+
+template<typename In, typename Out>
+bool PipelineStage<In, Out>::HasReady() const {
+  if (keep_order_) { return ready_items_.find(next_receive_seq_) != ready_items_.end(); }
+  return !ready_items_.empty();
+}
+
+template<typename In, typename Out>
+void PipelineStage<In, Out>::WorkerLoop() {
+  while (!is_closed_.load()) {
+    In in;
+    int64_t seq = -1;
+    {
+      std::unique_lock<std::mutex> lock(source_mutex_);
+      if (is_source_exhausted_ || is_closed_.load()) { break; }
+      if (!Source_(&in)) {
+        is_source_exhausted_ = true;
+        break;
+      }
+      seq = next_source_seq_++;
+    }
+    const auto map_start = std::chrono::steady_clock::now();
+    Out out = Map_(std::move(in));
+    map_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - map_start)
+                   .count();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [&]() { return is_closed_.load() || HasRoom(seq); });
+      if (is_closed_.load()) { break; }
+      ready_items_.emplace(seq, std::move(out));
+    }
+    cond_.notify_all();
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    alive_worker_num_ -= 1;
+  }
+  cond_.notify_all();
+}
+
+template<typename In, typename Out>
+bool PipelineStage<In, Out>::Receive(Out* out) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock,
+               [this]() { return is_closed_.load() || HasReady() || alive_worker_num_ == 0; });
+    if (is_closed_.load() || !HasReady()) { return false; }
+    occupancy_sum_ += ready_items_.size();
+    received_cnt_ += 1;
+    auto it = keep_order_ ? ready_items_.find(next_receive_seq_) : ready_items_.begin();
+    *out = std::move(it->second);
+    ready_items_.erase(it);
+    if (keep_order_) { next_receive_seq_ += 1; }
+  }
+  cond_.notify_all();
+  return true;
+}
+
+template<typename In, typename Out>
+void PipelineStage<In, Out>::Close() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_closed_.store(true);
+  }
+  cond_.notify_all();
+}
+
+template<typename In, typename Out>
+PipelineStageStat PipelineStage<In, Out>::GetStat() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const double elapsed_sec =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count();
+  PipelineStageStat stat;
+  stat.item_cnt = received_cnt_;
+  stat.items_per_sec = received_cnt_ / elapsed_sec;
+  stat.worker_busy_ratio = map_ns_.load() / 1e9 / (elapsed_sec * workers_.size());
+  stat.avg_queue_occupancy =
+      received_cnt_ > 0 ? static_cast<double>(occupancy_sum_) / received_cnt_ : 0;
+  return stat;
+}
+
+}  // namespace data
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_DATA_PIPELINE_STAGE_H_
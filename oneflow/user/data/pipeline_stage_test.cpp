@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/data/pipeline_stage.h"
+
+namespace oneflow {
+namespace data {
+
+namespace {
+
+std::function<bool(int64_t*)> MakeRangeSource(int64_t num) {
+  std::shared_ptr<int64_t> next(new int64_t(0));
+  return [next, num](int64_t* item) {
+    if (*next >= num) { return false; }
+    *item = (*next)++;
+    return true;
+  };
+}
+
+int64_t Square(int64_t&& x) {
+  // uneven work so that workers finish out of order
+  if (x % 7 == 0) { std::this_thread::sleep_for(std::chrono::microseconds(100)); }
+  return x * x;
+}
+
+double ItemsPerSecond(int32_t num_workers, int64_t item_num) {
+  PipelineStage<int64_t, int64_t> stage(
+      "bench", num_workers, 16, true, MakeRangeSource(item_num), [](int64_t&& x) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        return x;
+      });
+  int64_t out = -1;
+  int64_t cnt = 0;
+  while (stage.Receive(&out)) { ++cnt; }
+  CHECK_EQ(cnt, item_num);
+  return stage.GetStat().items_per_sec;
+}
+
+}  // namespace
+
+TEST(PipelineStage, keep_order) {
+  const int64_t num = 2000;
+  PipelineStage<int64_t, int64_t> stage("test", 8, 4, true, MakeRangeSource(num), Square);
+  int64_t out = -1;
+  FOR_RANGE(int64_t, i, 0, num) {
+    ASSERT_TRUE(stage.Receive(&out));
+    ASSERT_EQ(out, i * i);
+  }
+  ASSERT_FALSE(stage.Receive(&out));
+}
+
+TEST(PipelineStage, out_of_order) {
+  const int64_t num = 2000;
+  PipelineStage<int64_t, int64_t> stage("test", 8, 4, false, MakeRangeSource(num), Square);
+  std::vector<int64_t> visit(num, 0);
+  int64_t out = -1;
+  while (stage.Receive(&out)) {
+    const int64_t root = static_cast<int64_t>(std::sqrt(static_cast<double>(out)) + 0.5);
+    ASSERT_EQ(root * root, out);
+    ++visit.at(root);
+  }
+  for (int64_t cnt : visit) { ASSERT_EQ(cnt, 1); }
+  ASSERT_EQ(stage.GetStat().item_cnt, num);
+}
+
+TEST(PipelineStage, close_unblocks_workers_and_consumer) {
+  std::unique_ptr<PipelineStage<int64_t, int64_t>> stage(new PipelineStage<int64_t, int64_t>(
+      "test", 4, 2, true, MakeRangeSource(std::numeric_limits<int64_t>::max()), Square));
+  int64_t out = -1;
+  ASSERT_TRUE(stage->Receive(&out));
+  stage->Close();
+  ASSERT_FALSE(stage->Receive(&out));
+  stage.reset();
+}
+
+TEST(PipelineStage, DISABLED_throughput_vs_workers) {
+  const int64_t item_num = 2000;
+  for (int32_t num_workers : {1, 2, 4, 8}) {
+    LOG(INFO) << "workers: " << num_workers << ", " << ItemsPerSecond(num_workers, item_num)
+              << " items/sec";
+  }
+}
+
+}  // namespace data
+}  // namespace oneflow
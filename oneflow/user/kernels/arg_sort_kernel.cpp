@@ -14,7 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
-#include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/user/kernels/sort_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -34,27 +34,9 @@ class CpuArgSortKernel final : public user_op::OpKernel {
     const std::string& direction = ctx->Attr<std::string>("direction");
     const bool is_ascending = direction == "ASCENDING";
     const bool is_descending = direction == "DESCENDING";
-    FOR_RANGE(int32_t, i, 0, instance_num) {
-      const T* in_ptr_i = in->dptr<T>() + i * instance_size;
-      int32_t* out_ptr_i = out->mut_dptr<int32_t>() + i * instance_size;
-      std::iota(out_ptr_i, out_ptr_i + instance_size, 0);
-      auto comp = [&](const int32_t lhs, const int32_t rhs) {
-        const T l = in_ptr_i[lhs];
-        const T r = in_ptr_i[rhs];
-        if (l == r) {
-          return lhs < rhs;
-        } else {
-          if (is_ascending) {
-            return l < r;
-          } else if (is_descending) {
-            return l > r;
-          } else {
-            UNIMPLEMENTED();
-          }
-        }
-      };
-      std::sort(out_ptr_i, out_ptr_i + instance_size, comp);
-    }
+    CHECK(is_ascending || is_descending);
+    SortCpuKernelUtil<T>::ArgSort(instance_num, instance_size, is_ascending, in->dptr<T>(),
+                                  out->mut_dptr<int32_t>());
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
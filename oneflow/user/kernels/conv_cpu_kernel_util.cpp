@@ -0,0 +1,645 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
+#include "oneflow/core/common/cached_caller.h"
+#include "oneflow/core/job/global_for.h"
+#include "oneflow/core/job/resource_desc.h"
+#include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class ColBufWriter {
+ public:
+  ColBufWriter(const T* src_ptr, T* dst_ptr, int64_t c_size, int64_t id_size, int64_t ih_size,
+               int64_t iw_size, int64_t od_size, int64_t oh_size, int64_t ow_size)
+      : src_ptr_(src_ptr),
+        dst_ptr_(dst_ptr),
+        c_size_(c_size),
+        id_size_(id_size),
+        ih_size_(ih_size),
+        iw_size_(iw_size),
+        od_size_(od_size),
+        oh_size_(oh_size),
+        ow_size_(ow_size) {}
+  virtual ~ColBufWriter() = default;
+  virtual void DHWCWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) = 0;
+  virtual void CDHWWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) = 0;
+  virtual void InvalidDFunc() = 0;
+  virtual void InvalidHFunc() = 0;
+  virtual void InvalidWFunc() = 0;
+  virtual void NextImCSize() = 0;
+
+ protected:
+  const T* src_ptr_;
+  T* dst_ptr_;
+  int64_t c_size_;
+  int64_t id_size_;
+  int64_t ih_size_;
+  int64_t iw_size_;
+  int64_t od_size_;
+  int64_t oh_size_;
+  int64_t ow_size_;
+};
+
+template<typename T>
+class Im2ColWriter final : public ColBufWriter<T> {
+ public:
+  Im2ColWriter(const T* src_ptr, T* dst_ptr, int64_t c_size, int64_t id_size, int64_t ih_size,
+               int64_t iw_size, int64_t od_size, int64_t oh_size, int64_t ow_size)
+      : ColBufWriter<T>::ColBufWriter(src_ptr, dst_ptr, c_size, id_size, ih_size, iw_size, od_size,
+                                      oh_size, ow_size) {}
+  ~Im2ColWriter() = default;
+  void DHWCWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
+    *(this->dst_ptr_++) =
+        this->src_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw * this->iw_size_ + c];
+  }
+  void CDHWWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
+    *(this->dst_ptr_++) = this->src_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw];
+  }
+  void InvalidDFunc() override {
+    FOR_RANGE(int64_t, i, 0, this->od_size_) { *(this->dst_ptr_++) = 0; }
+  }
+  void InvalidHFunc() override {
+    FOR_RANGE(int64_t, i, 0, this->oh_size_) { *(this->dst_ptr_++) = 0; }
+  }
+  void InvalidWFunc() override {
+    FOR_RANGE(int64_t, i, 0, this->ow_size_) { *(this->dst_ptr_++) = 0; }
+  }
+  void NextImCSize() override { this->src_ptr_ += this->c_size_; }
+};
+
+template<typename T>
+class Col2ImWriter final : public ColBufWriter<T> {
+ public:
+  Col2ImWriter(const T* src_ptr, T* dst_ptr, int64_t c_size, int64_t id_size, int64_t ih_size,
+               int64_t iw_size, int64_t od_size, int64_t oh_size, int64_t ow_size)
+      : ColBufWriter<T>::ColBufWriter(src_ptr, dst_ptr, c_size, id_size, ih_size, iw_size, od_size,
+                                      oh_size, ow_size) {}
+  ~Col2ImWriter() = default;
+  void DHWCWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
+    this->dst_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw * this->iw_size_ + c] +=
+        *(this->src_ptr_++);
+  }
+  void CDHWWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
+    this->dst_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw] += *(this->src_ptr_++);
+  }
+  void InvalidDFunc() override { this->src_ptr_ += this->od_size_; }
+  void InvalidHFunc() override { this->src_ptr_ += this->oh_size_; }
+  void InvalidWFunc() override { this->src_ptr_ += this->ow_size_; }
+  void NextImCSize() override { this->dst_ptr_ += this->c_size_; }
+};
+
+template<typename T>
+using DHWValidFunc = void (ColBufWriter<T>::*)(int64_t c, int64_t kd, int64_t kh, int64_t kw);
+
+template<typename T>
+class ColBufUtil final {
+ public:
+  ColBufUtil(const ShapeView& in_shape, const ShapeView& out_shape, int32_t dhw_offset,
+             const int32_t* strides, const int32_t* dilation_rate, const int32_t* padding_before)
+      : strides_(strides), dilation_rate_(dilation_rate), padding_before_(padding_before) {
+    id_num_ = in_shape.At(dhw_offset);
+    ih_num_ = in_shape.At(dhw_offset + 1);
+    iw_num_ = in_shape.At(dhw_offset + 2);
+    od_num_ = out_shape.At(dhw_offset);
+    oh_num_ = out_shape.At(dhw_offset + 1);
+    ow_num_ = out_shape.At(dhw_offset + 2);
+    if (dhw_offset == 2) {
+      dhw_valid_func_ = &ColBufWriter<T>::CDHWWrite;
+    } else {
+      dhw_valid_func_ = &ColBufWriter<T>::DHWCWrite;
+    }
+  }
+  void operator()(ColBufWriter<T>* col_buf_writer, int64_t c, int64_t kd, int64_t kh, int64_t kw) {
+    int64_t id = kd * dilation_rate_[0] - padding_before_[0];
+    FOR_RANGE(int64_t, od, 0, od_num_) {
+      if (id < 0 || id >= id_num_) {
+        col_buf_writer->InvalidDFunc();
+      } else {
+        int64_t ih = kh * dilation_rate_[1] - padding_before_[1];
+        FOR_RANGE(int64_t, oh, 0, oh_num_) {
+          if (ih < 0 || ih >= ih_num_) {
+            col_buf_writer->InvalidHFunc();
+          } else {
+            int64_t iw = kw * dilation_rate_[2] - padding_before_[2];
+            FOR_RANGE(int64_t, ow, 0, ow_num_) {
+              if (iw < 0 || iw >= iw_num_) {
+                col_buf_writer->InvalidWFunc();
+              } else {
+                (col_buf_writer->*dhw_valid_func_)(c, id, ih, iw);
+              }
+              iw += strides_[2];
+            }
+          }
+          ih += strides_[1];
+        }
+      }
+      id += strides_[0];
+    }
+  }
+
+ private:
+  int64_t id_num_;
+  int64_t ih_num_;
+  int64_t iw_num_;
+  int64_t od_num_;
+  int64_t oh_num_;
+  int64_t ow_num_;
+  const int32_t* strides_;
+  const int32_t* dilation_rate_;
+  const int32_t* padding_before_;
+  DHWValidFunc<T> dhw_valid_func_;
+};
+
+
+template<typename T>
+void DoNCDWHFunc(const ShapeView& weight_shape, ColBufUtil<T>& col_buf_util,
+                 ColBufWriter<T>* col_buf_writer) {
+  for (int64_t c = 0; c != weight_shape.At(1); col_buf_writer->NextImCSize(), ++c) {
+    for (int64_t kd = 0; kd != weight_shape.At(2); ++kd) {
+      for (int64_t kh = 0; kh != weight_shape.At(3); ++kh) {
+        for (int64_t kw = 0; kw != weight_shape.At(4); ++kw) {
+          col_buf_util(col_buf_writer, c, kd, kh, kw);
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+void DoNDWHCFunc(const ShapeView& weight_shape, ColBufUtil<T>& col_buf_util,
+                 ColBufWriter<T>* col_buf_writer) {
+  for (int64_t kd = 0; kd != weight_shape.At(1); ++kd) {
+    for (int64_t kh = 0; kh != weight_shape.At(2); ++kh) {
+      for (int64_t kw = 0; kw != weight_shape.At(3); ++kw) {
+        for (int64_t c = 0; c != weight_shape.At(4); ++c) {
+          col_buf_util(col_buf_writer, c, kd, kh, kw);
+        }
+      }
+    }
+  }
+}
+
+// Samples whose gemm has fewer multiply-adds than this are too small for the BLAS library to
+// thread, so several of them are computed at once on the compute thread pool, each with its
+// own im2col buffer. Larger samples are computed one at a time with a threaded gemm.
+constexpr int64_t kMaxParallelSampleMacs = 1 << 21;
+// bound on the im2col buffers of the samples computed at once
+constexpr int64_t kMaxColBufSlots = 16;
+constexpr int64_t kMaxParallelColBufBytes = 64 << 20;
+// multiply-adds worth handing to another thread
+constexpr int64_t kConvGrainMacs = 1 << 16;
+// output pixels and output channels accumulated together by the direct algorithm
+constexpr int64_t kDirectTileWidth = 4;
+constexpr int64_t kDirectTileChannels = 64;
+
+int64_t KernelElemCnt(const ConvCpuParams& params) {
+  return params.kernel_dims[0] * params.kernel_dims[1] * params.kernel_dims[2];
+}
+
+int64_t InSpatialElemCnt(const ConvCpuParams& params) {
+  return params.in_dims[0] * params.in_dims[1] * params.in_dims[2];
+}
+
+int64_t OutSpatialElemCnt(const ConvCpuParams& params) {
+  return params.out_dims[0] * params.out_dims[1] * params.out_dims[2];
+}
+
+int64_t SampleMacs(const ConvCpuParams& params) {
+  return OutSpatialElemCnt(params) * params.out_channels * params.in_channels
+         * KernelElemCnt(params);
+}
+
+int64_t ColBufElemCnt(const ConvCpuParams& params) {
+  return params.in_channels * KernelElemCnt(params) * OutSpatialElemCnt(params);
+}
+
+int64_t NumColBufSlots(const ConvCpuParams& params, size_t elem_size) {
+  if (SampleMacs(params) >= kMaxParallelSampleMacs) { return 1; }
+  const int64_t col_buf_bytes = std::max<int64_t>(ColBufElemCnt(params) * elem_size, 1);
+  const int64_t max_slots = std::min(kMaxColBufSlots, kMaxParallelColBufBytes / col_buf_bytes);
+  return std::max<int64_t>(std::min(params.batch, max_slots), 1);
+}
+
+Shape SampleShape(int64_t channels, const int64_t* dims, bool channels_last) {
+  if (channels_last) { return Shape({1, dims[0], dims[1], dims[2], channels}); }
+  return Shape({1, channels, dims[0], dims[1], dims[2]});
+}
+
+Shape WeightShape(const ConvCpuParams& params) {
+  if (params.channels_last) {
+    return Shape({params.out_channels, params.kernel_dims[0], params.kernel_dims[1],
+                  params.kernel_dims[2], params.in_channels});
+  }
+  return Shape({params.out_channels, params.in_channels, params.kernel_dims[0],
+                params.kernel_dims[1], params.kernel_dims[2]});
+}
+
+// Calls fn(i) for every sample, several samples at once when each one is cheap.
+void ForEachSample(const ConvCpuParams& params, int64_t num_slots,
+                   const std::function<void(int64_t sample, int64_t slot)>& fn) {
+  CpuNdarrayParallelFor(num_slots, 1, [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, slot, begin, end) {
+      for (int64_t i = slot; i < params.batch; i += num_slots) { fn(i, slot); }
+    }
+  });
+}
+
+template<typename T>
+void AddBias(const ConvCpuParams& params, const T* bias, T* out) {
+  const int64_t spatial = OutSpatialElemCnt(params);
+  const int64_t channels = params.out_channels;
+  if (params.channels_last) {
+    const int64_t num_pixels = params.batch * spatial;
+    const int64_t pixel_grain =
+        std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(channels, 1), 1);
+    CpuNdarrayParallelFor(num_pixels, pixel_grain, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        T* pixel = out + i * channels;
+        FOR_RANGE(int64_t, c, 0, channels) { pixel[c] += bias[c]; }
+      }
+    });
+  } else {
+    const int64_t grain =
+        std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(spatial, 1), 1);
+    CpuNdarrayParallelFor(params.batch * channels, grain, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, plane, begin, end) {
+        const T val = bias[plane % channels];
+        T* dst = out + plane * spatial;
+        FOR_RANGE(int64_t, i, 0, spatial) { dst[i] += val; }
+      }
+    });
+  }
+}
+
+template<typename T>
+void Im2ColGemmForward(const ConvCpuParams& params, const T* in, const T* weight, T* out,
+                       T* workspace, size_t workspace_elem_cnt) {
+  const Shape in_shape = SampleShape(params.in_channels, params.in_dims, params.channels_last);
+  const Shape out_shape = SampleShape(params.out_channels, params.out_dims, params.channels_last);
+  const Shape weight_shape = WeightShape(params);
+  const auto Im2Col =
+      params.channels_last ? ConvKernelUtil<T>::NDHWCIm2Col : ConvKernelUtil<T>::NCDHWIm2Col;
+  const int64_t in_cnt = in_shape.elem_cnt();
+  const int64_t out_cnt = out_shape.elem_cnt();
+  const int64_t col_buf_cnt = ColBufElemCnt(params);
+  const int64_t spatial = OutSpatialElemCnt(params);
+  const int64_t k = params.in_channels * KernelElemCnt(params);
+  // a workspace sized for a larger static shape may hold fewer column buffers than this shape
+  // would use
+  const int64_t num_slots =
+      std::min<int64_t>(NumColBufSlots(params, sizeof(T)),
+                        workspace_elem_cnt / std::max<int64_t>(col_buf_cnt, 1));
+  CHECK_GE(num_slots, 1);
+  ForEachSample(params, num_slots, [&](int64_t i, int64_t slot) {
+    T* col_buf = workspace + slot * col_buf_cnt;
+    Im2Col(in + i * in_cnt, ShapeView(in_shape), ShapeView(weight_shape), ShapeView(out_shape),
+           params.strides, params.dilation_rate, params.padding_before, col_buf);
+    if (params.channels_last) {
+      // out = (weight * col_buf)(T)
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(nullptr, CblasTrans, CblasTrans, spatial,
+                                              params.out_channels, k, static_cast<T>(1), col_buf,
+                                              weight, static_cast<T>(0), out + i * out_cnt);
+    } else {
+      // out = weight * col_buf
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(nullptr, CblasNoTrans, CblasNoTrans,
+                                              params.out_channels, spatial, k, static_cast<T>(1),
+                                              weight, col_buf, static_cast<T>(0),
+                                              out + i * out_cnt);
+    }
+  });
+}
+
+template<typename T>
+void Gemm1x1Forward(const ConvCpuParams& params, const T* in, const T* weight, T* out) {
+  const int64_t spatial = OutSpatialElemCnt(params);
+  if (params.channels_last) {
+    // the whole batch is a single (n * d * h * w, ci) x (ci, co) product
+    NewKernelUtil<DeviceType::kCPU>::OFGemm(nullptr, CblasNoTrans, CblasTrans,
+                                            params.batch * spatial, params.out_channels,
+                                            params.in_channels, static_cast<T>(1), in, weight,
+                                            static_cast<T>(0), out);
+  } else {
+    const int64_t num_slots =
+        SampleMacs(params) >= kMaxParallelSampleMacs ? 1 : std::min(params.batch, kMaxColBufSlots);
+    ForEachSample(params, std::max<int64_t>(num_slots, 1), [&](int64_t i, int64_t slot) {
+      NewKernelUtil<DeviceType::kCPU>::OFGemm(
+          nullptr, CblasNoTrans, CblasNoTrans, params.out_channels, spatial, params.in_channels,
+          static_cast<T>(1), weight, in + i * params.in_channels * spatial, static_cast<T>(0),
+          out + i * params.out_channels * spatial);
+    });
+  }
+}
+
+int64_t NumDirectTiles(const ConvCpuParams& params) {
+  return (params.out_channels + kDirectTileChannels - 1) / kDirectTileChannels;
+}
+
+// The weight (co, taps, ci) is packed to (co / kDirectTileChannels, taps, ci,
+// kDirectTileChannels), so the weights of a tile of output channels are contiguous rows of
+// kDirectTileChannels for every tap and input channel. The last tile is padded with zeros.
+template<typename T>
+void PackDirectWeight(const ConvCpuParams& params, const T* weight, T* packed) {
+  const int64_t num_rows = KernelElemCnt(params) * params.in_channels;
+  const int64_t co = params.out_channels;
+  CpuNdarrayParallelFor(NumDirectTiles(params) * num_rows,
+                        std::max<int64_t>(kCpuNdarrayParallelGrain / kDirectTileChannels, 1),
+                        [&](int64_t begin, int64_t end) {
+                          FOR_RANGE(int64_t, i, begin, end) {
+                            const int64_t tile = i / num_rows;
+                            const int64_t row = i % num_rows;
+                            T* dst = packed + i * kDirectTileChannels;
+                            FOR_RANGE(int64_t, o, 0, kDirectTileChannels) {
+                              const int64_t out_channel = tile * kDirectTileChannels + o;
+                              dst[o] = out_channel < co ? weight[out_channel * num_rows + row]
+                                                        : GetZeroVal<T>();
+                            }
+                          }
+                        });
+}
+
+// acc[p * kDirectTileChannels + o] += the products of output pixel ow_begin + p of row (od, oh)
+// with the packed weights of one tile of output channels. Pixels in the padding read
+// zero_pixel, which has ci zeros.
+template<typename T>
+void AccumulateDirectTile(const ConvCpuParams& params, const T* in_sample, const T* tile_weight,
+                          const T* zero_pixel, int64_t od, int64_t oh, int64_t ow_begin,
+                          int64_t width, T* acc) {
+  const int64_t ci = params.in_channels;
+  const T* pixels[kDirectTileWidth];
+  FOR_RANGE(int64_t, kd, 0, params.kernel_dims[0]) {
+    const int64_t id =
+        od * params.strides[0] - params.padding_before[0] + kd * params.dilation_rate[0];
+    if (id < 0 || id >= params.in_dims[0]) { continue; }
+    FOR_RANGE(int64_t, kh, 0, params.kernel_dims[1]) {
+      const int64_t ih =
+          oh * params.strides[1] - params.padding_before[1] + kh * params.dilation_rate[1];
+      if (ih < 0 || ih >= params.in_dims[1]) { continue; }
+      const T* in_row = in_sample + (id * params.in_dims[1] + ih) * params.in_dims[2] * ci;
+      FOR_RANGE(int64_t, kw, 0, params.kernel_dims[2]) {
+        FOR_RANGE(int64_t, p, 0, width) {
+          const int64_t iw = (ow_begin + p) * params.strides[2] - params.padding_before[2]
+                             + kw * params.dilation_rate[2];
+          pixels[p] = (iw < 0 || iw >= params.in_dims[2]) ? zero_pixel : in_row + iw * ci;
+        }
+        const int64_t tap = (kd * params.kernel_dims[1] + kh) * params.kernel_dims[2] + kw;
+        const T* tap_weight = tile_weight + tap * ci * kDirectTileChannels;
+        FOR_RANGE(int64_t, c, 0, ci) {
+          const T* weight_row = tap_weight + c * kDirectTileChannels;
+          FOR_RANGE(int64_t, p, 0, width) {
+            const T x = pixels[p][c];
+            T* pixel_acc = acc + p * kDirectTileChannels;
+            FOR_RANGE(int64_t, o, 0, kDirectTileChannels) { pixel_acc[o] += x * weight_row[o]; }
+          }
+        }
+      }
+    }
+  }
+}
+
+template<typename T>
+void DirectChannelsLastForward(const ConvCpuParams& params, const T* in, const T* weight,
+                               const T* bias, T* out, T* workspace) {
+  PackDirectWeight(params, weight, workspace);
+  const int64_t co = params.out_channels;
+  const int64_t out_width = params.out_dims[2];
+  const int64_t num_rows = params.batch * params.out_dims[0] * params.out_dims[1];
+  const int64_t tile_weight_cnt = KernelElemCnt(params) * params.in_channels * kDirectTileChannels;
+  const int64_t row_macs = std::max<int64_t>(out_width * co * tile_weight_cnt / kDirectTileChannels,
+                                             1);
+  const int64_t in_cnt = InSpatialElemCnt(params) * params.in_channels;
+  CpuNdarrayParallelFor(
+      num_rows, std::max<int64_t>(kConvGrainMacs / row_macs, 1), [&](int64_t begin, int64_t end) {
+        T acc[kDirectTileWidth * kDirectTileChannels];
+        const std::vector<T> zero_pixel(params.in_channels, GetZeroVal<T>());
+        FOR_RANGE(int64_t, row, begin, end) {
+          const int64_t oh = row % params.out_dims[1];
+          const int64_t od = (row / params.out_dims[1]) % params.out_dims[0];
+          const T* in_sample = in + row / (params.out_dims[1] * params.out_dims[0]) * in_cnt;
+          T* out_row = out + row * out_width * co;
+          for (int64_t ow_begin = 0; ow_begin < out_width; ow_begin += kDirectTileWidth) {
+            const int64_t width = std::min(kDirectTileWidth, out_width - ow_begin);
+            FOR_RANGE(int64_t, tile, 0, NumDirectTiles(params)) {
+              const int64_t co_begin = tile * kDirectTileChannels;
+              const int64_t channels = std::min(kDirectTileChannels, co - co_begin);
+              FOR_RANGE(int64_t, p, 0, width) {
+                T* pixel_acc = acc + p * kDirectTileChannels;
+                FOR_RANGE(int64_t, o, 0, kDirectTileChannels) {
+                  pixel_acc[o] = (bias == nullptr || o >= channels) ? GetZeroVal<T>()
+                                                                    : bias[co_begin + o];
+                }
+              }
+              AccumulateDirectTile(params, in_sample, workspace + tile * tile_weight_cnt,
+                                   zero_pixel.data(), od, oh, ow_begin, width, acc);
+              FOR_RANGE(int64_t, p, 0, width) {
+                std::copy(acc + p * kDirectTileChannels, acc + p * kDirectTileChannels + channels,
+                          out_row + (ow_begin + p) * co + co_begin);
+              }
+            }
+          }
+        }
+      });
+}
+
+}  // namespace
+
+template<typename T>
+void ConvKernelUtil<T>::NCDHWIm2Col(const T* in_dptr, const ShapeView& in_shape,
+                                    const ShapeView& weight_shape, const ShapeView& out_shape,
+                                    const int32_t* strides, const int32_t* dilation_rate,
+                                    const int32_t* padding_before, T* col_buf_ptr) {
+  ColBufUtil<T> col_buf_util(in_shape, out_shape, 2, strides, dilation_rate, padding_before);
+  Im2ColWriter<T> col_buf_writer(in_dptr, col_buf_ptr, in_shape.Count(2), in_shape.Count(3),
+                                 in_shape.Count(4), 1, out_shape.Count(3), out_shape.Count(4), 1);
+  DoNCDWHFunc(weight_shape, col_buf_util, &col_buf_writer);
+}
+
+template<typename T>
+void ConvKernelUtil<T>::NDHWCIm2Col(const T* in_dptr, const ShapeView& in_shape,
+                                    const ShapeView& weight_shape, const ShapeView& out_shape,
+                                    const int32_t* strides, const int32_t* dilation_rate,
+                                    const int32_t* padding_before, T* col_buf_ptr) {
+  ColBufUtil<T> col_buf_util(in_shape, out_shape, 1, strides, dilation_rate, padding_before);
+  Im2ColWriter<T> col_buf_writer(in_dptr, col_buf_ptr, in_shape.Count(2), in_shape.Count(2),
+                                 in_shape.Count(3), in_shape.Count(4), out_shape.Count(2, 4),
+                                 out_shape.Count(3, 4), 1);
+  DoNDWHCFunc(weight_shape, col_buf_util, &col_buf_writer);
+}
+
+template<typename T>
+void ConvKernelUtil<T>::NCDHWCol2Im(const T* col_buf_ptr, const ShapeView& in_shape,
+                                    const ShapeView& weight_shape, const ShapeView& out_shape,
+                                    const int32_t* strides, const int32_t* dilation_rate,
+                                    const int32_t* padding_before, T* in_diff_ptr) {
+  ColBufUtil<T> col_buf_util(in_shape, out_shape, 2, strides, dilation_rate, padding_before);
+  Col2ImWriter<T> col_buf_writer(col_buf_ptr, in_diff_ptr, in_shape.Count(2), in_shape.Count(3),
+                                 in_shape.Count(4), 1, out_shape.Count(3), out_shape.Count(4), 1);
+  DoNCDWHFunc(weight_shape, col_buf_util, &col_buf_writer);
+}
+
+template<typename T>
+void ConvKernelUtil<T>::NDHWCCol2Im(const T* col_buf_ptr, const ShapeView& in_shape,
+                                    const ShapeView& weight_shape, const ShapeView& out_shape,
+                                    const int32_t* strides, const int32_t* dilation_rate,
+                                    const int32_t* padding_before, T* in_diff_ptr) {
+  ColBufUtil<T> col_buf_util(in_shape, out_shape, 1, strides, dilation_rate, padding_before);
+  Col2ImWriter<T> col_buf_writer(col_buf_ptr, in_diff_ptr, in_shape.Count(2), in_shape.Count(2),
+                                 in_shape.Count(3), in_shape.Count(4), out_shape.Count(2, 4),
+                                 out_shape.Count(3, 4), 1);
+  DoNDWHCFunc(weight_shape, col_buf_util, &col_buf_writer);
+}
+
+ConvCpuParams MakeConvCpuParams(DataType data_type, bool channels_last, const ShapeView& in_shape,
+                                const ShapeView& weight_shape, const ShapeView& out_shape,
+                                const int32_t* strides, const int32_t* dilation_rate,
+                                const int32_t* padding_before) {
+  CHECK_EQ(in_shape.NumAxes(), 5);
+  CHECK_EQ(weight_shape.NumAxes(), 5);
+  CHECK_EQ(out_shape.NumAxes(), 5);
+  ConvCpuParams params;
+  std::memset(&params, 0, sizeof(ConvCpuParams));
+  const int32_t dhw_offset = channels_last ? 1 : 2;
+  const int32_t channel_axis = channels_last ? 4 : 1;
+  params.batch = in_shape.At(0);
+  params.in_channels = in_shape.At(channel_axis);
+  params.out_channels = out_shape.At(channel_axis);
+  FOR_RANGE(int32_t, i, 0, 3) {
+    params.in_dims[i] = in_shape.At(dhw_offset + i);
+    params.out_dims[i] = out_shape.At(dhw_offset + i);
+    params.kernel_dims[i] = weight_shape.At(dhw_offset + i);
+    params.strides[i] = strides[i];
+    params.dilation_rate[i] = dilation_rate[i];
+    params.padding_before[i] = padding_before[i];
+  }
+  params.data_type = data_type;
+  params.channels_last = channels_last;
+  return params;
+}
+
+bool operator==(const ConvCpuParams& lhs, const ConvCpuParams& rhs) {
+  return std::memcmp(&lhs, &rhs, sizeof(ConvCpuParams)) == 0;
+}
+
+template<typename T>
+bool ConvCpuForwardUtil<T>::IsSupported(const ConvCpuParams& params, ConvCpuAlgo algo) {
+  if (algo == ConvCpuAlgo::kIm2ColGemm) {
+    return true;
+  } else if (algo == ConvCpuAlgo::kGemm1x1) {
+    FOR_RANGE(int32_t, i, 0, 3) {
+      if (params.kernel_dims[i] != 1 || params.strides[i] != 1 || params.padding_before[i] != 0
+          || params.in_dims[i] != params.out_dims[i]) {
+        return false;
+      }
+    }
+    return true;
+  } else if (algo == ConvCpuAlgo::kDirectChannelsLast) {
+    return params.channels_last;
+  } else {
+    UNIMPLEMENTED();
+    return false;
+  }
+}
+
+template<typename T>
+size_t ConvCpuForwardUtil<T>::GetWorkspaceElemCnt(const ConvCpuParams& params, ConvCpuAlgo algo) {
+  if (algo == ConvCpuAlgo::kIm2ColGemm) {
+    return NumColBufSlots(params, sizeof(T)) * ColBufElemCnt(params);
+  } else if (algo == ConvCpuAlgo::kGemm1x1) {
+    return 0;
+  } else if (algo == ConvCpuAlgo::kDirectChannelsLast) {
+    return NumDirectTiles(params) * kDirectTileChannels * KernelElemCnt(params)
+           * params.in_channels;
+  } else {
+    UNIMPLEMENTED();
+    return 0;
+  }
+}
+
+template<typename T>
+size_t ConvCpuForwardUtil<T>::GetMaxWorkspaceElemCnt(const ConvCpuParams& params) {
+  size_t elem_cnt = 0;
+  FOR_RANGE(int, i, 0, kConvCpuAlgoNum) {
+    const ConvCpuAlgo algo = static_cast<ConvCpuAlgo>(i);
+    if (IsSupported(params, algo)) {
+      elem_cnt = std::max(elem_cnt, GetWorkspaceElemCnt(params, algo));
+    }
+  }
+  return elem_cnt;
+}
+
+template<typename T>
+void ConvCpuForwardUtil<T>::Forward(const ConvCpuParams& params, ConvCpuAlgo algo, const T* in,
+                                    const T* weight, const T* bias, T* out, T* workspace,
+                                    size_t workspace_elem_cnt) {
+  CHECK(IsSupported(params, algo));
+  if (algo != ConvCpuAlgo::kIm2ColGemm) {
+    CHECK_LE(GetWorkspaceElemCnt(params, algo), workspace_elem_cnt);
+  }
+  if (algo == ConvCpuAlgo::kDirectChannelsLast) {
+    DirectChannelsLastForward(params, in, weight, bias, out, workspace);
+    return;
+  }
+  if (algo == ConvCpuAlgo::kIm2ColGemm) {
+    Im2ColGemmForward(params, in, weight, out, workspace, workspace_elem_cnt);
+  } else {
+    Gemm1x1Forward(params, in, weight, out);
+  }
+  if (bias != nullptr) { AddBias(params, bias, out); }
+}
+
+template<typename T>
+ConvCpuAlgo ConvCpuForwardUtil<T>::FindFastestAlgo(const ConvCpuParams& params, const T* in,
+                                                   const T* weight, const T* bias, T* out,
+                                                   T* workspace, size_t workspace_elem_cnt) {
+  auto Infer = [in, weight, bias, out, workspace,
+                workspace_elem_cnt](const ConvCpuParams& params) {
+    ConvCpuAlgo fastest_algo = ConvCpuAlgo::kIm2ColGemm;
+    double fastest_seconds = std::numeric_limits<double>::max();
+    std::vector<ConvCpuAlgo> algos;
+    FOR_RANGE(int, i, 0, kConvCpuAlgoNum) {
+      const ConvCpuAlgo algo = static_cast<ConvCpuAlgo>(i);
+      if (IsSupported(params, algo)) { algos.push_back(algo); }
+    }
+    if (algos.size() == 1) { return algos.front(); }
+    for (const ConvCpuAlgo algo : algos) {
+      // the first run warms up the workspace and the caches
+      Forward(params, algo, in, weight, bias, out, workspace, workspace_elem_cnt);
+      const auto start = std::chrono::steady_clock::now();
+      Forward(params, algo, in, weight, bias, out, workspace, workspace_elem_cnt);
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      if (elapsed.count() < fastest_seconds) {
+        fastest_seconds = elapsed.count();
+        fastest_algo = algo;
+      }
+    }
+    return fastest_algo;
+  };
+  const ResourceDesc* resource_desc = Global<ResourceDesc, ForSession>::Get();
+  const size_t cache_size = resource_desc == nullptr ? GetMaxVal<int32_t>()
+                                                     : resource_desc->thread_local_cache_max_size();
+  return ThreadLocalCachedCall(cache_size, Infer, params);
+}
+
+template struct ConvKernelUtil<float>;
+template struct ConvKernelUtil<double>;
+template struct ConvCpuForwardUtil<float>;
+template struct ConvCpuForwardUtil<double>;
+
+}  // namespace oneflow
@@ -0,0 +1,118 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+
+namespace oneflow {
+
+template<typename T>
+struct ConvKernelUtil final {
+  static void NCDHWIm2Col(const T* in_dptr, const ShapeView& in_shape,
+                          const ShapeView& weight_shape, const ShapeView& out_shape,
+                          const int32_t* strides, const int32_t* dilation_rate,
+                          const int32_t* padding_before, T* col_buf_ptr);
+  static void NDHWCIm2Col(const T* in_dptr, const ShapeView& in_shape,
+                          const ShapeView& weight_shape, const ShapeView& out_shape,
+                          const int32_t* strides, const int32_t* dilation_rate,
+                          const int32_t* padding_before, T* col_buf_ptr);
+  static void NCDHWCol2Im(const T* col_buf_ptr, const ShapeView& in_shape,
+                          const ShapeView& weight_shape, const ShapeView& out_shape,
+                          const int32_t* strides, const int32_t* dilation_rate,
+                          const int32_t* padding_before, T* in_diff_ptr);
+  static void NDHWCCol2Im(const T* col_buf_ptr, const ShapeView& in_shape,
+                          const ShapeView& weight_shape, const ShapeView& out_shape,
+                          const int32_t* strides, const int32_t* dilation_rate,
+                          const int32_t* padding_before, T* in_diff_ptr);
+};
+
+enum class ConvCpuAlgo {
+  // im2col of every sample followed by a gemm with the weight
+  kIm2ColGemm = 0,
+  // 1x1 kernels with unit strides and no padding, a gemm straight on the input
+  kGemm1x1 = 1,
+  // channels_last only, output pixels are accumulated in register sized tiles
+  kDirectChannelsLast = 2,
+};
+
+constexpr int kConvCpuAlgoNum = 3;
+
+// A convolution with 3 spatial dims, conv1d and conv2d have leading unit dims. Used as the key
+// of the algorithm cache, so it is hashed as raw memory and has to be built by
+// MakeConvCpuParams, which clears the padding bytes.
+struct ConvCpuParams {
+  int64_t batch;
+  int64_t in_channels;
+  int64_t out_channels;
+  int64_t in_dims[3];
+  int64_t out_dims[3];
+  int64_t kernel_dims[3];
+  int32_t strides[3];
+  int32_t dilation_rate[3];
+  int32_t padding_before[3];
+  int32_t data_type;
+  bool channels_last;
+};
+
+// Shapes are 5d, (N, C, D, H, W) or (N, D, H, W, C) for the tensors and (Co, Ci, D, H, W) or
+// (Co, D, H, W, Ci) for the weight.
+ConvCpuParams MakeConvCpuParams(DataType data_type, bool channels_last, const ShapeView& in_shape,
+                                const ShapeView& weight_shape, const ShapeView& out_shape,
+                                const int32_t* strides, const int32_t* dilation_rate,
+                                const int32_t* padding_before);
+
+bool operator==(const ConvCpuParams& lhs, const ConvCpuParams& rhs);
+
+template<typename T>
+struct ConvCpuForwardUtil final {
+  static bool IsSupported(const ConvCpuParams& params, ConvCpuAlgo algo);
+  static size_t GetWorkspaceElemCnt(const ConvCpuParams& params, ConvCpuAlgo algo);
+  // enough workspace for any supported algorithm
+  static size_t GetMaxWorkspaceElemCnt(const ConvCpuParams& params);
+  // out = conv(in, weight) + bias, bias is optional. im2col uses as many column buffers as fit
+  // into the workspace, so a workspace sized for a larger shape of the same conv is enough.
+  static void Forward(const ConvCpuParams& params, ConvCpuAlgo algo, const T* in, const T* weight,
+                      const T* bias, T* out, T* workspace, size_t workspace_elem_cnt);
+  // Times every supported algorithm on the given buffers once and returns the fastest. The
+  // choice is cached per thread and params, out is overwritten.
+  static ConvCpuAlgo FindFastestAlgo(const ConvCpuParams& params, const T* in, const T* weight,
+                                     const T* bias, T* out, T* workspace,
+                                     size_t workspace_elem_cnt);
+};
+
+}  // namespace oneflow
+
+namespace std {
+
+template<>
+struct hash<oneflow::ConvCpuParams> final {
+  static_assert(std::is_pod<oneflow::ConvCpuParams>::value, "ConvCpuParams is not POD");
+
+  size_t operator()(const oneflow::ConvCpuParams& params) const {
+    const auto* ptr = reinterpret_cast<const uint8_t*>(&params);
+    uint32_t value = 0x811C9DC5;
+    for (int i = 0; i < (int)sizeof(oneflow::ConvCpuParams); ++i) {
+      value ^= ptr[i];
+      value *= 0x01000193;
+    }
+    return (size_t)value;
+  }
+};
+
+}  // namespace std
+
+#endif  // ONEFLOW_USER_KERNELS_CONV_CPU_KERNEL_UTIL_H_
@@ -0,0 +1,229 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+std::vector<float> RandomVector(int64_t n) {
+  std::mt19937 gen(n);
+  std::uniform_real_distribution<float> dis(-1, 1);
+  std::vector<float> vec(n);
+  for (float& val : vec) { val = dis(gen); }
+  return vec;
+}
+
+// 2d convolution with square kernel, strides, dilation and padding on both sides
+ConvCpuParams MakeConv2DParams(bool channels_last, int64_t batch, int64_t ci, int64_t co,
+                               int64_t hw, int32_t kernel, int32_t stride, int32_t dilation,
+                               int32_t padding) {
+  const int64_t out_hw = (hw + 2 * padding - dilation * (kernel - 1) - 1) / stride + 1;
+  const Shape in_shape =
+      channels_last ? Shape({batch, 1, hw, hw, ci}) : Shape({batch, ci, 1, hw, hw});
+  const Shape weight_shape = channels_last ? Shape({co, 1, kernel, kernel, ci})
+                                           : Shape({co, ci, 1, kernel, kernel});
+  const Shape out_shape =
+      channels_last ? Shape({batch, 1, out_hw, out_hw, co}) : Shape({batch, co, 1, out_hw, out_hw});
+  const int32_t strides[3] = {1, stride, stride};
+  const int32_t dilation_rate[3] = {1, dilation, dilation};
+  const int32_t padding_before[3] = {0, padding, padding};
+  return MakeConvCpuParams(DataType::kFloat, channels_last, ShapeView(in_shape),
+                           ShapeView(weight_shape), ShapeView(out_shape), strides, dilation_rate,
+                           padding_before);
+}
+
+int64_t InElemCnt(const ConvCpuParams& p) {
+  return p.batch * p.in_channels * p.in_dims[0] * p.in_dims[1] * p.in_dims[2];
+}
+
+int64_t OutElemCnt(const ConvCpuParams& p) {
+  return p.batch * p.out_channels * p.out_dims[0] * p.out_dims[1] * p.out_dims[2];
+}
+
+int64_t WeightElemCnt(const ConvCpuParams& p) {
+  return p.out_channels * p.in_channels * p.kernel_dims[0] * p.kernel_dims[1] * p.kernel_dims[2];
+}
+
+// offset of (n, c, d, h, w) in a tensor of the given channels and dims
+int64_t Offset(bool channels_last, int64_t channels, const int64_t* dims, int64_t n, int64_t c,
+               int64_t d, int64_t h, int64_t w) {
+  const int64_t pixel = (d * dims[1] + h) * dims[2] + w;
+  const int64_t spatial = dims[0] * dims[1] * dims[2];
+  if (channels_last) { return (n * spatial + pixel) * channels + c; }
+  return (n * channels + c) * spatial + pixel;
+}
+
+std::vector<double> NaiveConv(const ConvCpuParams& p, const std::vector<float>& in,
+                              const std::vector<float>& weight, const std::vector<float>& bias) {
+  std::vector<double> out(OutElemCnt(p));
+  FOR_RANGE(int64_t, n, 0, p.batch) {
+    FOR_RANGE(int64_t, o, 0, p.out_channels) {
+      FOR_RANGE(int64_t, od, 0, p.out_dims[0]) {
+        FOR_RANGE(int64_t, oh, 0, p.out_dims[1]) {
+          FOR_RANGE(int64_t, ow, 0, p.out_dims[2]) {
+            double sum = bias.empty() ? 0 : bias.at(o);
+            FOR_RANGE(int64_t, c, 0, p.in_channels) {
+              FOR_RANGE(int64_t, kd, 0, p.kernel_dims[0]) {
+                FOR_RANGE(int64_t, kh, 0, p.kernel_dims[1]) {
+                  FOR_RANGE(int64_t, kw, 0, p.kernel_dims[2]) {
+                    const int64_t id =
+                        od * p.strides[0] - p.padding_before[0] + kd * p.dilation_rate[0];
+                    const int64_t ih =
+                        oh * p.strides[1] - p.padding_before[1] + kh * p.dilation_rate[1];
+                    const int64_t iw =
+                        ow * p.strides[2] - p.padding_before[2] + kw * p.dilation_rate[2];
+                    if (id < 0 || id >= p.in_dims[0] || ih < 0 || ih >= p.in_dims[1] || iw < 0
+                        || iw >= p.in_dims[2]) {
+                      continue;
+                    }
+                    // the weight has the layout of a tensor with a batch of out channels
+                    sum += in.at(Offset(p.channels_last, p.in_channels, p.in_dims, n, c, id, ih,
+                                        iw))
+                           * weight.at(Offset(p.channels_last, p.in_channels, p.kernel_dims, o, c,
+                                              kd, kh, kw));
+                  }
+                }
+              }
+            }
+            out.at(Offset(p.channels_last, p.out_channels, p.out_dims, n, o, od, oh, ow)) = sum;
+          }
+        }
+      }
+    }
+  }
+  return out;
+}
+
+// runs every supported algorithm with a workspace of the given size
+void CheckConv(const ConvCpuParams& params, bool with_bias, size_t workspace_elem_cnt) {
+  const std::vector<float> in = RandomVector(InElemCnt(params));
+  const std::vector<float> weight = RandomVector(WeightElemCnt(params));
+  const std::vector<float> bias =
+      with_bias ? RandomVector(params.out_channels) : std::vector<float>();
+  const std::vector<double> expected = NaiveConv(params, in, weight, bias);
+  std::vector<float> workspace(workspace_elem_cnt);
+  FOR_RANGE(int, i, 0, kConvCpuAlgoNum) {
+    const ConvCpuAlgo algo = static_cast<ConvCpuAlgo>(i);
+    if (!ConvCpuForwardUtil<float>::IsSupported(params, algo)) { continue; }
+    std::vector<float> out(OutElemCnt(params), 100);
+    ConvCpuForwardUtil<float>::Forward(params, algo, in.data(), weight.data(),
+                                       with_bias ? bias.data() : nullptr, out.data(),
+                                       workspace.data(), workspace.size());
+    FOR_RANGE(int64_t, j, 0, out.size()) { ASSERT_NEAR(out.at(j), expected.at(j), 1e-3) << i; }
+  }
+}
+
+void CheckConv(const ConvCpuParams& params, bool with_bias) {
+  CheckConv(params, with_bias, ConvCpuForwardUtil<float>::GetMaxWorkspaceElemCnt(params));
+}
+
+double ForwardSeconds(const ConvCpuParams& params, ConvCpuAlgo algo) {
+  const std::vector<float> in = RandomVector(InElemCnt(params));
+  const std::vector<float> weight = RandomVector(WeightElemCnt(params));
+  std::vector<float> out(OutElemCnt(params));
+  std::vector<float> workspace(ConvCpuForwardUtil<float>::GetWorkspaceElemCnt(params, algo));
+  ConvCpuForwardUtil<float>::Forward(params, algo, in.data(), weight.data(), nullptr, out.data(),
+                                     workspace.data(), workspace.size());
+  const int iters = 3;
+  const auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int, i, 0, iters) {
+    ConvCpuForwardUtil<float>::Forward(params, algo, in.data(), weight.data(), nullptr,
+                                       out.data(), workspace.data(), workspace.size());
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iters;
+}
+
+}  // namespace
+
+TEST(ConvCpuKernelUtil, forward) {
+  for (const bool channels_last : {false, true}) {
+    // (batch, ci, co, hw, kernel, stride, dilation, padding)
+    CheckConv(MakeConv2DParams(channels_last, 2, 3, 5, 7, 1, 1, 1, 0), false);
+    CheckConv(MakeConv2DParams(channels_last, 3, 8, 70, 9, 3, 1, 1, 1), true);
+    CheckConv(MakeConv2DParams(channels_last, 2, 6, 4, 11, 3, 2, 1, 1), true);
+    CheckConv(MakeConv2DParams(channels_last, 1, 4, 3, 12, 3, 1, 2, 2), false);
+    CheckConv(MakeConv2DParams(channels_last, 2, 3, 8, 15, 7, 2, 1, 3), true);
+    CheckConv(MakeConv2DParams(channels_last, 4, 16, 8, 6, 1, 2, 1, 0), true);
+  }
+  const Shape in_shape({2, 5, 6, 7, 3});
+  const Shape weight_shape({4, 3, 2, 3, 3});
+  const Shape out_shape({2, 3, 4, 6, 4});
+  const int32_t strides[3] = {1, 1, 1};
+  const int32_t dilation_rate[3] = {1, 1, 1};
+  const int32_t padding_before[3] = {0, 0, 1};
+  CheckConv(MakeConvCpuParams(DataType::kFloat, true, ShapeView(in_shape), ShapeView(weight_shape),
+                              ShapeView(out_shape), strides, dilation_rate, padding_before),
+            true);
+  Global<ThreadPool>::New(4);
+  CheckConv(MakeConv2DParams(false, 8, 16, 16, 14, 3, 1, 1, 1), true);
+  CheckConv(MakeConv2DParams(true, 8, 16, 16, 14, 3, 1, 1, 1), true);
+  CheckConv(MakeConv2DParams(true, 8, 32, 16, 14, 1, 1, 1, 0), true);
+  Global<ThreadPool>::Delete();
+}
+
+TEST(ConvCpuKernelUtil, forward_with_static_shape_workspace) {
+  // a dynamic conv sizes its workspace from the static shape, a smaller runtime shape packs more
+  // column buffers into the same bytes and must make do with fewer of them
+  Global<ThreadPool>::New(4);
+  for (const bool channels_last : {false, true}) {
+    const ConvCpuParams static_params = MakeConv2DParams(channels_last, 8, 16, 16, 32, 3, 1, 1, 1);
+    const ConvCpuParams params = MakeConv2DParams(channels_last, 8, 16, 16, 16, 3, 1, 1, 1);
+    const size_t workspace_elem_cnt =
+        ConvCpuForwardUtil<float>::GetMaxWorkspaceElemCnt(static_params);
+    ASSERT_GT(ConvCpuForwardUtil<float>::GetMaxWorkspaceElemCnt(params), workspace_elem_cnt);
+    CheckConv(params, true, workspace_elem_cnt);
+  }
+  Global<ThreadPool>::Delete();
+}
+
+TEST(ConvCpuKernelUtil, DISABLED_forward_throughput) {
+  // (ci, co, hw, kernel, stride, padding) of ResNet-50 and MobileNet layers
+  const std::vector<std::vector<int32_t>> sweep = {
+      {3, 64, 224, 7, 2, 3},   {64, 64, 56, 1, 1, 0},    {64, 64, 56, 3, 1, 1},
+      {64, 256, 56, 1, 1, 0},  {128, 128, 28, 3, 1, 1},  {256, 1024, 14, 1, 1, 0},
+      {512, 512, 7, 3, 1, 1},  {3, 32, 224, 3, 2, 1},    {32, 64, 112, 1, 1, 0},
+      {256, 256, 28, 1, 1, 0}, {512, 512, 14, 1, 1, 0},  {1024, 1024, 7, 1, 1, 0}};
+  const int64_t batch = 2;
+  Global<ThreadPool>::New(std::thread::hardware_concurrency());
+  for (const auto& dims : sweep) {
+    for (const bool channels_last : {false, true}) {
+      const ConvCpuParams params = MakeConv2DParams(channels_last, batch, dims.at(0), dims.at(1),
+                                                    dims.at(2), dims.at(3), dims.at(4), 1,
+                                                    dims.at(5));
+      const double gflop = 2.0 * OutElemCnt(params) * params.in_channels * dims.at(3) * dims.at(3)
+                           / 1e9;
+      std::ostringstream ss;
+      FOR_RANGE(int, i, 0, kConvCpuAlgoNum) {
+        const ConvCpuAlgo algo = static_cast<ConvCpuAlgo>(i);
+        if (!ConvCpuForwardUtil<float>::IsSupported(params, algo)) { continue; }
+        ss << ", algo " << i << ": " << gflop / ForwardSeconds(params, algo) << " GFLOPS";
+      }
+      LOG(INFO) << "ci: " << dims.at(0) << ", co: " << dims.at(1) << ", hw: " << dims.at(2)
+                << ", kernel: " << dims.at(3) << ", stride: " << dims.at(4)
+                << (channels_last ? ", channels_last" : ", channels_first") << ss.str();
+    }
+  }
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
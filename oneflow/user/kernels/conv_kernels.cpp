@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/user/ops/nn_util.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/user/kernels/conv_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -34,27 +35,6 @@ using Col2ImFunc = void (*)(const T* col_buf, const ShapeView& in_shape,
                             const int32_t* strides, const int32_t* dilation_rate,
                             const int32_t* padding_before, T* in_diff_ptr);
 
-template<typename T>
-using GemmFunc = void (*)(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b, const int m,
-                          const int n, const int k, const T alpha, const T* a, const T* b,
-                          const T beta, T* c);
-
-template<typename T>
-void Gemm4ChannelFirst(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b, const int m,
-                       const int n, const int k, const T alpha, const T* a, const T* b,
-                       const T beta, T* c) {
-  NewKernelUtil<DeviceType::kCPU>::OFGemm(nullptr, trans_a, trans_b, m, n, k, alpha, a, b, beta, c);
-}
-
-template<typename T>
-void Gemm4ChannelLast(enum CBLAS_TRANSPOSE trans_a, enum CBLAS_TRANSPOSE trans_b, const int m,
-                      const int n, const int k, const T alpha, const T* a, const T* b, const T beta,
-                      T* c) {
-  trans_a = (trans_a == CblasNoTrans) ? CblasTrans : CblasNoTrans;
-  trans_b = (trans_b == CblasNoTrans) ? CblasTrans : CblasNoTrans;
-  NewKernelUtil<DeviceType::kCPU>::OFGemm(nullptr, trans_b, trans_a, n, m, k, alpha, b, a, beta, c);
-}
-
 template<typename T>
 T* GetImgMutDptr(user_op::Tensor* tensor, int64_t idx) {
   return tensor->mut_dptr<T>() + tensor->shape().Count(1) * idx;
@@ -74,228 +54,54 @@ size_t CalcElemNumOfColBuf(const ShapeView& out_shape, const ShapeView& weight_s
   return col_buf_elem_cnt;
 }
 
-template<typename T>
-class ColBufWriter {
- public:
-  ColBufWriter(const T* src_ptr, T* dst_ptr, int64_t c_size, int64_t id_size, int64_t ih_size,
-               int64_t iw_size, int64_t od_size, int64_t oh_size, int64_t ow_size)
-      : src_ptr_(src_ptr),
-        dst_ptr_(dst_ptr),
-        c_size_(c_size),
-        id_size_(id_size),
-        ih_size_(ih_size),
-        iw_size_(iw_size),
-        od_size_(od_size),
-        oh_size_(oh_size),
-        ow_size_(ow_size) {}
-  virtual ~ColBufWriter() = default;
-  virtual void DHWCWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) = 0;
-  virtual void CDHWWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) = 0;
-  virtual void InvalidDFunc() = 0;
-  virtual void InvalidHFunc() = 0;
-  virtual void InvalidWFunc() = 0;
-  virtual void NextImCSize() = 0;
-
- protected:
-  const T* src_ptr_;
-  T* dst_ptr_;
-  int64_t c_size_;
-  int64_t id_size_;
-  int64_t ih_size_;
-  int64_t iw_size_;
-  int64_t od_size_;
-  int64_t oh_size_;
-  int64_t ow_size_;
-};
-
-template<typename T>
-class Im2ColWriter final : public ColBufWriter<T> {
- public:
-  Im2ColWriter(const T* src_ptr, T* dst_ptr, int64_t c_size, int64_t id_size, int64_t ih_size,
-               int64_t iw_size, int64_t od_size, int64_t oh_size, int64_t ow_size)
-      : ColBufWriter<T>::ColBufWriter(src_ptr, dst_ptr, c_size, id_size, ih_size, iw_size, od_size,
-                                      oh_size, ow_size) {}
-  ~Im2ColWriter() = default;
-  void DHWCWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
-    *(this->dst_ptr_++) =
-        this->src_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw * this->iw_size_ + c];
-  }
-  void CDHWWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
-    *(this->dst_ptr_++) = this->src_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw];
-  }
-  void InvalidDFunc() override {
-    FOR_RANGE(int64_t, i, 0, this->od_size_) { *(this->dst_ptr_++) = 0; }
-  }
-  void InvalidHFunc() override {
-    FOR_RANGE(int64_t, i, 0, this->oh_size_) { *(this->dst_ptr_++) = 0; }
-  }
-  void InvalidWFunc() override {
-    FOR_RANGE(int64_t, i, 0, this->ow_size_) { *(this->dst_ptr_++) = 0; }
-  }
-  void NextImCSize() override { this->src_ptr_ += this->c_size_; }
-};
-
-template<typename T>
-class Col2ImWriter final : public ColBufWriter<T> {
- public:
-  Col2ImWriter(const T* src_ptr, T* dst_ptr, int64_t c_size, int64_t id_size, int64_t ih_size,
-               int64_t iw_size, int64_t od_size, int64_t oh_size, int64_t ow_size)
-      : ColBufWriter<T>::ColBufWriter(src_ptr, dst_ptr, c_size, id_size, ih_size, iw_size, od_size,
-                                      oh_size, ow_size) {}
-  ~Col2ImWriter() = default;
-  void DHWCWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
-    this->dst_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw * this->iw_size_ + c] +=
-        *(this->src_ptr_++);
-  }
-  void CDHWWrite(int64_t c, int64_t id, int64_t ih, int64_t iw) override {
-    this->dst_ptr_[id * this->id_size_ + ih * this->ih_size_ + iw] += *(this->src_ptr_++);
-  }
-  void InvalidDFunc() override { this->src_ptr_ += this->od_size_; }
-  void InvalidHFunc() override { this->src_ptr_ += this->oh_size_; }
-  void InvalidWFunc() override { this->src_ptr_ += this->ow_size_; }
-  void NextImCSize() override { this->dst_ptr_ += this->c_size_; }
-};
+Shape Gen5DShape(const Shape& shape, int32_t idx_offset) {
+  DimVector ret_vec(shape.dim_vec());
+  int32_t ndims = ret_vec.size() - 2;
+  ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
+  return Shape(ret_vec);
+}
 
-template<typename T>
-using DHWValidFunc = void (ColBufWriter<T>::*)(int64_t c, int64_t kd, int64_t kh, int64_t kw);
+std::vector<int32_t> Gen3DVec(const std::vector<int32_t>& origin_vec) {
+  std::vector<int32_t> ret_vec = origin_vec;
+  ret_vec.insert(ret_vec.begin(), 3 - ret_vec.size(), 1);
+  return ret_vec;
+}
 
-template<typename T>
-class ColBufUtil final {
- public:
-  ColBufUtil(const ShapeView& in_shape, const ShapeView& out_shape, int32_t dhw_offset,
-             const int32_t* strides, const int32_t* dilation_rate, const int32_t* padding_before)
-      : strides_(strides), dilation_rate_(dilation_rate), padding_before_(padding_before) {
-    id_num_ = in_shape.At(dhw_offset);
-    ih_num_ = in_shape.At(dhw_offset + 1);
-    iw_num_ = in_shape.At(dhw_offset + 2);
-    od_num_ = out_shape.At(dhw_offset);
-    oh_num_ = out_shape.At(dhw_offset + 1);
-    ow_num_ = out_shape.At(dhw_offset + 2);
-    if (dhw_offset == 2) {
-      dhw_valid_func_ = &ColBufWriter<T>::CDHWWrite;
+std::vector<int32_t> Gen3DPadding(const std::vector<int32_t>& padding_before) {
+  std::vector<int32_t> ret_vec;
+  FOR_RANGE(uint8_t, dim, 0, 3) {
+    int64_t index = static_cast<int64_t>(dim) - (3 - padding_before.size());
+    if (index < 0) {
+      ret_vec.push_back(0);
     } else {
-      dhw_valid_func_ = &ColBufWriter<T>::DHWCWrite;
-    }
-  }
-  void operator()(ColBufWriter<T>* col_buf_writer, int64_t c, int64_t kd, int64_t kh, int64_t kw) {
-    int64_t id = kd * dilation_rate_[0] - padding_before_[0];
-    FOR_RANGE(int64_t, od, 0, od_num_) {
-      if (id < 0 || id >= id_num_) {
-        col_buf_writer->InvalidDFunc();
-      } else {
-        int64_t ih = kh * dilation_rate_[1] - padding_before_[1];
-        FOR_RANGE(int64_t, oh, 0, oh_num_) {
-          if (ih < 0 || ih >= ih_num_) {
-            col_buf_writer->InvalidHFunc();
-          } else {
-            int64_t iw = kw * dilation_rate_[2] - padding_before_[2];
-            FOR_RANGE(int64_t, ow, 0, ow_num_) {
-              if (iw < 0 || iw >= iw_num_) {
-                col_buf_writer->InvalidWFunc();
-              } else {
-                (col_buf_writer->*dhw_valid_func_)(c, id, ih, iw);
-              }
-              iw += strides_[2];
-            }
-          }
-          ih += strides_[1];
-        }
-      }
-      id += strides_[0];
-    }
-  }
-
- private:
-  int64_t id_num_;
-  int64_t ih_num_;
-  int64_t iw_num_;
-  int64_t od_num_;
-  int64_t oh_num_;
-  int64_t ow_num_;
-  const int32_t* strides_;
-  const int32_t* dilation_rate_;
-  const int32_t* padding_before_;
-  DHWValidFunc<T> dhw_valid_func_;
-};
-
-template<typename T>
-struct ConvKernelUtil final {
- public:
-  static void NCDHWIm2Col(const T* in_dptr, const ShapeView& in_shape,
-                          const ShapeView& weight_shape, const ShapeView& out_shape,
-                          const int32_t* strides, const int32_t* dilation_rate,
-                          const int32_t* padding_before, T* col_buf_ptr) {
-    ColBufUtil<T> col_buf_util(in_shape, out_shape, 2, strides, dilation_rate, padding_before);
-    Im2ColWriter<T> col_buf_writer(in_dptr, col_buf_ptr, in_shape.Count(2), in_shape.Count(3),
-                                   in_shape.Count(4), 1, out_shape.Count(3), out_shape.Count(4), 1);
-    DoNCDWHFunc(weight_shape, col_buf_util, &col_buf_writer);
-  }
-
-  static void NDHWCIm2Col(const T* in_dptr, const ShapeView& in_shape,
-                          const ShapeView& weight_shape, const ShapeView& out_shape,
-                          const int32_t* strides, const int32_t* dilation_rate,
-                          const int32_t* padding_before, T* col_buf_ptr) {
-    ColBufUtil<T> col_buf_util(in_shape, out_shape, 1, strides, dilation_rate, padding_before);
-    Im2ColWriter<T> col_buf_writer(in_dptr, col_buf_ptr, in_shape.Count(2), in_shape.Count(2),
-                                   in_shape.Count(3), in_shape.Count(4), out_shape.Count(2, 4),
-                                   out_shape.Count(3, 4), 1);
-    DoNDWHCFunc(weight_shape, col_buf_util, &col_buf_writer);
-  }
-
-  static void NCDHWCol2Im(const T* col_buf_ptr, const ShapeView& in_shape,
-                          const ShapeView& weight_shape, const ShapeView& out_shape,
-                          const int32_t* strides, const int32_t* dilation_rate,
-                          const int32_t* padding_before, T* in_diff_ptr) {
-    ColBufUtil<T> col_buf_util(in_shape, out_shape, 2, strides, dilation_rate, padding_before);
-    Col2ImWriter<T> col_buf_writer(col_buf_ptr, in_diff_ptr, in_shape.Count(2), in_shape.Count(3),
-                                   in_shape.Count(4), 1, out_shape.Count(3), out_shape.Count(4), 1);
-    DoNCDWHFunc(weight_shape, col_buf_util, &col_buf_writer);
-  }
-
-  static void NDHWCCol2Im(const T* col_buf_ptr, const ShapeView& in_shape,
-                          const ShapeView& weight_shape, const ShapeView& out_shape,
-                          const int32_t* strides, const int32_t* dilation_rate,
-                          const int32_t* padding_before, T* in_diff_ptr) {
-    ColBufUtil<T> col_buf_util(in_shape, out_shape, 1, strides, dilation_rate, padding_before);
-    Col2ImWriter<T> col_buf_writer(col_buf_ptr, in_diff_ptr, in_shape.Count(2), in_shape.Count(2),
-                                   in_shape.Count(3), in_shape.Count(4), out_shape.Count(2, 4),
-                                   out_shape.Count(3, 4), 1);
-    DoNDWHCFunc(weight_shape, col_buf_util, &col_buf_writer);
-  }
-
- private:
-  static void DoNCDWHFunc(const ShapeView& weight_shape, ColBufUtil<T>& col_buf_util,
-                          ColBufWriter<T>* col_buf_writer) {
-    for (int64_t c = 0; c != weight_shape.At(1); col_buf_writer->NextImCSize(), ++c) {
-      for (int64_t kd = 0; kd != weight_shape.At(2); ++kd) {
-        for (int64_t kh = 0; kh != weight_shape.At(3); ++kh) {
-          for (int64_t kw = 0; kw != weight_shape.At(4); ++kw) {
-            col_buf_util(col_buf_writer, c, kd, kh, kw);
-          }
-        }
-      }
+      ret_vec.push_back(padding_before.at(index));
     }
   }
+  return ret_vec;
+}
 
-  static void DoNDWHCFunc(const ShapeView& weight_shape, ColBufUtil<T>& col_buf_util,
-                          ColBufWriter<T>* col_buf_writer) {
-    for (int64_t kd = 0; kd != weight_shape.At(1); ++kd) {
-      for (int64_t kh = 0; kh != weight_shape.At(2); ++kh) {
-        for (int64_t kw = 0; kw != weight_shape.At(3); ++kw) {
-          for (int64_t c = 0; c != weight_shape.At(4); ++c) {
-            col_buf_util(col_buf_writer, c, kd, kh, kw);
-          }
-        }
-      }
-    }
-  }
-};
+ConvCpuParams GenConvCpuParams(user_op::InferContext* ctx) {
+  const int32_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));
+  const Shape in_shape = Gen5DShape(ctx->TensorDesc4ArgNameAndIndex("in", 0)->shape(), idx_offset);
+  const Shape weight_shape =
+      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex("weight", 0)->shape(), idx_offset);
+  const Shape out_shape =
+      Gen5DShape(ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape(), idx_offset);
+  const std::vector<int32_t> strides = Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"));
+  const std::vector<int32_t> dilation_rate =
+      Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"));
+  const std::vector<int32_t> padding_before =
+      Gen3DPadding(ctx->Attr<std::vector<int32_t>>("padding_before"));
+  return MakeConvCpuParams(ctx->TensorDesc4ArgNameAndIndex("in", 0)->data_type(),
+                           idx_offset == 1, ShapeView(in_shape), ShapeView(weight_shape),
+                           ShapeView(out_shape), strides.data(), dilation_rate.data(),
+                           padding_before.data());
+}
 
 template<typename T>
 struct ConvOpKernelState final : public user_op::OpKernelState {
   Im2ColFunc<T> im2col_func_;
   Col2ImFunc<T> col2im_func_;
-  GemmFunc<T> forward_func_;
 
   Shape in_5d_shape_;
   Shape out_5d_shape_;
@@ -336,23 +142,15 @@ std::shared_ptr<user_op::OpKernelState> CreateConvOpKernelState(user_op::KernelI
   if (data_format == "channels_first") {
     state->im2col_func_ = ConvKernelUtil<T>::NCDHWIm2Col;
     state->col2im_func_ = ConvKernelUtil<T>::NCDHWCol2Im;
-    state->forward_func_ = Gemm4ChannelFirst;
     state->is_out_diff_need_trans_ = CblasNoTrans;
     state->idx_offset_ = 2;
   } else {
     state->im2col_func_ = ConvKernelUtil<T>::NDHWCIm2Col;
     state->col2im_func_ = ConvKernelUtil<T>::NDHWCCol2Im;
-    state->forward_func_ = Gemm4ChannelLast;
     state->is_out_diff_need_trans_ = CblasTrans;
     state->idx_offset_ = 1;
   }
 
-  auto Gen5DShape = [](const Shape& shape, int32_t idx_offset) -> Shape {
-    DimVector ret_vec(shape.dim_vec());
-    int32_t ndims = ret_vec.size() - 2;
-    ret_vec.insert(ret_vec.begin() + idx_offset, 3 - ndims, 1);
-    return Shape(ret_vec);
-  };
   state->in_5d_shape_ =
       Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->shape(), state->idx_offset_);
   state->out_5d_shape_ =
@@ -360,23 +158,10 @@ std::shared_ptr<user_op::OpKernelState> CreateConvOpKernelState(user_op::KernelI
   state->weight_5d_shape_ =
       Gen5DShape(ctx->TensorDesc4ArgNameAndIndex(weight_name, 0)->shape(), state->idx_offset_);
 
-  auto Gen3DVec = [](const std::vector<int32_t>& origin_vec) -> std::vector<int32_t> {
-    std::vector<int32_t> ret_vec = origin_vec;
-    ret_vec.insert(ret_vec.begin(), 3 - ret_vec.size(), 1);
-    return ret_vec;
-  };
   state->strides_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("strides"));
   state->dilation_rate_3d_ = Gen3DVec(ctx->Attr<std::vector<int32_t>>("dilation_rate"));
   state->is_dynamic_ = ctx->TensorDesc4ArgNameAndIndex(in_name, 0)->is_dynamic();
-  const auto& padding_before = ctx->Attr<std::vector<int32_t>>("padding_before");
-  FOR_RANGE(uint8_t, dim, 0, 3) {
-    int64_t index = static_cast<int64_t>(dim) - (3 - padding_before.size());
-    if (index < 0) {
-      state->padding_before_3d_.push_back(0);
-    } else {
-      state->padding_before_3d_.push_back(padding_before.at(index));
-    }
-  }
+  state->padding_before_3d_ = Gen3DPadding(ctx->Attr<std::vector<int32_t>>("padding_before"));
 
   return std::move(state);
 }
@@ -406,77 +191,39 @@ class ConvCpuKernel final : public user_op::OpKernel {
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
 
-    T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
 
     auto* conv_state = dynamic_cast<ConvOpKernelState<T>*>(state);
-    conv_state->Update(in->shape(), out->shape());
     CHECK_NOTNULL(conv_state);
-    bool is_bias_mul_inited = false;
-    for (int64_t i = 0; i < in->shape().At(0); ++i) {
-      conv_state->im2col_func_(GetImgDptr<T>(in, i), ShapeView(conv_state->in_5d_shape_),
-                               ShapeView(conv_state->weight_5d_shape_),
-                               ShapeView(conv_state->out_5d_shape_), conv_state->strides_3d_.data(),
-                               conv_state->dilation_rate_3d_.data(),
-                               conv_state->padding_before_3d_.data(), col_buf_dptr);
-
-      // channels first: out = weight * col_buf
-      // channels last:  out = (weight * col_buf)(T)
-      int32_t idx_offset = conv_state->idx_offset_;
-      conv_state->forward_func_(
-          CblasNoTrans, CblasNoTrans,
-          conv_state->weight_5d_shape_.At(0),                           // filter
-          conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-          conv_state->weight_5d_shape_.Count(1),                        // ci * kd * kh * kw
-          static_cast<T>(1), weight->dptr<T>(), col_buf_dptr, static_cast<T>(0),
-          GetImgMutDptr<T>(out, i));
-
-      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
-      if (bias != nullptr) {
-        int64_t num_of_col_buf = CalcElemNumOfColBuf(out->shape(), weight->shape(), idx_offset);
-        int64_t num_of_bias_mul = tmp_buffer->shape().elem_cnt() - num_of_col_buf;
-        CHECK_GT(num_of_bias_mul, 0);
-        T* bias_mul_dptr = col_buf_dptr + num_of_col_buf * sizeof(T);
-        if (!is_bias_mul_inited) {
-          InitBiasMulBuf(bias_mul_dptr, num_of_bias_mul);
-          is_bias_mul_inited = true;
-        }
-
-        // channels first:  out += bias * bias_mul
-        // channels last:   out += (bias * bias_mul)(T)
-        conv_state->forward_func_(
-            CblasNoTrans, CblasNoTrans,
-            conv_state->weight_5d_shape_.At(0),                           // filter
-            conv_state->out_5d_shape_.Count(idx_offset, idx_offset + 3),  // od * oh * ow
-            1,                                                            // 1
-            static_cast<T>(1), bias->dptr<T>(), bias_mul_dptr, static_cast<T>(1),
-            GetImgMutDptr<T>(out, i));
-      }
-    }
+    conv_state->Update(in->shape(), out->shape());
+    const ConvCpuParams params = MakeConvCpuParams(
+        GetDataType<T>::value, conv_state->idx_offset_ == 1, ShapeView(conv_state->in_5d_shape_),
+        ShapeView(conv_state->weight_5d_shape_), ShapeView(conv_state->out_5d_shape_),
+        conv_state->strides_3d_.data(), conv_state->dilation_rate_3d_.data(),
+        conv_state->padding_before_3d_.data());
+    // the tmp buffer is sized for the static shape, a smaller dynamic one may get less than its
+    // GetMaxWorkspaceElemCnt and runs im2col with fewer column buffers
+    T* workspace = tmp_buffer == nullptr ? nullptr : tmp_buffer->mut_dptr<T>();
+    const size_t workspace_elem_cnt =
+        tmp_buffer == nullptr ? 0 : tmp_buffer->shape().elem_cnt() / sizeof(T);
+    const T* bias_dptr = bias == nullptr ? nullptr : bias->dptr<T>();
+    const ConvCpuAlgo algo =
+        ConvCpuForwardUtil<T>::FindFastestAlgo(params, in->dptr<T>(), weight->dptr<T>(), bias_dptr,
+                                               out->mut_dptr<T>(), workspace, workspace_elem_cnt);
+    ConvCpuForwardUtil<T>::Forward(params, algo, in->dptr<T>(), weight->dptr<T>(), bias_dptr,
+                                   out->mut_dptr<T>(), workspace, workspace_elem_cnt);
   }
 };
 
-#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                         \
-  REGISTER_USER_KERNEL(#op_name)                                                            \
-      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                           \
-      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                   \
-                       & (user_op::HobAttr<int32_t>("groups") == 1)                         \
-                       & (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))      \
-      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                         \
-        size_t tmp_buffer_size = 0;                                                         \
-        const auto& out_shape = ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape();         \
-        const auto& weight_shape = ctx->TensorDesc4ArgNameAndIndex("weight", 0)->shape();   \
-                                                                                            \
-        int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
-        tmp_buffer_size +=                                                                  \
-            CalcElemNumOfColBuf(out_shape, weight_shape, idx_offset) * sizeof(dtype);       \
-                                                                                            \
-        const auto* bias = ctx->TensorDesc4ArgNameAndIndex("bias", 0);                      \
-        if (bias != nullptr) {                                                              \
-          int64_t bias_mul_cnt = 1;                                                         \
-          for (int i = 0; i < ndims; ++i) { bias_mul_cnt *= out_shape.At(idx_offset + i); } \
-          tmp_buffer_size += bias_mul_cnt * sizeof(dtype);                                  \
-        }                                                                                   \
-        return tmp_buffer_size;                                                             \
+#define REGISTER_CONV_KERNEL(op_name, dtype, ndims)                                    \
+  REGISTER_USER_KERNEL(#op_name)                                                       \
+      .SetCreateFn<ConvCpuKernel<dtype, ndims>>()                                      \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                              \
+                       & (user_op::HobAttr<int32_t>("groups") == 1)                    \
+                       & (user_op::HobDataType("in", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                    \
+        return ConvCpuForwardUtil<dtype>::GetMaxWorkspaceElemCnt(GenConvCpuParams(ctx)) \
+               * sizeof(dtype);                                                        \
       })
 
 REGISTER_CONV_KERNEL(conv1d, float, 1);
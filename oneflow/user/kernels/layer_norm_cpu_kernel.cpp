@@ -14,6 +14,8 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ndarray/ndarray_util.h"
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
 
 namespace oneflow {
 
@@ -25,7 +27,41 @@ class LayerNormCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const bool scale = ctx->Attr<bool>("scale");
+    const bool center = ctx->Attr<bool>("center");
+    user_op::Tensor* normalized = scale ? ctx->Tensor4ArgNameAndIndex("normalized", 0) : y;
+    const double epsilon = ctx->Attr<double>("epsilon");
+    const T* gamma_ptr = nullptr;
+    const T* beta_ptr = nullptr;
+    int64_t instance_size = 0;
+    if (scale) {
+      const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      instance_size = gamma->shape().elem_cnt();
+      gamma_ptr = gamma->dptr<T>();
+    }
+    if (center) {
+      const user_op::Tensor* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+      if (gamma_ptr) {
+        CHECK_EQ(beta->shape().elem_cnt(), instance_size);
+      } else {
+        instance_size = beta->shape().elem_cnt();
+      }
+      beta_ptr = beta->dptr<T>();
+    }
+    if (scale || center) { CHECK_EQ(y->shape().elem_cnt() % instance_size, 0); }
+    const int64_t num_rows = mean->shape().elem_cnt();
+    CHECK_EQ(x->shape().elem_cnt() % num_rows, 0);
+    const int64_t row_size = x->shape().elem_cnt() / num_rows;
+    LayerNormCpuKernelUtil<T>::Forward(num_rows, row_size, epsilon, x->dptr<T>(), gamma_ptr,
+                                       beta_ptr, instance_size, mean->mut_dptr<T>(),
+                                       inv_variance->mut_dptr<T>(), normalized->mut_dptr<T>(),
+                                       y->mut_dptr<T>());
+  };
 };
 
 #define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)             \
@@ -45,7 +81,19 @@ class LayerNormGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const int64_t num_rows = mean->shape().elem_cnt();
+    CHECK_EQ(x->shape().elem_cnt() % num_rows, 0);
+    const int64_t row_size = x->shape().elem_cnt() / num_rows;
+    LayerNormCpuKernelUtil<T>::Backward(num_rows, row_size, dy->dptr<T>(), x->dptr<T>(),
+                                        mean->dptr<T>(), inv_variance->dptr<T>(),
+                                        dx->mut_dptr<T>());
+  };
 };
 
 #define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)        \
@@ -65,7 +113,48 @@ class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    using NdUtil = NdarrayUtil<DeviceType::kCPU, T>;
+    auto Val = NdUtil::GetValNdarrayBuilder();
+    auto Var = NdUtil::GetVarNdarrayBuilder();
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    user_op::Tensor* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    user_op::Tensor* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    user_op::Tensor* normalized_diff = ctx->Tensor4ArgNameAndIndex("normalized_diff", 0);
+    user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    if (beta_diff != nullptr) {
+      user_op::Tensor* reduce_buf = ctx->Tensor4ArgNameAndIndex("reduce_buf", 0);
+      const int64_t m = beta_diff->shape().elem_cnt();
+      CHECK_EQ(dy->shape().elem_cnt() % m, 0);
+      const int64_t n = dy->shape().elem_cnt() / m;
+      NdUtil::ReduceSum(ctx->device_ctx(), Var({1, m}, beta_diff->mut_dptr<T>()),
+                        Val({n, m}, dy->dptr<T>()), Var({n, m}, reduce_buf->mut_dptr<T>()));
+    }
+    if (gamma_diff != nullptr) {
+      const user_op::Tensor* normalized = ctx->Tensor4ArgNameAndIndex("normalized", 0);
+      user_op::Tensor* reduce_buf = ctx->Tensor4ArgNameAndIndex("reduce_buf", 0);
+      const int64_t m = gamma_diff->shape().elem_cnt();
+      CHECK_EQ(dy->shape().elem_cnt() % m, 0);
+      const int64_t n = dy->shape().elem_cnt() / m;
+      NdUtil::BroadcastMul(ctx->device_ctx(), Var({n, m}, reduce_buf->mut_dptr<T>()),
+                           Val({n, m}, normalized->dptr<T>()), Val({n, m}, dy->dptr<T>()));
+      NdUtil::ReduceSum(ctx->device_ctx(), Var({1, m}, gamma_diff->mut_dptr<T>()),
+                        Val({n, m}, reduce_buf->dptr<T>()), Var({n, m}, reduce_buf->mut_dptr<T>()));
+    }
+    if (normalized_diff != nullptr) {
+      if (gamma != nullptr) {
+        const int64_t m = gamma->shape().elem_cnt();
+        CHECK_EQ(dy->shape().elem_cnt() % m, 0);
+        const int64_t n = dy->shape().elem_cnt() / m;
+        NdUtil::BroadcastMul(ctx->device_ctx(), Var({n, m}, normalized_diff->mut_dptr<T>()),
+                             Val({n, m}, dy->dptr<T>()), Val({1, m}, gamma->dptr<T>()));
+      } else {
+        Memcpy<DeviceType::kCPU>(ctx->device_ctx(), normalized_diff->mut_dptr<void>(),
+                                 dy->dptr<void>(),
+                                 dy->shape().elem_cnt() * GetSizeOfDataType(dy->data_type()));
+      }
+    }
+  };
 };
 
 #define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)  \
@@ -0,0 +1,153 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
+
+namespace oneflow {
+
+namespace {
+
+// Welford states kept per lane so that the update loop vectorizes, merged with Chan's formula
+constexpr int64_t kLaneNum = 8;
+
+template<typename T>
+void WelfordMerge(T mean_b, T m2_b, int64_t count_b, T* mean, T* m2, int64_t* count) {
+  if (count_b == 0) { return; }
+  const int64_t count_ab = *count + count_b;
+  const T delta = mean_b - *mean;
+  const T ratio_b = static_cast<T>(count_b) / count_ab;
+  *mean += delta * ratio_b;
+  *m2 += m2_b + delta * delta * (*count) * ratio_b;
+  *count = count_ab;
+}
+
+// single pass mean and biased variance of a row
+template<typename T>
+void RowMeanAndVariance(const T* x, int64_t n, T* mean, T* variance) {
+  T lane_mean[kLaneNum] = {0};
+  T lane_m2[kLaneNum] = {0};
+  const int64_t group_num = n / kLaneNum;
+  for (int64_t g = 0; g < group_num; ++g) {
+    const T inv_count = static_cast<T>(1) / (g + 1);
+    const T* x_group = x + g * kLaneNum;
+    for (int64_t j = 0; j < kLaneNum; ++j) {
+      const T delta = x_group[j] - lane_mean[j];
+      lane_mean[j] += delta * inv_count;
+      lane_m2[j] += delta * (x_group[j] - lane_mean[j]);
+    }
+  }
+  T row_mean = 0;
+  T row_m2 = 0;
+  int64_t row_count = 0;
+  for (int64_t j = 0; j < kLaneNum; ++j) {
+    WelfordMerge<T>(lane_mean[j], lane_m2[j], group_num, &row_mean, &row_m2, &row_count);
+  }
+  for (int64_t i = group_num * kLaneNum; i < n; ++i) {
+    WelfordMerge<T>(x[i], 0, 1, &row_mean, &row_m2, &row_count);
+  }
+  *mean = row_mean;
+  *variance = row_count > 0 ? row_m2 / row_count : 0;
+}
+
+int64_t RowGrain(int64_t row_size) {
+  return std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(row_size, 1), 1);
+}
+
+}  // namespace
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::Forward(int64_t num_rows, int64_t row_size, double epsilon,
+                                        const T* x, const T* gamma, const T* beta,
+                                        int64_t instance_size, T* mean, T* inv_variance,
+                                        T* normalized, T* y) {
+  const bool params_per_row = (instance_size == row_size);
+  CpuNdarrayParallelFor(num_rows, RowGrain(row_size), [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, row, begin, end) {
+      const int64_t offset = row * row_size;
+      const T* x_row = x + offset;
+      T* normalized_row = normalized + offset;
+      T* y_row = y + offset;
+      T row_mean;
+      T row_variance;
+      RowMeanAndVariance<T>(x_row, row_size, &row_mean, &row_variance);
+      const T row_inv_variance = static_cast<T>(1) / std::sqrt(row_variance + epsilon);
+      mean[row] = row_mean;
+      inv_variance[row] = row_inv_variance;
+      if (params_per_row || (gamma == nullptr && beta == nullptr)) {
+        for (int64_t i = 0; i < row_size; ++i) {
+          const T val = (x_row[i] - row_mean) * row_inv_variance;
+          normalized_row[i] = val;
+          y_row[i] = (gamma ? val * gamma[i] : val) + (beta ? beta[i] : 0);
+        }
+      } else {
+        for (int64_t i = 0; i < row_size; ++i) {
+          const T val = (x_row[i] - row_mean) * row_inv_variance;
+          const int64_t param_idx = (offset + i) % instance_size;
+          normalized_row[i] = val;
+          y_row[i] = (gamma ? val * gamma[param_idx] : val) + (beta ? beta[param_idx] : 0);
+        }
+      }
+    }
+  });
+}
+
+template<typename T>
+void LayerNormCpuKernelUtil<T>::Backward(int64_t num_rows, int64_t row_size, const T* dy,
+                                         const T* x, const T* mean, const T* inv_variance,
+                                         T* dx) {
+  // dx = inv_variance * (dy - mean(dy) - normalized * mean(dy * normalized))
+  CpuNdarrayParallelFor(num_rows, RowGrain(row_size), [&](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, row, begin, end) {
+      const int64_t offset = row * row_size;
+      const T* dy_row = dy + offset;
+      const T* x_row = x + offset;
+      T* dx_row = dx + offset;
+      const T row_mean = mean[row];
+      const T row_inv_variance = inv_variance[row];
+      T lane_dy_sum[kLaneNum] = {0};
+      T lane_dy_normalized_sum[kLaneNum] = {0};
+      int64_t i = 0;
+      for (; i + kLaneNum <= row_size; i += kLaneNum) {
+        for (int64_t j = 0; j < kLaneNum; ++j) {
+          const T normalized = (x_row[i + j] - row_mean) * row_inv_variance;
+          lane_dy_sum[j] += dy_row[i + j];
+          lane_dy_normalized_sum[j] += dy_row[i + j] * normalized;
+        }
+      }
+      T dy_sum = 0;
+      T dy_normalized_sum = 0;
+      for (; i < row_size; ++i) {
+        dy_sum += dy_row[i];
+        dy_normalized_sum += dy_row[i] * (x_row[i] - row_mean) * row_inv_variance;
+      }
+      for (int64_t j = 0; j < kLaneNum; ++j) {
+        dy_sum += lane_dy_sum[j];
+        dy_normalized_sum += lane_dy_normalized_sum[j];
+      }
+      const T dy_mean = dy_sum / row_size;
+      const T dy_normalized_mean = dy_normalized_sum / row_size;
+      for (int64_t k = 0; k < row_size; ++k) {
+        const T normalized = (x_row[k] - row_mean) * row_inv_variance;
+        dx_row[k] = row_inv_variance * (dy_row[k] - dy_mean - normalized * dy_normalized_mean);
+      }
+    }
+  });
+}
+
+template struct LayerNormCpuKernelUtil<float>;
+template struct LayerNormCpuKernelUtil<double>;
+
+}  // namespace oneflow
@@ -0,0 +1,38 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+
+namespace oneflow {
+
+// Layer norm over num_rows rows of row_size contiguous elements, with the semantics of the cudnn
+// batch norm the GPU kernels use: biased variance and inv_variance = 1 / sqrt(variance + eps).
+template<typename T>
+struct LayerNormCpuKernelUtil {
+  // normalized may alias y. gamma and beta are optional, both have instance_size elements and
+  // repeat along the flattened x.
+  static void Forward(int64_t num_rows, int64_t row_size, double epsilon, const T* x,
+                      const T* gamma, const T* beta, int64_t instance_size, T* mean,
+                      T* inv_variance, T* normalized, T* y);
+  static void Backward(int64_t num_rows, int64_t row_size, const T* dy, const T* x, const T* mean,
+                       const T* inv_variance, T* dx);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_KERNEL_UTIL_H_
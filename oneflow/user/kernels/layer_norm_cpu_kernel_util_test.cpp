@@ -0,0 +1,165 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/layer_norm_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+const double kEpsilon = 1e-5;
+
+template<typename T>
+std::vector<T> RandomVector(int64_t n, T offset) {
+  std::mt19937 gen(n);
+  std::normal_distribution<double> dis(0, 2);
+  std::vector<T> vec(n);
+  for (T& val : vec) { val = offset + dis(gen); }
+  return vec;
+}
+
+// two-pass reference in double precision
+void NaiveForward(int64_t num_rows, int64_t row_size, const std::vector<float>& x,
+                  const std::vector<float>& gamma, const std::vector<float>& beta,
+                  std::vector<double>* mean, std::vector<double>* inv_variance,
+                  std::vector<double>* y) {
+  FOR_RANGE(int64_t, row, 0, num_rows) {
+    double sum = 0;
+    FOR_RANGE(int64_t, i, 0, row_size) { sum += x.at(row * row_size + i); }
+    const double row_mean = sum / row_size;
+    double square_sum = 0;
+    FOR_RANGE(int64_t, i, 0, row_size) {
+      const double diff = x.at(row * row_size + i) - row_mean;
+      square_sum += diff * diff;
+    }
+    const double row_inv_variance = 1.0 / std::sqrt(square_sum / row_size + kEpsilon);
+    mean->push_back(row_mean);
+    inv_variance->push_back(row_inv_variance);
+    FOR_RANGE(int64_t, i, 0, row_size) {
+      const int64_t param_idx = (row * row_size + i) % gamma.size();
+      y->push_back((x.at(row * row_size + i) - row_mean) * row_inv_variance * gamma.at(param_idx)
+                   + beta.at(param_idx));
+    }
+  }
+}
+
+void NaiveBackward(int64_t num_rows, int64_t row_size, const std::vector<float>& dy,
+                   const std::vector<float>& x, const std::vector<double>& mean,
+                   const std::vector<double>& inv_variance, std::vector<double>* dx) {
+  FOR_RANGE(int64_t, row, 0, num_rows) {
+    double dy_sum = 0;
+    double dy_normalized_sum = 0;
+    FOR_RANGE(int64_t, i, 0, row_size) {
+      const int64_t idx = row * row_size + i;
+      dy_sum += dy.at(idx);
+      dy_normalized_sum += dy.at(idx) * (x.at(idx) - mean.at(row)) * inv_variance.at(row);
+    }
+    FOR_RANGE(int64_t, i, 0, row_size) {
+      const int64_t idx = row * row_size + i;
+      const double normalized = (x.at(idx) - mean.at(row)) * inv_variance.at(row);
+      dx->push_back(inv_variance.at(row)
+                    * (dy.at(idx) - dy_sum / row_size - normalized * dy_normalized_sum / row_size));
+    }
+  }
+}
+
+void CheckLayerNorm(int64_t num_rows, int64_t row_size, int64_t instance_size) {
+  const int64_t elem_cnt = num_rows * row_size;
+  // a large offset makes a naive sum-of-squares variance lose most of its digits
+  const std::vector<float> x = RandomVector<float>(elem_cnt, 1000);
+  const std::vector<float> dy = RandomVector<float>(elem_cnt, 0);
+  const std::vector<float> gamma = RandomVector<float>(instance_size, 1);
+  const std::vector<float> beta = RandomVector<float>(instance_size, 0);
+  std::vector<float> mean(num_rows);
+  std::vector<float> inv_variance(num_rows);
+  std::vector<float> normalized(elem_cnt);
+  std::vector<float> y(elem_cnt);
+  std::vector<float> dx(elem_cnt);
+  LayerNormCpuKernelUtil<float>::Forward(num_rows, row_size, kEpsilon, x.data(), gamma.data(),
+                                         beta.data(), instance_size, mean.data(),
+                                         inv_variance.data(), normalized.data(), y.data());
+  LayerNormCpuKernelUtil<float>::Backward(num_rows, row_size, dy.data(), x.data(), mean.data(),
+                                          inv_variance.data(), dx.data());
+  std::vector<double> expected_mean;
+  std::vector<double> expected_inv_variance;
+  std::vector<double> expected_y;
+  std::vector<double> expected_dx;
+  NaiveForward(num_rows, row_size, x, gamma, beta, &expected_mean, &expected_inv_variance,
+               &expected_y);
+  NaiveBackward(num_rows, row_size, dy, x, expected_mean, expected_inv_variance, &expected_dx);
+  FOR_RANGE(int64_t, row, 0, num_rows) {
+    ASSERT_NEAR(mean.at(row), expected_mean.at(row), 1e-3);
+    ASSERT_NEAR(inv_variance.at(row), expected_inv_variance.at(row),
+                1e-4 * expected_inv_variance.at(row));
+  }
+  FOR_RANGE(int64_t, i, 0, elem_cnt) {
+    ASSERT_NEAR(y.at(i), expected_y.at(i), 1e-2);
+    ASSERT_NEAR(dx.at(i), expected_dx.at(i), 1e-3);
+  }
+}
+
+double ForwardBackwardSeconds(int64_t num_rows, int64_t row_size) {
+  const int64_t elem_cnt = num_rows * row_size;
+  const std::vector<float> x = RandomVector<float>(elem_cnt, 0);
+  const std::vector<float> gamma = RandomVector<float>(row_size, 1);
+  const std::vector<float> beta = RandomVector<float>(row_size, 0);
+  std::vector<float> mean(num_rows);
+  std::vector<float> inv_variance(num_rows);
+  std::vector<float> normalized(elem_cnt);
+  std::vector<float> y(elem_cnt);
+  std::vector<float> dx(elem_cnt);
+  const auto start = std::chrono::steady_clock::now();
+  LayerNormCpuKernelUtil<float>::Forward(num_rows, row_size, kEpsilon, x.data(), gamma.data(),
+                                         beta.data(), row_size, mean.data(), inv_variance.data(),
+                                         normalized.data(), y.data());
+  LayerNormCpuKernelUtil<float>::Backward(num_rows, row_size, y.data(), x.data(), mean.data(),
+                                          inv_variance.data(), dx.data());
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}  // namespace
+
+TEST(LayerNormCpuKernelUtil, forward_backward) {
+  CheckLayerNorm(33, 1031, 1031);
+  CheckLayerNorm(7, 5, 5);
+  // parameters spanning several rows, and several parameter rows per normalized row
+  CheckLayerNorm(12, 64, 256);
+  CheckLayerNorm(12, 256, 64);
+  Global<ThreadPool>::New(4);
+  CheckLayerNorm(517, 768, 768);
+  Global<ThreadPool>::Delete();
+}
+
+TEST(LayerNormCpuKernelUtil, DISABLED_throughput_vs_hidden_size) {
+  Global<ThreadPool>::New(std::thread::hardware_concurrency());
+  const int64_t elem_cnt = 1 << 23;
+  for (int64_t row_size : {768, 1024, 2048, 4096}) {
+    const int64_t num_rows = elem_cnt / row_size;
+    const double sec = ForwardBackwardSeconds(num_rows, row_size);
+    // x, normalized and y in the forward pass, dy, x and dx in the backward pass
+    LOG(INFO) << "hidden size: " << row_size << ", rows: " << num_rows
+              << ", forward + backward: " << sec * 1e3 << " ms, "
+              << num_rows * row_size * sizeof(float) * 6 / sec / 1e9 << " GB/s";
+  }
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -15,9 +15,41 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/model_update_kernel_util.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 
+namespace {
+
+// Rows of an indexed slices update handled by one task, so that a task covers about
+// kCpuNdarrayParallelGrain elements.
+int64_t RowGrain(int64_t row_size) {
+  return std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(row_size, 1), 1);
+}
+
+// Column slices narrower than this are not worth splitting the rows of an update into.
+constexpr int64_t kMinColumnSliceSize = 64;
+
+// Calls Update(tensor, begin, end) on ranges of the elements of the tensors, splitting the
+// elements of all the tensors across the thread pool as one range.
+template<typename T, typename G, typename F>
+void MultiTensorParallelFor(int64_t num_tensors, const MultiTensorUpdateTensor<T, G>* tensors,
+                            const F& Update) {
+  std::vector<int64_t> offsets(num_tensors + 1, 0);
+  FOR_RANGE(int64_t, i, 0, num_tensors) { offsets[i + 1] = offsets[i] + tensors[i].n; }
+  CpuNdarrayParallelFor(offsets.back(), kCpuNdarrayParallelGrain, [&](int64_t begin, int64_t end) {
+    // the last tensor starting at or before begin, empty tensors are skipped over
+    int64_t i = std::upper_bound(offsets.begin(), offsets.end(), begin) - offsets.begin() - 1;
+    for (; i < num_tensors && offsets[i] < end; ++i) {
+      const int64_t tensor_begin = std::max(begin, offsets[i]) - offsets[i];
+      const int64_t tensor_end = std::min(end, offsets[i + 1]) - offsets[i];
+      if (tensor_begin < tensor_end) { Update(tensors[i], tensor_begin, tensor_end); }
+    }
+  });
+}
+
+}  // namespace
+
 template<typename T, typename G>
 struct SGDUpdateKernelUtil<DeviceType::kCPU, T, G> {
   static void Update(DeviceCtx* ctx, int64_t n, float scale, float l1, float l2, float weight_decay,
@@ -30,14 +62,43 @@ void SGDUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(DeviceCtx* ctx, int64_t
                                                          const float* learning_rate,
                                                          const G* model_diff, T* model) {
   const T lr = *learning_rate;
-  for (int64_t i = 0; i != n; ++i) {
-    SGDUpdateFunctor<T, G>()(model_diff + i, model + i, scale, l1, l2, weight_decay, lr);
-  }
+  CpuNdarrayParallelFor(n, kCpuNdarrayParallelGrain, [=](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      SGDUpdateFunctor<T, G>()(model_diff + i, model + i, scale, l1, l2, weight_decay, lr);
+    }
+  });
 }
 
 template struct SGDUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct SGDUpdateKernelUtil<DeviceType::kCPU, float, float16>;
 template struct SGDUpdateKernelUtil<DeviceType::kCPU, double, double>;
 
+template<typename T, typename G>
+struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(DeviceCtx* ctx, int64_t num_tensors, float scale, float l1, float l2,
+                     float weight_decay, const float* learning_rate,
+                     const MultiTensorUpdateTensor<T, G>* tensors);
+};
+
+template<typename T, typename G>
+void MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(
+    DeviceCtx* ctx, int64_t num_tensors, float scale, float l1, float l2, float weight_decay,
+    const float* learning_rate, const MultiTensorUpdateTensor<T, G>* tensors) {
+  const T lr = *learning_rate;
+  MultiTensorParallelFor(
+      num_tensors, tensors,
+      [=](const MultiTensorUpdateTensor<T, G>& tensor, int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, i, begin, end) {
+          SGDUpdateFunctor<T, G>()(tensor.model_diff + i, tensor.model + i, scale, l1, l2,
+                                   weight_decay, lr);
+        }
+      });
+}
+
+template struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, float, float16>;
+template struct MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, double, double>;
+
 template<typename T, typename K>
 struct IndexedSlicesSGDUpdateKernelUtil<DeviceType::kCPU, T, K> {
   static void Update(DeviceCtx* ctx, int64_t num_indices, int64_t num_features,
@@ -50,15 +111,38 @@ void IndexedSlicesSGDUpdateKernelUtil<DeviceType::kCPU, T, K>::Update(
     DeviceCtx* ctx, int64_t num_indices, int64_t num_features, int64_t feature_size,
     int64_t feature_id_offset, const float* learning_rate, const K* indices, const T* values,
     T* model) {
-  FOR_RANGE(int64_t, i, 0, num_indices) {
-    const K feature_id = indices[i];
-    CHECK_GE(feature_id, 0);
-    const K local_feature_id = feature_id - feature_id_offset;
-    if (local_feature_id >= 0 && local_feature_id < num_features) {
-      const T* from = values + i * feature_size;
-      T* to = model + local_feature_id * feature_size;
-      for (int64_t j = 0; j < feature_size; ++j) { to[j] -= from[j] * (*learning_rate); }
+  const T lr = *learning_rate;
+  // indices may repeat, so every model row must be updated by one task only and in the order of
+  // the indices: tasks either take a column slice of all the rows or own a range of model rows
+  const auto UpdateRows = [=](int64_t feature_begin, int64_t feature_end, int64_t col_begin,
+                              int64_t col_end) {
+    FOR_RANGE(int64_t, i, 0, num_indices) {
+      const K feature_id = indices[i];
+      CHECK_GE(feature_id, 0);
+      const int64_t local_feature_id = feature_id - feature_id_offset;
+      if (local_feature_id >= feature_begin && local_feature_id < feature_end) {
+        const T* from = values + i * feature_size;
+        T* to = model + local_feature_id * feature_size;
+        FOR_RANGE(int64_t, j, col_begin, col_end) { to[j] -= from[j] * lr; }
+      }
     }
+  };
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  if (thread_pool == nullptr || num_indices * feature_size <= kCpuNdarrayParallelGrain) {
+    UpdateRows(0, num_features, 0, feature_size);
+  } else if (feature_size >= 2 * kMinColumnSliceSize) {
+    const int64_t col_grain =
+        std::max(kCpuNdarrayParallelGrain / std::max<int64_t>(num_indices, 1), kMinColumnSliceSize);
+    CpuNdarrayParallelFor(feature_size, col_grain, [&](int64_t begin, int64_t end) {
+      UpdateRows(0, num_features, begin, end);
+    });
+  } else {
+    // every task scans all the indices, so have no more tasks than threads
+    const int64_t num_tasks = std::max<int64_t>(thread_pool->thread_num(), 1);
+    const int64_t num_features_per_task = (num_features + num_tasks - 1) / num_tasks;
+    CpuNdarrayParallelFor(num_features, num_features_per_task, [&](int64_t begin, int64_t end) {
+      UpdateRows(begin, end, 0, feature_size);
+    });
   }
 }
 
@@ -81,15 +165,44 @@ void MomentumUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(
     DeviceCtx* ctx, int64_t n, float scale, float l1, float l2, float beta, float weight_decay,
     const float* learning_rate, const G* model_diff, T* model, T* momentum) {
   const T lr = *learning_rate;
-  for (int64_t i = 0; i != n; ++i) {
-    MomentumUpdateFunctor<T, G>()(model_diff + i, model + i, momentum + i, scale, l1, l2, beta,
-                                  weight_decay, lr);
-  }
+  CpuNdarrayParallelFor(n, kCpuNdarrayParallelGrain, [=](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      MomentumUpdateFunctor<T, G>()(model_diff + i, model + i, momentum + i, scale, l1, l2, beta,
+                                    weight_decay, lr);
+    }
+  });
 }
 
 template struct MomentumUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MomentumUpdateKernelUtil<DeviceType::kCPU, float, float16>;
 template struct MomentumUpdateKernelUtil<DeviceType::kCPU, double, double>;
 
+template<typename T, typename G>
+struct MultiTensorMomentumUpdateKernelUtil<DeviceType::kCPU, T, G> {
+  static void Update(DeviceCtx* ctx, int64_t num_tensors, float scale, float l1, float l2,
+                     float beta, float weight_decay, const float* learning_rate,
+                     const MultiTensorUpdateTensor<T, G>* tensors);
+};
+
+template<typename T, typename G>
+void MultiTensorMomentumUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(
+    DeviceCtx* ctx, int64_t num_tensors, float scale, float l1, float l2, float beta,
+    float weight_decay, const float* learning_rate, const MultiTensorUpdateTensor<T, G>* tensors) {
+  const T lr = *learning_rate;
+  MultiTensorParallelFor(
+      num_tensors, tensors,
+      [=](const MultiTensorUpdateTensor<T, G>& tensor, int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, i, begin, end) {
+          MomentumUpdateFunctor<T, G>()(tensor.model_diff + i, tensor.model + i,
+                                        tensor.state + i, scale, l1, l2, beta, weight_decay, lr);
+        }
+      });
+}
+
+template struct MultiTensorMomentumUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct MultiTensorMomentumUpdateKernelUtil<DeviceType::kCPU, float, float16>;
+template struct MultiTensorMomentumUpdateKernelUtil<DeviceType::kCPU, double, double>;
+
 template<typename T, typename K, typename IDX>
 struct IndexedSlicesMomentumMdUpdateKernelUtil<DeviceType::kCPU, T, K, IDX> {
   static void Update(DeviceCtx* ctx, T beta, int64_t num_instance, int64_t feature_size,
@@ -103,18 +216,23 @@ void IndexedSlicesMomentumMdUpdateKernelUtil<DeviceType::kCPU, T, K, IDX>::Updat
     DeviceCtx* ctx, T beta, int64_t num_instance, int64_t feature_size, int64_t lower_bound,
     int64_t upper_bound, const IDX* num_unique_instance, const float* learning_rate,
     const K* indices, const T* values, T* model, T* momentum) {
-  const int64_t n = *num_unique_instance * feature_size;
   const T lr = *learning_rate;
-  for (int64_t i = 0; i != n; ++i) {
-    const IDX indices_idx = i / feature_size;
-    const IDX inner_idx = i - indices_idx * feature_size;
-    const IDX instance_id = indices[indices_idx];
-    if (instance_id >= lower_bound && instance_id < upper_bound) {
-      const IDX model_idx = (instance_id - lower_bound) * feature_size + inner_idx;
-      MomentumUpdateFunctor<T, T>()(values + i, model + model_idx, momentum + model_idx, 1.0, 0.0,
-                                    0.0, beta, 0.0, lr);
+  const auto UpdateRows = [=](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      const K instance_id = indices[i];
+      if (instance_id < lower_bound || instance_id >= upper_bound) { continue; }
+      const T* row_values = values + i * feature_size;
+      const int64_t model_offset = (instance_id - lower_bound) * feature_size;
+      T* row_model = model + model_offset;
+      T* row_momentum = momentum + model_offset;
+      FOR_RANGE(int64_t, j, 0, feature_size) {
+        MomentumUpdateFunctor<T, T>()(row_values + j, row_model + j, row_momentum + j, 1.0, 0.0,
+                                      0.0, beta, 0.0, lr);
+      }
     }
-  }
+  };
+  // the indices are unique, rows can be updated in parallel
+  CpuNdarrayParallelFor(*num_unique_instance, RowGrain(feature_size), UpdateRows);
 }
 
 #define INSTANTIATE_INDEXED_SLICES_MOMENTUM_MODEL_UPDATE_KERNEL_UTIL_CPU(                 \
@@ -147,13 +265,16 @@ void AdamUpdateKernelUtil<DeviceType::kCPU, T, G>::Update(
   } else {
     lr = *learning_rate;
   }
-  FOR_RANGE(int64_t, i, 0, n) {
-    AdamUpdateFunctor<T, G>()(model_diff + i, model + i, m + i, v + i, scale, l1, l2, beta1, beta2,
-                              epsilon, weight_decay, lr);
-  }
+  CpuNdarrayParallelFor(n, kCpuNdarrayParallelGrain, [=](int64_t begin, int64_t end) {
+    FOR_RANGE(int64_t, i, begin, end) {
+      AdamUpdateFunctor<T, G>()(model_diff + i, model + i, m + i, v + i, scale, l1, l2, beta1,
+                                beta2, epsilon, weight_decay, lr);
+    }
+  });
 }
 
 template struct AdamUpdateKernelUtil<DeviceType::kCPU, float, float>;
+template struct AdamUpdateKernelUtil<DeviceType::kCPU, float, float16>;
 template struct AdamUpdateKernelUtil<DeviceType::kCPU, double, double>;
 
 template<typename T, typename K, typename IDX>
@@ -171,17 +292,23 @@ struct IndexedSlicesAdamMdUpdateKernelUtil<DeviceType::kCPU, T, K, IDX> {
     } else {
       lr = *learning_rate;
     }
-    const int64_t n = *num_unique_instance * feature_size;
-    FOR_RANGE(int64_t, i, 0, n) {
-      const IDX indices_idx = i / feature_size;
-      const IDX inner_idx = i - indices_idx * feature_size;
-      const IDX instance_id = indices[indices_idx];
-      if (instance_id >= lower_bound && instance_id < upper_bound) {
-        const IDX model_idx = (instance_id - lower_bound) * feature_size + inner_idx;
-        AdamUpdateFunctor<T, T>()(values + i, model + model_idx, m + model_idx, v + model_idx, 1, 0,
-                                  0, beta1, beta2, epsilon, 0, lr);
+    const auto UpdateRows = [=](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        const K instance_id = indices[i];
+        if (instance_id < lower_bound || instance_id >= upper_bound) { continue; }
+        const T* row_values = values + i * feature_size;
+        const int64_t model_offset = (instance_id - lower_bound) * feature_size;
+        T* row_model = model + model_offset;
+        T* row_m = m + model_offset;
+        T* row_v = v + model_offset;
+        FOR_RANGE(int64_t, j, 0, feature_size) {
+          AdamUpdateFunctor<T, T>()(row_values + j, row_model + j, row_m + j, row_v + j, 1, 0, 0,
+                                    beta1, beta2, epsilon, 0, lr);
+        }
       }
-    }
+    };
+    // the indices are unique, rows can be updated in parallel
+    CpuNdarrayParallelFor(*num_unique_instance, RowGrain(feature_size), UpdateRows);
   }
 };
 
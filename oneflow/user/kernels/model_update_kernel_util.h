@@ -95,6 +95,33 @@ struct MomentumUpdateKernelUtil {
                      T* momentum);
 };
 
+// One variable of a multi-tensor update. state is the momentum of a momentum update and is
+// unused by SGD.
+template<typename T, typename G>
+struct MultiTensorUpdateTensor {
+  int64_t n;
+  const G* model_diff;
+  T* model;
+  T* state;
+};
+
+// Update many variables sharing the hyperparameters in one call. The elements of all the
+// variables are split across the thread pool as one range, so variables too small to be
+// parallelized on their own still share the threads.
+template<DeviceType device_type, typename T, typename G>
+struct MultiTensorSGDUpdateKernelUtil {
+  static void Update(DeviceCtx* ctx, int64_t num_tensors, float scale, float l1, float l2,
+                     float weight_decay, const float* learning_rate,
+                     const MultiTensorUpdateTensor<T, G>* tensors);
+};
+
+template<DeviceType device_type, typename T, typename G>
+struct MultiTensorMomentumUpdateKernelUtil {
+  static void Update(DeviceCtx* ctx, int64_t num_tensors, float scale, float l1, float l2,
+                     float beta, float weight_decay, const float* learning_rate,
+                     const MultiTensorUpdateTensor<T, G>* tensors);
+};
+
 template<DeviceType device_type, typename T, typename K, typename IDX>
 struct IndexedSlicesMomentumMdUpdateKernelUtil {
   static void Update(DeviceCtx* ctx, T beta, int64_t num_instance, int64_t feature_size,
@@ -0,0 +1,186 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/model_update_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+std::vector<float> RandomVector(int64_t n) {
+  std::mt19937 gen(n);
+  std::uniform_real_distribution<float> dis(-1, 1);
+  std::vector<float> vec(n);
+  for (float& val : vec) { val = dis(gen); }
+  return vec;
+}
+
+// indices in [0, 2 * num_features) with repeats, half of them fall out of the local model
+std::vector<int32_t> RandomIndices(int64_t n, int64_t num_features) {
+  std::mt19937 gen(n + num_features);
+  std::uniform_int_distribution<int32_t> dis(0, 2 * num_features - 1);
+  std::vector<int32_t> vec(n);
+  for (int32_t& val : vec) { val = dis(gen); }
+  return vec;
+}
+
+void CheckIndexedSlicesSGDUpdate(int64_t num_indices, int64_t num_features, int64_t feature_size) {
+  const std::vector<int32_t> indices = RandomIndices(num_indices, num_features);
+  const std::vector<float> values = RandomVector(num_indices * feature_size);
+  std::vector<float> model = RandomVector(num_features * feature_size);
+  std::vector<float> expected = model;
+  const float lr = 0.5;
+  const int64_t feature_id_offset = num_features / 2;
+  FOR_RANGE(int64_t, i, 0, num_indices) {
+    const int64_t row = indices.at(i) - feature_id_offset;
+    if (row < 0 || row >= num_features) { continue; }
+    FOR_RANGE(int64_t, j, 0, feature_size) {
+      expected.at(row * feature_size + j) -= values.at(i * feature_size + j) * lr;
+    }
+  }
+  IndexedSlicesSGDUpdateKernelUtil<DeviceType::kCPU, float, int32_t>::Update(
+      nullptr, num_indices, num_features, feature_size, feature_id_offset, &lr, indices.data(),
+      values.data(), model.data());
+  // every row is updated in the order of the indices, so results are exact
+  FOR_RANGE(int64_t, i, 0, num_features * feature_size) { ASSERT_EQ(model.at(i), expected.at(i)); }
+}
+
+void CheckIndexedSlicesMomentumUpdate(int64_t num_unique, int64_t num_features,
+                                      int64_t feature_size) {
+  std::vector<int32_t> indices(num_unique);
+  std::iota(indices.begin(), indices.end(), 0);
+  std::shuffle(indices.begin(), indices.end(), std::mt19937(num_unique));
+  const std::vector<float> values = RandomVector(num_unique * feature_size);
+  std::vector<float> model = RandomVector(num_features * feature_size);
+  std::vector<float> momentum = RandomVector(num_features * feature_size);
+  std::vector<float> expected_model = model;
+  std::vector<float> expected_momentum = momentum;
+  const float lr = 0.25;
+  const float beta = 0.9;
+  const int64_t lower_bound = num_features / 4;
+  const int64_t upper_bound = lower_bound + num_features;
+  FOR_RANGE(int64_t, i, 0, num_unique) {
+    if (indices.at(i) < lower_bound || indices.at(i) >= upper_bound) { continue; }
+    FOR_RANGE(int64_t, j, 0, feature_size) {
+      const int64_t model_idx = (indices.at(i) - lower_bound) * feature_size + j;
+      MomentumUpdateFunctor<float, float>()(&values.at(i * feature_size + j),
+                                            &expected_model.at(model_idx),
+                                            &expected_momentum.at(model_idx), 1, 0, 0, beta, 0,
+                                            lr);
+    }
+  }
+  const int32_t num_unique_instance = num_unique;
+  IndexedSlicesMomentumMdUpdateKernelUtil<DeviceType::kCPU, float, int32_t, int32_t>::Update(
+      nullptr, beta, num_unique, feature_size, lower_bound, upper_bound, &num_unique_instance,
+      &lr, indices.data(), values.data(), model.data(), momentum.data());
+  ASSERT_EQ(model, expected_model);
+  ASSERT_EQ(momentum, expected_momentum);
+}
+
+// many small variables, some empty, and one larger than a task
+std::vector<int64_t> MultiTensorSizes() {
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int64_t> dis(0, 2000);
+  std::vector<int64_t> sizes(300);
+  for (int64_t& size : sizes) { size = dis(gen); }
+  sizes.at(0) = 0;
+  sizes.at(7) = 0;
+  sizes.at(sizes.size() - 1) = 0;
+  sizes.at(100) = 3 * kCpuNdarrayParallelGrain + 5;
+  return sizes;
+}
+
+}  // namespace
+
+TEST(ModelUpdateKernelUtil, multi_tensor_sgd_and_momentum_update) {
+  const std::vector<int64_t> sizes = MultiTensorSizes();
+  std::vector<std::vector<float>> diffs;
+  std::vector<std::vector<float>> models;
+  std::vector<std::vector<float>> momentums;
+  for (int64_t size : sizes) {
+    diffs.push_back(RandomVector(size));
+    models.push_back(RandomVector(size));
+    momentums.push_back(std::vector<float>(size, 0.5));
+  }
+  std::vector<std::vector<float>> expected_models = models;
+  std::vector<std::vector<float>> expected_momentums = momentums;
+  std::vector<MultiTensorUpdateTensor<float, float>> tensors;
+  FOR_RANGE(size_t, i, 0, sizes.size()) {
+    tensors.push_back({sizes.at(i), diffs.at(i).data(), models.at(i).data(),
+                       momentums.at(i).data()});
+  }
+  const float lr = 0.1;
+  Global<ThreadPool>::New(4);
+  FOR_RANGE(size_t, i, 0, sizes.size()) {
+    SGDUpdateKernelUtil<DeviceType::kCPU, float, float>::Update(
+        nullptr, sizes.at(i), 2, 0.001, 0.002, 0.01, &lr, diffs.at(i).data(),
+        expected_models.at(i).data());
+    MomentumUpdateKernelUtil<DeviceType::kCPU, float, float>::Update(
+        nullptr, sizes.at(i), 2, 0.001, 0.002, 0.9, 0.01, &lr, diffs.at(i).data(),
+        expected_models.at(i).data(), expected_momentums.at(i).data());
+  }
+  MultiTensorSGDUpdateKernelUtil<DeviceType::kCPU, float, float>::Update(
+      nullptr, tensors.size(), 2, 0.001, 0.002, 0.01, &lr, tensors.data());
+  MultiTensorMomentumUpdateKernelUtil<DeviceType::kCPU, float, float>::Update(
+      nullptr, tensors.size(), 2, 0.001, 0.002, 0.9, 0.01, &lr, tensors.data());
+  Global<ThreadPool>::Delete();
+  // every element goes through the same functor, so results are exact
+  ASSERT_EQ(models, expected_models);
+  ASSERT_EQ(momentums, expected_momentums);
+}
+
+TEST(ModelUpdateKernelUtil, indexed_slices_sgd_update) {
+  CheckIndexedSlicesSGDUpdate(7, 5, 3);
+  Global<ThreadPool>::New(4);
+  // one task, column slices and model row ranges
+  CheckIndexedSlicesSGDUpdate(100, 20, 16);
+  CheckIndexedSlicesSGDUpdate(4096, 64, 512);
+  CheckIndexedSlicesSGDUpdate(65536, 1000, 8);
+  Global<ThreadPool>::Delete();
+}
+
+TEST(ModelUpdateKernelUtil, indexed_slices_momentum_update) {
+  Global<ThreadPool>::New(4);
+  CheckIndexedSlicesMomentumUpdate(10, 8, 4);
+  CheckIndexedSlicesMomentumUpdate(20000, 16000, 32);
+  Global<ThreadPool>::Delete();
+}
+
+TEST(ModelUpdateKernelUtil, sgd_update_with_half_gradient) {
+  const int64_t n = 100000;
+  const std::vector<float> diff = RandomVector(n);
+  std::vector<float16> half_diff(n);
+  std::transform(diff.begin(), diff.end(), half_diff.begin(),
+                 [](float val) { return static_cast<float16>(val); });
+  std::vector<float> model = RandomVector(n);
+  std::vector<float> expected = model;
+  const float lr = 0.1;
+  FOR_RANGE(int64_t, i, 0, n) {
+    expected.at(i) -= lr * (static_cast<float>(half_diff.at(i)) * 2 + 0.01f * expected.at(i));
+  }
+  Global<ThreadPool>::New(4);
+  SGDUpdateKernelUtil<DeviceType::kCPU, float, float16>::Update(
+      nullptr, n, 2, 0, 0.01, 0, &lr, half_diff.data(), model.data());
+  Global<ThreadPool>::Delete();
+  FOR_RANGE(int64_t, i, 0, n) { ASSERT_NEAR(model.at(i), expected.at(i), 1e-6); }
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -137,6 +137,7 @@ class SGDUpdateKernel final : public user_op::OpKernel {
                        & (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
 
 REGISTER_SGD_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_SGD_UPDATE_KERNEL(DeviceType::kCPU, float, float16);
 REGISTER_SGD_UPDATE_KERNEL(DeviceType::kCPU, double, double);
 #ifdef WITH_CUDA
 REGISTER_SGD_UPDATE_KERNEL(DeviceType::kGPU, float, float16);
@@ -233,6 +234,7 @@ class MomentumUpdateKernel final : public user_op::OpKernel {
                        & (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
 
 REGISTER_MOMENTUM_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_MOMENTUM_UPDATE_KERNEL(DeviceType::kCPU, float, float16);
 REGISTER_MOMENTUM_UPDATE_KERNEL(DeviceType::kCPU, double, double);
 #ifdef WITH_CUDA
 REGISTER_MOMENTUM_UPDATE_KERNEL(DeviceType::kGPU, float, float16);
@@ -350,6 +352,7 @@ class AdamUpdateKernel final : public user_op::OpKernel {
                        & (user_op::HobDataType("model_diff", 0) == GetDataType<gtype>::value));
 
 REGISTER_ADAM_UPDATE_KERNEL(DeviceType::kCPU, float, float);
+REGISTER_ADAM_UPDATE_KERNEL(DeviceType::kCPU, float, float16);
 REGISTER_ADAM_UPDATE_KERNEL(DeviceType::kCPU, double, double);
 #ifdef WITH_CUDA
 REGISTER_ADAM_UPDATE_KERNEL(DeviceType::kGPU, float, float16);
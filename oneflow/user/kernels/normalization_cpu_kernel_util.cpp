@@ -0,0 +1,194 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
+
+namespace oneflow {
+
+namespace {
+
+int64_t TaskGrain(int64_t elem_cnt_per_task) {
+  return std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(elem_cnt_per_task, 1), 1);
+}
+
+// Calls fn(i, c) for every element i of channel c. Tasks are the (outer, channel) planes when
+// they are contiguous and whole rows of channels otherwise, so the innermost loop is always
+// unit stride.
+template<typename Fn>
+void ForEachElement(int64_t outer, int64_t channels, int64_t inner, const Fn& fn) {
+  if (inner != 1) {
+    CpuNdarrayParallelFor(outer * channels, TaskGrain(inner), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, plane, begin, end) {
+        const int64_t c = plane % channels;
+        const int64_t offset = plane * inner;
+        FOR_RANGE(int64_t, i, offset, offset + inner) { fn(i, c); }
+      }
+    });
+  } else {
+    CpuNdarrayParallelFor(outer, TaskGrain(channels), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, row, begin, end) {
+        const int64_t offset = row * channels;
+        FOR_RANGE(int64_t, c, 0, channels) { fn(offset + c, c); }
+      }
+    });
+  }
+}
+
+// sums[c * K + k] = sum over the elements i of channel c of the k-th value fn(i, c, acc) adds to
+// acc. Partial sums of planes or row blocks are combined in a fixed order afterwards, so the
+// result does not depend on how the work was scheduled.
+template<typename T, int K, typename Fn>
+void ReducePerChannel(int64_t outer, int64_t channels, int64_t inner, const Fn& fn, T* sums) {
+  std::vector<T> partials;
+  int64_t num_partials = 0;
+  if (inner != 1) {
+    num_partials = outer;
+    partials.resize(outer * channels * K);
+    CpuNdarrayParallelFor(outer * channels, TaskGrain(inner), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, plane, begin, end) {
+        const int64_t c = plane % channels;
+        const int64_t offset = plane * inner;
+        T acc[K] = {};
+        FOR_RANGE(int64_t, i, offset, offset + inner) { fn(i, c, acc); }
+        std::copy(acc, acc + K, partials.data() + plane * K);
+      }
+    });
+  } else {
+    const int64_t num_rows_per_block = std::max<int64_t>(std::min(outer, TaskGrain(channels)), 1);
+    num_partials = (outer + num_rows_per_block - 1) / num_rows_per_block;
+    partials.resize(num_partials * channels * K);
+    CpuNdarrayParallelFor(num_partials, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, block, begin, end) {
+        T* acc = partials.data() + block * channels * K;
+        const int64_t row_end = std::min((block + 1) * num_rows_per_block, outer);
+        FOR_RANGE(int64_t, row, block * num_rows_per_block, row_end) {
+          const int64_t offset = row * channels;
+          FOR_RANGE(int64_t, c, 0, channels) { fn(offset + c, c, acc + c * K); }
+        }
+      }
+    });
+  }
+  std::fill(sums, sums + channels * K, GetZeroVal<T>());
+  FOR_RANGE(int64_t, j, 0, num_partials) {
+    const T* partial = partials.data() + j * channels * K;
+    FOR_RANGE(int64_t, i, 0, channels * K) { sums[i] += partial[i]; }
+  }
+}
+
+}  // namespace
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ComputeMeanAndVariance(int64_t outer, int64_t channels,
+                                                           int64_t inner, const T* x, T* mean,
+                                                           T* variance) {
+  const T inv_num = static_cast<T>(1) / static_cast<T>(std::max<int64_t>(outer * inner, 1));
+  // two passes over x, the second one over centered values, keep the variance stable for
+  // inputs with a large mean
+  ReducePerChannel<T, 1>(
+      outer, channels, inner, [x](int64_t i, int64_t c, T* acc) { acc[0] += x[i]; }, mean);
+  FOR_RANGE(int64_t, c, 0, channels) { mean[c] *= inv_num; }
+  ReducePerChannel<T, 1>(
+      outer, channels, inner,
+      [x, mean](int64_t i, int64_t c, T* acc) {
+        const T diff = x[i] - mean[c];
+        acc[0] += diff * diff;
+      },
+      variance);
+  FOR_RANGE(int64_t, c, 0, channels) { variance[c] *= inv_num; }
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::ScaleShift(int64_t outer, int64_t channels, int64_t inner,
+                                               const T* x, const T* scale, const T* shift,
+                                               const T* addend, bool relu, T* y) {
+  const T zero = GetZeroVal<T>();
+  if (addend == nullptr && !relu) {
+    ForEachElement(outer, channels, inner,
+                   [=](int64_t i, int64_t c) { y[i] = x[i] * scale[c] + shift[c]; });
+  } else if (addend == nullptr) {
+    ForEachElement(outer, channels, inner, [=](int64_t i, int64_t c) {
+      const T val = x[i] * scale[c] + shift[c];
+      y[i] = val > zero ? val : zero;
+    });
+  } else if (!relu) {
+    ForEachElement(outer, channels, inner,
+                   [=](int64_t i, int64_t c) { y[i] = x[i] * scale[c] + shift[c] + addend[i]; });
+  } else {
+    ForEachElement(outer, channels, inner, [=](int64_t i, int64_t c) {
+      const T val = x[i] * scale[c] + shift[c] + addend[i];
+      y[i] = val > zero ? val : zero;
+    });
+  }
+}
+
+template<typename T>
+void NormalizationCpuKernelUtil<T>::Backward(int64_t outer, int64_t channels, int64_t inner,
+                                             const T* x, const T* dy, const T* relu_y,
+                                             const T* mean, const T* inv_variance, const T* gamma,
+                                             T* gamma_diff, T* beta_diff, T* relu_dy, T* dx) {
+  const T zero = GetZeroVal<T>();
+  // sums[2 * c] is sum(dy), sums[2 * c + 1] is sum(dy * (x - mean))
+  std::vector<T> sums(channels * 2);
+  if (relu_y == nullptr) {
+    ReducePerChannel<T, 2>(
+        outer, channels, inner,
+        [=](int64_t i, int64_t c, T* acc) {
+          acc[0] += dy[i];
+          acc[1] += dy[i] * (x[i] - mean[c]);
+        },
+        sums.data());
+  } else {
+    ReducePerChannel<T, 2>(
+        outer, channels, inner,
+        [=](int64_t i, int64_t c, T* acc) {
+          const T masked_dy = relu_y[i] > zero ? dy[i] : zero;
+          if (relu_dy != nullptr) { relu_dy[i] = masked_dy; }
+          acc[0] += masked_dy;
+          acc[1] += masked_dy * (x[i] - mean[c]);
+        },
+        sums.data());
+  }
+  const T inv_num = static_cast<T>(1) / static_cast<T>(std::max<int64_t>(outer * inner, 1));
+  // dx = gamma * inv_variance * (dy - mean(dy) - normalized * mean(dy * normalized))
+  std::vector<T> dy_scale(channels);
+  std::vector<T> x_scale(channels);
+  std::vector<T> bias(channels);
+  FOR_RANGE(int64_t, c, 0, channels) {
+    beta_diff[c] = sums[2 * c];
+    gamma_diff[c] = sums[2 * c + 1] * inv_variance[c];
+    dy_scale[c] = gamma[c] * inv_variance[c];
+    x_scale[c] = -dy_scale[c] * gamma_diff[c] * inv_variance[c] * inv_num;
+    bias[c] = -dy_scale[c] * beta_diff[c] * inv_num - x_scale[c] * mean[c];
+  }
+  const T* dy_scale_ptr = dy_scale.data();
+  const T* x_scale_ptr = x_scale.data();
+  const T* bias_ptr = bias.data();
+  if (relu_y == nullptr) {
+    ForEachElement(outer, channels, inner, [=](int64_t i, int64_t c) {
+      dx[i] = dy[i] * dy_scale_ptr[c] + x[i] * x_scale_ptr[c] + bias_ptr[c];
+    });
+  } else {
+    ForEachElement(outer, channels, inner, [=](int64_t i, int64_t c) {
+      const T masked_dy = relu_y[i] > zero ? dy[i] : zero;
+      dx[i] = masked_dy * dy_scale_ptr[c] + x[i] * x_scale_ptr[c] + bias_ptr[c];
+    });
+  }
+}
+
+template struct NormalizationCpuKernelUtil<float>;
+template struct NormalizationCpuKernelUtil<double>;
+
+}  // namespace oneflow
@@ -0,0 +1,44 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+
+namespace oneflow {
+
+// Batch norm over a tensor viewed as (outer, channels, inner), e.g. (N, C, H * W) for NCHW with
+// axis 1 and (N * H * W, C, 1) for NHWC with axis 3. Per channel parameters have channels
+// elements.
+template<typename T>
+struct NormalizationCpuKernelUtil {
+  // biased variance, as cudnn reports it
+  static void ComputeMeanAndVariance(int64_t outer, int64_t channels, int64_t inner, const T* x,
+                                     T* mean, T* variance);
+  // y = x * scale + shift, plus addend and then relu when asked for. addend is optional and
+  // may alias y.
+  static void ScaleShift(int64_t outer, int64_t channels, int64_t inner, const T* x,
+                         const T* scale, const T* shift, const T* addend, bool relu, T* y);
+  // y is only read when relu_y is set, in which case dy is masked by y > 0 first and written to
+  // relu_dy if that is not null.
+  static void Backward(int64_t outer, int64_t channels, int64_t inner, const T* x, const T* dy,
+                       const T* relu_y, const T* mean, const T* inv_variance, const T* gamma,
+                       T* gamma_diff, T* beta_diff, T* relu_dy, T* dx);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_NORMALIZATION_CPU_KERNEL_UTIL_H_
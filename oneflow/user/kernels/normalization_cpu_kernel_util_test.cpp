@@ -0,0 +1,165 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+template<typename T>
+std::vector<T> RandomVector(int64_t n, T offset) {
+  std::mt19937 gen(n);
+  std::normal_distribution<double> dis(0, 2);
+  std::vector<T> vec(n);
+  for (T& val : vec) { val = offset + dis(gen); }
+  return vec;
+}
+
+// NCHW (n, c, hw) to NHWC (n, hw, c)
+std::vector<float> ToChannelsLast(int64_t n, int64_t c, int64_t hw, const std::vector<float>& x) {
+  std::vector<float> y(x.size());
+  FOR_RANGE(int64_t, i, 0, n) {
+    FOR_RANGE(int64_t, j, 0, c) {
+      FOR_RANGE(int64_t, k, 0, hw) { y.at((i * hw + k) * c + j) = x.at((i * c + j) * hw + k); }
+    }
+  }
+  return y;
+}
+
+struct NormalizationResult {
+  std::vector<float> mean;
+  std::vector<float> variance;
+  std::vector<float> y;
+  std::vector<float> gamma_diff;
+  std::vector<float> beta_diff;
+  std::vector<float> relu_dy;
+  std::vector<float> dx;
+};
+
+NormalizationResult RunNormalization(int64_t outer, int64_t c, int64_t inner,
+                                     const std::vector<float>& x, const std::vector<float>& dy,
+                                     const std::vector<float>& gamma,
+                                     const std::vector<float>& beta) {
+  NormalizationResult ret;
+  ret.mean.resize(c);
+  ret.variance.resize(c);
+  ret.y.resize(x.size());
+  ret.gamma_diff.resize(c);
+  ret.beta_diff.resize(c);
+  ret.relu_dy.resize(x.size());
+  ret.dx.resize(x.size());
+  NormalizationCpuKernelUtil<float>::ComputeMeanAndVariance(outer, c, inner, x.data(),
+                                                            ret.mean.data(), ret.variance.data());
+  std::vector<float> inv_variance(c);
+  std::vector<float> scale(c);
+  std::vector<float> shift(c);
+  FOR_RANGE(int64_t, i, 0, c) {
+    inv_variance.at(i) = 1.f / std::sqrt(ret.variance.at(i) + 1e-5f);
+    scale.at(i) = gamma.at(i) * inv_variance.at(i);
+    shift.at(i) = beta.at(i) - ret.mean.at(i) * scale.at(i);
+  }
+  NormalizationCpuKernelUtil<float>::ScaleShift(outer, c, inner, x.data(), scale.data(),
+                                                shift.data(), nullptr, true, ret.y.data());
+  NormalizationCpuKernelUtil<float>::Backward(
+      outer, c, inner, x.data(), dy.data(), ret.y.data(), ret.mean.data(), inv_variance.data(),
+      gamma.data(), ret.gamma_diff.data(), ret.beta_diff.data(), ret.relu_dy.data(),
+      ret.dx.data());
+  return ret;
+}
+
+void CheckNormalization(int64_t n, int64_t c, int64_t hw) {
+  const int64_t elem_cnt = n * c * hw;
+  const std::vector<float> x = RandomVector<float>(elem_cnt, 100);
+  const std::vector<float> dy = RandomVector<float>(elem_cnt, 0);
+  const std::vector<float> gamma = RandomVector<float>(c, 1);
+  const std::vector<float> beta = RandomVector<float>(c, 0);
+  const NormalizationResult nchw = RunNormalization(n, c, hw, x, dy, gamma, beta);
+
+  // double precision reference of the channels_first layout
+  const int64_t num = n * hw;
+  FOR_RANGE(int64_t, j, 0, c) {
+    double sum = 0;
+    FOR_RANGE(int64_t, i, 0, n) {
+      FOR_RANGE(int64_t, k, 0, hw) { sum += x.at((i * c + j) * hw + k); }
+    }
+    const double mean = sum / num;
+    double square_sum = 0;
+    FOR_RANGE(int64_t, i, 0, n) {
+      FOR_RANGE(int64_t, k, 0, hw) {
+        const double diff = x.at((i * c + j) * hw + k) - mean;
+        square_sum += diff * diff;
+      }
+    }
+    const double inv_variance = 1.0 / std::sqrt(square_sum / num + 1e-5);
+    ASSERT_NEAR(nchw.mean.at(j), mean, 1e-3);
+    ASSERT_NEAR(nchw.variance.at(j), square_sum / num, 1e-3 * square_sum / num);
+    double dy_sum = 0;
+    double dy_normalized_sum = 0;
+    FOR_RANGE(int64_t, i, 0, n) {
+      FOR_RANGE(int64_t, k, 0, hw) {
+        const int64_t idx = (i * c + j) * hw + k;
+        const double normalized = (x.at(idx) - mean) * inv_variance;
+        const double y = std::max(normalized * gamma.at(j) + beta.at(j), 0.0);
+        ASSERT_NEAR(nchw.y.at(idx), y, 1e-3);
+        const double relu_dy = nchw.y.at(idx) > 0 ? dy.at(idx) : 0;
+        ASSERT_EQ(nchw.relu_dy.at(idx), relu_dy);
+        dy_sum += relu_dy;
+        dy_normalized_sum += relu_dy * normalized;
+      }
+    }
+    ASSERT_NEAR(nchw.beta_diff.at(j), dy_sum, 1e-3 * num);
+    ASSERT_NEAR(nchw.gamma_diff.at(j), dy_normalized_sum, 1e-3 * num);
+    FOR_RANGE(int64_t, i, 0, n) {
+      FOR_RANGE(int64_t, k, 0, hw) {
+        const int64_t idx = (i * c + j) * hw + k;
+        const double normalized = (x.at(idx) - mean) * inv_variance;
+        const double dx = gamma.at(j) * inv_variance
+                          * (nchw.relu_dy.at(idx) - dy_sum / num
+                             - normalized * dy_normalized_sum / num);
+        ASSERT_NEAR(nchw.dx.at(idx), dx, 1e-3);
+      }
+    }
+  }
+
+  // the channels_last layout has to agree with the channels_first one
+  const NormalizationResult nhwc =
+      RunNormalization(n * hw, c, 1, ToChannelsLast(n, c, hw, x), ToChannelsLast(n, c, hw, dy),
+                       gamma, beta);
+  FOR_RANGE(int64_t, j, 0, c) {
+    ASSERT_NEAR(nhwc.mean.at(j), nchw.mean.at(j), 1e-3);
+    ASSERT_NEAR(nhwc.gamma_diff.at(j), nchw.gamma_diff.at(j), 1e-3 * num);
+  }
+  const std::vector<float> nchw_dx = ToChannelsLast(n, c, hw, nchw.dx);
+  FOR_RANGE(int64_t, i, 0, elem_cnt) { ASSERT_NEAR(nhwc.dx.at(i), nchw_dx.at(i), 1e-3); }
+}
+
+}  // namespace
+
+TEST(NormalizationCpuKernelUtil, nchw_and_nhwc) {
+  CheckNormalization(2, 3, 5);
+  CheckNormalization(4, 17, 49);
+  Global<ThreadPool>::New(4);
+  CheckNormalization(8, 64, 28 * 28);
+  CheckNormalization(64, 3, 56 * 56);
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
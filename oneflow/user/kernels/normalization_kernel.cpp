@@ -0,0 +1,277 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/normalization_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// (outer, channels, inner) view of x around axis
+struct NormalizationDims {
+  NormalizationDims(const ShapeView& x_shape, int32_t axis) {
+    CHECK_GE(axis, 0);
+    CHECK_LT(axis, x_shape.NumAxes());
+    outer = x_shape.Count(0, axis);
+    channels = x_shape.At(axis);
+    inner = x_shape.Count(axis + 1);
+  }
+  void CheckParamTensor(const user_op::Tensor* tensor) const {
+    CHECK_EQ(tensor->shape().NumAxes(), 1);
+    CHECK_EQ(tensor->shape().At(0), channels);
+  }
+  int64_t outer;
+  int64_t channels;
+  int64_t inner;
+};
+
+template<typename T>
+class NormalizationInferenceCpuKernel final : public user_op::OpKernel {
+ public:
+  NormalizationInferenceCpuKernel() = default;
+  ~NormalizationInferenceCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const bool training = ctx->Attr<bool>("training");
+    CHECK(!training);
+    const auto* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    auto* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const auto* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const auto* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+    const auto* moving_mean = ctx->Tensor4ArgNameAndIndex("moving_mean", 0);
+    const auto* moving_variance = ctx->Tensor4ArgNameAndIndex("moving_variance", 0);
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    CHECK_EQ(x->shape(), y->shape());
+    CHECK_EQ(y->data_type(), x->data_type());
+    const NormalizationDims dims(x->shape(), ctx->Attr<int32_t>("axis"));
+    dims.CheckParamTensor(gamma);
+    dims.CheckParamTensor(beta);
+    dims.CheckParamTensor(moving_mean);
+    dims.CheckParamTensor(moving_variance);
+
+    // the whole normalization folds into y = x * scale + shift per channel
+    std::vector<T> scale(dims.channels);
+    std::vector<T> shift(dims.channels);
+    FOR_RANGE(int64_t, c, 0, dims.channels) {
+      scale[c] = gamma->dptr<T>()[c] / std::sqrt(moving_variance->dptr<T>()[c] + epsilon);
+      shift[c] = beta->dptr<T>()[c] - moving_mean->dptr<T>()[c] * scale[c];
+    }
+    const T* add_to_output = nullptr;
+    if (ctx->user_op_conf().has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output_tensor =
+          ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output_tensor->data_type(), y->data_type());
+      CHECK_EQ(add_to_output_tensor->shape(), y->shape());
+      add_to_output = add_to_output_tensor->dptr<T>();
+    }
+    NormalizationCpuKernelUtil<T>::ScaleShift(dims.outer, dims.channels, dims.inner,
+                                              x->dptr<T>(), scale.data(), shift.data(),
+                                              add_to_output, false, y->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_BN_INFERENCE_CPU_KERNEL(dtype)                                                 \
+  REGISTER_USER_KERNEL("normalization")                                                         \
+      .SetCreateFn<NormalizationInferenceCpuKernel<dtype>>()                                    \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                       \
+                       & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value)            \
+                       & (user_op::HobAttr<bool>("training") == false))                         \
+      .SetInplaceProposalFn([](const user_op::InferContext& ctx,                                \
+                               user_op::AddInplaceArgPair AddInplaceArgPairFn) -> Maybe<void> { \
+        if (ctx.user_op_conf().has_input("_add_to_output", 0)) {                                \
+          OF_RETURN_IF_ERROR(AddInplaceArgPairFn("y", 0, "_add_to_output", 0, true));           \
+        }                                                                                       \
+        return Maybe<void>::Ok();                                                               \
+      });
+
+REGISTER_BN_INFERENCE_CPU_KERNEL(float)
+REGISTER_BN_INFERENCE_CPU_KERNEL(double)
+
+#undef REGISTER_BN_INFERENCE_CPU_KERNEL
+
+template<typename T>
+class NormalizationTrainCpuKernel final : public user_op::OpKernel {
+ public:
+  NormalizationTrainCpuKernel() = default;
+  ~NormalizationTrainCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const bool add_relu = ctx->user_op_conf().op_type_name() == "normalization_add_relu";
+    if (!add_relu) { CHECK(ctx->Attr<bool>("training")); }
+    const auto* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    auto* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const auto* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    const auto* beta = ctx->Tensor4ArgNameAndIndex("beta", 0);
+    auto* moving_mean = ctx->Tensor4ArgNameAndIndex("moving_mean", 0);
+    auto* moving_variance = ctx->Tensor4ArgNameAndIndex("moving_variance", 0);
+    const auto epsilon = ctx->Attr<float>("epsilon");
+    const auto momentum = ctx->Attr<float>("momentum");
+    CHECK_EQ(x->shape(), y->shape());
+    CHECK_EQ(y->data_type(), x->data_type());
+    const NormalizationDims dims(x->shape(), ctx->Attr<int32_t>("axis"));
+    dims.CheckParamTensor(gamma);
+    dims.CheckParamTensor(beta);
+    dims.CheckParamTensor(moving_mean);
+    dims.CheckParamTensor(moving_variance);
+
+    std::vector<T> mean(dims.channels);
+    std::vector<T> variance(dims.channels);
+    NormalizationCpuKernelUtil<T>::ComputeMeanAndVariance(
+        dims.outer, dims.channels, dims.inner, x->dptr<T>(), mean.data(), variance.data());
+
+    // moving averages follow cudnn, which keeps the unbiased variance
+    const int64_t num = dims.outer * dims.inner;
+    const T unbias = num > 1 ? static_cast<T>(num) / static_cast<T>(num - 1) : static_cast<T>(1);
+    T* moving_mean_ptr = moving_mean->mut_dptr<T>();
+    T* moving_variance_ptr = moving_variance->mut_dptr<T>();
+    std::vector<T> inv_variance(dims.channels);
+    std::vector<T> scale(dims.channels);
+    std::vector<T> shift(dims.channels);
+    FOR_RANGE(int64_t, c, 0, dims.channels) {
+      moving_mean_ptr[c] = momentum * moving_mean_ptr[c] + (1 - momentum) * mean[c];
+      moving_variance_ptr[c] =
+          momentum * moving_variance_ptr[c] + (1 - momentum) * variance[c] * unbias;
+      inv_variance[c] = static_cast<T>(1) / std::sqrt(variance[c] + epsilon);
+      scale[c] = gamma->dptr<T>()[c] * inv_variance[c];
+      shift[c] = beta->dptr<T>()[c] - mean[c] * scale[c];
+    }
+    if (ctx->user_op_conf().has_output("mean", 0)) {
+      auto* mean_tensor = ctx->Tensor4ArgNameAndIndex("mean", 0);
+      dims.CheckParamTensor(mean_tensor);
+      std::copy(mean.cbegin(), mean.cend(), mean_tensor->mut_dptr<T>());
+    }
+    if (ctx->user_op_conf().has_output("inv_variance", 0)) {
+      auto* inv_variance_tensor = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+      dims.CheckParamTensor(inv_variance_tensor);
+      std::copy(inv_variance.cbegin(), inv_variance.cend(), inv_variance_tensor->mut_dptr<T>());
+    }
+
+    const T* addend = nullptr;
+    if (ctx->user_op_conf().has_input("_add_to_output", 0)) {
+      CHECK(!add_relu);
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), y->data_type());
+      CHECK_EQ(add_to_output->shape(), y->shape());
+      addend = add_to_output->dptr<T>();
+    } else if (add_relu && ctx->user_op_conf().has_input("addend", 0)) {
+      addend = ctx->Tensor4ArgNameAndIndex("addend", 0)->dptr<T>();
+    }
+    NormalizationCpuKernelUtil<T>::ScaleShift(dims.outer, dims.channels, dims.inner,
+                                              x->dptr<T>(), scale.data(), shift.data(), addend,
+                                              add_relu, y->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_BN_TRAIN_CPU_KERNEL(dtype)                                                     \
+  REGISTER_USER_KERNEL("normalization")                                                         \
+      .SetCreateFn<NormalizationTrainCpuKernel<dtype>>()                                        \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                                       \
+                       & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value)            \
+                       & (user_op::HobAttr<bool>("training") == true))                          \
+      .SetInplaceProposalFn([](const user_op::InferContext& ctx,                                \
+                               user_op::AddInplaceArgPair AddInplaceArgPairFn) -> Maybe<void> { \
+        if (ctx.user_op_conf().has_input("_add_to_output", 0)) {                                \
+          OF_RETURN_IF_ERROR(AddInplaceArgPairFn("y", 0, "_add_to_output", 0, true));           \
+        }                                                                                       \
+        return Maybe<void>::Ok();                                                               \
+      });
+
+REGISTER_BN_TRAIN_CPU_KERNEL(float)
+REGISTER_BN_TRAIN_CPU_KERNEL(double)
+
+#define REGISTER_BN_ADD_RELU_CPU_KERNEL(dtype)                                        \
+  REGISTER_USER_KERNEL("normalization_add_relu")                                      \
+      .SetCreateFn<NormalizationTrainCpuKernel<dtype>>()                              \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                             \
+                       & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value));
+
+REGISTER_BN_ADD_RELU_CPU_KERNEL(float)
+REGISTER_BN_ADD_RELU_CPU_KERNEL(double)
+
+template<typename T>
+class NormalizationGradCpuKernel final : public user_op::OpKernel {
+ public:
+  NormalizationGradCpuKernel() = default;
+  ~NormalizationGradCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    auto* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const auto* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const auto* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+    auto* gamma_diff = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0);
+    auto* beta_diff = ctx->Tensor4ArgNameAndIndex("beta_diff", 0);
+    const auto* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const auto* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    CHECK_EQ(dy->shape(), x->shape());
+    CHECK_EQ(dy->data_type(), x->data_type());
+    CHECK_EQ(dx->shape(), x->shape());
+    CHECK_EQ(dx->data_type(), x->data_type());
+    const NormalizationDims dims(x->shape(), ctx->Attr<int32_t>("axis"));
+    dims.CheckParamTensor(gamma);
+    dims.CheckParamTensor(gamma_diff);
+    dims.CheckParamTensor(beta_diff);
+    dims.CheckParamTensor(mean);
+    dims.CheckParamTensor(inv_variance);
+
+    // the relu mask is applied on the fly instead of materializing the relu grad first
+    const T* relu_y = nullptr;
+    T* relu_dy = nullptr;
+    if (ctx->user_op_conf().op_type_name() == "normalization_add_relu_grad") {
+      relu_y = ctx->Tensor4ArgNameAndIndex("y", 0)->dptr<T>();
+      if (ctx->user_op_conf().has_output("addend_diff", 0)) {
+        relu_dy = ctx->Tensor4ArgNameAndIndex("addend_diff", 0)->mut_dptr<T>();
+      }
+    } else {
+      CHECK_EQ(ctx->user_op_conf().op_type_name(), "normalization_grad");
+    }
+    NormalizationCpuKernelUtil<T>::Backward(
+        dims.outer, dims.channels, dims.inner, x->dptr<T>(), dy->dptr<T>(), relu_y,
+        mean->dptr<T>(), inv_variance->dptr<T>(), gamma->dptr<T>(), gamma_diff->mut_dptr<T>(),
+        beta_diff->mut_dptr<T>(), relu_dy, dx->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_BN_GRAD_CPU_KERNEL(dtype)                                             \
+  REGISTER_USER_KERNEL("normalization_grad")                                           \
+      .SetCreateFn<NormalizationGradCpuKernel<dtype>>()                                \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                              \
+                       & (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value));
+
+REGISTER_BN_GRAD_CPU_KERNEL(float)
+REGISTER_BN_GRAD_CPU_KERNEL(double)
+
+#define REGISTER_BN_ADD_RELU_GRAD_CPU_KERNEL(dtype)                                    \
+  REGISTER_USER_KERNEL("normalization_add_relu_grad")                                  \
+      .SetCreateFn<NormalizationGradCpuKernel<dtype>>()                                \
+      .SetIsMatchedHob((user_op::HobDeviceTag() == "cpu")                              \
+                       & (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value));
+
+REGISTER_BN_ADD_RELU_GRAD_CPU_KERNEL(float)
+REGISTER_BN_ADD_RELU_GRAD_CPU_KERNEL(double)
+
+}  // namespace
+
+}  // namespace oneflow
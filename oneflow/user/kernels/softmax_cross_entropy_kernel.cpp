@@ -15,33 +15,50 @@ limitations under the License.
 */
 #include "oneflow/user/kernels/softmax_cross_entropy_kernel.h"
 #include "oneflow/core/kernel/kernel_util.cuh"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 namespace user_op {
 
+namespace {
+
+int64_t RowGrain(int64_t num_classes) {
+  return std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(num_classes, 1), 1);
+}
+
+}  // namespace
+
 template<typename T>
 struct CrossEntropyKernelUtil<DeviceType::kCPU, T> {
   static void ComputeEntropy(DeviceCtx* ctx, const int64_t num_instances, const int64_t num_classes,
                              const T* x, const T* labels, T* y) {
-    FOR_RANGE(int64_t, i, 0, num_instances) {
-      T tmp = 0;
-      FOR_RANGE(int64_t, j, 0, num_classes) {
-        T label = labels[i * num_classes + j];
-        T prob = x[i * num_classes + j];
-        // tmp -= label * SafeLog(prob);
-        tmp -= label * logf((prob > 1e-20) ? prob : 1e-20);
+    CpuNdarrayParallelFor(num_instances, RowGrain(num_classes), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        T tmp = 0;
+        FOR_RANGE(int64_t, j, 0, num_classes) {
+          T label = labels[i * num_classes + j];
+          T prob = x[i * num_classes + j];
+          // tmp -= label * SafeLog(prob);
+          tmp -= label * logf((prob > 1e-20) ? prob : 1e-20);
+        }
+        y[i] = tmp;
       }
-      y[i] = tmp;
-    }
+    });
   }
 
   static void ComputeDiffWithSoftmax(DeviceCtx* ctx, const int64_t elem_cnt,
                                      const int64_t num_classes, const T* prob, const T* labels,
                                      const T* dy, T* dx) {
-    FOR_RANGE(int64_t, i, 0, elem_cnt) {
-      const int32_t row_id = i / num_classes;
-      dx[i] = dy[row_id] * (prob[i] - labels[i]);
-    }
+    if (num_classes == 0) { return; }
+    const int64_t num_instances = elem_cnt / num_classes;
+    CpuNdarrayParallelFor(num_instances, RowGrain(num_classes), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, row_id, begin, end) {
+        const int64_t offset = row_id * num_classes;
+        FOR_RANGE(int64_t, i, offset, offset + num_classes) {
+          dx[i] = dy[row_id] * (prob[i] - labels[i]);
+        }
+      }
+    });
   }
 };
 
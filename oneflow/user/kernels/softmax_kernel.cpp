@@ -33,11 +33,13 @@ class SoftmaxKernel final : public user_op::OpKernel {
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
     const int64_t num_classes = in->shape().At(in->shape().NumAxes() - 1);
     const int64_t num_instances = in->shape().Count(0, in->shape().NumAxes() - 1);
+    // the CPU softmax needs no temp storage, in which case there is no tmp_buffer
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
-    const size_t temp_storage_bytes = tmp_buffer->shape().elem_cnt();
+    void* temp_storage = tmp_buffer == nullptr ? nullptr : tmp_buffer->mut_dptr();
+    const size_t temp_storage_bytes = tmp_buffer == nullptr ? 0 : tmp_buffer->shape().elem_cnt();
     SoftmaxKernelUtil<device_type, T>::ComputeProb(ctx->device_ctx(), num_instances, num_classes,
-                                                   in->dptr<T>(), out->mut_dptr<T>(),
-                                                   tmp_buffer->mut_dptr(), temp_storage_bytes);
+                                                   in->dptr<T>(), out->mut_dptr<T>(), temp_storage,
+                                                   temp_storage_bytes);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -79,11 +81,12 @@ class SoftmaxGradKernel final : public user_op::OpKernel {
     const int64_t num_instances = y->shape().elem_cnt() / num_classes;
 
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
-    const size_t temp_storage_bytes = tmp_buffer->shape().elem_cnt();
+    void* temp_storage = tmp_buffer == nullptr ? nullptr : tmp_buffer->mut_dptr();
+    const size_t temp_storage_bytes = tmp_buffer == nullptr ? 0 : tmp_buffer->shape().elem_cnt();
 
     SoftmaxKernelUtil<device_type, T>::ComputeDiff(ctx->device_ctx(), num_instances, num_classes,
                                                    dy->dptr<T>(), y->dptr<T>(), dx->mut_dptr<T>(),
-                                                   tmp_buffer->mut_dptr(), temp_storage_bytes);
+                                                   temp_storage, temp_storage_bytes);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
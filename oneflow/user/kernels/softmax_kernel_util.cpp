@@ -16,6 +16,7 @@ limitations under the License.
 #include "oneflow/user/kernels/softmax_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.cuh"
 #include "oneflow/core/ndarray/ndarray_util.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 
@@ -36,8 +37,77 @@ size_t GetReduceTempStorageSize(int64_t n, int64_t w) {
   return GetCudaAlignedSize(n * w * sizeof(T));
 }
 
+// elements whose max is taken before they are exponentiated, small enough to stay in L1
+constexpr int64_t kCpuSoftmaxBlockSize = 256;
+
+int64_t CpuSoftmaxRowGrain(int64_t w) {
+  return std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(w, 1), 1);
+}
+
+// One pass over a row for both its max and sum(exp(x - max)). The running sum is rescaled
+// whenever a block raises the max, so each element is exponentiated once.
+template<typename T>
+void CpuSoftmaxRowMaxAndSum(int64_t w, const T* in, T* max, T* sum) {
+  T row_max = -std::numeric_limits<T>::infinity();
+  T row_sum = GetZeroVal<T>();
+  for (int64_t begin = 0; begin < w; begin += kCpuSoftmaxBlockSize) {
+    const int64_t end = std::min(begin + kCpuSoftmaxBlockSize, w);
+    T block_max = in[begin];
+    for (int64_t j = begin + 1; j < end; ++j) { block_max = std::max(block_max, in[j]); }
+    if (block_max > row_max) {
+      row_sum *= std::exp(row_max - block_max);
+      row_max = block_max;
+    }
+    T block_sum = GetZeroVal<T>();
+    for (int64_t j = begin; j < end; ++j) { block_sum += std::exp(in[j] - row_max); }
+    row_sum += block_sum;
+  }
+  *max = row_max;
+  *sum = row_sum;
+}
+
 }  // namespace
 
+// Fused row-wise CPU softmax: in is read twice and prob written once per row, without temp
+// storage, and rows are split across the compute thread pool.
+template<typename T>
+struct SoftmaxKernelUtil<DeviceType::kCPU, T> {
+  static size_t GetComputeProbTempStorageSizeInBytes(int64_t n, int64_t w) { return 0; }
+  static size_t GetComputeDiffTempStorageSizeInBytes(int64_t n, int64_t w) { return 0; }
+
+  static void ComputeProb(DeviceCtx* ctx, const int64_t n, const int64_t w, const T* in, T* prob,
+                          void* temp_storage, const size_t temp_storage_bytes) {
+    CpuNdarrayParallelFor(n, CpuSoftmaxRowGrain(w), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        const T* in_row = in + i * w;
+        T* prob_row = prob + i * w;
+        T max;
+        T sum;
+        CpuSoftmaxRowMaxAndSum(w, in_row, &max, &sum);
+        const T inv_sum = static_cast<T>(1) / sum;
+        FOR_RANGE(int64_t, j, 0, w) { prob_row[j] = std::exp(in_row[j] - max) * inv_sum; }
+      }
+    });
+  }
+
+  static void ComputeDiff(DeviceCtx* ctx, const int64_t n, const int64_t w, const T* dy,
+                          const T* out, T* dx, void* temp_storage,
+                          const size_t temp_storage_bytes) {
+    CpuNdarrayParallelFor(n, CpuSoftmaxRowGrain(w), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, i, begin, end) {
+        const T* dy_row = dy + i * w;
+        const T* out_row = out + i * w;
+        T* dx_row = dx + i * w;
+        // wide rows lose too many digits in a float dot product
+        double dot = 0;
+        FOR_RANGE(int64_t, j, 0, w) { dot += static_cast<double>(dy_row[j]) * out_row[j]; }
+        const T dot_val = static_cast<T>(dot);
+        FOR_RANGE(int64_t, j, 0, w) { dx_row[j] = (dy_row[j] - dot_val) * out_row[j]; }
+      }
+    });
+  }
+};
+
 template<DeviceType device_type, typename T>
 size_t SoftmaxKernelUtil<device_type, T>::GetComputeProbTempStorageSizeInBytes(int64_t n,
                                                                                int64_t w) {
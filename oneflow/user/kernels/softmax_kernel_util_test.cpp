@@ -0,0 +1,74 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/softmax_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+std::vector<float> RandomVector(int64_t n, double stddev) {
+  std::mt19937 gen(n);
+  std::normal_distribution<double> dis(0, stddev);
+  std::vector<float> vec(n);
+  for (float& val : vec) { val = dis(gen); }
+  return vec;
+}
+
+void CheckSoftmax(int64_t n, int64_t w, double stddev) {
+  const std::vector<float> in = RandomVector(n * w, stddev);
+  const std::vector<float> dy = RandomVector(n * w, 1);
+  std::vector<float> prob(n * w);
+  std::vector<float> dx(n * w);
+  using Util = SoftmaxKernelUtil<DeviceType::kCPU, float>;
+  ASSERT_EQ(Util::GetComputeProbTempStorageSizeInBytes(n, w), 0);
+  Util::ComputeProb(nullptr, n, w, in.data(), prob.data(), nullptr, 0);
+  Util::ComputeDiff(nullptr, n, w, dy.data(), prob.data(), dx.data(), nullptr, 0);
+  FOR_RANGE(int64_t, i, 0, n) {
+    double max = -std::numeric_limits<double>::infinity();
+    FOR_RANGE(int64_t, j, 0, w) { max = std::max<double>(max, in.at(i * w + j)); }
+    double sum = 0;
+    FOR_RANGE(int64_t, j, 0, w) { sum += std::exp(in.at(i * w + j) - max); }
+    double dot = 0;
+    FOR_RANGE(int64_t, j, 0, w) {
+      const double expected = std::exp(in.at(i * w + j) - max) / sum;
+      ASSERT_NEAR(prob.at(i * w + j), expected, 1e-5 * expected + 1e-30);
+      dot += dy.at(i * w + j) * expected;
+    }
+    FOR_RANGE(int64_t, j, 0, w) {
+      const double expected = (dy.at(i * w + j) - dot) * prob.at(i * w + j);
+      ASSERT_NEAR(dx.at(i * w + j), expected, 1e-5);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(SoftmaxKernelUtil, cpu_prob_and_diff) {
+  CheckSoftmax(3, 1, 1);
+  CheckSoftmax(5, 7, 1);
+  // maxima found late in the row rescale the running sum several times
+  CheckSoftmax(4, 1000, 30);
+  Global<ThreadPool>::New(4);
+  CheckSoftmax(64, 30000, 5);
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -0,0 +1,296 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/sort_cpu_kernel_util.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
+
+namespace oneflow {
+
+namespace {
+
+// top k keeps a bounded heap of the best elements so far when k is at most kMaxHeapTopK and the
+// rows are at least max(k, kHeapTopKMinRatio) times longer than k, as heap updates get both more
+// frequent and more expensive with k. Otherwise it partitions an index buffer with nth_element.
+constexpr int32_t kMaxHeapTopK = 128;
+constexpr int32_t kHeapTopKMinRatio = 8;
+// elements compared against the heap threshold, or reduced to lane maxima, at once
+constexpr int32_t kBlockSize = 16;
+// rows shorter than this are sorted by comparisons, longer ones by radix
+constexpr int64_t kMinRadixSortSize = 256;
+// when there are fewer rows than threads, rows at least this long are cut into chunks which are
+// sorted in parallel and then merged
+constexpr int64_t kMinSplitSortSize = 1 << 16;
+
+int64_t RowGrain(int64_t instance_size) {
+  return std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(instance_size, 1), 1);
+}
+
+bool UsesHeapTopK(int32_t instance_size, int32_t k) {
+  return k <= kMaxHeapTopK
+         && static_cast<int64_t>(k) * std::max(k, kHeapTopKMinRatio) <= instance_size;
+}
+
+// index of the first maximum, the same as std::max_element. The lane maxima are vectorizable,
+// the second scan stops at the first element equal to the maximum.
+template<typename T>
+int32_t ArgMax(const T* in, int32_t n) {
+  if (n >= 2 * kBlockSize) {
+    T lane_max[kBlockSize];
+    std::copy(in, in + kBlockSize, lane_max);
+    int32_t i = kBlockSize;
+    for (; i + kBlockSize <= n; i += kBlockSize) {
+      FOR_RANGE(int32_t, j, 0, kBlockSize) {
+        lane_max[j] = in[i + j] > lane_max[j] ? in[i + j] : lane_max[j];
+      }
+    }
+    // later NaNs never win a comparison, but a NaN of the first block sticks to its lane and
+    // hides the larger elements of that lane
+    const bool has_nan_lane =
+        std::any_of(lane_max, lane_max + kBlockSize, [](const T val) { return val != val; });
+    if (!has_nan_lane) {
+      T max_val = *std::max_element(lane_max, lane_max + kBlockSize);
+      for (; i < n; ++i) { max_val = in[i] > max_val ? in[i] : max_val; }
+      return std::distance(in, std::find(in, in + n, max_val));
+    }
+  }
+  return std::distance(in, std::max_element(in, in + n));
+}
+
+template<typename T>
+struct TopKEntry {
+  T value;
+  int32_t index;
+};
+
+template<typename T>
+bool IsBetter(const TopKEntry<T>& lhs, const TopKEntry<T>& rhs) {
+  return lhs.value > rhs.value || (lhs.value == rhs.value && lhs.index < rhs.index);
+}
+
+// heap holds the k best elements seen so far with the worst one on top. Later elements have
+// larger indices, so they only make it into the heap when they are strictly greater than the
+// top, and whole blocks below the top are skipped after one vectorizable comparison.
+template<typename T>
+void HeapTopK(const T* in, int32_t n, int32_t k, TopKEntry<T>* heap, int32_t* out) {
+  FOR_RANGE(int32_t, i, 0, k) { heap[i] = TopKEntry<T>{in[i], i}; }
+  std::make_heap(heap, heap + k, IsBetter<T>);
+  auto Push = [&](int32_t i) {
+    if (in[i] > heap[0].value) {
+      std::pop_heap(heap, heap + k, IsBetter<T>);
+      heap[k - 1] = TopKEntry<T>{in[i], i};
+      std::push_heap(heap, heap + k, IsBetter<T>);
+    }
+  };
+  int32_t i = k;
+  for (; i + kBlockSize <= n; i += kBlockSize) {
+    const T threshold = heap[0].value;
+    int32_t num_greater = 0;
+    FOR_RANGE(int32_t, j, 0, kBlockSize) { num_greater += in[i + j] > threshold; }
+    if (num_greater != 0) {
+      FOR_RANGE(int32_t, j, 0, kBlockSize) { Push(i + j); }
+    }
+  }
+  for (; i < n; ++i) { Push(i); }
+  std::sort_heap(heap, heap + k, IsBetter<T>);
+  FOR_RANGE(int32_t, j, 0, k) { out[j] = heap[j].index; }
+}
+
+template<typename T>
+void NthElementTopK(const T* in, int32_t n, int32_t k, bool sorted, int32_t* indices,
+                    int32_t* out) {
+  std::iota(indices, indices + n, 0);
+  auto comp = [&](const int32_t lhs, const int32_t rhs) {
+    return in[lhs] > in[rhs] || (in[lhs] == in[rhs] && lhs < rhs);
+  };
+  std::nth_element(indices, indices + k, indices + n, comp);
+  if (sorted) { std::sort(indices, indices + k, comp); }
+  std::copy(indices, indices + k, out);
+}
+
+// unsigned keys which compare like the values, so rows can be radix sorted
+template<typename T, typename Enable = void>
+struct RadixKey {
+  using type = typename std::make_unsigned<T>::type;
+  static type Encode(T val) {
+    return static_cast<type>(val) ^ (static_cast<type>(1) << (sizeof(T) * 8 - 1));
+  }
+};
+
+template<typename T>
+struct RadixKey<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  using type = typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type;
+  static type Encode(T val) {
+    // -0 and 0 compare equal, so they have to keep their index order
+    if (val == 0) { val = 0; }
+    type bits;
+    std::memcpy(&bits, &val, sizeof(T));
+    const type sign = static_cast<type>(1) << (sizeof(T) * 8 - 1);
+    return (bits & sign) ? ~bits : (bits | sign);
+  }
+};
+
+template<typename K>
+struct SortEntry {
+  K key;
+  int32_t index;
+};
+
+template<typename K>
+bool KeyLess(const SortEntry<K>& lhs, const SortEntry<K>& rhs) {
+  return lhs.key < rhs.key;
+}
+
+// stable LSD radix sort on bytes of the keys, buf is scratch space of n entries. Passes over a
+// byte all keys share are skipped.
+template<typename K>
+void RadixSort(int64_t n, SortEntry<K>* entries, SortEntry<K>* buf) {
+  constexpr int32_t kNumPasses = sizeof(K);
+  std::vector<int64_t> counts(kNumPasses * 256, 0);
+  FOR_RANGE(int64_t, i, 0, n) {
+    const K key = entries[i].key;
+    FOR_RANGE(int32_t, pass, 0, kNumPasses) {
+      ++counts[pass * 256 + ((key >> (pass * 8)) & 0xFF)];
+    }
+  }
+  SortEntry<K>* src = entries;
+  SortEntry<K>* dst = buf;
+  FOR_RANGE(int32_t, pass, 0, kNumPasses) {
+    int64_t* offsets = counts.data() + pass * 256;
+    const int32_t shift = pass * 8;
+    if (offsets[(src[0].key >> shift) & 0xFF] == n) { continue; }
+    int64_t offset = 0;
+    FOR_RANGE(int32_t, digit, 0, 256) {
+      const int64_t count = offsets[digit];
+      offsets[digit] = offset;
+      offset += count;
+    }
+    FOR_RANGE(int64_t, i, 0, n) { dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i]; }
+    std::swap(src, dst);
+  }
+  if (src != entries) { std::copy(src, src + n, entries); }
+}
+
+// sorts elements [begin, end) of a row into entries, descending order is ascending order of the
+// complemented keys so equal elements stay in index order either way
+template<typename T, typename K>
+void SortRange(const T* in, int64_t begin, int64_t end, bool ascending, SortEntry<K>* entries,
+               SortEntry<K>* buf) {
+  const int64_t n = end - begin;
+  FOR_RANGE(int64_t, i, 0, n) {
+    const K key = RadixKey<T>::Encode(in[begin + i]);
+    entries[i] = SortEntry<K>{ascending ? key : static_cast<K>(~key),
+                              static_cast<int32_t>(begin + i)};
+  }
+  if (n < kMinRadixSortSize) {
+    std::sort(entries, entries + n, [](const SortEntry<K>& lhs, const SortEntry<K>& rhs) {
+      return lhs.key < rhs.key || (lhs.key == rhs.key && lhs.index < rhs.index);
+    });
+  } else {
+    RadixSort(n, entries, buf);
+  }
+}
+
+}  // namespace
+
+template<typename T>
+size_t SortCpuKernelUtil<T>::GetTopKTmpBufferSize(int32_t instance_num, int32_t instance_size,
+                                                  int32_t k) {
+  if (k <= 1 || UsesHeapTopK(instance_size, k)) { return 0; }
+  return static_cast<size_t>(instance_num) * instance_size * sizeof(int32_t);
+}
+
+template<typename T>
+void SortCpuKernelUtil<T>::TopK(int32_t instance_num, int32_t instance_size, int32_t k,
+                                bool sorted, const T* in, int32_t* indices_buf, int32_t* out) {
+  if (k <= 0) { return; }
+  // the tmp buffer is sized for the static shape, which may have chosen the heap for a row
+  // width where this one would not
+  const bool use_heap = UsesHeapTopK(instance_size, k) || indices_buf == nullptr;
+  CpuNdarrayParallelFor(instance_num, RowGrain(instance_size), [&](int64_t begin, int64_t end) {
+    std::vector<TopKEntry<T>> heap(use_heap ? k : 0);
+    FOR_RANGE(int64_t, i, begin, end) {
+      const T* in_i = in + i * instance_size;
+      int32_t* out_i = out + i * k;
+      if (k == 1) {
+        out_i[0] = ArgMax(in_i, instance_size);
+      } else if (use_heap) {
+        HeapTopK(in_i, instance_size, k, heap.data(), out_i);
+      } else {
+        NthElementTopK(in_i, instance_size, k, sorted, indices_buf + i * instance_size, out_i);
+      }
+    }
+  });
+}
+
+template<typename T>
+void SortCpuKernelUtil<T>::ArgSort(int32_t instance_num, int32_t instance_size, bool ascending,
+                                   const T* in, int32_t* out) {
+  using K = typename RadixKey<T>::type;
+  ThreadPool* thread_pool = Global<ThreadPool>::Get();
+  const int64_t thread_num = thread_pool == nullptr ? 1 : thread_pool->thread_num();
+  if (instance_num >= thread_num || instance_size < kMinSplitSortSize) {
+    CpuNdarrayParallelFor(instance_num, RowGrain(instance_size), [&](int64_t begin, int64_t end) {
+      std::vector<SortEntry<K>> entries(instance_size);
+      std::vector<SortEntry<K>> buf(instance_size);
+      FOR_RANGE(int64_t, i, begin, end) {
+        SortRange(in + i * instance_size, 0, instance_size, ascending, entries.data(),
+                  buf.data());
+        int32_t* out_i = out + i * instance_size;
+        FOR_RANGE(int32_t, j, 0, instance_size) { out_i[j] = entries[j].index; }
+      }
+    });
+    return;
+  }
+  // few long rows, chunks are sorted in parallel and then merged pairwise. std::merge takes
+  // equal keys from the left chunk first, which keeps them in index order.
+  const int64_t n = instance_size;
+  const int64_t chunk_size = std::max((n + thread_num - 1) / thread_num, kMinRadixSortSize);
+  const int64_t num_chunks = (n + chunk_size - 1) / chunk_size;
+  std::vector<SortEntry<K>> entries(n);
+  std::vector<SortEntry<K>> buf(n);
+  FOR_RANGE(int32_t, i, 0, instance_num) {
+    const T* in_i = in + i * n;
+    thread_pool->ParallelFor(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, chunk, begin, end) {
+        const int64_t lo = chunk * chunk_size;
+        const int64_t hi = std::min(lo + chunk_size, n);
+        SortRange(in_i, lo, hi, ascending, entries.data() + lo, buf.data() + lo);
+      }
+    });
+    SortEntry<K>* src = entries.data();
+    SortEntry<K>* dst = buf.data();
+    for (int64_t width = chunk_size; width < n; width *= 2) {
+      const int64_t num_merges = (n + 2 * width - 1) / (2 * width);
+      thread_pool->ParallelFor(0, num_merges, 1, [&](int64_t begin, int64_t end) {
+        FOR_RANGE(int64_t, merge, begin, end) {
+          const int64_t lo = merge * 2 * width;
+          const int64_t mid = std::min(lo + width, n);
+          const int64_t hi = std::min(lo + 2 * width, n);
+          std::merge(src + lo, src + mid, src + mid, src + hi, dst + lo, KeyLess<K>);
+        }
+      });
+      std::swap(src, dst);
+    }
+    int32_t* out_i = out + i * n;
+    FOR_RANGE(int64_t, j, 0, n) { out_i[j] = src[j].index; }
+  }
+}
+
+template struct SortCpuKernelUtil<float>;
+template struct SortCpuKernelUtil<double>;
+template struct SortCpuKernelUtil<int32_t>;
+template struct SortCpuKernelUtil<int64_t>;
+
+}  // namespace oneflow
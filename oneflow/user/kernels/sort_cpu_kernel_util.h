@@ -0,0 +1,40 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_SORT_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_SORT_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+
+namespace oneflow {
+
+// Top k and arg sort over instance_num rows of instance_size elements each. Equal elements are
+// always ordered by ascending index.
+template<typename T>
+struct SortCpuKernelUtil {
+  // bytes of indices_buf TopK needs, rows only get an index buffer when k is too large for the
+  // heap. A null indices_buf makes every row use the heap.
+  static size_t GetTopKTmpBufferSize(int32_t instance_num, int32_t instance_size, int32_t k);
+  // out has the indices of the k largest elements of every row. They are in descending order
+  // when sorted is set or k is small, and in unspecified order otherwise.
+  static void TopK(int32_t instance_num, int32_t instance_size, int32_t k, bool sorted,
+                   const T* in, int32_t* indices_buf, int32_t* out);
+  static void ArgSort(int32_t instance_num, int32_t instance_size, bool ascending, const T* in,
+                      int32_t* out);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_SORT_CPU_KERNEL_UTIL_H_
@@ -0,0 +1,211 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/sort_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+// values in [-range, range], a small range makes plenty of ties
+template<typename T>
+std::vector<T> RandomVector(int64_t n, int32_t range) {
+  std::mt19937 gen(n + range);
+  std::uniform_int_distribution<int32_t> dis(-range, range);
+  std::vector<T> vec(n);
+  for (T& val : vec) { val = static_cast<T>(dis(gen)) / 4; }
+  return vec;
+}
+
+// arg sort of every row by comparisons, equal elements by ascending index
+template<typename T>
+std::vector<int32_t> ReferenceArgSort(int32_t instance_num, int32_t instance_size, bool ascending,
+                                      const std::vector<T>& in) {
+  std::vector<int32_t> out(in.size());
+  FOR_RANGE(int32_t, i, 0, instance_num) {
+    const T* in_i = in.data() + i * instance_size;
+    int32_t* out_i = out.data() + i * instance_size;
+    std::iota(out_i, out_i + instance_size, 0);
+    std::stable_sort(out_i, out_i + instance_size, [&](const int32_t lhs, const int32_t rhs) {
+      return ascending ? in_i[lhs] < in_i[rhs] : in_i[lhs] > in_i[rhs];
+    });
+  }
+  return out;
+}
+
+template<typename T>
+void CheckTopK(int32_t instance_num, int32_t instance_size, int32_t k, int32_t range,
+               bool with_buf = true) {
+  const std::vector<T> in = RandomVector<T>(instance_num * instance_size, range);
+  const std::vector<int32_t> sorted = ReferenceArgSort(instance_num, instance_size, false, in);
+  std::vector<int32_t> buf(
+      with_buf ? SortCpuKernelUtil<T>::GetTopKTmpBufferSize(instance_num, instance_size, k)
+                     / sizeof(int32_t)
+               : 0);
+  std::vector<int32_t> out(instance_num * k);
+  for (const bool is_sorted : {true, false}) {
+    SortCpuKernelUtil<T>::TopK(instance_num, instance_size, k, is_sorted, in.data(),
+                               buf.empty() ? nullptr : buf.data(), out.data());
+    FOR_RANGE(int32_t, i, 0, instance_num) {
+      std::vector<int32_t> out_i(out.begin() + i * k, out.begin() + (i + 1) * k);
+      std::vector<int32_t> expected(sorted.begin() + i * instance_size,
+                                    sorted.begin() + i * instance_size + k);
+      if (!is_sorted) {
+        std::sort(out_i.begin(), out_i.end());
+        std::sort(expected.begin(), expected.end());
+      }
+      ASSERT_EQ(out_i, expected);
+    }
+  }
+}
+
+template<typename T>
+void CheckArgSort(int32_t instance_num, int32_t instance_size, int32_t range) {
+  const std::vector<T> in = RandomVector<T>(instance_num * instance_size, range);
+  std::vector<int32_t> out(in.size());
+  for (const bool ascending : {true, false}) {
+    SortCpuKernelUtil<T>::ArgSort(instance_num, instance_size, ascending, in.data(), out.data());
+    ASSERT_EQ(out, ReferenceArgSort(instance_num, instance_size, ascending, in));
+  }
+}
+
+template<typename T>
+void CheckAll(int32_t range) {
+  for (const int32_t k : {1, 2, 5, 64, 128, 1000}) {
+    CheckTopK<T>(7, 1000, k, range);
+    CheckTopK<T>(2, 50000, k, range);
+  }
+  CheckTopK<T>(3, 10, 10, range);
+  // a tmp buffer sized for a wider static shape which uses the heap
+  ASSERT_EQ(SortCpuKernelUtil<T>::GetTopKTmpBufferSize(7, 50000, 100), 0);
+  CheckTopK<T>(7, 1000, 100, range, false);
+  CheckArgSort<T>(33, 100, range);
+  CheckArgSort<T>(5, 3000, range);
+  CheckArgSort<T>(2, 300000, range);
+}
+
+// top 1 of rows with NaNs is the index std::max_element gives
+template<typename T>
+void CheckArgMaxWithNaN(int32_t instance_size, int32_t nan_index, int32_t max_index) {
+  std::vector<T> in = RandomVector<T>(instance_size, 100);
+  in.at(max_index) = 1000;
+  in.at(nan_index) = std::numeric_limits<T>::quiet_NaN();
+  int32_t out = -1;
+  SortCpuKernelUtil<T>::TopK(1, instance_size, 1, true, in.data(), nullptr, &out);
+  ASSERT_EQ(out, std::distance(in.begin(), std::max_element(in.begin(), in.end())))
+      << nan_index << " " << max_index;
+}
+
+template<typename Fn>
+double Seconds(const Fn& fn) {
+  const int iters = 5;
+  const auto start = std::chrono::steady_clock::now();
+  FOR_RANGE(int, i, 0, iters) { fn(); }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iters;
+}
+
+}  // namespace
+
+TEST(SortCpuKernelUtil, top_k_and_arg_sort) {
+  CheckAll<float>(1000000);
+  CheckAll<float>(20);
+  CheckAll<double>(1000000);
+  CheckAll<int32_t>(20);
+  Global<ThreadPool>::New(4);
+  CheckAll<int64_t>(1000000);
+  CheckAll<float>(20);
+  Global<ThreadPool>::Delete();
+}
+
+TEST(SortCpuKernelUtil, arg_max_with_nan) {
+  // (instance_size, nan_index, max_index)
+  const std::vector<std::vector<int32_t>> cases = {
+      {40, 3, 19}, {40, 0, 19}, {40, 19, 3}, {100, 15, 47}, {100, 70, 99}, {20, 3, 11}};
+  for (const auto& c : cases) {
+    CheckArgMaxWithNaN<float>(c.at(0), c.at(1), c.at(2));
+    CheckArgMaxWithNaN<double>(c.at(0), c.at(1), c.at(2));
+  }
+}
+
+TEST(SortCpuKernelUtil, DISABLED_top_k_throughput) {
+  // (rows, row width) from many short rows to a few vocabulary sized ones
+  const std::vector<std::pair<int32_t, int32_t>> shapes = {
+      {4096, 128}, {1024, 1000}, {64, 32768}, {8, 1 << 20}};
+  Global<ThreadPool>::New(std::thread::hardware_concurrency());
+  for (const auto& shape : shapes) {
+    const int32_t instance_num = shape.first;
+    const int32_t instance_size = shape.second;
+    const std::vector<float> in = RandomVector<float>(instance_num * instance_size, 1000000);
+    std::vector<int32_t> indices(in.size());
+    for (const int32_t k : {1, 5, 64, 1000}) {
+      if (k > instance_size) { continue; }
+      std::vector<int32_t> out(instance_num * k);
+      // the former kernel, nth_element on an index buffer of every row
+      const double nth_element_sec = Seconds([&]() {
+        FOR_RANGE(int32_t, i, 0, instance_num) {
+          const float* in_i = in.data() + i * instance_size;
+          int32_t* indices_i = indices.data() + i * instance_size;
+          std::iota(indices_i, indices_i + instance_size, 0);
+          auto comp = [&](const int32_t lhs, const int32_t rhs) {
+            return in_i[lhs] > in_i[rhs] || (in_i[lhs] == in_i[rhs] && lhs < rhs);
+          };
+          std::nth_element(indices_i, indices_i + k, indices_i + instance_size, comp);
+          std::sort(indices_i, indices_i + k, comp);
+          std::copy(indices_i, indices_i + k, out.data() + i * k);
+        }
+      });
+      const double top_k_sec = Seconds([&]() {
+        SortCpuKernelUtil<float>::TopK(instance_num, instance_size, k, true, in.data(),
+                                       indices.data(), out.data());
+      });
+      const double melem = 1e-6 * instance_num * instance_size;
+      LOG(INFO) << "rows: " << instance_num << ", width: " << instance_size << ", k: " << k
+                << ", nth_element: " << melem / nth_element_sec
+                << " Melem/s, top k: " << melem / top_k_sec << " Melem/s";
+    }
+  }
+  for (const auto& shape : shapes) {
+    const int32_t instance_num = shape.first;
+    const int32_t instance_size = shape.second;
+    const std::vector<float> in = RandomVector<float>(instance_num * instance_size, 1000000);
+    std::vector<int32_t> out(in.size());
+    const double std_sort_sec = Seconds([&]() {
+      FOR_RANGE(int32_t, i, 0, instance_num) {
+        const float* in_i = in.data() + i * instance_size;
+        int32_t* out_i = out.data() + i * instance_size;
+        std::iota(out_i, out_i + instance_size, 0);
+        std::sort(out_i, out_i + instance_size, [&](const int32_t lhs, const int32_t rhs) {
+          return in_i[lhs] < in_i[rhs] || (in_i[lhs] == in_i[rhs] && lhs < rhs);
+        });
+      }
+    });
+    const double arg_sort_sec = Seconds([&]() {
+      SortCpuKernelUtil<float>::ArgSort(instance_num, instance_size, true, in.data(), out.data());
+    });
+    const double melem = 1e-6 * instance_num * instance_size;
+    LOG(INFO) << "rows: " << instance_num << ", width: " << instance_size
+              << ", std::sort: " << melem / std_sort_sec
+              << " Melem/s, arg sort: " << melem / arg_sort_sec << " Melem/s";
+  }
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/user/kernels/sparse_cross_entropy_kernel_util.h"
 #include "oneflow/core/kernel/kernel_util.cuh"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
 
 namespace oneflow {
 namespace user_op {
@@ -49,19 +50,25 @@ struct SparseCrossEntropyKernelUtil<DeviceType::kCPU, T, K> {
                                      const int64_t num_classes, const int64_t depth,
                                      const int64_t lower_bound, const T* prob, const K* labels,
                                      const T* dy, T* dx) {
-    FOR_RANGE(int64_t, i, 0, elem_cnt) {
-      const int32_t row_id = i / num_classes;
-      const int32_t col_id = i - row_id * num_classes;
-      CHECK_GE(labels[row_id], 0);
-      CHECK_LT(labels[row_id], depth);
-      K label = labels[row_id] - lower_bound;
-
-      if (label == col_id) {
-        dx[i] = dy[row_id] * (prob[i] - 1);
-      } else {
-        dx[i] = dy[row_id] * prob[i];
+    if (num_classes == 0) { return; }
+    const int64_t num_instances = elem_cnt / num_classes;
+    const int64_t grain =
+        std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(num_classes, 1), 1);
+    CpuNdarrayParallelFor(num_instances, grain, [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, row_id, begin, end) {
+        CHECK_GE(labels[row_id], 0);
+        CHECK_LT(labels[row_id], depth);
+        const K label = labels[row_id] - lower_bound;
+        const T* prob_row = prob + row_id * num_classes;
+        T* dx_row = dx + row_id * num_classes;
+        FOR_RANGE(int64_t, col_id, 0, num_classes) {
+          dx_row[col_id] = dy[row_id] * prob_row[col_id];
+        }
+        if (label >= 0 && label < num_classes) {
+          dx_row[label] = dy[row_id] * (prob_row[label] - 1);
+        }
       }
-    }
+    });
   }
 };
 
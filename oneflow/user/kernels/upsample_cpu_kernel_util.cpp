@@ -0,0 +1,318 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/upsample_cpu_kernel_util.h"
+#include "oneflow/core/ndarray/cpu_ndarray_parallel.h"
+
+namespace oneflow {
+
+namespace {
+
+// channels handled by one backward task of a channels_last tensor
+constexpr int64_t kUpsampleChannelBlock = 64;
+
+// Same index math as the GPU kernels, evaluated once per output row and column instead of once
+// per output element.
+struct UpsampleAxisTable {
+  std::vector<int64_t> lo;
+  std::vector<int64_t> hi;
+  std::vector<float> lerp;
+};
+
+UpsampleAxisTable MakeNearestTable(int64_t out_size, int64_t in_size, float scale) {
+  UpsampleAxisTable table;
+  table.lo.resize(out_size);
+  FOR_RANGE(int64_t, i, 0, out_size) {
+    const int64_t idx =
+        static_cast<int64_t>(std::floor((static_cast<float>(i) + 0.5f) * scale));
+    table.lo[i] = std::max<int64_t>(std::min<int64_t>(idx, in_size - 1), 0);
+  }
+  return table;
+}
+
+UpsampleAxisTable MakeBilinearTable(int64_t out_size, int64_t in_size, float scale) {
+  UpsampleAxisTable table;
+  table.lo.resize(out_size);
+  table.hi.resize(out_size);
+  table.lerp.resize(out_size);
+  FOR_RANGE(int64_t, i, 0, out_size) {
+    const float in = (static_cast<float>(i) + 0.5f) * scale - 0.5f;
+    table.lo[i] = in > 0.f ? static_cast<int64_t>(std::floor(in)) : 0;
+    table.hi[i] = in < in_size - 1 ? static_cast<int64_t>(std::ceil(in)) : in_size - 1;
+    table.lerp[i] = in - std::floor(in);
+  }
+  return table;
+}
+
+
+int64_t TaskGrain(int64_t elem_cnt_per_task) {
+  return std::max<int64_t>(kCpuNdarrayParallelGrain / std::max<int64_t>(elem_cnt_per_task, 1), 1);
+}
+
+template<typename T>
+void UpsampleNearestForward(const UpsampleDims& d, bool channels_first, const T* x,
+                            const UpsampleAxisTable& h_table, const UpsampleAxisTable& w_table,
+                            T* y) {
+  const int64_t in_plane = d.in_h * d.in_w;
+  const int64_t out_plane = d.out_h * d.out_w;
+  if (channels_first) {
+    CpuNdarrayParallelFor(d.n * d.c, TaskGrain(out_plane), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, plane, begin, end) {
+        const T* x_plane = x + plane * in_plane;
+        T* y_row = y + plane * out_plane;
+        FOR_RANGE(int64_t, oh, 0, d.out_h) {
+          const T* x_row = x_plane + h_table.lo[oh] * d.in_w;
+          FOR_RANGE(int64_t, ow, 0, d.out_w) { y_row[ow] = x_row[w_table.lo[ow]]; }
+          y_row += d.out_w;
+        }
+      }
+    });
+  } else {
+    const int64_t out_row_size = d.out_w * d.c;
+    CpuNdarrayParallelFor(d.n * d.out_h, TaskGrain(out_row_size), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, row, begin, end) {
+        const int64_t n = row / d.out_h;
+        const T* x_row = x + (n * d.in_h + h_table.lo[row % d.out_h]) * d.in_w * d.c;
+        T* y_pixel = y + row * out_row_size;
+        FOR_RANGE(int64_t, ow, 0, d.out_w) {
+          const T* x_pixel = x_row + w_table.lo[ow] * d.c;
+          FOR_RANGE(int64_t, c, 0, d.c) { y_pixel[c] = x_pixel[c]; }
+          y_pixel += d.c;
+        }
+      }
+    });
+  }
+}
+
+// dx is zeroed and accumulated by the task owning it, so no two tasks write the same element
+template<typename T>
+void UpsampleNearestBackward(const UpsampleDims& d, bool channels_first, const T* dy,
+                             const UpsampleAxisTable& h_table, const UpsampleAxisTable& w_table,
+                             T* dx) {
+  const int64_t in_plane = d.in_h * d.in_w;
+  const int64_t out_plane = d.out_h * d.out_w;
+  if (channels_first) {
+    CpuNdarrayParallelFor(d.n * d.c, TaskGrain(out_plane), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, plane, begin, end) {
+        T* dx_plane = dx + plane * in_plane;
+        std::fill(dx_plane, dx_plane + in_plane, GetZeroVal<T>());
+        const T* dy_row = dy + plane * out_plane;
+        FOR_RANGE(int64_t, oh, 0, d.out_h) {
+          T* dx_row = dx_plane + h_table.lo[oh] * d.in_w;
+          FOR_RANGE(int64_t, ow, 0, d.out_w) { dx_row[w_table.lo[ow]] += dy_row[ow]; }
+          dy_row += d.out_w;
+        }
+      }
+    });
+  } else {
+    const int64_t num_blocks = (d.c + kUpsampleChannelBlock - 1) / kUpsampleChannelBlock;
+    const int64_t block_size = std::min(d.c, kUpsampleChannelBlock);
+    CpuNdarrayParallelFor(
+        d.n * num_blocks, TaskGrain(out_plane * block_size), [&](int64_t begin, int64_t end) {
+          FOR_RANGE(int64_t, task, begin, end) {
+            const int64_t n = task / num_blocks;
+            const int64_t c_begin = (task % num_blocks) * kUpsampleChannelBlock;
+            const int64_t c_end = std::min(c_begin + kUpsampleChannelBlock, d.c);
+            T* dx_image = dx + n * in_plane * d.c;
+            FOR_RANGE(int64_t, i, 0, in_plane) {
+              std::fill(dx_image + i * d.c + c_begin, dx_image + i * d.c + c_end,
+                        GetZeroVal<T>());
+            }
+            const T* dy_pixel = dy + n * out_plane * d.c;
+            FOR_RANGE(int64_t, oh, 0, d.out_h) {
+              T* dx_row = dx_image + h_table.lo[oh] * d.in_w * d.c;
+              FOR_RANGE(int64_t, ow, 0, d.out_w) {
+                T* dx_pixel = dx_row + w_table.lo[ow] * d.c;
+                FOR_RANGE(int64_t, c, c_begin, c_end) { dx_pixel[c] += dy_pixel[c]; }
+                dy_pixel += d.c;
+              }
+            }
+          }
+        });
+  }
+}
+
+template<typename T>
+void UpsampleBilinearForward(const UpsampleDims& d, bool channels_first, const T* x,
+                             const UpsampleAxisTable& h_table, const UpsampleAxisTable& w_table,
+                             T* y) {
+  const int64_t in_plane = d.in_h * d.in_w;
+  const int64_t out_plane = d.out_h * d.out_w;
+  if (channels_first) {
+    CpuNdarrayParallelFor(d.n * d.c, TaskGrain(out_plane), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, plane, begin, end) {
+        const T* x_plane = x + plane * in_plane;
+        T* y_row = y + plane * out_plane;
+        FOR_RANGE(int64_t, oh, 0, d.out_h) {
+          const T* top_row = x_plane + h_table.lo[oh] * d.in_w;
+          const T* bottom_row = x_plane + h_table.hi[oh] * d.in_w;
+          const float h_lerp = h_table.lerp[oh];
+          FOR_RANGE(int64_t, ow, 0, d.out_w) {
+            const int64_t left = w_table.lo[ow];
+            const int64_t right = w_table.hi[ow];
+            const float w_lerp = w_table.lerp[ow];
+            const float top = top_row[left] + (top_row[right] - top_row[left]) * w_lerp;
+            const float bottom =
+                bottom_row[left] + (bottom_row[right] - bottom_row[left]) * w_lerp;
+            y_row[ow] = top + (bottom - top) * h_lerp;
+          }
+          y_row += d.out_w;
+        }
+      }
+    });
+  } else {
+    const int64_t in_row_size = d.in_w * d.c;
+    const int64_t out_row_size = d.out_w * d.c;
+    CpuNdarrayParallelFor(d.n * d.out_h, TaskGrain(out_row_size), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, row, begin, end) {
+        const int64_t n = row / d.out_h;
+        const int64_t oh = row % d.out_h;
+        const T* top_row = x + (n * d.in_h + h_table.lo[oh]) * in_row_size;
+        const T* bottom_row = x + (n * d.in_h + h_table.hi[oh]) * in_row_size;
+        const float h_lerp = h_table.lerp[oh];
+        T* y_pixel = y + row * out_row_size;
+        FOR_RANGE(int64_t, ow, 0, d.out_w) {
+          const T* top_left = top_row + w_table.lo[ow] * d.c;
+          const T* top_right = top_row + w_table.hi[ow] * d.c;
+          const T* bottom_left = bottom_row + w_table.lo[ow] * d.c;
+          const T* bottom_right = bottom_row + w_table.hi[ow] * d.c;
+          const float w_lerp = w_table.lerp[ow];
+          FOR_RANGE(int64_t, c, 0, d.c) {
+            const float top = top_left[c] + (top_right[c] - top_left[c]) * w_lerp;
+            const float bottom = bottom_left[c] + (bottom_right[c] - bottom_left[c]) * w_lerp;
+            y_pixel[c] = top + (bottom - top) * h_lerp;
+          }
+          y_pixel += d.c;
+        }
+      }
+    });
+  }
+}
+
+template<typename T>
+void UpsampleBilinearBackward(const UpsampleDims& d, bool channels_first, const T* dy,
+                              const UpsampleAxisTable& h_table, const UpsampleAxisTable& w_table,
+                              T* dx) {
+  const int64_t in_plane = d.in_h * d.in_w;
+  const int64_t out_plane = d.out_h * d.out_w;
+  if (channels_first) {
+    CpuNdarrayParallelFor(d.n * d.c, TaskGrain(out_plane), [&](int64_t begin, int64_t end) {
+      FOR_RANGE(int64_t, plane, begin, end) {
+        T* dx_plane = dx + plane * in_plane;
+        std::fill(dx_plane, dx_plane + in_plane, GetZeroVal<T>());
+        const T* dy_row = dy + plane * out_plane;
+        FOR_RANGE(int64_t, oh, 0, d.out_h) {
+          T* top_row = dx_plane + h_table.lo[oh] * d.in_w;
+          T* bottom_row = dx_plane + h_table.hi[oh] * d.in_w;
+          const float h_lerp = h_table.lerp[oh];
+          FOR_RANGE(int64_t, ow, 0, d.out_w) {
+            const int64_t left = w_table.lo[ow];
+            const int64_t right = w_table.hi[ow];
+            const float w_lerp = w_table.lerp[ow];
+            const float dbottom = h_lerp * dy_row[ow];
+            const float dtop = dy_row[ow] - dbottom;
+            top_row[left] += static_cast<T>((1 - w_lerp) * dtop);
+            top_row[right] += static_cast<T>(w_lerp * dtop);
+            bottom_row[left] += static_cast<T>((1 - w_lerp) * dbottom);
+            bottom_row[right] += static_cast<T>(w_lerp * dbottom);
+          }
+          dy_row += d.out_w;
+        }
+      }
+    });
+  } else {
+    const int64_t num_blocks = (d.c + kUpsampleChannelBlock - 1) / kUpsampleChannelBlock;
+    const int64_t block_size = std::min(d.c, kUpsampleChannelBlock);
+    const int64_t in_row_size = d.in_w * d.c;
+    CpuNdarrayParallelFor(
+        d.n * num_blocks, TaskGrain(out_plane * block_size), [&](int64_t begin, int64_t end) {
+          FOR_RANGE(int64_t, task, begin, end) {
+            const int64_t n = task / num_blocks;
+            const int64_t c_begin = (task % num_blocks) * kUpsampleChannelBlock;
+            const int64_t c_end = std::min(c_begin + kUpsampleChannelBlock, d.c);
+            T* dx_image = dx + n * in_plane * d.c;
+            FOR_RANGE(int64_t, i, 0, in_plane) {
+              std::fill(dx_image + i * d.c + c_begin, dx_image + i * d.c + c_end,
+                        GetZeroVal<T>());
+            }
+            const T* dy_pixel = dy + n * out_plane * d.c;
+            FOR_RANGE(int64_t, oh, 0, d.out_h) {
+              T* top_row = dx_image + h_table.lo[oh] * in_row_size;
+              T* bottom_row = dx_image + h_table.hi[oh] * in_row_size;
+              const float h_lerp = h_table.lerp[oh];
+              FOR_RANGE(int64_t, ow, 0, d.out_w) {
+                T* top_left = top_row + w_table.lo[ow] * d.c;
+                T* top_right = top_row + w_table.hi[ow] * d.c;
+                T* bottom_left = bottom_row + w_table.lo[ow] * d.c;
+                T* bottom_right = bottom_row + w_table.hi[ow] * d.c;
+                const float w_lerp = w_table.lerp[ow];
+                FOR_RANGE(int64_t, c, c_begin, c_end) {
+                  const float dbottom = h_lerp * dy_pixel[c];
+                  const float dtop = dy_pixel[c] - dbottom;
+                  top_left[c] += static_cast<T>((1 - w_lerp) * dtop);
+                  top_right[c] += static_cast<T>(w_lerp * dtop);
+                  bottom_left[c] += static_cast<T>((1 - w_lerp) * dbottom);
+                  bottom_right[c] += static_cast<T>(w_lerp * dbottom);
+                }
+                dy_pixel += d.c;
+              }
+            }
+          }
+        });
+  }
+}
+
+}  // namespace
+
+template<typename T>
+void UpsampleCpuKernelUtil<T>::NearestForward(const UpsampleDims& dims, bool channels_first,
+                                              float height_scale, float width_scale, const T* x,
+                                              T* y) {
+  UpsampleNearestForward<T>(dims, channels_first, x,
+                            MakeNearestTable(dims.out_h, dims.in_h, 1.f / height_scale),
+                            MakeNearestTable(dims.out_w, dims.in_w, 1.f / width_scale), y);
+}
+
+template<typename T>
+void UpsampleCpuKernelUtil<T>::NearestBackward(const UpsampleDims& dims, bool channels_first,
+                                               float height_scale, float width_scale, const T* dy,
+                                               T* dx) {
+  UpsampleNearestBackward<T>(dims, channels_first, dy,
+                             MakeNearestTable(dims.out_h, dims.in_h, 1.f / height_scale),
+                             MakeNearestTable(dims.out_w, dims.in_w, 1.f / width_scale), dx);
+}
+
+template<typename T>
+void UpsampleCpuKernelUtil<T>::BilinearForward(const UpsampleDims& dims, bool channels_first,
+                                               float height_scale, float width_scale, const T* x,
+                                               T* y) {
+  UpsampleBilinearForward<T>(dims, channels_first, x,
+                             MakeBilinearTable(dims.out_h, dims.in_h, 1.f / height_scale),
+                             MakeBilinearTable(dims.out_w, dims.in_w, 1.f / width_scale), y);
+}
+
+template<typename T>
+void UpsampleCpuKernelUtil<T>::BilinearBackward(const UpsampleDims& dims, bool channels_first,
+                                                float height_scale, float width_scale,
+                                                const T* dy, T* dx) {
+  UpsampleBilinearBackward<T>(dims, channels_first, dy,
+                              MakeBilinearTable(dims.out_h, dims.in_h, 1.f / height_scale),
+                              MakeBilinearTable(dims.out_w, dims.in_w, 1.f / width_scale), dx);
+}
+
+template struct UpsampleCpuKernelUtil<float>;
+template struct UpsampleCpuKernelUtil<double>;
+
+}  // namespace oneflow
@@ -0,0 +1,64 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_UPSAMPLE_CPU_KERNEL_UTIL_H_
+#define ONEFLOW_USER_KERNELS_UPSAMPLE_CPU_KERNEL_UTIL_H_
+
+#include "oneflow/core/kernel/kernel_util.h"
+
+namespace oneflow {
+
+// x and y are NCHW or NHWC tensors that only differ in height and width
+struct UpsampleDims {
+  UpsampleDims(const ShapeView& x_shape, const ShapeView& y_shape, bool channels_first) {
+    CHECK_EQ(x_shape.NumAxes(), 4);
+    CHECK_EQ(y_shape.NumAxes(), 4);
+    const int32_t c_axis = channels_first ? 1 : 3;
+    const int32_t h_axis = channels_first ? 2 : 1;
+    n = x_shape.At(0);
+    c = x_shape.At(c_axis);
+    in_h = x_shape.At(h_axis);
+    in_w = x_shape.At(h_axis + 1);
+    out_h = y_shape.At(h_axis);
+    out_w = y_shape.At(h_axis + 1);
+    CHECK_EQ(y_shape.At(0), n);
+    CHECK_EQ(y_shape.At(c_axis), c);
+  }
+  int64_t n;
+  int64_t c;
+  int64_t in_h;
+  int64_t in_w;
+  int64_t out_h;
+  int64_t out_w;
+};
+
+// Nearest and bilinear upsampling with the index math of the GPU kernels. height_scale and
+// width_scale are the attrs of the op, the output size over the input size. Backward
+// overwrites dx.
+template<typename T>
+struct UpsampleCpuKernelUtil {
+  static void NearestForward(const UpsampleDims& dims, bool channels_first, float height_scale,
+                             float width_scale, const T* x, T* y);
+  static void NearestBackward(const UpsampleDims& dims, bool channels_first, float height_scale,
+                              float width_scale, const T* dy, T* dx);
+  static void BilinearForward(const UpsampleDims& dims, bool channels_first, float height_scale,
+                              float width_scale, const T* x, T* y);
+  static void BilinearBackward(const UpsampleDims& dims, bool channels_first, float height_scale,
+                               float width_scale, const T* dy, T* dx);
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_UPSAMPLE_CPU_KERNEL_UTIL_H_
@@ -0,0 +1,169 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/user/kernels/upsample_cpu_kernel_util.h"
+#include "oneflow/core/thread/thread_pool.h"
+
+namespace oneflow {
+
+namespace test {
+
+namespace {
+
+std::vector<float> RandomVector(int64_t n) {
+  std::mt19937 gen(n);
+  std::uniform_real_distribution<float> dis(-1, 1);
+  std::vector<float> vec(n);
+  for (float& val : vec) { val = dis(gen); }
+  return vec;
+}
+
+// NCHW (n, c, hw) to NHWC (n, hw, c)
+std::vector<float> ToChannelsLast(int64_t n, int64_t c, int64_t hw, const std::vector<float>& x) {
+  std::vector<float> y(x.size());
+  FOR_RANGE(int64_t, i, 0, n) {
+    FOR_RANGE(int64_t, j, 0, c) {
+      FOR_RANGE(int64_t, k, 0, hw) { y.at((i * hw + k) * c + j) = x.at((i * c + j) * hw + k); }
+    }
+  }
+  return y;
+}
+
+// Calls fn(ih, iw, weight) for every input pixel that output pixel (oh, ow) is interpolated from,
+// following the per element formulas of the GPU kernels
+template<typename Fn>
+void ForEachSample(bool bilinear, const UpsampleDims& d, float h_scale, float w_scale, int64_t oh,
+                   int64_t ow, const Fn& fn) {
+  if (!bilinear) {
+    auto Nearest = [](int64_t o, float scale, int64_t in_size) {
+      const int64_t i = static_cast<int64_t>(std::floor((static_cast<float>(o) + 0.5f) * scale));
+      return std::max<int64_t>(std::min<int64_t>(i, in_size - 1), 0);
+    };
+    fn(Nearest(oh, h_scale, d.in_h), Nearest(ow, w_scale, d.in_w), 1.0);
+    return;
+  }
+  const float in_h = (static_cast<float>(oh) + 0.5f) * h_scale - 0.5f;
+  const float in_w = (static_cast<float>(ow) + 0.5f) * w_scale - 0.5f;
+  const int64_t top = in_h > 0 ? static_cast<int64_t>(std::floor(in_h)) : 0;
+  const int64_t bottom = in_h < d.in_h - 1 ? static_cast<int64_t>(std::ceil(in_h)) : d.in_h - 1;
+  const int64_t left = in_w > 0 ? static_cast<int64_t>(std::floor(in_w)) : 0;
+  const int64_t right = in_w < d.in_w - 1 ? static_cast<int64_t>(std::ceil(in_w)) : d.in_w - 1;
+  const double h_lerp = in_h - std::floor(in_h);
+  const double w_lerp = in_w - std::floor(in_w);
+  fn(top, left, (1 - h_lerp) * (1 - w_lerp));
+  fn(top, right, (1 - h_lerp) * w_lerp);
+  fn(bottom, left, h_lerp * (1 - w_lerp));
+  fn(bottom, right, h_lerp * w_lerp);
+}
+
+void CheckUpsample(bool bilinear, int64_t n, int64_t c, int64_t in_h, int64_t in_w,
+                   int64_t out_h, int64_t out_w) {
+  const float height_scale = static_cast<float>(out_h) / in_h;
+  const float width_scale = static_cast<float>(out_w) / in_w;
+  const Shape x_shape({n, c, in_h, in_w});
+  const Shape y_shape({n, c, out_h, out_w});
+  const UpsampleDims d(ShapeView(x_shape), ShapeView(y_shape), true);
+  const std::vector<float> x = RandomVector(x_shape.elem_cnt());
+  const std::vector<float> dy = RandomVector(y_shape.elem_cnt());
+
+  // double precision reference of the channels_first layout
+  std::vector<double> expected_y(y_shape.elem_cnt());
+  std::vector<double> expected_dx(x_shape.elem_cnt());
+  FOR_RANGE(int64_t, plane, 0, n * c) {
+    FOR_RANGE(int64_t, oh, 0, out_h) {
+      FOR_RANGE(int64_t, ow, 0, out_w) {
+        const int64_t y_idx = (plane * out_h + oh) * out_w + ow;
+        ForEachSample(bilinear, d, 1.f / height_scale, 1.f / width_scale, oh, ow,
+                      [&](int64_t ih, int64_t iw, double weight) {
+                        const int64_t x_idx = (plane * in_h + ih) * in_w + iw;
+                        expected_y.at(y_idx) += weight * x.at(x_idx);
+                        expected_dx.at(x_idx) += weight * dy.at(y_idx);
+                      });
+      }
+    }
+  }
+
+  // dx is overwritten, not accumulated into
+  std::vector<float> y(y_shape.elem_cnt());
+  std::vector<float> dx(x_shape.elem_cnt(), 100);
+  if (bilinear) {
+    UpsampleCpuKernelUtil<float>::BilinearForward(d, true, height_scale, width_scale, x.data(),
+                                                  y.data());
+    UpsampleCpuKernelUtil<float>::BilinearBackward(d, true, height_scale, width_scale,
+                                                   dy.data(), dx.data());
+  } else {
+    UpsampleCpuKernelUtil<float>::NearestForward(d, true, height_scale, width_scale, x.data(),
+                                                 y.data());
+    UpsampleCpuKernelUtil<float>::NearestBackward(d, true, height_scale, width_scale, dy.data(),
+                                                  dx.data());
+  }
+  FOR_RANGE(int64_t, i, 0, y.size()) { ASSERT_NEAR(y.at(i), expected_y.at(i), 1e-5) << i; }
+  FOR_RANGE(int64_t, i, 0, dx.size()) { ASSERT_NEAR(dx.at(i), expected_dx.at(i), 1e-4) << i; }
+
+  // the channels_last layout has to agree with the channels_first one
+  const std::vector<float> nhwc_x = ToChannelsLast(n, c, in_h * in_w, x);
+  const std::vector<float> nhwc_dy = ToChannelsLast(n, c, out_h * out_w, dy);
+  const Shape nhwc_x_shape({n, in_h, in_w, c});
+  const Shape nhwc_y_shape({n, out_h, out_w, c});
+  const UpsampleDims nhwc_d(ShapeView(nhwc_x_shape), ShapeView(nhwc_y_shape), false);
+  std::vector<float> nhwc_y(y.size());
+  std::vector<float> nhwc_dx(dx.size(), 100);
+  if (bilinear) {
+    UpsampleCpuKernelUtil<float>::BilinearForward(nhwc_d, false, height_scale, width_scale,
+                                                  nhwc_x.data(), nhwc_y.data());
+    UpsampleCpuKernelUtil<float>::BilinearBackward(nhwc_d, false, height_scale, width_scale,
+                                                   nhwc_dy.data(), nhwc_dx.data());
+  } else {
+    UpsampleCpuKernelUtil<float>::NearestForward(nhwc_d, false, height_scale, width_scale,
+                                                 nhwc_x.data(), nhwc_y.data());
+    UpsampleCpuKernelUtil<float>::NearestBackward(nhwc_d, false, height_scale, width_scale,
+                                                  nhwc_dy.data(), nhwc_dx.data());
+  }
+  ASSERT_EQ(nhwc_y, ToChannelsLast(n, c, out_h * out_w, y));
+  const std::vector<float> nchw_dx = ToChannelsLast(n, c, in_h * in_w, dx);
+  FOR_RANGE(int64_t, i, 0, dx.size()) { ASSERT_NEAR(nhwc_dx.at(i), nchw_dx.at(i), 1e-5) << i; }
+}
+
+void CheckAll(bool bilinear) {
+  // (n, c, in_h, in_w, out_h, out_w), integer, fractional and shrinking scales
+  CheckUpsample(bilinear, 2, 3, 4, 5, 8, 10);
+  CheckUpsample(bilinear, 1, 2, 5, 3, 8, 9);
+  CheckUpsample(bilinear, 2, 3, 7, 6, 3, 4);
+  CheckUpsample(bilinear, 1, 1, 1, 1, 3, 2);
+  // more channels than one channels_last backward task takes
+  CheckUpsample(bilinear, 2, 70, 6, 5, 12, 15);
+}
+
+}  // namespace
+
+TEST(UpsampleCpuKernelUtil, nearest_forward_backward) {
+  CheckAll(false);
+  Global<ThreadPool>::New(4);
+  CheckAll(false);
+  CheckUpsample(false, 4, 16, 28, 28, 56, 56);
+  Global<ThreadPool>::Delete();
+}
+
+TEST(UpsampleCpuKernelUtil, bilinear_forward_backward) {
+  CheckAll(true);
+  Global<ThreadPool>::New(4);
+  CheckAll(true);
+  CheckUpsample(true, 4, 16, 28, 28, 56, 56);
+  Global<ThreadPool>::Delete();
+}
+
+}  // namespace test
+
+}  // namespace oneflow
@@ -0,0 +1,147 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/upsample_cpu_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+bool IsChannelsFirst(user_op::KernelComputeContext* ctx) {
+  const std::string& data_format = ctx->Attr<std::string>("data_format");
+  CHECK(data_format == "channels_first" || data_format == "channels_last");
+  return data_format == "channels_first";
+}
+
+}  // namespace
+
+template<typename T>
+class UpsampleNearestCPUKernel final : public user_op::OpKernel {
+ public:
+  UpsampleNearestCPUKernel() = default;
+  ~UpsampleNearestCPUKernel() = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x_blob = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y_blob = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const float height_scale = ctx->Attr<float>("height_scale");
+    const float width_scale = ctx->Attr<float>("width_scale");
+    const bool channels_first = IsChannelsFirst(ctx);
+    const UpsampleDims dims(x_blob->shape(), y_blob->shape(), channels_first);
+    UpsampleCpuKernelUtil<T>::NearestForward(dims, channels_first, height_scale, width_scale,
+                                             x_blob->dptr<T>(), y_blob->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class UpsampleNearestGradCPUKernel final : public user_op::OpKernel {
+ public:
+  UpsampleNearestGradCPUKernel() = default;
+  ~UpsampleNearestGradCPUKernel() = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* dx_blob = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    if (dx_blob == nullptr) { return; }
+    const user_op::Tensor* dy_blob = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const float height_scale = ctx->Attr<float>("height_scale");
+    const float width_scale = ctx->Attr<float>("width_scale");
+    const bool channels_first = IsChannelsFirst(ctx);
+    const UpsampleDims dims(dx_blob->shape(), dy_blob->shape(), channels_first);
+    UpsampleCpuKernelUtil<T>::NearestBackward(dims, channels_first, height_scale, width_scale,
+                                              dy_blob->dptr<T>(), dx_blob->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_UPSAMPLE_NEAREST_CPU_KERNEL(dtype)                                      \
+  REGISTER_USER_KERNEL("upsample")                                                       \
+      .SetCreateFn<UpsampleNearestCPUKernel<dtype>>()                                    \
+      .SetIsMatchedHob(                                                                  \
+          (user_op::HobDeviceTag() == "cpu")                                             \
+          & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value)                  \
+          & (user_op::HobAttr<std::string>("interpolation") == std::string("nearest"))); \
+  REGISTER_USER_KERNEL("upsample_grad")                                                  \
+      .SetCreateFn<UpsampleNearestGradCPUKernel<dtype>>()                                \
+      .SetIsMatchedHob(                                                                  \
+          (user_op::HobDeviceTag() == "cpu")                                             \
+          & (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value)                 \
+          & (user_op::HobAttr<std::string>("interpolation") == std::string("nearest")));
+
+REGISTER_UPSAMPLE_NEAREST_CPU_KERNEL(float)
+REGISTER_UPSAMPLE_NEAREST_CPU_KERNEL(double)
+
+template<typename T>
+class UpsampleBilinearCPUKernel final : public user_op::OpKernel {
+ public:
+  UpsampleBilinearCPUKernel() = default;
+  ~UpsampleBilinearCPUKernel() = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x_blob = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y_blob = ctx->Tensor4ArgNameAndIndex("y", 0);
+    const float height_scale = ctx->Attr<float>("height_scale");
+    const float width_scale = ctx->Attr<float>("width_scale");
+    const bool channels_first = IsChannelsFirst(ctx);
+    const UpsampleDims dims(x_blob->shape(), y_blob->shape(), channels_first);
+    UpsampleCpuKernelUtil<T>::BilinearForward(dims, channels_first, height_scale, width_scale,
+                                              x_blob->dptr<T>(), y_blob->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class UpsampleBilinearGradCPUKernel final : public user_op::OpKernel {
+ public:
+  UpsampleBilinearGradCPUKernel() = default;
+  ~UpsampleBilinearGradCPUKernel() = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    user_op::Tensor* dx_blob = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    if (dx_blob == nullptr) { return; }
+    const user_op::Tensor* dy_blob = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const float height_scale = ctx->Attr<float>("height_scale");
+    const float width_scale = ctx->Attr<float>("width_scale");
+    const bool channels_first = IsChannelsFirst(ctx);
+    const UpsampleDims dims(dx_blob->shape(), dy_blob->shape(), channels_first);
+    UpsampleCpuKernelUtil<T>::BilinearBackward(dims, channels_first, height_scale, width_scale,
+                                               dy_blob->dptr<T>(), dx_blob->mut_dptr<T>());
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_UPSAMPLE_BILINEAR_CPU_KERNEL(dtype)                                      \
+  REGISTER_USER_KERNEL("upsample")                                                        \
+      .SetCreateFn<UpsampleBilinearCPUKernel<dtype>>()                                    \
+      .SetIsMatchedHob(                                                                   \
+          (user_op::HobDeviceTag() == "cpu")                                              \
+          & (user_op::HobDataType("y", 0) == GetDataType<dtype>::value)                   \
+          & (user_op::HobAttr<std::string>("interpolation") == std::string("bilinear"))); \
+  REGISTER_USER_KERNEL("upsample_grad")                                                   \
+      .SetCreateFn<UpsampleBilinearGradCPUKernel<dtype>>()                                \
+      .SetIsMatchedHob(                                                                   \
+          (user_op::HobDeviceTag() == "cpu")                                              \
+          & (user_op::HobDataType("dx", 0) == GetDataType<dtype>::value)                  \
+          & (user_op::HobAttr<std::string>("interpolation") == std::string("bilinear")));
+
+REGISTER_UPSAMPLE_BILINEAR_CPU_KERNEL(float)
+REGISTER_UPSAMPLE_BILINEAR_CPU_KERNEL(double)
+
+}  // namespace oneflow
@@ -34,6 +34,9 @@ REGISTER_CPU_ONLY_USER_OP("COCOReader")
     .Attr<bool>("group_by_ratio", UserOpAttrType::kAtBool, true)
     .Attr<bool>("remove_images_without_annotations", UserOpAttrType::kAtBool, true)
     .Attr<bool>("stride_partition", UserOpAttrType::kAtBool, false)
+    .Attr<int32_t>("num_read_workers", UserOpAttrType::kAtInt32, 1)
+    .Attr<int32_t>("read_queue_depth", UserOpAttrType::kAtInt32, 64)
+    .Attr<bool>("read_keep_order", UserOpAttrType::kAtBool, true)
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       const SbpParallel& sbp = ctx->SbpParallel4ArgNameAndIndex("image", 0);
       CHECK_OR_RETURN(sbp == ctx->SbpParallel4ArgNameAndIndex("image_id", 0));
@@ -28,6 +28,11 @@ REGISTER_CPU_ONLY_USER_OP("OFRecordReader")
     .Attr<int64_t>("seed", UserOpAttrType::kAtInt64, -1)
     .Attr<int32_t>("shuffle_buffer_size", UserOpAttrType::kAtInt32, 1024)
     .Attr<bool>("shuffle_after_epoch", UserOpAttrType::kAtBool, false)
+    .Attr<bool>("use_index", UserOpAttrType::kAtBool, false)
+    .Attr<int32_t>("num_read_workers", UserOpAttrType::kAtInt32, 1)
+    .Attr<int32_t>("read_queue_depth", UserOpAttrType::kAtInt32, 64)
+    .Attr<bool>("read_keep_order", UserOpAttrType::kAtBool, true)
+    .Attr<int64_t>("resume_record_num", UserOpAttrType::kAtInt64, 0)
     .SetTensorDescInferFn([](user_op::InferContext* ctx) -> Maybe<void> {
       user_op::TensorDesc* out_tensor = ctx->TensorDesc4ArgNameAndIndex("out", 0);
       int32_t local_batch_size = ctx->Attr<int32_t>("batch_size");
@@ -29,13 +29,22 @@ REGISTER_USER_OP("upsample")
       user_op::TensorDesc* y_desc = ctx->TensorDesc4ArgNameAndIndex("y", 0);
       const float height_scale = ctx->Attr<float>("height_scale");
       const float width_scale = ctx->Attr<float>("width_scale");
-      if (ctx->Attr<std::string>("data_format") != "channels_first"
+      const std::string& data_format = ctx->Attr<std::string>("data_format");
+      if ((data_format != "channels_first" && data_format != "channels_last")
           || x_desc->shape().NumAxes() != 4) {
-        LOG(FATAL) << "upsample only supports NCHW";
+        LOG(FATAL) << "upsample only supports NCHW and NHWC";
+      }
+      const Shape& x_shape = x_desc->shape();
+      if (data_format == "channels_first") {
+        *y_desc->mut_shape() = Shape({x_shape.At(0), x_shape.At(1),
+                                      static_cast<int32_t>(height_scale) * x_shape.At(2),
+                                      static_cast<int32_t>(width_scale) * x_shape.At(3)});
+      } else {
+        *y_desc->mut_shape() = Shape({x_shape.At(0),
+                                      static_cast<int32_t>(height_scale) * x_shape.At(1),
+                                      static_cast<int32_t>(width_scale) * x_shape.At(2),
+                                      x_shape.At(3)});
       }
-      *y_desc->mut_shape() = Shape({x_desc->shape().At(0), x_desc->shape().At(1),
-                                    static_cast<int32_t>(height_scale) * x_desc->shape().At(2),
-                                    static_cast<int32_t>(width_scale) * x_desc->shape().At(3)});
       return Maybe<void>::Ok();
     })
     .SetBatchAxisInferFn([](user_op::BatchAxisContext* ctx) -> Maybe<void> {
@@ -59,12 +68,20 @@ REGISTER_USER_OP("upsample_grad")
       Shape* dx_shape = ctx->Shape4ArgNameAndIndex("dx", 0);
       const float height_scale = ctx->Attr<float>("height_scale");
       const float width_scale = ctx->Attr<float>("width_scale");
-      if (ctx->Attr<std::string>("data_format") != "channels_first" || dy_shape->NumAxes() != 4) {
-        LOG(FATAL) << "upsample_nearest only supports NCHW";
+      const std::string& data_format = ctx->Attr<std::string>("data_format");
+      if ((data_format != "channels_first" && data_format != "channels_last")
+          || dy_shape->NumAxes() != 4) {
+        LOG(FATAL) << "upsample_nearest only supports NCHW and NHWC";
+      }
+      if (data_format == "channels_first") {
+        *dx_shape = Shape({dy_shape->At(0), dy_shape->At(1),
+                           dy_shape->At(2) / static_cast<int32_t>(height_scale),
+                           dy_shape->At(3) / static_cast<int32_t>(width_scale)});
+      } else {
+        *dx_shape = Shape({dy_shape->At(0), dy_shape->At(1) / static_cast<int32_t>(height_scale),
+                           dy_shape->At(2) / static_cast<int32_t>(width_scale),
+                           dy_shape->At(3)});
       }
-      *dx_shape = Shape({dy_shape->At(0), dy_shape->At(1),
-                         dy_shape->At(2) / static_cast<int32_t>(height_scale),
-                         dy_shape->At(3) / static_cast<int32_t>(width_scale)});
       return Maybe<void>::Ok();
     })
     .SetGetSbpFn([](user_op::SbpContext* ctx) -> Maybe<void> {
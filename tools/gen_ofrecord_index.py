@@ -0,0 +1,33 @@
+import argparse
+import os
+import struct
+
+# Writes "part-0.index" beside every OFRecord part file "part-0": the offsets of the records as
+# native int64, one per record, which the OFRecordReader uses with use_index=True.
+
+parser = argparse.ArgumentParser()
+parser.add_argument("part_files", type=str, nargs="+")
+args = parser.parse_args()
+
+
+def gen_index(part_path):
+    offsets = []
+    part_size = os.path.getsize(part_path)
+    with open(part_path, "rb") as f:
+        offset = 0
+        while offset < part_size:
+            f.seek(offset)
+            (size,) = struct.unpack("=q", f.read(8))
+            assert size >= 0, "broken OFRecord part file: " + part_path
+            offsets.append(offset)
+            offset += 8 + size
+    assert offset == part_size, "broken OFRecord part file: " + part_path
+    tmp_path = part_path + ".index.tmp"
+    with open(tmp_path, "wb") as f:
+        f.write(struct.pack("={}q".format(len(offsets)), *offsets))
+    os.rename(tmp_path, part_path + ".index")
+    return len(offsets)
+
+
+for part_path in args.part_files:
+    print(part_path, gen_index(part_path))